@@ -1,5 +1,8 @@
 const std = @import("std");
+const builtin = @import("builtin");
 const stdx = @import("stdx");
+const graphics = @import("graphics");
+const Vec3 = stdx.math.Vec3;
 const t = stdx.testing;
 const fatal = stdx.fatal;
 const NullId = std.math.maxInt(u32);
@@ -10,6 +13,7 @@ const VoxelPt = world_.VoxelPt;
 const VoxelId = world_.VoxelId;
 const VoxelMaterial = world_.VoxelMaterial;
 const Voxel = world_.Voxel;
+const OctRegion = world_.OctRegion;
 pub const ChunkPt = stdx.math.Point3(i32);
 pub const OctRegionId = u32;
 pub const OctRegionOrVoxelId = u32;
@@ -19,7 +23,9 @@ const log = stdx.log.scoped(.chunks);
 pub fn Chunks(comptime ChunkSize: u32) type {
     return struct {
         pub const MaxDepth = std.math.log2(ChunkSize)-1;
-        var oct_path_buf: [MaxDepth+1]OctPathItem = undefined;
+        pub const SkipGrid = [ChunkSize*ChunkSize*ChunkSize]u8;
+        /// Chunks remeshed together are spread across threads once there are at least this many.
+        const MinParallelRemeshChunks = 4;
 
         inline fn voxelToChunkPt(pt: VoxelPt) ChunkPt {
             return ChunkPt.init(@divFloor(pt.x, ChunkSize), @divFloor(pt.y, ChunkSize), @divFloor(pt.z, ChunkSize));
@@ -88,10 +94,18 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             }
         }
 
-        /// Greedy meshing.
+        /// Greedy meshing. Regenerates the chunk's meshes in place on the calling thread.
         pub fn genChunkMeshes(world: *World, chunk: *Chunk) void {
+            const skip_grid = world.alloc.create(SkipGrid) catch fatal();
+            defer world.alloc.destroy(skip_grid);
             chunk.meshes.clearRetainingCapacity();
+            genChunkMeshesTo(world, chunk, skip_grid, &chunk.meshes);
+            chunk.instances_stale = true;
+        }
 
+        /// Greedy meshing into out. Only reads from world and chunk and uses skip_grid as scratch,
+        /// so multiple chunks can be meshed on different threads as long as voxels aren't modified.
+        fn genChunkMeshesTo(world: *const World, chunk: *const Chunk, skip_grid: *SkipGrid, out: *std.ArrayListUnmanaged(ChunkMesh)) void {
             // Check for no voxels case.
             if (chunk.is_voxel_mask == 0 and
                 chunk.children[0] == NullId and 
@@ -107,7 +121,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             }
 
             // The skip array indicates where the next x should begin to speed up iteration. When voxels are merged or empty voxel spaces are detected they update the relevant cells.
-            var skip_grid = std.mem.zeroes([ChunkSize*ChunkSize*ChunkSize]u8);
+            std.mem.set(u8, skip_grid, 0);
 
             // Main loop looking for a start point.
             var skip_idx: u32 = 0;
@@ -125,14 +139,14 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                         } else {
                             // Query voxel space.
                             const start_pt = VoxelPt.init(x, y, z);
-                            const res = getChunkVoxelBounds(world.*, chunk, start_pt);
+                            const res = getChunkVoxelBounds(world, chunk, start_pt);
                             if (!res.is_empty) {
                                 const last_x = x;
-                                x = expandVoxelMesh(world, chunk, &skip_grid, start_pt, res.end_pt, res.voxel_id);
+                                x = expandVoxelMesh(world, chunk, skip_grid, out, start_pt, res.end_pt, res.voxel_id);
                                 skip_idx += @intCast(u32, x - last_x);
                             } else {
                                 // Fill skip with empty space.
-                                fillSkipGrid(&skip_grid, start_pt, res.end_pt, @intCast(u8, res.end_pt.x));
+                                fillSkipGrid(skip_grid, start_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                                 const last_x = x;
                                 x = res.end_pt.x;
                                 skip_idx += @intCast(u32, x - last_x);
@@ -146,7 +160,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             }
         }
 
-        fn expandVoxelMesh(world: *World, chunk: *Chunk, skip_grid: *[ChunkSize*ChunkSize*ChunkSize]u8, start_pt: VoxelPt, end_pt: VoxelPt, voxel_id: VoxelId) i32 {
+        fn expandVoxelMesh(world: *const World, chunk: *const Chunk, skip_grid: *SkipGrid, out: *std.ArrayListUnmanaged(ChunkMesh), start_pt: VoxelPt, end_pt: VoxelPt, voxel_id: VoxelId) i32 {
             const mat_type = world.voxels.getNoCheck(voxel_id).mat_type;
 
             // Expand +x.
@@ -158,7 +172,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                     break;
                 }
                 const expand_pt = VoxelPt.init(x, start_pt.y, start_pt.z);
-                const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                const res = getChunkVoxelBounds(world, chunk, expand_pt);
                 if (res.is_empty) {
                     fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                     break;
@@ -184,7 +198,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                         break :b;
                     }
                     const expand_pt = VoxelPt.init(tx, start_pt.y, z);
-                    const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                    const res = getChunkVoxelBounds(world, chunk, expand_pt);
                     if (res.is_empty) {
                         fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                         expand_z_to_end = false;
@@ -214,7 +228,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                             break :b;
                         }
                         const expand_pt = VoxelPt.init(tx, start_pt.y, z);
-                        const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                        const res = getChunkVoxelBounds(world, chunk, expand_pt);
                         if (res.is_empty) {
                             fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                             break :b;
@@ -246,7 +260,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                             break :b;
                         }
                         const expand_pt = VoxelPt.init(tx, y, tz);
-                        const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                        const res = getChunkVoxelBounds(world, chunk, expand_pt);
                         if (res.is_empty) {
                             fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                             expand_y_to_end = false;
@@ -276,7 +290,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                                 break :b;
                             }
                             const expand_pt = VoxelPt.init(tx, y, tz);
-                            const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                            const res = getChunkVoxelBounds(world, chunk, expand_pt);
                             if (res.is_empty) {
                                 fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                                 expand_y_to_end = false;
@@ -310,7 +324,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                                 break :b;
                             }
                             const expand_pt = VoxelPt.init(tx, y, tz);
-                            const res = getChunkVoxelBounds(world.*, chunk, expand_pt);
+                            const res = getChunkVoxelBounds(world, chunk, expand_pt);
                             if (res.is_empty) {
                                 fillSkipGrid(skip_grid, expand_pt, res.end_pt, @intCast(u8, res.end_pt.x));
                                 break :b;
@@ -328,7 +342,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             }
 
             const mesh_end_pt = VoxelPt.init(x, y, z);
-            chunk.meshes.append(world.alloc, .{
+            out.append(world.alloc, .{
                 .start_pt = start_pt,
                 .end_pt = mesh_end_pt,
             }) catch fatal();
@@ -338,11 +352,247 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             return mesh_end_pt.x;
         }
 
+        /// Hierarchical visibility test against frustum. Returns true if a non empty octant of the chunk intersects it.
+        /// Descends at most max_depth levels into the octree. 0 only tests the chunk bounds.
+        pub fn isChunkVisible(world: *const World, chunk: *const Chunk, frustum: graphics.Frustum, voxel_size: f32, max_depth: u32) bool {
+            const min = toWorldPt(chunk.start_pt, voxel_size);
+            const max = toWorldPt(VoxelPt.init(chunk.start_pt.x + ChunkSize, chunk.start_pt.y + ChunkSize, chunk.start_pt.z + ChunkSize), voxel_size);
+            if (!frustum.intersectsAabb(min, max)) {
+                return false;
+            }
+            if (max_depth == 0) {
+                return true;
+            }
+            return isOctVisible(world, chunk.children, chunk.is_voxel_mask, chunk.start_pt, ChunkSize/2, frustum, voxel_size, max_depth);
+        }
+
+        fn isOctVisible(world: *const World, children: [8]OctRegionOrVoxelId, is_voxel_mask: u8, start_pt: VoxelPt, subregion_size: i32, frustum: graphics.Frustum, voxel_size: f32, depth: u32) bool {
+            inline for (idx_to_octant) |octant, i| {
+                const is_voxel = is_voxel_mask & @enumToInt(octant) > 0;
+                if (is_voxel or children[i] != NullId) {
+                    const pt = getNextStartPt(octant, start_pt, subregion_size);
+                    const min = toWorldPt(pt, voxel_size);
+                    const max = toWorldPt(VoxelPt.init(pt.x + subregion_size, pt.y + subregion_size, pt.z + subregion_size), voxel_size);
+                    if (frustum.intersectsAabb(min, max)) {
+                        // Stop at voxels, the depth limit, or leaf regions which only hold voxels.
+                        if (is_voxel or depth == 1 or subregion_size == 1) {
+                            return true;
+                        }
+                        const region = world.oct_regions.getNoCheck(children[i]);
+                        if (isOctVisible(world, region.children, region.is_voxel_mask, pt, subregion_size >> 1, frustum, voxel_size, depth - 1)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        inline fn toWorldPt(pt: VoxelPt, voxel_size: f32) Vec3 {
+            return Vec3.init(@intToFloat(f32, pt.x) * voxel_size, @intToFloat(f32, pt.y) * voxel_size, @intToFloat(f32, pt.z) * voxel_size);
+        }
+
+        /// Queues the chunk to be remeshed by the next remeshDirtyChunks.
+        fn markChunkDirty(world: *World, chunk_pt: ChunkPt, chunk: *Chunk) void {
+            chunk.unsaved = true;
+            if (!chunk.mesh_dirty) {
+                chunk.mesh_dirty = true;
+                world.dirty_chunks.append(world.alloc, chunk_pt) catch fatal();
+            }
+        }
+
+        /// Remeshes up to max_chunks dirty chunks, spreading them across the world's remesh pool.
+        /// Each chunk's new meshes are built separately and swapped into Chunk.meshes after every job finishes,
+        /// so readers never see a partially built mesh list. Voxels must not be modified while this runs,
+        /// so the calling thread takes jobs too and returns once the batch is done.
+        /// Returns the number of chunks remeshed.
+        pub fn remeshDirtyChunks(world: *World, max_chunks: usize) usize {
+            const num_chunks = std.math.min(world.dirty_chunks.items.len, max_chunks);
+            if (num_chunks == 0) {
+                return 0;
+            }
+
+            // Chunk pointers are resolved up front since no chunks are created until the jobs complete.
+            const jobs = world.alloc.alloc(RemeshJob, num_chunks) catch fatal();
+            defer world.alloc.free(jobs);
+            const pts = world.dirty_chunks.items[world.dirty_chunks.items.len - num_chunks..];
+            for (pts) |pt, i| {
+                jobs[i] = .{
+                    .chunk = world.chunks.getPtr(pt).?,
+                    .meshes = .{},
+                };
+            }
+
+            var ctx = RemeshContext{
+                .world = world,
+                .jobs = jobs,
+                .next_job = std.atomic.Atomic(usize).init(0),
+            };
+
+            if (world.remesh_pool == null) {
+                world.remesh_pool = RemeshPool.create(world.alloc);
+            }
+            const pool = world.remesh_pool.?;
+            if (pool.threads.len > 0 and num_chunks >= MinParallelRemeshChunks) {
+                pool.run(&ctx);
+            } else {
+                ctx.work(pool.main_skip_grid);
+            }
+
+            // Publish the new meshes.
+            for (jobs) |*job| {
+                std.mem.swap(std.ArrayListUnmanaged(ChunkMesh), &job.chunk.meshes, &job.meshes);
+                job.meshes.deinit(world.alloc);
+                job.chunk.mesh_dirty = false;
+                job.chunk.instances_stale = true;
+            }
+            world.dirty_chunks.shrinkRetainingCapacity(world.dirty_chunks.items.len - num_chunks);
+            return num_chunks;
+        }
+
+        const MaxRemeshThreads = 16;
+
+        const RemeshJob = struct {
+            chunk: *Chunk,
+            /// New meshes built by the worker.
+            meshes: std.ArrayListUnmanaged(ChunkMesh),
+        };
+
+        const RemeshContext = struct {
+            world: *const World,
+            jobs: []RemeshJob,
+            next_job: std.atomic.Atomic(usize),
+
+            fn work(self: *RemeshContext, skip_grid: *SkipGrid) void {
+                while (true) {
+                    const idx = self.next_job.fetchAdd(1, .Monotonic);
+                    if (idx >= self.jobs.len) {
+                        break;
+                    }
+                    const job = &self.jobs[idx];
+                    genChunkMeshesTo(self.world, job.chunk, skip_grid, &job.meshes);
+                }
+            }
+        };
+
+        /// Worker threads that live as long as the world and sleep until a batch of remesh jobs is submitted.
+        /// Each thread owns its skip grid.
+        pub const RemeshPool = struct {
+            alloc: std.mem.Allocator,
+            threads: []std.Thread,
+            main_skip_grid: *SkipGrid,
+
+            mutex: std.Thread.Mutex,
+            /// Signaled when a batch is submitted or the pool is shutting down.
+            batch_cond: std.Thread.Condition,
+            /// Signaled when the last worker finishes the current batch.
+            done_cond: std.Thread.Condition,
+            batch: ?*RemeshContext,
+            batch_gen: u32,
+            /// Workers that haven't finished the current batch.
+            num_active: u32,
+            quit: bool,
+
+            fn create(alloc: std.mem.Allocator) *RemeshPool {
+                const self = alloc.create(RemeshPool) catch fatal();
+                self.* = .{
+                    .alloc = alloc,
+                    .threads = &.{},
+                    .main_skip_grid = alloc.create(SkipGrid) catch fatal(),
+                    .mutex = .{},
+                    .batch_cond = .{},
+                    .done_cond = .{},
+                    .batch = null,
+                    .batch_gen = 0,
+                    .num_active = 0,
+                    .quit = false,
+                };
+                if (!builtin.single_threaded) {
+                    // The calling thread also takes jobs.
+                    const cpu_count = std.Thread.getCpuCount() catch 1;
+                    const num_workers = std.math.min(cpu_count, MaxRemeshThreads) - 1;
+                    self.threads = alloc.alloc(std.Thread, num_workers) catch fatal();
+                    var num_spawned: usize = 0;
+                    while (num_spawned < num_workers) : (num_spawned += 1) {
+                        self.threads[num_spawned] = std.Thread.spawn(.{}, workerLoop, .{ self }) catch break;
+                    }
+                    self.threads = alloc.shrink(self.threads, num_spawned);
+                }
+                return self;
+            }
+
+            pub fn destroy(self: *RemeshPool) void {
+                self.mutex.lock();
+                self.quit = true;
+                self.mutex.unlock();
+                self.batch_cond.broadcast();
+                for (self.threads) |thread| {
+                    thread.join();
+                }
+                self.alloc.free(self.threads);
+                self.alloc.destroy(self.main_skip_grid);
+                self.alloc.destroy(self);
+            }
+
+            /// Wakes the workers and takes jobs until the batch is done.
+            fn run(self: *RemeshPool, ctx: *RemeshContext) void {
+                self.mutex.lock();
+                self.batch = ctx;
+                self.batch_gen +%= 1;
+                self.num_active = @intCast(u32, self.threads.len);
+                self.mutex.unlock();
+                self.batch_cond.broadcast();
+
+                ctx.work(self.main_skip_grid);
+
+                self.mutex.lock();
+                defer self.mutex.unlock();
+                while (self.num_active > 0) {
+                    self.done_cond.wait(&self.mutex);
+                }
+                self.batch = null;
+            }
+
+            fn workerLoop(self: *RemeshPool) void {
+                const skip_grid = self.alloc.create(SkipGrid) catch fatal();
+                defer self.alloc.destroy(skip_grid);
+
+                self.mutex.lock();
+                defer self.mutex.unlock();
+                // Starts at the initial gen so a batch submitted before this thread first locks isn't missed.
+                var last_gen: u32 = 0;
+                while (true) {
+                    while (!self.quit and self.batch_gen == last_gen) {
+                        self.batch_cond.wait(&self.mutex);
+                    }
+                    if (self.quit) {
+                        return;
+                    }
+                    last_gen = self.batch_gen;
+                    const ctx = self.batch.?;
+
+                    self.mutex.unlock();
+                    ctx.work(skip_grid);
+                    self.mutex.lock();
+
+                    self.num_active -= 1;
+                    if (self.num_active == 0) {
+                        self.done_cond.signal();
+                    }
+                }
+            }
+        };
+
         pub fn getOrCreateChunk(self: *World, chunk_pt: ChunkPt) *Chunk {
             const chunk_res = self.chunks.getOrPut(chunk_pt) catch fatal();
             if (!chunk_res.found_existing) {
                 chunk_res.value_ptr.* = .{
                     .meshes = .{},
+                    .mesh_dirty = false,
+                    .instance_buf = null,
+                    .instances_stale = false,
+                    .unsaved = false,
+                    .last_used = 0,
                     .children = .{ NullId, NullId, NullId, NullId, NullId, NullId, NullId, NullId },
                     .is_voxel_mask = 0,
                     .start_pt = getChunkStartPt(chunk_pt),
@@ -351,7 +601,113 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             return chunk_res.value_ptr;
         }
 
-        fn fillSkipGrid(skip_grid: *[ChunkSize*ChunkSize*ChunkSize]u8, start_pt: VoxelPt, end_pt: VoxelPt, value: u8) void {
+        /// Serializes the chunk's octree in preorder. Each region is written as a mask of present children and a mask of voxel children,
+        /// followed by each present child in octant order: a material byte for a voxel or a nested region.
+        /// Regions merged by compressUpwards stay merged so uniform areas only take a few bytes.
+        pub fn encodeChunk(world: *const World, chunk: *const Chunk, out: *std.ArrayList(u8)) !void {
+            try encodeOct(world, chunk.children, chunk.is_voxel_mask, out);
+        }
+
+        fn encodeOct(world: *const World, children: [8]OctRegionOrVoxelId, is_voxel_mask: u8, out: *std.ArrayList(u8)) !void {
+            var present_mask: u8 = 0;
+            for (children) |child, i| {
+                if (child != NullId) {
+                    present_mask |= @enumToInt(idx_to_octant[i]);
+                }
+            }
+            try out.append(present_mask);
+            try out.append(is_voxel_mask);
+            for (children) |child, i| {
+                if (child == NullId) {
+                    continue;
+                }
+                if (is_voxel_mask & @enumToInt(idx_to_octant[i]) > 0) {
+                    try out.append(@enumToInt(world.voxels.getNoCheck(child).mat_type));
+                } else {
+                    const region = world.oct_regions.getNoCheck(child);
+                    try encodeOct(world, region.children, region.is_voxel_mask, out);
+                }
+            }
+        }
+
+        /// Creates a chunk from data written by encodeChunk and queues it for remeshing. The chunk must not exist.
+        pub fn decodeChunk(world: *World, chunk_pt: ChunkPt, data: []const u8) !*Chunk {
+            std.debug.assert(world.getChunk(chunk_pt) == null);
+            var children: [8]OctRegionOrVoxelId = undefined;
+            var is_voxel_mask: u8 = undefined;
+            var pos: usize = 0;
+            try decodeOct(world, data, &pos, MaxDepth, &children, &is_voxel_mask);
+            if (pos != data.len) {
+                freeOct(world, children, is_voxel_mask);
+                return error.InvalidChunkData;
+            }
+            const chunk = getOrCreateChunk(world, chunk_pt);
+            chunk.children = children;
+            chunk.is_voxel_mask = is_voxel_mask;
+            markChunkDirty(world, chunk_pt, chunk);
+            chunk.unsaved = false;
+            return chunk;
+        }
+
+        /// depth is the number of region levels allowed below this one.
+        fn decodeOct(world: *World, data: []const u8, pos: *usize, depth: u32, children: *[8]OctRegionOrVoxelId, is_voxel_mask: *u8) error{InvalidChunkData}!void {
+            if (pos.* + 2 > data.len) {
+                return error.InvalidChunkData;
+            }
+            const present_mask = data[pos.*];
+            const voxel_mask = data[pos.* + 1];
+            pos.* += 2;
+            // Children of leaf regions can only be voxels.
+            if (voxel_mask & ~present_mask != 0 or (depth == 0 and voxel_mask != present_mask)) {
+                return error.InvalidChunkData;
+            }
+            children.* = .{ NullId, NullId, NullId, NullId, NullId, NullId, NullId, NullId };
+            is_voxel_mask.* = voxel_mask;
+            errdefer freeOct(world, children.*, is_voxel_mask.*);
+            for (idx_to_octant) |octant, i| {
+                if (present_mask & @enumToInt(octant) == 0) {
+                    continue;
+                }
+                if (voxel_mask & @enumToInt(octant) > 0) {
+                    if (pos.* >= data.len) {
+                        return error.InvalidChunkData;
+                    }
+                    const mat_type = std.meta.intToEnum(VoxelMaterial, data[pos.*]) catch return error.InvalidChunkData;
+                    pos.* += 1;
+                    children[i] = world.voxels.add(.{ .mat_type = mat_type }) catch fatal();
+                } else {
+                    // Decode into a local since adding regions invalidates pointers into oct_regions.
+                    var region: OctRegion = undefined;
+                    try decodeOct(world, data, pos, depth - 1, &region.children, &region.is_voxel_mask);
+                    children[i] = world.oct_regions.add(region) catch fatal();
+                }
+            }
+        }
+
+        fn freeOct(world: *World, children: [8]OctRegionOrVoxelId, is_voxel_mask: u8) void {
+            for (children) |child, i| {
+                if (child == NullId) {
+                    continue;
+                }
+                if (is_voxel_mask & @enumToInt(idx_to_octant[i]) > 0) {
+                    world.voxels.remove(child);
+                } else {
+                    rremoveVoxelRegion(world, child);
+                }
+            }
+        }
+
+        /// Frees the chunk's octree and meshes and removes it from the world.
+        /// The chunk must not be waiting to be remeshed.
+        pub fn unloadChunk(world: *World, chunk_pt: ChunkPt) void {
+            const chunk = world.chunks.getPtr(chunk_pt) orelse return;
+            std.debug.assert(!chunk.mesh_dirty);
+            freeOct(world, chunk.children, chunk.is_voxel_mask);
+            chunk.deinit(world.alloc, world.gctx);
+            _ = world.chunks.remove(chunk_pt);
+        }
+
+        fn fillSkipGrid(skip_grid: *SkipGrid, start_pt: VoxelPt, end_pt: VoxelPt, value: u8) void {
             // TODO: don't fill the current x line since greedy mesh advances past end_pt.x.
             var skip_idx = @intCast(u32, start_pt.y * ChunkSize * ChunkSize + start_pt.z * ChunkSize + start_pt.x);
             var y = start_pt.y;
@@ -372,7 +728,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
         }
 
         /// pt is relative. Used by mesh generation.
-        fn getChunkVoxelBounds(world: World, chunk: *Chunk, pt: VoxelPt) ChunkVoxelBounds {
+        fn getChunkVoxelBounds(world: *const World, chunk: *const Chunk, pt: VoxelPt) ChunkVoxelBounds {
             var cur_pos = VoxelPt.init(0, 0, 0);
             var cur_subregion_size: i32 = ChunkSize/2; // i32 to avoid casting.
             var oct_res = getChildOct(cur_pos, cur_subregion_size, pt);
@@ -514,7 +870,9 @@ pub fn Chunks(comptime ChunkSize: u32) type {
         }
 
         pub fn fillVoxelRegion(world: *World, chunk_pt: ChunkPt, path: []const Octant, mat_type: VoxelMaterial) void {
+            world.finishPendingLoad(chunk_pt);
             const chunk = getOrCreateChunk(world, chunk_pt);
+            markChunkDirty(world, chunk_pt, chunk);
 
             if (path.len == 0) {
                 inline for (idx_to_octant) |octant, i| {
@@ -626,16 +984,20 @@ pub fn Chunks(comptime ChunkSize: u32) type {
 
         pub fn setVoxel(world: *World, pt: VoxelPt, mat_type: VoxelMaterial) void {
             const chunk_pt = voxelToChunkPt(pt);
+            world.finishPendingLoad(chunk_pt);
             const chunk = getOrCreateChunk(world, chunk_pt);
 
-            const path = setVoxelDownward(world, chunk, chunk_pt, pt, mat_type);
+            var path_buf: [MaxDepth+1]OctPathItem = undefined;
+            const path = setVoxelDownward(world, chunk, chunk_pt, pt, mat_type, &path_buf);
             if (path.len == MaxDepth+1) {
                 world.compressUpwards(chunk, path);
             }
+            markChunkDirty(world, chunk_pt, chunk);
         }
 
         /// Set's the voxel at a position but doesn't perform the upward optimize step.
-        fn setVoxelDownward(self: *World, chunk: *Chunk, chunk_pt: ChunkPt, pt: VoxelPt, mat_type: VoxelMaterial) []const OctPathItem {
+        /// Returns the octree path to the voxel which is stored in path_buf.
+        fn setVoxelDownward(self: *World, chunk: *Chunk, chunk_pt: ChunkPt, pt: VoxelPt, mat_type: VoxelMaterial, path_buf: *[MaxDepth+1]OctPathItem) []const OctPathItem {
             // First index from chunk root.
             var cur_pos = VoxelPt.init(chunk_pt.x * ChunkSize, chunk_pt.y * ChunkSize, chunk_pt.z * ChunkSize);
             var cur_subregion_size: i32 = ChunkSize/2; // i32 to avoid casting.
@@ -654,11 +1016,11 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                 } else {
                     // At leaf subregion. Just update the voxel.
                     self.voxels.getPtrNoCheck(voxel_id).mat_type = mat_type;
-                    oct_path_buf[0] = .{
+                    path_buf[0] = .{
                         .item_id = voxel_id,
                         .oct_idx = oct_res.oct_idx,
                     };
-                    return oct_path_buf[0..1];
+                    return path_buf[0..1];
                 }
             } else {
                 if (chunk.children[oct_res.oct_idx] == NullId) {
@@ -666,11 +1028,11 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                         // At leaf region. Add voxel.
                         chunk.children[oct_res.oct_idx] = self.voxels.add(.{ .mat_type = mat_type }) catch fatal();
                         chunk.is_voxel_mask |= @enumToInt(octant);
-                        oct_path_buf[0] = .{
+                        path_buf[0] = .{
                             .item_id = chunk.children[oct_res.oct_idx],
                             .oct_idx = oct_res.oct_idx,
                         };
-                        return oct_path_buf[0..1];
+                        return path_buf[0..1];
                     } else {
                         // Create subregion.
                         chunk.children[oct_res.oct_idx] = self.oct_regions.add(.{
@@ -682,7 +1044,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             }
 
             var cur_region_id = chunk.children[oct_res.oct_idx];
-            oct_path_buf[0] = .{
+            path_buf[0] = .{
                 .item_id = cur_region_id,
                 .oct_idx = oct_res.oct_idx,
             };
@@ -714,11 +1076,11 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                     } else {
                         // At leaf subregion. Just update the voxel.
                         self.voxels.getPtrNoCheck(voxel_id).mat_type = mat_type;
-                        oct_path_buf[path_idx] = .{
+                        path_buf[path_idx] = .{
                             .item_id = voxel_id,
                             .oct_idx = oct_res.oct_idx,
                         };
-                        return oct_path_buf[0..path_idx+1];
+                        return path_buf[0..path_idx+1];
                     }
                 } else {
                     if (next_subregion_id == NullId) {
@@ -733,7 +1095,7 @@ pub fn Chunks(comptime ChunkSize: u32) type {
                 }
 
                 cur_region_id = next_subregion_id;
-                oct_path_buf[path_idx] = .{
+                path_buf[path_idx] = .{
                     .item_id = cur_region_id,
                     .oct_idx = oct_res.oct_idx,
                 };
@@ -749,18 +1111,18 @@ pub fn Chunks(comptime ChunkSize: u32) type {
             if (voxel_id == NullId) {
                 subregion.children[oct_idx] = self.voxels.add(.{ .mat_type = mat_type }) catch fatal();
                 subregion.is_voxel_mask |= @enumToInt(octant);
-                oct_path_buf[path_idx] = .{
+                path_buf[path_idx] = .{
                     .item_id = subregion.children[oct_idx],
                     .oct_idx = oct_idx,
                 };
-                return oct_path_buf[0..path_idx+1];
+                return path_buf[0..path_idx+1];
             } else {
                 self.voxels.getPtrNoCheck(voxel_id).mat_type = mat_type;
-                oct_path_buf[path_idx] = .{
+                path_buf[path_idx] = .{
                     .item_id = voxel_id,
                     .oct_idx = oct_idx,
                 };
-                return oct_path_buf[0..path_idx+1];
+                return path_buf[0..path_idx+1];
             }
 
             // Select voxel.
@@ -986,21 +1348,162 @@ test "genChunkMeshes" {
     try t.eq(chunk.meshes.items[2].end_pt, VoxelPt.init(8, 1, 8));
 }
 
+test "remeshDirtyChunks" {
+    var world = World.init(t.alloc);
+    defer world.deinit();
+
+    // Edits queue each chunk once.
+    TestChunks.setVoxel(&world, VoxelPt.init(4, 4, 4), .Block);
+    TestChunks.setVoxel(&world, VoxelPt.init(5, 4, 4), .Block);
+    var i: i32 = 0;
+    while (i < 8) : (i += 1) {
+        TestChunks.setVoxel(&world, VoxelPt.init(i * 8, 0, 0), .Block);
+    }
+    try t.eq(world.dirty_chunks.items.len, 8);
+
+    try t.eq(TestChunks.remeshDirtyChunks(&world, 2), 2);
+    try t.eq(world.dirty_chunks.items.len, 6);
+    try t.eq(TestChunks.remeshDirtyChunks(&world, std.math.maxInt(usize)), 6);
+    try t.eq(world.dirty_chunks.items.len, 0);
+
+    const chunk = world.getChunk(ChunkPt.init(0, 0, 0)).?;
+    try t.eq(chunk.mesh_dirty, false);
+    try t.eq(chunk.meshes.items.len, 2);
+    i = 1;
+    while (i < 8) : (i += 1) {
+        const other = world.getChunk(ChunkPt.init(i, 0, 0)).?;
+        try t.eq(other.meshes.items.len, 1);
+        try t.eq(other.meshes.items[0].start_pt, VoxelPt.init(0, 0, 0));
+        try t.eq(other.meshes.items[0].end_pt, VoxelPt.init(1, 1, 1));
+    }
+}
+
+test "isChunkVisible" {
+    var world = World.init(t.alloc);
+    defer world.deinit();
+
+    // Only the bottom of the chunk has voxels.
+    TestChunks.setVoxel(&world, VoxelPt.init(4, 0, 4), .Block);
+    const chunk = world.getChunk(ChunkPt.init(0, 0, 0)).?;
+
+    // Narrow view through the top of the chunk.
+    var cam: graphics.Camera = undefined;
+    cam.initPerspective3D(10, 1, 0.1, 1000);
+    cam.setRotation(0, 0);
+    const eye = Vec3.init(4, 7.5, 4).add(cam.forward_nvec.mul(-12));
+    cam.setPos(eye.x, eye.y, eye.z);
+    var frustum = cam.computeFrustum();
+
+    // The chunk bounds are in view but its voxels are not.
+    try t.eq(TestChunks.isChunkVisible(&world, chunk, frustum, 1, 0), true);
+    try t.eq(TestChunks.isChunkVisible(&world, chunk, frustum, 1, 3), false);
+
+    // Lower the view to the voxel.
+    cam.setPos(eye.x, 0.5, eye.z);
+    frustum = cam.computeFrustum();
+    try t.eq(TestChunks.isChunkVisible(&world, chunk, frustum, 1, 3), true);
+}
+
+test "encodeChunk, decodeChunk" {
+    var world = World.init(t.alloc);
+    defer world.deinit();
+
+    // A 2x2x2 block that gets merged and a lone voxel.
+    var x: i32 = 0;
+    while (x < 2) : (x += 1) {
+        var y: i32 = 0;
+        while (y < 2) : (y += 1) {
+            var z: i32 = 0;
+            while (z < 2) : (z += 1) {
+                TestChunks.setVoxel(&world, VoxelPt.init(x, y, z), .Block);
+            }
+        }
+    }
+    TestChunks.setVoxel(&world, VoxelPt.init(5, 6, 7), .Block);
+    _ = TestChunks.remeshDirtyChunks(&world, std.math.maxInt(usize));
+
+    var buf = std.ArrayList(u8).init(t.alloc);
+    defer buf.deinit();
+    try TestChunks.encodeChunk(&world, world.getChunk(ChunkPt.init(0, 0, 0)).?, &buf);
+
+    TestChunks.unloadChunk(&world, ChunkPt.init(0, 0, 0));
+    try t.eq(world.getChunk(ChunkPt.init(0, 0, 0)) == null, true);
+    try t.eq(world.voxels.size(), 0);
+    try t.eq(world.oct_regions.size(), 0);
+
+    const chunk = try TestChunks.decodeChunk(&world, ChunkPt.init(0, 0, 0), buf.items);
+    try t.eq(chunk.unsaved, false);
+    try t.eq(chunk.mesh_dirty, true);
+    try t.eq(TestChunks.getVoxel(world, VoxelPt.init(1, 1, 1)).?.mat_type, .Block);
+    try t.eq(TestChunks.getVoxel(world, VoxelPt.init(5, 6, 7)).?.mat_type, .Block);
+    try t.eq(TestChunks.getVoxel(world, VoxelPt.init(3, 3, 3)) == null, true);
+
+    // Encodes to the same bytes.
+    var buf2 = std.ArrayList(u8).init(t.alloc);
+    defer buf2.deinit();
+    try TestChunks.encodeChunk(&world, chunk, &buf2);
+    try t.eqSlice(u8, buf2.items, buf.items);
+
+    // Truncated data is rejected without leaking voxels.
+    const num_voxels = world.voxels.size();
+    try t.expectError(TestChunks.decodeChunk(&world, ChunkPt.init(1, 0, 0), buf.items[0..buf.items.len-1]), error.InvalidChunkData);
+    try t.eq(world.getChunk(ChunkPt.init(1, 0, 0)) == null, true);
+    try t.eq(world.voxels.size(), num_voxels);
+}
+
+test "Edits wait for a pending chunk load" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const path = try tmp.dir.realpathAlloc(t.alloc, ".");
+    defer t.alloc.free(path);
+
+    var world = World.initOpts(t.alloc, .{ .save_dir = path });
+    TestChunks.setVoxel(&world, VoxelPt.init(0, 0, 0), .Block);
+    world.deinit();
+
+    world = World.initOpts(t.alloc, .{ .save_dir = path });
+    defer world.deinit();
+    const pt = ChunkPt.init(0, 0, 0);
+    world.pending_loads.put(t.alloc, pt, {}) catch fatal();
+    world.store.?.requestLoad(pt);
+
+    // The edit is applied on top of the saved voxels.
+    TestChunks.setVoxel(&world, VoxelPt.init(1, 0, 0), .Block);
+    try t.eq(world.pending_loads.contains(pt), false);
+    try t.eq(TestChunks.getVoxel(world, VoxelPt.init(0, 0, 0)).?.mat_type, .Block);
+    try t.eq(TestChunks.getVoxel(world, VoxelPt.init(1, 0, 0)).?.mat_type, .Block);
+}
+
 pub const Chunk = struct {
     /// Generated meshes for rendering.
     meshes: std.ArrayListUnmanaged(ChunkMesh),
+    /// Whether the chunk is queued in World.dirty_chunks for remeshing.
+    mesh_dirty: bool,
+
+    /// Gpu buffer of render instances built from meshes. Rebuilt by the world when stale.
+    instance_buf: ?graphics.CuboidBufferId,
+    instances_stale: bool,
+
+    /// Whether the voxels changed since the chunk was loaded or saved.
+    unsaved: bool,
+    /// Frame the chunk was last in view or near the camera. Used to pick chunks to unload.
+    last_used: u32,
 
     start_pt: VoxelPt,
 
     children: [8]OctRegionOrVoxelId,
     is_voxel_mask: u8,
 
-    pub fn deinit(self: *Chunk, alloc: std.mem.Allocator) void {
+    /// gctx is the context that created the instance buffer. Can be null if the chunk was never drawn.
+    pub fn deinit(self: *Chunk, alloc: std.mem.Allocator, gctx: ?*graphics.Graphics) void {
         self.meshes.deinit(alloc);
+        if (self.instance_buf) |buf_id| {
+            gctx.?.removeCuboidBuffer(buf_id);
+        }
     }
 };
 
-const ChunkMesh = struct {
+pub const ChunkMesh = struct {
     // Far bottom left.
     start_pt: VoxelPt,
     // Near top right. Exclusive.
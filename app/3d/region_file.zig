@@ -0,0 +1,373 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const stdx = @import("stdx");
+const t = stdx.testing;
+const fatal = stdx.fatal;
+const log = stdx.log.scoped(.region_file);
+
+const ChunkPt = @import("chunks.zig").ChunkPt;
+pub const RegionPt = stdx.math.Point3(i32);
+
+/// Chunks per region along each axis.
+pub const RegionSize = 8;
+const NumRegionChunks = RegionSize * RegionSize * RegionSize;
+const Magic = "CSRG";
+const Version: u32 = 1;
+const HeaderSize = 12 + NumRegionChunks * @sizeOf(Entry);
+
+/// Keep a small number of region files open on the io thread.
+const MaxOpenRegions = 32;
+
+const Entry = extern struct {
+    offset: u32,
+    /// 0 if the chunk was never saved.
+    len: u32,
+};
+
+/// Groups RegionSize^3 chunks into one file named "r.x.y.z" so a world doesn't need a file per chunk.
+/// Layout, little endian:
+///   magic: [4]u8, version: u32, chunk_size: u32
+///   entries: [RegionSize^3]Entry
+///   chunk data...
+/// A rewritten chunk is stored in place if it fits, otherwise it's appended. The old space isn't reclaimed.
+pub const RegionFile = struct {
+    file: std.fs.File,
+    entries: [NumRegionChunks]Entry,
+    end_pos: u64,
+
+    /// Returns null if the region file doesn't exist and create is false.
+    pub fn open(dir: std.fs.Dir, region_pt: RegionPt, chunk_size: u32, create: bool) !?RegionFile {
+        var name_buf: [64]u8 = undefined;
+        const name = std.fmt.bufPrint(&name_buf, "r.{}.{}.{}", .{ region_pt.x, region_pt.y, region_pt.z }) catch unreachable;
+        const file = dir.openFile(name, .{ .mode = .read_write }) catch |err| switch (err) {
+            error.FileNotFound => {
+                if (!create) {
+                    return null;
+                }
+                const new_file = try dir.createFile(name, .{ .read = true, .truncate = false, .exclusive = true });
+                errdefer new_file.close();
+                var ret = RegionFile{
+                    .file = new_file,
+                    .entries = std.mem.zeroes([NumRegionChunks]Entry),
+                    .end_pos = HeaderSize,
+                };
+                var header: [12]u8 = undefined;
+                std.mem.copy(u8, header[0..4], Magic);
+                std.mem.writeIntLittle(u32, header[4..8], Version);
+                std.mem.writeIntLittle(u32, header[8..12], chunk_size);
+                try new_file.pwriteAll(&header, 0);
+                try new_file.pwriteAll(std.mem.sliceAsBytes(&ret.entries), 12);
+                return ret;
+            },
+            else => return err,
+        };
+        errdefer file.close();
+
+        var header: [12]u8 = undefined;
+        if (try file.preadAll(&header, 0) != header.len) {
+            return error.InvalidRegionFile;
+        }
+        if (!std.mem.eql(u8, header[0..4], Magic) or std.mem.readIntLittle(u32, header[4..8]) != Version) {
+            return error.InvalidRegionFile;
+        }
+        if (std.mem.readIntLittle(u32, header[8..12]) != chunk_size) {
+            return error.ChunkSizeMismatch;
+        }
+        var ret = RegionFile{
+            .file = file,
+            .entries = undefined,
+            .end_pos = try file.getEndPos(),
+        };
+        const entry_bytes = std.mem.sliceAsBytes(&ret.entries);
+        if (try file.preadAll(entry_bytes, 12) != entry_bytes.len) {
+            return error.InvalidRegionFile;
+        }
+        if (builtin.cpu.arch.endian() == .Big) {
+            for (ret.entries) |*entry| {
+                entry.offset = @byteSwap(u32, entry.offset);
+                entry.len = @byteSwap(u32, entry.len);
+            }
+        }
+        return ret;
+    }
+
+    pub fn close(self: RegionFile) void {
+        self.file.close();
+    }
+
+    /// Returns null if the chunk was never saved. Caller owns the returned memory.
+    pub fn readChunk(self: RegionFile, alloc: std.mem.Allocator, chunk_pt: ChunkPt) !?[]u8 {
+        const entry = self.entries[getLocalIdx(chunk_pt)];
+        if (entry.len == 0) {
+            return null;
+        }
+        const buf = try alloc.alloc(u8, entry.len);
+        errdefer alloc.free(buf);
+        if (try self.file.preadAll(buf, entry.offset) != buf.len) {
+            return error.InvalidRegionFile;
+        }
+        return buf;
+    }
+
+    pub fn writeChunk(self: *RegionFile, chunk_pt: ChunkPt, data: []const u8) !void {
+        const idx = getLocalIdx(chunk_pt);
+        var entry = self.entries[idx];
+        if (data.len > entry.len) {
+            entry.offset = @intCast(u32, self.end_pos);
+            self.end_pos += data.len;
+        }
+        entry.len = @intCast(u32, data.len);
+        // Write the data before the entry so a crash doesn't leave the entry pointing at garbage.
+        try self.file.pwriteAll(data, entry.offset);
+        var entry_buf: [8]u8 = undefined;
+        std.mem.writeIntLittle(u32, entry_buf[0..4], entry.offset);
+        std.mem.writeIntLittle(u32, entry_buf[4..8], entry.len);
+        try self.file.pwriteAll(&entry_buf, 12 + idx * @sizeOf(Entry));
+        self.entries[idx] = entry;
+    }
+};
+
+pub fn toRegionPt(chunk_pt: ChunkPt) RegionPt {
+    return RegionPt.init(@divFloor(chunk_pt.x, RegionSize), @divFloor(chunk_pt.y, RegionSize), @divFloor(chunk_pt.z, RegionSize));
+}
+
+fn getLocalIdx(chunk_pt: ChunkPt) u32 {
+    const x = @intCast(u32, @mod(chunk_pt.x, RegionSize));
+    const y = @intCast(u32, @mod(chunk_pt.y, RegionSize));
+    const z = @intCast(u32, @mod(chunk_pt.z, RegionSize));
+    return (y * RegionSize + z) * RegionSize + x;
+}
+
+pub const LoadResult = struct {
+    chunk_pt: ChunkPt,
+    /// Encoded chunk owned by the receiver. Null if the chunk isn't saved or couldn't be read.
+    data: ?[]u8,
+};
+
+const Request = union(enum) {
+    load: ChunkPt,
+    save: struct {
+        chunk_pt: ChunkPt,
+        data: []u8,
+    },
+    flush: *std.Thread.ResetEvent,
+    close: void,
+};
+
+/// Reads and writes chunks in region files on a dedicated io thread.
+/// Requests are processed in order so a load after a save sees the saved data.
+/// The store only moves bytes, encoding and decoding chunks is left to the main thread which owns the world.
+pub const RegionStore = struct {
+    alloc: std.mem.Allocator,
+    dir: std.fs.Dir,
+    chunk_size: u32,
+    /// Whether the directory had region files when the store was opened.
+    has_regions: bool,
+
+    /// Only accessed by the io thread.
+    open_regions: std.AutoHashMapUnmanaged(RegionPt, RegionFile),
+
+    requests: std.atomic.Queue(Request),
+    loaded: std.atomic.Queue(LoadResult),
+    wakeup: std.Thread.ResetEvent,
+    thread: ?std.Thread,
+
+    /// Creates the directory at path if it doesn't exist.
+    /// Heap allocated since the io thread keeps a pointer to it.
+    pub fn init(alloc: std.mem.Allocator, path: []const u8, chunk_size: u32) !*RegionStore {
+        const new = try alloc.create(RegionStore);
+        errdefer alloc.destroy(new);
+        new.* = .{
+            .alloc = alloc,
+            .dir = try std.fs.cwd().makeOpenPath(path, .{}),
+            .chunk_size = chunk_size,
+            .has_regions = false,
+            .open_regions = .{},
+            .requests = std.atomic.Queue(Request).init(),
+            .loaded = std.atomic.Queue(LoadResult).init(),
+            .wakeup = undefined,
+            .thread = null,
+        };
+        errdefer new.dir.close();
+        var iter_dir = try std.fs.cwd().openIterableDir(path, .{});
+        defer iter_dir.close();
+        var iter = iter_dir.iterate();
+        while (try iter.next()) |entry| {
+            if (entry.kind == .File and std.mem.startsWith(u8, entry.name, "r.")) {
+                new.has_regions = true;
+                break;
+            }
+        }
+        new.wakeup.reset();
+        if (!builtin.single_threaded) {
+            new.thread = std.Thread.spawn(.{}, loop, .{ new }) catch |err| b: {
+                log.warn("Failed to spawn region io thread, using blocking io: {}", .{err});
+                break :b null;
+            };
+        }
+        return new;
+    }
+
+    /// Finishes pending requests before closing.
+    pub fn deinit(self: *RegionStore) void {
+        if (self.thread) |thread| {
+            self.putRequest(.close);
+            thread.join();
+        }
+        while (self.loaded.get()) |node| {
+            if (node.data.data) |data| {
+                self.alloc.free(data);
+            }
+            self.alloc.destroy(node);
+        }
+        var iter = self.open_regions.valueIterator();
+        while (iter.next()) |region| {
+            region.close();
+        }
+        self.open_regions.deinit(self.alloc);
+        self.dir.close();
+        self.alloc.destroy(self);
+    }
+
+    pub fn requestLoad(self: *RegionStore, chunk_pt: ChunkPt) void {
+        self.putRequest(.{ .load = chunk_pt });
+    }
+
+    /// Takes ownership of data which must be allocated with the store's allocator.
+    pub fn requestSave(self: *RegionStore, chunk_pt: ChunkPt, data: []u8) void {
+        self.putRequest(.{ .save = .{ .chunk_pt = chunk_pt, .data = data } });
+    }
+
+    /// Returns the next completed load. The caller frees LoadResult.data with the store's allocator.
+    pub fn pollLoaded(self: *RegionStore) ?LoadResult {
+        const node = self.loaded.get() orelse return null;
+        defer self.alloc.destroy(node);
+        return node.data;
+    }
+
+    /// Blocks until every request made so far is processed.
+    pub fn flush(self: *RegionStore) void {
+        var done: std.Thread.ResetEvent = undefined;
+        done.reset();
+        self.putRequest(.{ .flush = &done });
+        done.wait();
+    }
+
+    fn putRequest(self: *RegionStore, req: Request) void {
+        if (self.thread == null) {
+            // Blocking io.
+            _ = self.process(req);
+            return;
+        }
+        const node = self.alloc.create(std.atomic.Queue(Request).Node) catch fatal();
+        node.data = req;
+        self.requests.put(node);
+        self.wakeup.set();
+    }
+
+    fn loop(self: *RegionStore) void {
+        while (true) {
+            while (self.requests.get()) |node| {
+                const req = node.data;
+                self.alloc.destroy(node);
+                if (!self.process(req)) {
+                    return;
+                }
+            }
+            // Wait until the next request is added.
+            self.wakeup.wait();
+            self.wakeup.reset();
+        }
+    }
+
+    /// Returns false after a close request.
+    fn process(self: *RegionStore, req: Request) bool {
+        switch (req) {
+            .load => |chunk_pt| {
+                const data = self.readChunk(chunk_pt) catch |err| b: {
+                    log.warn("Failed to load chunk {}: {}", .{ chunk_pt, err });
+                    break :b null;
+                };
+                const node = self.alloc.create(std.atomic.Queue(LoadResult).Node) catch fatal();
+                node.data = .{
+                    .chunk_pt = chunk_pt,
+                    .data = data,
+                };
+                self.loaded.put(node);
+            },
+            .save => |save| {
+                defer self.alloc.free(save.data);
+                self.writeChunk(save.chunk_pt, save.data) catch |err| {
+                    log.warn("Failed to save chunk {}: {}", .{ save.chunk_pt, err });
+                };
+            },
+            .flush => |done| {
+                done.set();
+            },
+            .close => return false,
+        }
+        return true;
+    }
+
+    fn readChunk(self: *RegionStore, chunk_pt: ChunkPt) !?[]u8 {
+        const region = (try self.getRegion(toRegionPt(chunk_pt), false)) orelse return null;
+        return region.readChunk(self.alloc, chunk_pt);
+    }
+
+    fn writeChunk(self: *RegionStore, chunk_pt: ChunkPt, data: []const u8) !void {
+        const region = (try self.getRegion(toRegionPt(chunk_pt), true)).?;
+        try region.writeChunk(chunk_pt, data);
+    }
+
+    fn getRegion(self: *RegionStore, region_pt: RegionPt, create: bool) !?*RegionFile {
+        if (self.open_regions.getPtr(region_pt)) |region| {
+            return region;
+        }
+        const region = (try RegionFile.open(self.dir, region_pt, self.chunk_size, create)) orelse return null;
+        errdefer region.close();
+        if (self.open_regions.count() >= MaxOpenRegions) {
+            // Close any region to make room.
+            var iter = self.open_regions.iterator();
+            const entry = iter.next().?;
+            entry.value_ptr.close();
+            _ = self.open_regions.remove(entry.key_ptr.*);
+        }
+        const res = try self.open_regions.getOrPut(self.alloc, region_pt);
+        res.value_ptr.* = region;
+        return res.value_ptr;
+    }
+};
+
+test "RegionStore" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const path = try tmp.dir.realpathAlloc(t.alloc, ".");
+    defer t.alloc.free(path);
+
+    var store = try RegionStore.init(t.alloc, path, 32);
+    store.requestSave(ChunkPt.init(0, 0, 0), try t.alloc.dupe(u8, "abc"));
+    store.requestSave(ChunkPt.init(-1, 2, 9), try t.alloc.dupe(u8, "defg"));
+    // Rewrite in place.
+    store.requestSave(ChunkPt.init(0, 0, 0), try t.alloc.dupe(u8, "xy"));
+    store.deinit();
+
+    // Reopen and load.
+    store = try RegionStore.init(t.alloc, path, 32);
+    defer store.deinit();
+    try t.eq(store.has_regions, true);
+    store.requestLoad(ChunkPt.init(0, 0, 0));
+    store.requestLoad(ChunkPt.init(-1, 2, 9));
+    store.requestLoad(ChunkPt.init(1, 0, 0));
+    store.flush();
+
+    var res = store.pollLoaded().?;
+    try t.eq(res.chunk_pt, ChunkPt.init(0, 0, 0));
+    try t.eqStr(res.data.?, "xy");
+    t.alloc.free(res.data.?);
+    res = store.pollLoaded().?;
+    try t.eqStr(res.data.?, "defg");
+    t.alloc.free(res.data.?);
+    res = store.pollLoaded().?;
+    try t.eq(res.data == null, true);
+    try t.eq(store.pollLoaded() == null, true);
+}
@@ -22,6 +22,8 @@ const OctPathItem = chunks.OctPathItem;
 const Chunk = chunks.Chunk;
 const ChunkPt = chunks.ChunkPt;
 const Chunks = chunks.Chunks(ChunkSize);
+const RegionStore = @import("region_file.zig").RegionStore;
+const RegionLoadResult = @import("region_file.zig").LoadResult;
 pub const VoxelId = u32;
 
 pub const VoxelMaterial = enum(u1) {
@@ -46,35 +48,90 @@ pub const Voxel = struct {
 /// 5 - far top right
 /// 6 - near top left
 /// 7 - near top right
-const OctRegion = struct {
+pub const OctRegion = struct {
     children: [8]OctRegionOrVoxelId,
     /// Each bit indicates whether the corresponding child is a voxel id or a subregion id.
     is_voxel_mask: u8,
 };
 
+pub const WorldOptions = struct {
+    /// Number of physics worker threads. Null uses one less than the number of cpus.
+    physics_threads: ?u32 = null,
+    /// Chunks and objects beyond this distance from the camera are not drawn. Also bounded by the camera's far plane.
+    draw_distance: f32 = std.math.inf(f32),
+    /// Octree levels to descend when a chunk's bounds are partially in view. 0 only tests the chunk bounds.
+    cull_octree_depth: u32 = 2,
+    /// Directory for region files. Null keeps every chunk in memory and nothing is saved.
+    save_dir: ?[]const u8 = null,
+    /// Saved chunks within this many chunks of the camera are loaded and kept loaded.
+    stream_radius: u32 = 4,
+    /// Chunks outside the stream radius are unloaded, least recently used first, while voxel memory exceeds this.
+    max_voxel_mem: usize = 256 * 1024 * 1024,
+    /// Limits the number of chunks requested and decoded each frame.
+    max_chunk_loads_per_frame: u32 = 32,
+};
+
+/// Draw submissions from the last World.update.
+pub const CullStats = struct {
+    chunks_submitted: u32 = 0,
+    chunks_culled: u32 = 0,
+    objects_submitted: u32 = 0,
+    objects_culled: u32 = 0,
+};
+
 pub const World = struct {
     alloc: std.mem.Allocator,
     objects: stdx.ds.DenseHandleList(u32, WorldObject, false),
 
     // Voxels.
     chunks: std.AutoHashMap(ChunkPt, Chunk),
+    /// Chunks with voxel edits that haven't been remeshed yet.
+    dirty_chunks: std.ArrayListUnmanaged(ChunkPt),
+    /// Created with the first remesh.
+    remesh_pool: ?*Chunks.RemeshPool,
     oct_regions: stdx.ds.PooledHandleList(OctRegionId, OctRegion),
     voxels: stdx.ds.PooledHandleList(VoxelId, Voxel),
     gen_mesh_start_buf: std.PriorityQueue(chunks.MeshStartPt, void, chunks.compareStartPt), // Only used for experimental mesh generation algo.
 
+    // Culling.
+    draw_distance: f32,
+    cull_octree_depth: u32,
+    cull_stats: CullStats,
+
+    // Streaming. Only used with WorldOptions.save_dir.
+    store: ?*RegionStore,
+    stream_radius: u32,
+    max_voxel_mem: usize,
+    max_chunk_loads_per_frame: u32,
+    /// Chunks requested from the store that haven't been received yet.
+    pending_loads: std.AutoHashMapUnmanaged(ChunkPt, void),
+    /// Chunks the store doesn't have so they aren't requested again.
+    missing_chunks: std.AutoHashMapUnmanaged(ChunkPt, void),
+    frame: u32,
+
+    // Rendering.
+    /// Context that owns the chunk instance buffers. Set by update.
+    gctx: ?*graphics.Graphics,
+    /// Reused to build a chunk's instances before uploading them.
+    tmp_instances: std.ArrayListUnmanaged(graphics.CuboidInstance),
+
     // Physics.
     physics_sys: jolt.PhysicsSystem,
     body_iface: jolt.BodyInterface,
     bp_layer_iface: jolt.BPLayerInterfaceImpl,
     temp_alloc: *jolt.TempAllocator,
     job_sys: jolt.JobSystem,
-    bodies: std.ArrayList(jolt.BodyId),
+    body_states: jolt.BodyStates,
 
     const WorldToPhysicsScale = 0.5;
     const PhysicsToWorldScale = 1 / WorldToPhysicsScale;
     pub var inited_jolt = false;
 
     pub fn init(alloc: std.mem.Allocator) World {
+        return initOpts(alloc, .{});
+    }
+
+    pub fn initOpts(alloc: std.mem.Allocator, opts: WorldOptions) World {
         var ret = World{
             .alloc = alloc,
             .objects = stdx.ds.DenseHandleList(u32, WorldObject, false).init(alloc),
@@ -83,17 +140,37 @@ pub const World = struct {
             .bp_layer_iface = undefined,
             .temp_alloc = undefined,
             .job_sys = undefined,
-            .bodies = undefined,
+            .body_states = undefined,
             .chunks = std.AutoHashMap(ChunkPt, Chunk).init(alloc),
+            .dirty_chunks = .{},
+            .remesh_pool = null,
             .oct_regions = stdx.ds.PooledHandleList(OctRegionId, OctRegion).init(alloc),
             .voxels = stdx.ds.PooledHandleList(VoxelId, Voxel).init(alloc),
             .gen_mesh_start_buf = std.PriorityQueue(chunks.MeshStartPt, void, chunks.compareStartPt).init(alloc, {}),
+            .draw_distance = opts.draw_distance,
+            .cull_octree_depth = opts.cull_octree_depth,
+            .cull_stats = .{},
+            .store = null,
+            .stream_radius = opts.stream_radius,
+            .max_voxel_mem = opts.max_voxel_mem,
+            .max_chunk_loads_per_frame = opts.max_chunk_loads_per_frame,
+            .pending_loads = .{},
+            .missing_chunks = .{},
+            .frame = 0,
+            .gctx = null,
+            .tmp_instances = .{},
         };
-        ret.initPhysics(alloc);
+        if (opts.save_dir) |dir| {
+            ret.store = RegionStore.init(alloc, dir, ChunkSize) catch |err| b: {
+                log.warn("Failed to open save dir {s}: {}", .{ dir, err });
+                break :b null;
+            };
+        }
+        ret.initPhysics(alloc, opts);
         return ret;
     }
 
-    pub fn initPhysics(self: *World, alloc: std.mem.Allocator) void {
+    pub fn initPhysics(self: *World, alloc: std.mem.Allocator, opts: WorldOptions) void {
         if (!inited_jolt) {
             jolt.init();
             inited_jolt = true;
@@ -104,58 +181,39 @@ pub const World = struct {
         const max_contact_constraints = 10240;
         self.bp_layer_iface = jolt.BPLayerInterfaceImpl.init();
 
-        const S = struct {
-            /// Function that determines if two broadphase layers can collide
-            fn broadPhaseCanCollide(layer1: jolt.ObjectLayer, layer2_: jolt.BroadPhaseLayer) bool {
-                const layer2 = layer2_.mValue;
-                switch (layer1) {
-                    jolt.Layers.NonMoving => return layer2 == jolt.BroadPhaseLayers.Moving,
-                    jolt.Layers.Moving => return layer2 == jolt.BroadPhaseLayers.NonMoving or layer2 == jolt.BroadPhaseLayers.Moving or layer2 == jolt.BroadPhaseLayers.Sensor,
-                    jolt.Layers.Debris => return layer2 == jolt.BroadPhaseLayers.NonMoving,
-                    jolt.Layers.Sensor => return layer2 == jolt.BroadPhaseLayers.Moving,
-                    jolt.Layers.Unused1,
-                    jolt.Layers.Unused2,
-                    jolt.Layers.Unused3,
-                    jolt.Layers.Unused4 => return false,
-                    else => unreachable,
-                }
-            }
-            /// Function that determines if two object layers can collide
-            fn objectCanCollide(obj1: jolt.ObjectLayer, obj2: jolt.ObjectLayer) bool {
-                switch (obj1) {
-                    jolt.Layers.Unused1,
-                    jolt.Layers.Unused2,
-                    jolt.Layers.Unused3,
-                    jolt.Layers.Unused4 => return false,
-                    jolt.Layers.NonMoving => return obj2 == jolt.Layers.Moving or obj2 == jolt.Layers.Debris,
-                    jolt.Layers.Moving => return obj2 == jolt.Layers.NonMoving or obj2 == jolt.Layers.Moving or obj2 == jolt.Layers.Sensor,
-                    jolt.Layers.Debris => return obj2 == jolt.Layers.NonMoving,
-                    jolt.Layers.Sensor => return obj2 == jolt.Layers.Moving,
-                    else => unreachable,
-                }
-            }
-        };
-        self.physics_sys = jolt.PhysicsSystem.init(max_bodies, num_body_mutexes, max_body_pairs, max_contact_constraints, self.bp_layer_iface.handle, S.broadPhaseCanCollide, S.objectCanCollide);
+        self.physics_sys = jolt.PhysicsSystem.init(max_bodies, num_body_mutexes, max_body_pairs, max_contact_constraints, self.bp_layer_iface.handle, jolt.defaultBroadPhaseCanCollide, jolt.defaultObjectCanCollide);
         self.temp_alloc = jolt.initTempAllocatorImpl(20 * 1024 * 1024);
-        self.job_sys = jolt.JobSystem.initThreadPool(2048, 8, 1);
-        self.bodies = std.ArrayList(jolt.BodyId).init(alloc);
+        self.job_sys = jolt.JobSystem.initThreadPool(2048, 8, opts.physics_threads);
+        self.body_states = jolt.BodyStates.init(alloc);
         self.body_iface = self.physics_sys.getBodyInterface();
     }
 
     pub fn deinit(self: *World) void {
         self.objects.deinit();
 
+        if (self.store) |store| {
+            self.saveChunks();
+            store.deinit();
+        }
+        self.pending_loads.deinit(self.alloc);
+        self.missing_chunks.deinit(self.alloc);
+
         var iter = self.chunks.valueIterator();
         while (iter.next()) |chunk| {
-            chunk.deinit(self.alloc);
+            chunk.deinit(self.alloc, self.gctx);
         }
         self.chunks.deinit();
+        self.tmp_instances.deinit(self.alloc);
+        self.dirty_chunks.deinit(self.alloc);
+        if (self.remesh_pool) |pool| {
+            pool.destroy();
+        }
         self.oct_regions.deinit();
         self.voxels.deinit();
         self.gen_mesh_start_buf.deinit();
 
         // Physics
-        self.bodies.deinit();
+        self.body_states.deinit();
         self.job_sys.deinitJobSystemThreadPool();
         jolt.deinitTempAllocatorImpl(self.temp_alloc);
         self.bp_layer_iface.deinit();
@@ -184,12 +242,176 @@ pub const World = struct {
                 }
             }
         }
+        _ = Chunks.remeshDirtyChunks(self, std.math.maxInt(usize));
+    }
+
+    /// Whether the save dir already had chunks when the world was created, eg. to skip generating terrain.
+    pub fn hasSavedChunks(self: World) bool {
+        if (self.store) |store| {
+            return store.has_regions;
+        } else return false;
+    }
+
+    /// Queues every chunk that changed since it was loaded or saved to be written to the save dir.
+    pub fn saveChunks(self: *World) void {
+        const store = self.store orelse return;
+        var iter = self.chunks.iterator();
+        while (iter.next()) |entry| {
+            if (entry.value_ptr.unsaved) {
+                self.saveChunk(store, entry.key_ptr.*, entry.value_ptr);
+            }
+        }
+    }
+
+    fn saveChunk(self: *World, store: *RegionStore, chunk_pt: ChunkPt, chunk: *Chunk) void {
+        var buf = std.ArrayList(u8).init(self.alloc);
+        Chunks.encodeChunk(self, chunk, &buf) catch fatal();
+        store.requestSave(chunk_pt, buf.toOwnedSlice());
+        chunk.unsaved = false;
+        _ = self.missing_chunks.remove(chunk_pt);
+    }
+
+    /// Receives chunks loaded by the store, requests saved chunks around center and unloads chunks over the memory budget.
+    fn streamChunks(self: *World, center: Vec3) void {
+        const store = self.store orelse return;
+        self.frame += 1;
+
+        var num_loaded: u32 = 0;
+        while (num_loaded < self.max_chunk_loads_per_frame) : (num_loaded += 1) {
+            const res = store.pollLoaded() orelse break;
+            self.receiveLoadedChunk(res);
+        }
+
+        // Request chunks around the center.
+        const radius = @intCast(i32, self.stream_radius);
+        const center_pt = toChunkPt(center);
+        if (self.missing_chunks.count() > MaxMissingChunksPerStreamVolume * self.stream_radius * self.stream_radius * self.stream_radius) {
+            // Forget empty chunks that were likely passed a while ago.
+            self.missing_chunks.clearRetainingCapacity();
+        }
+        var num_requested: u32 = 0;
+        var x = center_pt.x - radius;
+        while (x <= center_pt.x + radius) : (x += 1) {
+            var y = center_pt.y - radius;
+            while (y <= center_pt.y + radius) : (y += 1) {
+                var z = center_pt.z - radius;
+                while (z <= center_pt.z + radius) : (z += 1) {
+                    const pt = ChunkPt.init(x, y, z);
+                    if (self.chunks.getPtr(pt)) |chunk| {
+                        chunk.last_used = self.frame;
+                        continue;
+                    }
+                    if (num_requested == self.max_chunk_loads_per_frame or self.pending_loads.contains(pt) or self.missing_chunks.contains(pt)) {
+                        continue;
+                    }
+                    self.pending_loads.put(self.alloc, pt, {}) catch fatal();
+                    store.requestLoad(pt);
+                    num_requested += 1;
+                }
+            }
+        }
+
+        self.unloadChunksOverBudget(store, center_pt);
+    }
+
+    fn receiveLoadedChunk(self: *World, res: RegionLoadResult) void {
+        _ = self.pending_loads.remove(res.chunk_pt);
+        if (res.data) |data| {
+            defer self.alloc.free(data);
+            // Edits wait for pending loads so the chunk should only exist if it was created some other way.
+            if (self.getChunk(res.chunk_pt) != null) {
+                log.warn("Discarding saved chunk {} that was already created.", .{ res.chunk_pt });
+                return;
+            }
+            const chunk = Chunks.decodeChunk(self, res.chunk_pt, data) catch |err| {
+                log.warn("Failed to decode chunk {}: {}", .{ res.chunk_pt, err });
+                return;
+            };
+            chunk.last_used = self.frame;
+        } else {
+            self.missing_chunks.put(self.alloc, res.chunk_pt, {}) catch fatal();
+        }
+    }
+
+    /// Called before an edit creates a chunk. If the chunk is still loading, this blocks until the store
+    /// returns it so the edit applies to the saved voxels instead of an empty chunk that would overwrite them on the next save.
+    /// Other loads that completed in the meantime are also received.
+    pub fn finishPendingLoad(self: *World, chunk_pt: ChunkPt) void {
+        if (!self.pending_loads.contains(chunk_pt)) {
+            return;
+        }
+        const store = self.store.?;
+        store.flush();
+        while (store.pollLoaded()) |res| {
+            self.receiveLoadedChunk(res);
+        }
+    }
+
+    fn unloadChunksOverBudget(self: *World, store: *RegionStore, center_pt: ChunkPt) void {
+        var mesh_mem: usize = 0;
         var iter = self.chunks.valueIterator();
         while (iter.next()) |chunk| {
-            Chunks.genChunkMeshes(self, chunk);
+            mesh_mem += getChunkMeshMemSize(chunk);
+        }
+        if (self.getOctreeMemSize() + mesh_mem <= self.max_voxel_mem) {
+            return;
+        }
+
+        const Candidate = struct {
+            chunk_pt: ChunkPt,
+            last_used: u32,
+
+            fn lessThan(_: void, a: @This(), b: @This()) bool {
+                return a.last_used < b.last_used;
+            }
+        };
+        var candidates = std.ArrayList(Candidate).init(self.alloc);
+        defer candidates.deinit();
+        const radius = @intCast(i32, self.stream_radius);
+        var entry_iter = self.chunks.iterator();
+        while (entry_iter.next()) |entry| {
+            const pt = entry.key_ptr.*;
+            const dx = pt.x - center_pt.x;
+            const dy = pt.y - center_pt.y;
+            const dz = pt.z - center_pt.z;
+            const far = dx < -radius or dx > radius or dy < -radius or dy > radius or dz < -radius or dz > radius;
+            // Chunks waiting to be remeshed are recently edited and referenced by dirty_chunks.
+            if (far and !entry.value_ptr.mesh_dirty) {
+                candidates.append(.{ .chunk_pt = pt, .last_used = entry.value_ptr.last_used }) catch fatal();
+            }
+        }
+        std.sort.sort(Candidate, candidates.items, {}, Candidate.lessThan);
+
+        for (candidates.items) |candidate| {
+            const chunk = self.chunks.getPtr(candidate.chunk_pt).?;
+            if (chunk.unsaved) {
+                self.saveChunk(store, candidate.chunk_pt, chunk);
+            }
+            mesh_mem -= getChunkMeshMemSize(chunk);
+            Chunks.unloadChunk(self, candidate.chunk_pt);
+            if (self.getOctreeMemSize() + mesh_mem <= self.max_voxel_mem) {
+                break;
+            }
         }
     }
 
+    /// Estimated memory held by loaded chunks excluding their meshes.
+    fn getOctreeMemSize(self: World) usize {
+        return self.chunks.count() * @sizeOf(Chunk) + self.oct_regions.size() * @sizeOf(OctRegion) + self.voxels.size() * @sizeOf(Voxel);
+    }
+
+    fn getChunkMeshMemSize(chunk: *const Chunk) usize {
+        return chunk.meshes.capacity * @sizeOf(chunks.ChunkMesh);
+    }
+
+    fn toChunkPt(pos: Vec3) ChunkPt {
+        return ChunkPt.init(
+            @floatToInt(i32, @floor(pos.x / ChunkWorldSize)),
+            @floatToInt(i32, @floor(pos.y / ChunkWorldSize)),
+            @floatToInt(i32, @floor(pos.z / ChunkWorldSize)),
+        );
+    }
+
     pub fn getChunk(self: World, chunk_pt: ChunkPt) ?*Chunk {
         return self.chunks.getPtr(chunk_pt) orelse return null;
     }
@@ -205,9 +427,10 @@ pub const World = struct {
 
         var iter = self.chunks.valueIterator();
         while (iter.next()) |chunk| {
-            chunk.deinit(self.alloc);
+            chunk.deinit(self.alloc, self.gctx);
         }
         self.chunks.clearRetainingCapacity();
+        self.dirty_chunks.clearRetainingCapacity();
     }
 
     /// Goes up the octree path and reduces equal voxels. Should only be done when the voxel was inserted in a leaf oct region.
@@ -274,55 +497,84 @@ pub const World = struct {
         body.setUserData(eid);
     }
 
+    /// Converts the chunk's meshes into render instances and uploads them. Only needed after the chunk is remeshed.
+    fn buildChunkInstances(self: *World, gctx: *graphics.Graphics, chunk: *Chunk) void {
+        const material = graphics.Material.initAlbedoColor(Color.Green);
+        self.tmp_instances.clearRetainingCapacity();
+        self.tmp_instances.ensureTotalCapacity(self.alloc, chunk.meshes.items.len) catch fatal();
+        for (chunk.meshes.items) |mesh| {
+            const extent = Vec3.init(
+                VoxelSize * @intToFloat(f32, mesh.end_pt.x - mesh.start_pt.x),
+                VoxelSize * @intToFloat(f32, mesh.end_pt.y - mesh.start_pt.y),
+                VoxelSize * @intToFloat(f32, mesh.end_pt.z - mesh.start_pt.z),
+            );
+            const start = VoxelPt.init(chunk.start_pt.x + mesh.start_pt.x, chunk.start_pt.y + mesh.start_pt.y, chunk.start_pt.z + mesh.start_pt.z);
+            self.tmp_instances.appendAssumeCapacity(.{
+                .pos = Vec3.init(
+                    VoxelSize * @intToFloat(f32, start.x) + extent.x * 0.5,
+                    VoxelSize * @intToFloat(f32, start.y) + extent.y * 0.5,
+                    VoxelSize * @intToFloat(f32, start.z) + extent.z * 0.5,
+                ),
+                .extent = extent,
+                .material = material,
+            });
+        }
+        if (chunk.instance_buf) |buf_id| {
+            gctx.updateCuboidBuffer(buf_id, self.tmp_instances.items);
+        } else {
+            chunk.instance_buf = gctx.createCuboidBuffer(self.tmp_instances.items);
+        }
+        chunk.instances_stale = false;
+    }
+
     pub fn setLinearVelocity(self: *World, eid: EntityId, vel: Vec3) void {
         const obj = self.objects.get(eid).?;
         self.body_iface.setLinearVelocity(obj.body_id, vel.mul(WorldToPhysicsScale));
     }
 
-    pub fn update(self: *World, delta_ms: f32, gctx: *graphics.Graphics) void {
-        self.bodies.resize(self.physics_sys.getNumActiveBodies()) catch fatal();
-        if (self.bodies.items.len > 0) {
-            self.physics_sys.getActiveBodies(self.bodies.items);
-        }
+    pub fn update(self: *World, delta_ms: f32, gctx: *graphics.Graphics, cam: graphics.Camera) void {
+        self.gctx = gctx;
         self.physics_sys.update(delta_ms * 0.001, 1, 1, self.temp_alloc, self.job_sys);
 
-        const body_iface = self.physics_sys.getBodyLockInterfaceNoLock();
-        for (self.bodies.items) |body_id| {
-            const body = body_iface.tryGetBody(body_id) catch fatal();
-            // Sync physics position to world.
-            const eid = @intCast(EntityId, body.getUserData());
+        // Sync physics position to world.
+        self.physics_sys.getActiveBodyStates(&self.body_states);
+        const states = self.body_states;
+        var i: usize = 0;
+        while (i < states.len) : (i += 1) {
+            const eid = @intCast(EntityId, states.user_data[i]);
             const obj = self.objects.getPtr(eid).?;
-            obj.pos = body.getPosition().mul(PhysicsToWorldScale);
-            obj.rot = body.getRotation();
+            obj.pos = states.getPosition(i).mul(PhysicsToWorldScale);
+            obj.rot = states.getRotation(i);
         }
 
+        self.streamChunks(cam.world_pos);
+
+        // Remesh a bounded number of edited chunks per frame.
+        _ = Chunks.remeshDirtyChunks(self, MaxRemeshChunksPerFrame);
+
+        self.cull_stats = .{};
+        const far = std.math.min(cam.far, self.draw_distance);
+        const frustum = cam.computeFrustumFar(far);
+
         // Draw terrain.
-        const material = graphics.Material.initAlbedoColor(Color.Green);
-        var chunk_x: i32 = -3;
-        var voxels: u32 = 0;
-        while (chunk_x < 3) : (chunk_x += 1) {
-            var chunk_y: i32 = -3;
-            while (chunk_y < 3) : (chunk_y += 1) {
-                var chunk_z: i32 = -3;
-                while (chunk_z < 3) : (chunk_z += 1) {
-                    if (self.chunks.get(ChunkPt.init(chunk_x, chunk_y, chunk_z))) |chunk| {
-                        for (chunk.meshes.items) |mesh| {
-                            var xform = Transform.initIdentity();
-                            const width = VoxelSize * @intToFloat(f32, mesh.end_pt.x - mesh.start_pt.x);
-                            const height = VoxelSize * @intToFloat(f32, mesh.end_pt.y - mesh.start_pt.y);
-                            const depth = VoxelSize * @intToFloat(f32, mesh.end_pt.z - mesh.start_pt.z);
-                            const start_x = chunk_x * ChunkSize + mesh.start_pt.x;
-                            const start_y = chunk_y * ChunkSize + mesh.start_pt.y;
-                            const start_z = chunk_z * ChunkSize + mesh.start_pt.z;
-                            xform.scale3D(width, height, depth);
-                            xform.translate3D(
-                                VoxelSize * @intToFloat(f32, start_x) + width * 0.5,
-                                VoxelSize * @intToFloat(f32, start_y) + height * 0.5,
-                                VoxelSize * @intToFloat(f32, start_z) + depth * 0.5,
-                            );
-                            voxels += 1;
-                            gctx.drawCuboidPbr3D(xform, material);
-                            // log.debug("draw voxel {}", .{voxels});
+        // Visit the chunks within draw distance or every chunk if that's fewer.
+        const max_span = 64;
+        const span = if (far < ChunkWorldSize * max_span) @floatToInt(u32, @ceil(2 * far / ChunkWorldSize)) + 1 else std.math.maxInt(u32);
+        if (span > max_span or span * span * span > self.chunks.count()) {
+            var iter = self.chunks.valueIterator();
+            while (iter.next()) |chunk| {
+                self.drawChunkCulled(gctx, frustum, chunk);
+            }
+        } else {
+            const min_pt = toChunkPt(cam.world_pos.add3(-far, -far, -far));
+            var chunk_x: i32 = min_pt.x;
+            while (chunk_x < min_pt.x + @intCast(i32, span)) : (chunk_x += 1) {
+                var chunk_y: i32 = min_pt.y;
+                while (chunk_y < min_pt.y + @intCast(i32, span)) : (chunk_y += 1) {
+                    var chunk_z: i32 = min_pt.z;
+                    while (chunk_z < min_pt.z + @intCast(i32, span)) : (chunk_z += 1) {
+                        if (self.chunks.getPtr(ChunkPt.init(chunk_x, chunk_y, chunk_z))) |chunk| {
+                            self.drawChunkCulled(gctx, frustum, chunk);
                         }
                     }
                 }
@@ -331,16 +583,43 @@ pub const World = struct {
 
         // TODO: Draw objects.
         for (self.objects.items()) |obj| {
+            // Bounding sphere of the rotated cuboid.
+            const radius = obj.scale.length() * 0.5;
+            if (!frustum.intersectsSphere(obj.pos, radius)) {
+                self.cull_stats.objects_culled += 1;
+                continue;
+            }
             var xform = Transform.initIdentity();
             xform.scale3D(obj.scale.x, obj.scale.y, obj.scale.z);
             xform.rotateQuat(obj.rot);
             xform.translate3D(obj.pos.x, obj.pos.y, obj.pos.z);
             gctx.drawCuboidPbr3D(xform, graphics.Material.initAlbedoColor(Color.Gray));
+            self.cull_stats.objects_submitted += 1;
+        }
+    }
+
+    fn drawChunkCulled(self: *World, gctx: *graphics.Graphics, frustum: graphics.Frustum, chunk: *Chunk) void {
+        if (chunk.meshes.items.len == 0) {
+            return;
+        }
+        if (!Chunks.isChunkVisible(self, chunk, frustum, VoxelSize, self.cull_octree_depth)) {
+            self.cull_stats.chunks_culled += 1;
+            return;
+        }
+        chunk.last_used = self.frame;
+        if (chunk.instances_stale) {
+            self.buildChunkInstances(gctx, chunk);
         }
+        gctx.drawCuboidsPbr3D(chunk.instance_buf.?);
+        self.cull_stats.chunks_submitted += 1;
     }
 };
 
 const VoxelSize = 20;
+const ChunkWorldSize = @intToFloat(f32, ChunkSize * VoxelSize);
+/// Bounds the missing chunk set relative to the stream volume.
+const MaxMissingChunksPerStreamVolume = 64;
+const MaxRemeshChunksPerFrame = 64;
 
 const WorldObjectType = enum(u1) {
     Cuboid = 0,
@@ -198,7 +198,9 @@ pub fn main() !void {
     const alloc = app.alloc;
     const gctx = app.gctx;
 
-    world = World.init(alloc);
+    world = World.initOpts(alloc, .{
+        .save_dir = "3d-world",
+    });
     defer world.deinit();
 
     // Floor.
@@ -209,7 +211,10 @@ pub fn main() !void {
     world.addCuboid(Vec3.init(0, 20, 5), Vec3.init(5, 5, 5), Quaternion.initRotation(Vec3.UnitZ, 0.25 * std.math.pi), false);
     world.addCuboid(Vec3.init(0, 20, 0), Vec3.init(5, 5, 5), Quaternion.initRotation(Vec3.UnitX, 0.25 * std.math.pi).mul(Quaternion.initRotation(Vec3.UnitZ, 0.25 * std.math.pi)), false);
 
-    world.genTerrain();
+    // Saved chunks stream in around the camera.
+    if (!world.hasSavedChunks()) {
+        world.genTerrain();
+    }
 
     ui_mod.init(alloc, app.gctx);
     ui_mod.addInputHandlers(&app.dispatcher);
@@ -346,7 +351,7 @@ fn update(delta_ms: f32) void {
     brainstem_mesh.update(delta_ms*0.5);
     gctx.drawAnimatedMeshPbr3D(xform, brainstem_mesh);
 
-    world.update(delta_ms, gctx);
+    world.update(delta_ms, gctx, main_cam);
 
     gctx.drawPlane();
 
@@ -359,6 +364,8 @@ fn update(delta_ms: f32) void {
     gctx.fillTextFmt(10, 730, "forward: ({d:.1},{d:.1},{d:.1})", .{main_cam.forward_nvec.x, main_cam.forward_nvec.y, main_cam.forward_nvec.z});
     gctx.fillTextFmt(10, 750, "up: ({d:.1},{d:.1},{d:.1})", .{main_cam.up_nvec.x, main_cam.up_nvec.y, main_cam.up_nvec.z});
     gctx.fillTextFmt(10, 770, "right: ({d:.1},{d:.1},{d:.1})", .{main_cam.right_nvec.x, main_cam.right_nvec.y, main_cam.right_nvec.z});
+    const stats = world.cull_stats;
+    gctx.fillTextFmt(10, 790, "chunks: {} drawn, {} culled  objects: {} drawn, {} culled", .{stats.chunks_submitted, stats.chunks_culled, stats.objects_submitted, stats.objects_culled});
     const ui_width = @intToFloat(f32, app.win.getWidth());
     const ui_height = @intToFloat(f32, app.win.getHeight());
     ui_mod.updateAndRender(delta_ms, {}, buildRoot, ui_width, ui_height) catch unreachable;
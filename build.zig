@@ -229,6 +229,32 @@ pub fn build(b: *Builder) !void {
     // const test_jolt = jolt.createTest(b, target, mode, .{ .multi_threaded = false }).run();
     b.step("test-jolt", "Test jolt library.").dependOn(&test_jolt.step);
 
+    {
+        // Runs the physics benchmark with jolt built for both configurations. Pass -Darg to set [num_bodies] [num_steps] [num_threads].
+        const step = b.addLog("", .{});
+        const run_baseline = jolt.createBench(b, target, mode, .{ .multi_threaded = false, .enable_simd = false }).run();
+        run_baseline.addArgs(args);
+        const run = jolt.createBench(b, target, mode, .{}).run();
+        run.addArgs(args);
+        run.step.dependOn(&run_baseline.step);
+        step.step.dependOn(&run.step);
+        b.step("bench-jolt", "Benchmark headless jolt physics, single threaded scalar vs multithreaded simd.").dependOn(&step.step);
+    }
+
+    {
+        // Pass -Darg to set [width] [height] [iterations] [font_path].
+        const run = graphics.createBench(b, target, mode).run();
+        run.addArgs(args);
+        b.step("bench-raster", "Benchmark the headless cpu rasterizer, reports triangles/sec and glyphs/sec.").dependOn(&run.step);
+    }
+
+    {
+        // Pass -Darg to set [iterations] [font_path].
+        const run = graphics.createTextBench(b, target, mode).run();
+        run.addArgs(args);
+        b.step("bench-text", "Benchmark utf8 decoding and glyph lookup, reports glyphs/sec.").dependOn(&run.step);
+    }
+
     {
         const step = b.addLog("", .{});
         const build_exe = ctx.createBuildExeStep(null);
@@ -338,6 +364,28 @@ pub fn build(b: *Builder) !void {
         b.step("test-cosmic-js", "Test cosmic js").dependOn(&step.step);
     }
 
+    {
+        var ctx_ = ctx;
+        ctx_.link_net = true;
+        ctx_.link_graphics = true;
+        ctx_.link_audio = true;
+        ctx_.link_v8 = true;
+        ctx_.path = "runtime/main.zig";
+        const step = b.addLog("", .{});
+        if (builtin.os.tag == .macos and target.getOsTag() == .macos and !target.isNativeOs()) {
+            const gen_mac_libc = GenMacLibCStep.create(b, target);
+            step.step.dependOn(&gen_mac_libc.step);
+        }
+        step.step.dependOn(&extras_repo.step);
+
+        const build_options = ctx_.createDefaultBuildOptions();
+        build_options.addOption([]const u8, "VersionName", VersionName);
+        const run = ctx_.createBuildExeStep(build_options).run();
+        run.addArgs(&.{ "gen-snapshot", fromRoot(b, "runtime/snapshots/api_snapshot.bin") });
+        step.step.dependOn(&run.step);
+        b.step("gen-snapshot", "Generates the api init scripts snapshot. Rebuild cosmic afterwards to embed it.").dependOn(&step.step);
+    }
+
     var build_cosmic = b.addLog("", .{});
     {
         const build_options = ctx.createDefaultBuildOptions();
@@ -679,6 +727,7 @@ const BuildContext = struct {
             mingw.buildAndLinkWinPosix(step);
             mingw.buildAndLinkWinPthreads(step);
         }
+        parser.addPackage(step);
         ui.addPackage(step, .{
             .graphics_backend = self.graphics_backend,
             .add_dep_pkgs = false,
@@ -689,6 +738,8 @@ const BuildContext = struct {
             .enable_tracy = self.enable_tracy,
             .link_lyon = self.link_lyon,
             .link_tess2 = self.link_tess2,
+            // Runtime render targets draw text with the cpu backend.
+            .link_stbtt = self.link_v8,
             .sdl_lib_path = LibSdlPath,
             .add_dep_pkgs = false,
         };
@@ -732,6 +783,7 @@ const BuildContext = struct {
                 .graphics_backend = self.graphics_backend,
                 .link_lyon = self.link_lyon,
                 .link_tess2 = self.link_tess2,
+                .has_api_snapshot = hasApiSnapshot(),
                 .add_dep_pkgs = false,
             });
         }
@@ -774,6 +826,7 @@ const BuildContext = struct {
         build_options.addOption(bool, "enable_tracy", self.enable_tracy);
         build_options.addOption(bool, "has_lyon", self.link_lyon);
         build_options.addOption(bool, "has_tess2", self.link_tess2);
+        build_options.addOption(bool, "has_api_snapshot", hasApiSnapshot());
         return build_options;
     }
 
@@ -1167,6 +1220,12 @@ fn statPath(path_abs: []const u8) !PathStat {
     }
 }
 
+/// The snapshot is generated by the gen-snapshot step and is embedded into the runtime if it exists.
+fn hasApiSnapshot() bool {
+    const stat = statPath(srcPath() ++ "/runtime/snapshots/api_snapshot.bin") catch return false;
+    return stat == .File;
+}
+
 fn getVersionString(is_official_build: bool) []const u8 {
     if (is_official_build) {
         return VersionName;
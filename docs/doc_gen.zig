@@ -402,7 +402,8 @@ fn getJsTypeName(comptime T: type) []const u8 {
         []const f32 => "Array",
 
         v8.Uint8Array,
-        runtime.Uint8Array => "Uint8Array",
+        runtime.Uint8Array,
+        runtime.OwnedUint8Array => "Uint8Array",
         []const api.cs_files.FileEntry => "[]FileEntry",
         api.cs_files.FileEntry => "FileEntry",
 
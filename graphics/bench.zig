@@ -0,0 +1,90 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const graphics = @import("graphics");
+const Color = graphics.Color;
+
+/// Draws batches of shapes, images and text with the headless cpu backend and reports triangles/sec and glyphs/sec.
+/// Usage: bench-raster [width] [height] [iterations] [font_path]
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    const args = try std.process.argsAlloc(alloc);
+    defer std.process.argsFree(alloc, args);
+
+    const width = if (args.len > 1) try std.fmt.parseInt(u32, args[1], 10) else 1920;
+    const height = if (args.len > 2) try std.fmt.parseInt(u32, args[2], 10) else 1080;
+    const iterations = if (args.len > 3) try std.fmt.parseInt(u32, args[3], 10) else 20000;
+    const font_path = if (args.len > 4) args[4] else "assets/vera.ttf";
+
+    var gctx: graphics.Graphics = undefined;
+    try gctx.initCpu(alloc, width, height);
+    defer gctx.deinit();
+    const font_id = try gctx.addFontFromPathTTF(font_path);
+
+    var prng = std.rand.DefaultPrng.init(0);
+    const rand = prng.random();
+    const widthf = @intToFloat(f32, width);
+    const heightf = @intToFloat(f32, height);
+
+    const stdout = std.io.getStdOut().writer();
+    try stdout.print("cpu raster {}x{} iterations={}\n", .{ width, height, iterations });
+
+    // Opaque rects take the solid span path.
+    var timer = try std.time.Timer.start();
+    var i: u32 = 0;
+    while (i < iterations) : (i += 1) {
+        gctx.setFillColor(Color.init(rand.int(u8), rand.int(u8), rand.int(u8), 255));
+        gctx.fillRect(rand.float(f32) * widthf, rand.float(f32) * heightf, 64, 64);
+    }
+    try report(stdout, "opaque rects 64x64", iterations * 2, "triangles", timer.lap());
+
+    // Translucent triangles blend every pixel.
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        const x = rand.float(f32) * widthf;
+        const y = rand.float(f32) * heightf;
+        gctx.setFillColor(Color.init(rand.int(u8), rand.int(u8), rand.int(u8), 128));
+        gctx.fillTriangle(x, y, x + 64, y + 16, x + 24, y + 64);
+    }
+    try report(stdout, "blended triangles", iterations, "triangles", timer.lap());
+
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        const x = rand.float(f32) * widthf;
+        const y = rand.float(f32) * heightf;
+        gctx.setFillGradient(x, y, Color.Blue, x + 64, y + 64, Color.Red);
+        gctx.fillRect(x, y, 64, 64);
+    }
+    try report(stdout, "gradient rects 64x64", iterations * 2, "triangles", timer.lap());
+
+    var pixels: [64 * 64 * 4]u8 = undefined;
+    rand.bytes(&pixels);
+    const image = gctx.createImageFromBitmap(64, 64, &pixels, .{});
+    timer.reset();
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        gctx.drawImageSized(rand.float(f32) * widthf, rand.float(f32) * heightf, 64, 64, image);
+    }
+    try report(stdout, "images 64x64", iterations * 2, "triangles", timer.lap());
+
+    // The first line rasterizes glyphs into the atlas, after that it's textured quads.
+    const line = "The quick brown fox jumps over the lazy dog 0123456789";
+    const num_glyphs = @intCast(u32, try std.unicode.utf8CountCodepoints(line));
+    gctx.setFont(font_id, 18);
+    gctx.setFillColor(Color.Black);
+    timer.reset();
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        gctx.fillText(rand.float(f32) * widthf, rand.float(f32) * heightf, line);
+    }
+    try report(stdout, "text 18px", iterations * num_glyphs, "glyphs", timer.lap());
+}
+
+fn report(writer: anytype, name: []const u8, count: u64, unit: []const u8, elapsed_ns: u64) !void {
+    const elapsed_s = @intToFloat(f64, elapsed_ns) / std.time.ns_per_s;
+    try writer.print("{s}: {} {s} time={d:.3}s {s}/sec={d:.0}\n", .{
+        name, count, unit, elapsed_s, unit, @intToFloat(f64, count) / elapsed_s,
+    });
+}
@@ -106,7 +106,8 @@ pub fn buildAndLink(step: *std.build.LibExeObjStep, opts: Options) void {
             .lib_path = opts.sdl_lib_path,
         });
     }
-    if (opts.link_stbtt) {
+    // The cpu backend renders text with stbtt.
+    if (opts.link_stbtt or opts.graphics_backend == .Cpu) {
         stb.buildAndLinkStbtt(step);
     }
     stb.buildAndLinkStbi(step);
@@ -123,6 +124,34 @@ pub fn buildAndLink(step: *std.build.LibExeObjStep, opts: Options) void {
     cgltf.buildAndLink(step);
 }
 
+/// Headless benchmark of the cpu rasterizer backend.
+pub fn createBench(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.builtin.Mode) *std.build.LibExeObjStep {
+    const exe = b.addExecutable("bench-raster", srcPath() ++ "/bench.zig");
+    exe.setBuildMode(mode);
+    exe.setTarget(target);
+    exe.linkLibC();
+    const opts = Options{
+        .graphics_backend = .Cpu,
+    };
+    addPackage(exe, opts);
+    buildAndLink(exe, opts);
+    return exe;
+}
+
+/// Micro benchmark of utf8 decoding and glyph lookup for text.
+pub fn createTextBench(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.builtin.Mode) *std.build.LibExeObjStep {
+    const exe = b.addExecutable("bench-text", srcPath() ++ "/text_bench.zig");
+    exe.setBuildMode(mode);
+    exe.setTarget(target);
+    exe.linkLibC();
+    const opts = Options{
+        .graphics_backend = .Cpu,
+    };
+    addPackage(exe, opts);
+    buildAndLink(exe, opts);
+    return exe;
+}
+
 fn srcPath() []const u8 {
     return std.fs.path.dirname(@src().file) orelse unreachable;
 }
\ No newline at end of file
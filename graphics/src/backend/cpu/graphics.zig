@@ -0,0 +1,665 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const math = stdx.math;
+const Vec2 = math.Vec2;
+const vec2 = Vec2.init;
+const Transform = math.Transform;
+const stbtt = @import("stbtt");
+const t = stdx.testing;
+const log = stdx.log.scoped(.cpu_graphics);
+
+const graphics = @import("../../graphics.zig");
+const Color = graphics.Color;
+const ImageId = graphics.ImageId;
+const FontId = graphics.FontId;
+const TextAlign = graphics.TextAlign;
+const TextBaseline = graphics.TextBaseline;
+const RectBinPacker = graphics.RectBinPacker;
+const Tessellator = graphics.tessellator.Tessellator;
+const rasterizer = @import("rasterizer.zig");
+pub const Bitmap = rasterizer.Bitmap;
+pub const Rasterizer = rasterizer.Rasterizer;
+const Vertex = rasterizer.Vertex;
+const Paint = rasterizer.Paint;
+
+/// Headless 2D graphics that rasterizes on the cpu into an in-memory RGBA buffer.
+/// Shapes are turned into triangles the same way as the gpu batcher and then scanline filled.
+/// Text is rendered with stbtt into a glyph atlas that is drawn with textured quads.
+pub const Graphics = struct {
+    alloc: std.mem.Allocator,
+
+    /// Render target.
+    buf: Bitmap,
+    raster: Rasterizer,
+
+    view_xform: Transform,
+    fill_color: Color,
+    /// Set by setFillGradient and used for fills until the next setFillColor.
+    fill_gradient: ?rasterizer.GradientPaint,
+    stroke_color: Color,
+    line_width: f32,
+    line_width_half: f32,
+    clip_rect: ?ClipRect,
+    state_stack: std.ArrayListUnmanaged(DrawState),
+
+    tessellator: Tessellator,
+    verts: std.ArrayListUnmanaged(Vertex),
+    idxes: std.ArrayListUnmanaged(u16),
+
+    images: std.ArrayListUnmanaged(Image),
+
+    fonts: std.ArrayListUnmanaged(Font),
+    font_id: FontId,
+    font_size: f32,
+    text_align: TextAlign,
+    text_baseline: TextBaseline,
+
+    /// Single channel glyphs are stored as white with coverage in alpha so they can be tinted by the vertex color.
+    glyph_atlas: Bitmap,
+    glyph_packer: RectBinPacker,
+    glyphs: std.AutoHashMapUnmanaged(GlyphKey, Glyph),
+    raster_glyph_buf: std.ArrayListUnmanaged(u8),
+
+    const Self = @This();
+
+    pub fn init(self: *Self, alloc: std.mem.Allocator, width: u32, height: u32) !void {
+        const buf = try Bitmap.init(alloc, width, height);
+        errdefer buf.deinit(alloc);
+        const glyph_atlas = try Bitmap.init(alloc, 512, 512);
+        self.* = .{
+            .alloc = alloc,
+            .buf = buf,
+            .raster = Rasterizer.init(buf),
+            .view_xform = Transform.initIdentity(),
+            .fill_color = Color.Black,
+            .fill_gradient = null,
+            .stroke_color = Color.Black,
+            .line_width = 1,
+            .line_width_half = 0.5,
+            .clip_rect = null,
+            .state_stack = .{},
+            .tessellator = undefined,
+            .verts = .{},
+            .idxes = .{},
+            .images = .{},
+            .fonts = .{},
+            // FontIds start at 1, same as the gpu font cache.
+            .font_id = 0,
+            .font_size = 20,
+            .text_align = .Left,
+            .text_baseline = .Top,
+            .glyph_atlas = glyph_atlas,
+            .glyph_packer = RectBinPacker.init(alloc, 512, 512),
+            .glyphs = .{},
+            .raster_glyph_buf = .{},
+        };
+        self.tessellator.init(alloc);
+
+        const S = struct {
+            fn onResize(ptr: ?*anyopaque, width_: u32, height_: u32) void {
+                const self_ = stdx.mem.ptrCastAlign(*Self, ptr);
+                self_.resizeGlyphAtlas(width_, height_);
+            }
+        };
+        self.glyph_packer.addResizeCallback(self, S.onResize);
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.buf.deinit(self.alloc);
+        self.state_stack.deinit(self.alloc);
+        self.tessellator.deinit();
+        self.verts.deinit(self.alloc);
+        self.idxes.deinit(self.alloc);
+        for (self.images.items) |img| {
+            img.bitmap.deinit(self.alloc);
+        }
+        self.images.deinit(self.alloc);
+        for (self.fonts.items) |font| {
+            self.alloc.free(font.data);
+        }
+        self.fonts.deinit(self.alloc);
+        self.glyph_atlas.deinit(self.alloc);
+        self.glyph_packer.deinit();
+        self.glyphs.deinit(self.alloc);
+        self.raster_glyph_buf.deinit(self.alloc);
+    }
+
+    /// Overwrites the entire render target, ignoring the clip rect.
+    pub fn clear(self: *Self, color: Color) void {
+        self.buf.fill(color);
+    }
+
+    pub fn getPixel(self: Self, x: u32, y: u32) Color {
+        return self.buf.getPixel(x, y);
+    }
+
+    pub fn translate(self: *Self, x: f32, y: f32) void {
+        self.view_xform.translate(x, y);
+    }
+
+    pub fn scale(self: *Self, x: f32, y: f32) void {
+        self.view_xform.scale(x, y);
+    }
+
+    pub fn rotateZ(self: *Self, rad: f32) void {
+        self.view_xform.rotateZ(rad);
+    }
+
+    pub fn resetTransform(self: *Self) void {
+        self.view_xform.reset();
+    }
+
+    pub fn getViewTransform(self: Self) Transform {
+        return self.view_xform;
+    }
+
+    pub fn getFillColor(self: Self) Color {
+        return self.fill_color;
+    }
+
+    pub fn setFillColor(self: *Self, color: Color) void {
+        self.fill_color = color;
+        self.fill_gradient = null;
+    }
+
+    /// Gradient positions are converted to pixel coords with the current transform, same as the gpu backend.
+    pub fn setFillGradient(self: *Self, start_x: f32, start_y: f32, start_color: Color, end_x: f32, end_y: f32, end_color: Color) void {
+        self.fill_gradient = .{
+            .start_pos = self.view_xform.interpolatePt(vec2(start_x, start_y)),
+            .start_color = start_color,
+            .end_pos = self.view_xform.interpolatePt(vec2(end_x, end_y)),
+            .end_color = end_color,
+        };
+    }
+
+    pub fn getStrokeColor(self: Self) Color {
+        return self.stroke_color;
+    }
+
+    pub fn setStrokeColor(self: *Self, color: Color) void {
+        self.stroke_color = color;
+    }
+
+    pub fn getLineWidth(self: Self) f32 {
+        return self.line_width;
+    }
+
+    pub fn setLineWidth(self: *Self, width: f32) void {
+        self.line_width = width;
+        self.line_width_half = width * 0.5;
+    }
+
+    /// Clip rect is in pixel coords and ignores the current transform, same as the gpu backend.
+    pub fn clipRect(self: *Self, x: f32, y: f32, width: f32, height: f32) void {
+        self.clip_rect = .{ .x0 = x, .y0 = y, .x1 = x + width, .y1 = y + height };
+        self.raster.setClipBounds(x, y, x + width, y + height);
+    }
+
+    pub fn pushState(self: *Self) void {
+        self.state_stack.append(self.alloc, .{
+            .clip_rect = self.clip_rect,
+            .view_xform = self.view_xform,
+        }) catch fatal();
+    }
+
+    pub fn popState(self: *Self) void {
+        const state = self.state_stack.pop();
+        if (state.clip_rect) |r| {
+            self.clipRect(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+        } else {
+            self.clip_rect = null;
+            self.raster.resetClip();
+        }
+        self.view_xform = state.view_xform;
+    }
+
+    fn fillPaint(self: Self) Paint {
+        if (self.fill_gradient) |grad| {
+            return .{ .Gradient = grad };
+        } else {
+            return .Color;
+        }
+    }
+
+    pub fn fillRect(self: *Self, x: f32, y: f32, width: f32, height: f32) void {
+        self.fillRectBoundsColor(x, y, x + width, y + height, self.fill_color, self.fillPaint());
+    }
+
+    pub fn fillRectBounds(self: *Self, x0: f32, y0: f32, x1: f32, y1: f32) void {
+        self.fillRectBoundsColor(x0, y0, x1, y1, self.fill_color, self.fillPaint());
+    }
+
+    fn fillRectBoundsColor(self: *Self, x0: f32, y0: f32, x1: f32, y1: f32, color: Color, paint: Paint) void {
+        const verts = [4]Vertex{
+            .{ .pos = self.view_xform.interpolatePt(vec2(x0, y0)), .uv = vec2(0, 0), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1, y0)), .uv = vec2(1, 0), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1, y1)), .uv = vec2(1, 1), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x0, y1)), .uv = vec2(0, 1), .color = color },
+        };
+        self.raster.drawTriangles(&verts, &QuadIndexes, paint);
+    }
+
+    pub fn drawRect(self: *Self, x: f32, y: f32, width: f32, height: f32) void {
+        self.drawRectBounds(x, y, x + width, y + height);
+    }
+
+    pub fn drawRectBounds(self: *Self, x0: f32, y0: f32, x1: f32, y1: f32) void {
+        const hw = self.line_width_half;
+        // Top border.
+        self.fillRectBoundsColor(x0 - hw, y0 - hw, x1 + hw, y0 + hw, self.stroke_color, .Color);
+        // Right border.
+        self.fillRectBoundsColor(x1 - hw, y0 + hw, x1 + hw, y1 - hw, self.stroke_color, .Color);
+        // Bottom border.
+        self.fillRectBoundsColor(x0 - hw, y1 - hw, x1 + hw, y1 + hw, self.stroke_color, .Color);
+        // Left border.
+        self.fillRectBoundsColor(x0 - hw, y0 + hw, x0 + hw, y1 - hw, self.stroke_color, .Color);
+    }
+
+    pub fn drawLine(self: *Self, x1: f32, y1: f32, x2: f32, y2: f32) void {
+        if (x1 == x2 and y1 == y2) {
+            return;
+        }
+        const normal = vec2(y2 - y1, x1 - x2).toLength(self.line_width_half);
+        const verts = [4]Vertex{
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1 - normal.x, y1 - normal.y)), .color = self.stroke_color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1 + normal.x, y1 + normal.y)), .color = self.stroke_color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x2 + normal.x, y2 + normal.y)), .color = self.stroke_color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x2 - normal.x, y2 - normal.y)), .color = self.stroke_color },
+        };
+        self.raster.drawTriangles(&verts, &QuadIndexes, .Color);
+    }
+
+    pub fn fillTriangle(self: *Self, x1: f32, y1: f32, x2: f32, y2: f32, x3: f32, y3: f32) void {
+        self.raster.drawTriangle(
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1, y1)), .color = self.fill_color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x2, y2)), .color = self.fill_color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x3, y3)), .color = self.fill_color },
+            self.fillPaint(),
+        );
+    }
+
+    /// Triangle fan from the first point.
+    pub fn fillConvexPolygon(self: *Self, pts: []const Vec2) void {
+        self.verts.clearRetainingCapacity();
+        self.idxes.clearRetainingCapacity();
+        for (pts) |pt, i| {
+            self.pushVertex(pt, self.fill_color);
+            if (i >= 2) {
+                self.pushTriangle(0, @intCast(u16, i - 1), @intCast(u16, i));
+            }
+        }
+        self.raster.drawTriangles(self.verts.items, self.idxes.items, self.fillPaint());
+    }
+
+    pub fn fillPolygon(self: *Self, pts: []const Vec2) void {
+        self.tessellator.clearBuffers();
+        self.tessellator.triangulatePolygon(pts);
+        self.verts.clearRetainingCapacity();
+        for (self.tessellator.out_verts.items) |pt| {
+            self.pushVertex(pt, self.fill_color);
+        }
+        self.raster.drawTriangles(self.verts.items, self.tessellator.out_idxes.items, self.fillPaint());
+    }
+
+    pub fn fillCircle(self: *Self, x: f32, y: f32, radius: f32) void {
+        self.fillEllipseSectorN(x, y, radius, radius, 0, math.pi_2, 360);
+    }
+
+    pub fn fillCircleSector(self: *Self, x: f32, y: f32, radius: f32, start_rad: f32, sweep_rad: f32) void {
+        self.fillEllipseSector(x, y, radius, radius, start_rad, sweep_rad);
+    }
+
+    pub fn fillEllipse(self: *Self, x: f32, y: f32, h_radius: f32, v_radius: f32) void {
+        self.fillEllipseSectorN(x, y, h_radius, v_radius, 0, math.pi_2, 360);
+    }
+
+    pub fn fillEllipseSector(self: *Self, x: f32, y: f32, h_radius: f32, v_radius: f32, start_rad: f32, sweep_rad: f32) void {
+        // Approx 1 triangle per degree.
+        const num_tri = std.math.max(1, @floatToInt(u32, @ceil(@fabs(sweep_rad) / math.pi_2 * 360)));
+        self.fillEllipseSectorN(x, y, h_radius, v_radius, start_rad, sweep_rad, num_tri);
+    }
+
+    fn fillEllipseSectorN(self: *Self, x: f32, y: f32, h_radius: f32, v_radius: f32, start_rad: f32, sweep_rad: f32, num_tri: u32) void {
+        self.verts.clearRetainingCapacity();
+        self.idxes.clearRetainingCapacity();
+        self.pushVertex(vec2(x, y), self.fill_color);
+        const rad_per_tri = sweep_rad / @intToFloat(f32, num_tri);
+        var i: u32 = 0;
+        while (i <= num_tri) : (i += 1) {
+            const rad = start_rad + rad_per_tri * @intToFloat(f32, i);
+            self.pushVertex(vec2(x + @cos(rad) * h_radius, y + @sin(rad) * v_radius), self.fill_color);
+            if (i > 0) {
+                self.pushTriangle(0, @intCast(u16, i), @intCast(u16, i + 1));
+            }
+        }
+        self.raster.drawTriangles(self.verts.items, self.idxes.items, self.fillPaint());
+    }
+
+    fn pushVertex(self: *Self, pt: Vec2, color: Color) void {
+        self.verts.append(self.alloc, .{
+            .pos = self.view_xform.interpolatePt(pt),
+            .color = color,
+        }) catch fatal();
+    }
+
+    fn pushTriangle(self: *Self, a: u16, b: u16, c: u16) void {
+        self.idxes.appendSlice(self.alloc, &.{ a, b, c }) catch fatal();
+    }
+
+    /// Copies RGBA data into a new image. Null data creates a transparent image.
+    pub fn createImageFromBitmap(self: *Self, width: usize, height: usize, data: ?[]const u8, opts: graphics.CreateImageOptions) ImageId {
+        const bitmap = Bitmap.init(self.alloc, @intCast(u32, width), @intCast(u32, height)) catch fatal();
+        if (data) |data_| {
+            std.mem.copy(u8, bitmap.data, data_[0..bitmap.data.len]);
+        }
+        self.images.append(self.alloc, .{
+            .bitmap = bitmap,
+            .linear_filter = opts.linear_filter,
+        }) catch fatal();
+        return @intCast(ImageId, self.images.items.len - 1);
+    }
+
+    pub fn drawImage(self: *Self, x: f32, y: f32, image_id: ImageId) void {
+        const img = self.images.items[image_id];
+        self.drawImageSized(x, y, @intToFloat(f32, img.bitmap.width), @intToFloat(f32, img.bitmap.height), image_id);
+    }
+
+    pub fn drawImageSized(self: *Self, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
+        const img = &self.images.items[image_id];
+        self.drawSubImage(0, 0, @intToFloat(f32, img.bitmap.width), @intToFloat(f32, img.bitmap.height), x, y, width, height, image_id);
+    }
+
+    /// Source rect is in image pixels.
+    pub fn drawSubImage(self: *Self, src_x: f32, src_y: f32, src_width: f32, src_height: f32, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
+        const img = &self.images.items[image_id];
+        const img_width = @intToFloat(f32, img.bitmap.width);
+        const img_height = @intToFloat(f32, img.bitmap.height);
+        self.drawTexQuad(x, y, x + width, y + height, src_x / img_width, src_y / img_height, (src_x + src_width) / img_width, (src_y + src_height) / img_height, Color.White, .{
+            .bitmap = &img.bitmap,
+            .linear_filter = img.linear_filter,
+        });
+    }
+
+    fn drawTexQuad(self: *Self, x0: f32, y0: f32, x1: f32, y1: f32, u_0: f32, v_0: f32, u_1: f32, v_1: f32, color: Color, tex: rasterizer.TexturePaint) void {
+        const verts = [4]Vertex{
+            .{ .pos = self.view_xform.interpolatePt(vec2(x0, y0)), .uv = vec2(u_0, v_0), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1, y0)), .uv = vec2(u_1, v_0), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x1, y1)), .uv = vec2(u_1, v_1), .color = color },
+            .{ .pos = self.view_xform.interpolatePt(vec2(x0, y1)), .uv = vec2(u_0, v_1), .color = color },
+        };
+        self.raster.drawTriangles(&verts, &QuadIndexes, .{ .Texture = tex });
+    }
+
+    /// Copies the ttf data. Returns a FontId starting from 1.
+    pub fn addFontTTF(self: *Self, data: []const u8) FontId {
+        // stbtt expects null terminated data.
+        const own_data = self.alloc.alloc(u8, data.len + 1) catch fatal();
+        std.mem.copy(u8, own_data, data);
+        own_data[data.len] = 0;
+
+        var font: Font = .{
+            .data = own_data,
+            .info = undefined,
+            .ascent = undefined,
+            .descent = undefined,
+            .line_gap = undefined,
+        };
+        stbtt.InitFont(&font.info, own_data, 0) catch @panic("failed to load font");
+        var ascent: c_int = undefined;
+        var descent: c_int = undefined;
+        var line_gap: c_int = undefined;
+        stbtt.stbtt_GetFontVMetrics(&font.info, &ascent, &descent, &line_gap);
+        font.ascent = @intToFloat(f32, ascent);
+        font.descent = @intToFloat(f32, -descent);
+        font.line_gap = @intToFloat(f32, line_gap);
+        self.fonts.append(self.alloc, font) catch fatal();
+        const id = @intCast(FontId, self.fonts.items.len);
+        if (self.font_id == 0) {
+            self.font_id = id;
+        }
+        return id;
+    }
+
+    pub fn setFont(self: *Self, font_id: FontId, font_size: f32) void {
+        self.font_id = font_id;
+        self.font_size = font_size;
+    }
+
+    pub fn getFontSize(self: Self) f32 {
+        return self.font_size;
+    }
+
+    pub fn setFontSize(self: *Self, font_size: f32) void {
+        self.font_size = font_size;
+    }
+
+    pub fn setTextAlign(self: *Self, align_: TextAlign) void {
+        self.text_align = align_;
+    }
+
+    pub fn setTextBaseline(self: *Self, baseline: TextBaseline) void {
+        self.text_baseline = baseline;
+    }
+
+    /// Returns the advance width of a string in the current font.
+    pub fn measureText(self: *Self, str: []const u8) f32 {
+        if (self.font_id == 0) {
+            return 0;
+        }
+        const font = &self.fonts.items[self.font_id - 1];
+        const font_scale = stbtt.stbtt_ScaleForPixelHeight(&font.info, self.font_size);
+        var width: f32 = 0;
+        var prev_gid: c_int = 0;
+        var iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+        while (iter.nextCodepoint()) |cp| {
+            const gid = stbtt.stbtt_FindGlyphIndex(&font.info, cp);
+            if (prev_gid != 0) {
+                width += @intToFloat(f32, stbtt.stbtt_GetGlyphKernAdvance(&font.info, prev_gid, gid)) * font_scale;
+            }
+            var advance: c_int = undefined;
+            var lsb: c_int = undefined;
+            stbtt.stbtt_GetGlyphHMetrics(&font.info, gid, &advance, &lsb);
+            width += @intToFloat(f32, advance) * font_scale;
+            prev_gid = gid;
+        }
+        return width;
+    }
+
+    /// Fills text with the current fill color.
+    pub fn fillText(self: *Self, x: f32, y: f32, str: []const u8) void {
+        if (self.font_id == 0) {
+            log.warn("No font added.", .{});
+            return;
+        }
+        const font_id = self.font_id;
+        const font_scale = stbtt.stbtt_ScaleForPixelHeight(&self.fonts.items[font_id - 1].info, self.font_size);
+        const ascent = self.fonts.items[font_id - 1].ascent * font_scale;
+        const descent = self.fonts.items[font_id - 1].descent * font_scale;
+
+        var pen_x = switch (self.text_align) {
+            .Left => x,
+            .Center => x - self.measureText(str) / 2,
+            .Right => x - self.measureText(str),
+        };
+        const baseline_y = switch (self.text_baseline) {
+            .Top => y + ascent,
+            .Middle => y + ascent - (ascent + descent) / 2,
+            .Alphabetic => y,
+            .Bottom => y - descent,
+        };
+
+        // Glyphs are rasterized at the user font size. The glyph atlas can resize while looping so the bitmap is referenced at each draw.
+        const size_key = @floatToInt(u16, std.math.clamp(@round(self.font_size * 4), 0, std.math.maxInt(u16)));
+        var prev_gid: c_int = 0;
+        var iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+        while (iter.nextCodepoint()) |cp| {
+            const font = &self.fonts.items[font_id - 1];
+            const gid = stbtt.stbtt_FindGlyphIndex(&font.info, cp);
+            if (prev_gid != 0) {
+                pen_x += @intToFloat(f32, stbtt.stbtt_GetGlyphKernAdvance(&font.info, prev_gid, gid)) * font_scale;
+            }
+            prev_gid = gid;
+            const glyph = self.getOrLoadGlyph(font_id, gid, size_key, font_scale);
+            if (glyph.width > 0) {
+                const gx = pen_x + glyph.x_offset;
+                const gy = baseline_y + glyph.y_offset;
+                const atlas_width = @intToFloat(f32, self.glyph_atlas.width);
+                const atlas_height = @intToFloat(f32, self.glyph_atlas.height);
+                const ax = @intToFloat(f32, glyph.x);
+                const ay = @intToFloat(f32, glyph.y);
+                const w = @intToFloat(f32, glyph.width);
+                const h = @intToFloat(f32, glyph.height);
+                self.drawTexQuad(gx, gy, gx + w, gy + h, ax / atlas_width, ay / atlas_height, (ax + w) / atlas_width, (ay + h) / atlas_height, self.fill_color, .{
+                    .bitmap = &self.glyph_atlas,
+                });
+            }
+            pen_x += glyph.advance;
+        }
+    }
+
+    fn getOrLoadGlyph(self: *Self, font_id: FontId, gid: c_int, size_key: u16, font_scale: f32) Glyph {
+        const key = GlyphKey{
+            .font_id = font_id,
+            .glyph_id = @intCast(u32, gid),
+            .size = size_key,
+        };
+        if (self.glyphs.get(key)) |glyph| {
+            return glyph;
+        }
+        const font = &self.fonts.items[font_id - 1];
+        var advance: c_int = undefined;
+        var lsb: c_int = undefined;
+        stbtt.stbtt_GetGlyphHMetrics(&font.info, gid, &advance, &lsb);
+
+        var x0: c_int = 0;
+        var y0: c_int = 0;
+        var x1: c_int = 0;
+        var y1: c_int = 0;
+        stbtt.stbtt_GetGlyphBitmapBox(&font.info, gid, font_scale, font_scale, &x0, &y0, &x1, &y1);
+        const width = @intCast(u32, std.math.max(0, x1 - x0));
+        const height = @intCast(u32, std.math.max(0, y1 - y0));
+
+        var glyph = Glyph{
+            .x = 0,
+            .y = 0,
+            .width = width,
+            .height = height,
+            .x_offset = @intToFloat(f32, x0),
+            .y_offset = @intToFloat(f32, y0),
+            .advance = @intToFloat(f32, advance) * font_scale,
+        };
+        if (width > 0 and height > 0) {
+            // Pad by a pixel so linear filtering doesn't bleed into neighbors.
+            const pos = self.glyph_packer.allocRect(width + 2, height + 2);
+            glyph.x = pos.x + 1;
+            glyph.y = pos.y + 1;
+
+            self.raster_glyph_buf.resize(self.alloc, width * height) catch fatal();
+            stbtt.stbtt_MakeGlyphBitmap(&font.info, self.raster_glyph_buf.items.ptr, @intCast(c_int, width), @intCast(c_int, height), @intCast(c_int, width), font_scale, font_scale, gid);
+
+            const atlas = self.glyph_atlas;
+            var row: u32 = 0;
+            while (row < height) : (row += 1) {
+                const src = self.raster_glyph_buf.items[row * width .. (row + 1) * width];
+                var dst_idx = ((glyph.y + row) * atlas.width + glyph.x) * 4;
+                for (src) |coverage| {
+                    atlas.data[dst_idx..][0..4].* = .{ 255, 255, 255, coverage };
+                    dst_idx += 4;
+                }
+            }
+        }
+        self.glyphs.put(self.alloc, key, glyph) catch fatal();
+        return glyph;
+    }
+
+    fn resizeGlyphAtlas(self: *Self, width: u32, height: u32) void {
+        const old = self.glyph_atlas;
+        defer old.deinit(self.alloc);
+        self.glyph_atlas = Bitmap.init(self.alloc, width, height) catch fatal();
+        var row: u32 = 0;
+        while (row < old.height) : (row += 1) {
+            const src = old.data[row * old.width * 4 .. (row + 1) * old.width * 4];
+            std.mem.copy(u8, self.glyph_atlas.data[row * width * 4 ..], src);
+        }
+    }
+};
+
+const QuadIndexes = [_]u16{ 0, 1, 2, 0, 2, 3 };
+
+const ClipRect = struct {
+    x0: f32,
+    y0: f32,
+    x1: f32,
+    y1: f32,
+};
+
+const DrawState = struct {
+    clip_rect: ?ClipRect,
+    view_xform: Transform,
+};
+
+const Image = struct {
+    bitmap: Bitmap,
+    linear_filter: bool,
+};
+
+const Font = struct {
+    /// Owned null terminated ttf data.
+    data: []const u8,
+    info: stbtt.fontinfo,
+
+    /// In font units.
+    ascent: f32,
+    descent: f32,
+    line_gap: f32,
+};
+
+const GlyphKey = struct {
+    font_id: FontId,
+    glyph_id: u32,
+    /// Font size in quarter pixels.
+    size: u16,
+};
+
+const Glyph = struct {
+    /// Position in the glyph atlas.
+    x: u32,
+    y: u32,
+    width: u32,
+    height: u32,
+
+    /// Offset from the pen position on the baseline to the top left of the glyph bitmap.
+    x_offset: f32,
+    y_offset: f32,
+    advance: f32,
+};
+
+test "Graphics fills shapes into the buffer" {
+    var g: Graphics = undefined;
+    try g.init(t.alloc, 16, 16);
+    defer g.deinit();
+
+    g.clear(Color.White);
+    g.setFillColor(Color.Blue);
+    g.translate(2, 2);
+    g.fillRect(0, 0, 4, 4);
+    try t.eq(g.getPixel(2, 2).value, Color.Blue.value);
+    try t.eq(g.getPixel(5, 5).value, Color.Blue.value);
+    try t.eq(g.getPixel(6, 6).value, Color.White.value);
+    try t.eq(g.getPixel(1, 1).value, Color.White.value);
+
+    g.resetTransform();
+    g.pushState();
+    g.clipRect(8, 8, 4, 4);
+    g.setFillColor(Color.Red);
+    g.fillCircle(10, 10, 6);
+    g.popState();
+    try t.eq(g.getPixel(10, 10).value, Color.Red.value);
+    try t.eq(g.getPixel(7, 10).value, Color.White.value);
+    try t.eq(g.getPixel(12, 10).value, Color.White.value);
+
+    const img = g.createImageFromBitmap(1, 1, &.{ 0, 255, 0, 255 }, .{ .linear_filter = false });
+    g.drawImageSized(0, 12, 2, 2, img);
+    try t.eq(g.getPixel(1, 13).value, Color.StdGreen.value);
+}
@@ -0,0 +1,477 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+const Vec2 = stdx.math.Vec2;
+const vec2 = Vec2.init;
+
+const graphics = @import("../../graphics.zig");
+const Color = graphics.Color;
+
+/// Color channels in the range 0-255.
+const Vec4 = @Vector(4, f32);
+
+/// Straight alpha RGBA8 pixels stored in rows starting from the top left.
+pub const Bitmap = struct {
+    width: u32,
+    height: u32,
+    data: []u8,
+
+    pub fn init(alloc: std.mem.Allocator, width: u32, height: u32) !Bitmap {
+        const data = try alloc.alloc(u8, width * height * 4);
+        std.mem.set(u8, data, 0);
+        return Bitmap{
+            .width = width,
+            .height = height,
+            .data = data,
+        };
+    }
+
+    pub fn deinit(self: Bitmap, alloc: std.mem.Allocator) void {
+        alloc.free(self.data);
+    }
+
+    pub fn getPixel(self: Bitmap, x: u32, y: u32) Color {
+        const i = (y * self.width + x) * 4;
+        return Color.init(self.data[i], self.data[i + 1], self.data[i + 2], self.data[i + 3]);
+    }
+
+    /// Overwrites every pixel without blending.
+    pub fn fill(self: Bitmap, color: Color) void {
+        fillPixels(self.data, color);
+    }
+};
+
+pub const Vertex = struct {
+    pos: Vec2,
+    uv: Vec2 = vec2(0, 0),
+    color: Color = Color.White,
+};
+
+/// Determines the source color of each covered pixel.
+pub const Paint = union(enum) {
+    /// Interpolated vertex colors.
+    Color: void,
+    /// Texture sample multiplied by the interpolated vertex color, same as the gpu tex shader.
+    Texture: TexturePaint,
+    /// Linear gradient in pixel space, same as the gpu gradient shader. Vertex colors are ignored.
+    Gradient: GradientPaint,
+};
+
+pub const TexturePaint = struct {
+    bitmap: *const Bitmap,
+    linear_filter: bool = true,
+
+    fn sample(self: TexturePaint, u: f32, v: f32) Vec4 {
+        const bm = self.bitmap;
+        const max_x = @intCast(i32, bm.width) - 1;
+        const max_y = @intCast(i32, bm.height) - 1;
+        const sx = u * @intToFloat(f32, bm.width);
+        const sy = v * @intToFloat(f32, bm.height);
+        if (!self.linear_filter) {
+            return loadPixel(bm, clampIdx(@floor(sx), max_x), clampIdx(@floor(sy), max_y));
+        }
+        // Sample between the four nearest texel centers with clamp to edge.
+        const fx = sx - 0.5;
+        const fy = sy - 0.5;
+        const x0f = @floor(fx);
+        const y0f = @floor(fy);
+        const tx = fx - x0f;
+        const ty = fy - y0f;
+        const x0 = clampIdx(x0f, max_x);
+        const x1 = clampIdx(x0f + 1, max_x);
+        const y0 = clampIdx(y0f, max_y);
+        const y1 = clampIdx(y0f + 1, max_y);
+        const top = mix(loadPixel(bm, x0, y0), loadPixel(bm, x1, y0), tx);
+        const bot = mix(loadPixel(bm, x0, y1), loadPixel(bm, x1, y1), tx);
+        return mix(top, bot, ty);
+    }
+};
+
+pub const GradientPaint = struct {
+    start_pos: Vec2,
+    start_color: Color,
+    end_pos: Vec2,
+    end_color: Color,
+
+    fn sample(self: GradientPaint, x: f32, y: f32) Vec4 {
+        const grad_vec = Vec2.initTo(self.start_pos, self.end_pos);
+        const amt = grad_vec.dot(vec2(x - self.start_pos.x, y - self.start_pos.y)) / grad_vec.squareLength();
+        // Like the shader, the mix is not clamped but the output channels are.
+        return clamp255(mix(toVec4(self.start_color), toVec4(self.end_color), amt));
+    }
+};
+
+/// Pixel bounds. Max is exclusive.
+pub const ClipRect = struct {
+    min_x: i32,
+    min_y: i32,
+    max_x: i32,
+    max_y: i32,
+
+    fn initBitmap(bm: Bitmap) ClipRect {
+        return .{
+            .min_x = 0,
+            .min_y = 0,
+            .max_x = @intCast(i32, bm.width),
+            .max_y = @intCast(i32, bm.height),
+        };
+    }
+};
+
+/// Scanline triangle rasterizer into a Bitmap.
+/// Pixels are covered when their center is inside the triangle. Centers that lie exactly on an edge follow the top-left rule
+/// so triangles that share an edge (eg. the batcher's quads and fans) never leave gaps or blend a pixel twice.
+/// Blending is StraightAlpha, same as the default gpu blend mode.
+pub const Rasterizer = struct {
+    dst: Bitmap,
+    clip: ClipRect,
+
+    pub fn init(dst: Bitmap) Rasterizer {
+        return .{
+            .dst = dst,
+            .clip = ClipRect.initBitmap(dst),
+        };
+    }
+
+    /// Restricts drawing to the intersection of the bitmap and the given bounds in pixels.
+    pub fn setClipBounds(self: *Rasterizer, x0: f32, y0: f32, x1: f32, y1: f32) void {
+        self.clip = .{
+            .min_x = toPixelBound(@round(x0), self.dst.width),
+            .min_y = toPixelBound(@round(y0), self.dst.height),
+            .max_x = toPixelBound(@round(x1), self.dst.width),
+            .max_y = toPixelBound(@round(y1), self.dst.height),
+        };
+    }
+
+    pub fn resetClip(self: *Rasterizer) void {
+        self.clip = ClipRect.initBitmap(self.dst);
+    }
+
+    /// Draws an indexed triangle list.
+    pub fn drawTriangles(self: Rasterizer, verts: []const Vertex, indexes: []const u16, paint: Paint) void {
+        var i: usize = 0;
+        while (i + 2 < indexes.len) : (i += 3) {
+            self.drawTriangle(verts[indexes[i]], verts[indexes[i + 1]], verts[indexes[i + 2]], paint);
+        }
+    }
+
+    pub fn drawTriangle(self: Rasterizer, v0: Vertex, v1: Vertex, v2: Vertex, paint: Paint) void {
+        const a = v0;
+        var b = v1;
+        var c = v2;
+        var area = Edge.init(a.pos, b.pos).eval(c.pos.x, c.pos.y);
+        if (area == 0 or std.math.isNan(area)) {
+            return;
+        }
+        if (area < 0) {
+            std.mem.swap(Vertex, &b, &c);
+            area = -area;
+        }
+        // Each edge function is also the unnormalized barycentric weight of the opposite vertex.
+        const edges = [3]Edge{
+            Edge.init(b.pos, c.pos),
+            Edge.init(c.pos, a.pos),
+            Edge.init(a.pos, b.pos),
+        };
+        const inv_area = 1 / area;
+
+        const min_y = std.math.min(a.pos.y, std.math.min(b.pos.y, c.pos.y));
+        const max_y = std.math.max(a.pos.y, std.math.max(b.pos.y, c.pos.y));
+        const y_start = std.math.max(self.clip.min_y, toPixelBound(@floor(min_y), self.dst.height));
+        const y_end = std.math.min(self.clip.max_y, toPixelBound(@ceil(max_y), self.dst.height));
+
+        const solid = paint == .Color and a.color.value == b.color.value and b.color.value == c.color.value;
+        const stride = @intCast(i32, self.dst.width);
+
+        var y = y_start;
+        row: while (y < y_end) : (y += 1) {
+            const py = @intToFloat(f32, y) + 0.5;
+            var x_start = self.clip.min_x;
+            var x_end = self.clip.max_x;
+            for (edges) |e| {
+                const k = e.b * py + e.c;
+                if (e.a == 0) {
+                    if (k < 0 or (k == 0 and !e.top)) {
+                        continue :row;
+                    }
+                } else {
+                    // Left edges own the pixel centers they pass through, right edges don't.
+                    const x = toPixelBound(@ceil(-k / e.a - 0.5), self.dst.width);
+                    if (e.a > 0) {
+                        x_start = std.math.max(x_start, x);
+                    } else {
+                        x_end = std.math.min(x_end, x);
+                    }
+                }
+            }
+            if (x_start >= x_end) {
+                continue;
+            }
+            const span = self.dst.data[@intCast(usize, (y * stride + x_start) * 4)..@intCast(usize, (y * stride + x_end) * 4)];
+            if (solid) {
+                fillSpanSolid(span, a.color);
+                continue;
+            }
+            const px = @intToFloat(f32, x_start) + 0.5;
+            const w = Vec4{ edges[0].eval(px, py) * inv_area, edges[1].eval(px, py) * inv_area, edges[2].eval(px, py) * inv_area, 0 };
+            const dw = Vec4{ edges[0].a * inv_area, edges[1].a * inv_area, edges[2].a * inv_area, 0 };
+            shadeSpan(span, px, py, w, dw, a, b, c, paint);
+        }
+    }
+};
+
+/// E(x, y) = a*x + b*y + c is positive on the inner side of the edge when the triangle winds clockwise on screen.
+const Edge = struct {
+    a: f32,
+    b: f32,
+    c: f32,
+    /// Horizontal edge with the triangle below it. Pixel centers exactly on a top edge are covered, on a bottom edge they are not.
+    top: bool,
+
+    fn init(p0: Vec2, p1: Vec2) Edge {
+        // Compute from a canonical endpoint order so two triangles sharing the edge get exactly negated coefficients
+        // and agree on every pixel center that lies on it.
+        const flip = p1.y < p0.y or (p1.y == p0.y and p1.x < p0.x);
+        const s = if (flip) p1 else p0;
+        const e = if (flip) p0 else p1;
+        const dx = e.x - s.x;
+        const dy = e.y - s.y;
+        var res = Edge{
+            .a = -dy,
+            .b = dx,
+            .c = dy * s.x - dx * s.y,
+            .top = false,
+        };
+        if (flip) {
+            res.a = -res.a;
+            res.b = -res.b;
+            res.c = -res.c;
+        }
+        res.top = res.a == 0 and res.b > 0;
+        return res;
+    }
+
+    inline fn eval(self: Edge, x: f32, y: f32) f32 {
+        return self.a * x + self.b * y + self.c;
+    }
+};
+
+fn shadeSpan(span: []u8, start_x: f32, py: f32, start_w: Vec4, dw: Vec4, a: Vertex, b: Vertex, c: Vertex, paint: Paint) void {
+    const ca = toVec4(a.color);
+    const cb = toVec4(b.color);
+    const cc = toVec4(c.color);
+    var w = start_w;
+    var px = start_x;
+    var i: usize = 0;
+    while (i < span.len) : ({
+        i += 4;
+        w += dw;
+        px += 1;
+    }) {
+        const src = switch (paint) {
+            .Color => ca * @splat(4, w[0]) + cb * @splat(4, w[1]) + cc * @splat(4, w[2]),
+            .Texture => |tex| blk: {
+                const u = w[0] * a.uv.x + w[1] * b.uv.x + w[2] * c.uv.x;
+                const v = w[0] * a.uv.y + w[1] * b.uv.y + w[2] * c.uv.y;
+                const color = ca * @splat(4, w[0]) + cb * @splat(4, w[1]) + cc * @splat(4, w[2]);
+                break :blk tex.sample(u, v) * color * @splat(4, @as(f32, 1.0 / 255.0));
+            },
+            .Gradient => |grad| grad.sample(px, py),
+        };
+        blendPixel(span[i..][0..4], src);
+    }
+}
+
+fn fillSpanSolid(span: []u8, color: Color) void {
+    const a = color.channels.a;
+    if (a == 255) {
+        fillPixels(span, color);
+    } else if (a > 0) {
+        const sa = @intToFloat(f32, a) / 255;
+        const src = toVec4(color) * @splat(4, sa) + @splat(4, @as(f32, 0.5));
+        const inv_sa = @splat(4, 1 - sa);
+        var i: usize = 0;
+        while (i < span.len) : (i += 4) {
+            const dst = span[i..][0..4];
+            dst.* = toBytes(src + loadBytes(dst.*) * inv_sa);
+        }
+    }
+}
+
+/// Writes an opaque color into a run of pixels 16 at a time.
+fn fillPixels(dst: []u8, color: Color) void {
+    var pattern: [64]u8 = undefined;
+    var i: usize = 0;
+    while (i < pattern.len) : (i += 4) {
+        pattern[i..][0..4].* = .{ color.channels.r, color.channels.g, color.channels.b, color.channels.a };
+    }
+    i = 0;
+    while (i + pattern.len <= dst.len) : (i += pattern.len) {
+        std.mem.copy(u8, dst[i .. i + pattern.len], &pattern);
+    }
+    std.mem.copy(u8, dst[i..], pattern[0 .. dst.len - i]);
+}
+
+inline fn blendPixel(dst: *[4]u8, src: Vec4) void {
+    const sa = src[3] * (1.0 / 255.0);
+    if (sa <= 0) {
+        return;
+    }
+    dst.* = toBytes(src * @splat(4, sa) + loadBytes(dst.*) * @splat(4, 1 - sa) + @splat(4, @as(f32, 0.5)));
+}
+
+inline fn mix(a: Vec4, b: Vec4, amt: f32) Vec4 {
+    return a + (b - a) * @splat(4, amt);
+}
+
+fn clamp255(v: Vec4) Vec4 {
+    return .{
+        std.math.clamp(v[0], 0, 255),
+        std.math.clamp(v[1], 0, 255),
+        std.math.clamp(v[2], 0, 255),
+        std.math.clamp(v[3], 0, 255),
+    };
+}
+
+inline fn toVec4(color: Color) Vec4 {
+    return loadBytes(.{ color.channels.r, color.channels.g, color.channels.b, color.channels.a });
+}
+
+inline fn loadBytes(bytes: [4]u8) Vec4 {
+    return .{
+        @intToFloat(f32, bytes[0]),
+        @intToFloat(f32, bytes[1]),
+        @intToFloat(f32, bytes[2]),
+        @intToFloat(f32, bytes[3]),
+    };
+}
+
+/// Expects rounding to already be added in.
+inline fn toBytes(v: Vec4) [4]u8 {
+    const c = clamp255(v);
+    return .{
+        @floatToInt(u8, c[0]),
+        @floatToInt(u8, c[1]),
+        @floatToInt(u8, c[2]),
+        @floatToInt(u8, c[3]),
+    };
+}
+
+fn loadPixel(bm: *const Bitmap, x: i32, y: i32) Vec4 {
+    const i = @intCast(usize, (y * @intCast(i32, bm.width) + x) * 4);
+    return loadBytes(bm.data[i..][0..4].*);
+}
+
+fn clampIdx(v: f32, max: i32) i32 {
+    return @floatToInt(i32, std.math.clamp(v, 0, @intToFloat(f32, max)));
+}
+
+/// Clamps to [0, dim]. Also maps NaN to dim.
+fn toPixelBound(v: f32, dim: u32) i32 {
+    return @floatToInt(i32, std.math.clamp(v, 0, @intToFloat(f32, dim)));
+}
+
+fn quadVerts(x0: f32, y0: f32, x1: f32, y1: f32, color: Color) [4]Vertex {
+    return .{
+        .{ .pos = vec2(x0, y0), .uv = vec2(0, 0), .color = color },
+        .{ .pos = vec2(x1, y0), .uv = vec2(1, 0), .color = color },
+        .{ .pos = vec2(x1, y1), .uv = vec2(1, 1), .color = color },
+        .{ .pos = vec2(x0, y1), .uv = vec2(0, 1), .color = color },
+    };
+}
+
+const QuadIndexes = [_]u16{ 0, 1, 2, 0, 2, 3 };
+
+test "Rasterizer covers pixel centers within the clip" {
+    const bm = try Bitmap.init(t.alloc, 8, 8);
+    defer bm.deinit(t.alloc);
+    var r = Rasterizer.init(bm);
+    r.setClipBounds(0, 0, 5, 8);
+
+    const verts = quadVerts(2, 1, 6.4, 5, Color.Red);
+    r.drawTriangles(&verts, &QuadIndexes, .Color);
+
+    var y: u32 = 0;
+    while (y < 8) : (y += 1) {
+        var x: u32 = 0;
+        while (x < 8) : (x += 1) {
+            const inside = x >= 2 and x < 5 and y >= 1 and y < 5;
+            try t.eq(bm.getPixel(x, y).value, if (inside) Color.Red.value else Color.Transparent.value);
+        }
+    }
+}
+
+test "Rasterizer blends shared edges once" {
+    const bm = try Bitmap.init(t.alloc, 4, 4);
+    defer bm.deinit(t.alloc);
+    const r = Rasterizer.init(bm);
+
+    // The diagonal passes exactly through pixel centers.
+    const verts = quadVerts(0, 0, 4, 4, Color.init(255, 0, 0, 128));
+    r.drawTriangles(&verts, &QuadIndexes, .Color);
+    try expectBlendedOnce(bm);
+
+    // Same for a fan around a shared center vertex with interpolated colors.
+    bm.fill(Color.Transparent);
+    const corner = Color.init(255, 0, 0, 128);
+    const fan = [_]Vertex{
+        .{ .pos = vec2(2, 2), .color = Color.init(255, 0, 255, 128) },
+        .{ .pos = vec2(0, 0), .color = corner },
+        .{ .pos = vec2(4, 0), .color = corner },
+        .{ .pos = vec2(4, 4), .color = corner },
+        .{ .pos = vec2(0, 4), .color = corner },
+    };
+    r.drawTriangles(&fan, &.{ 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 1 }, .Color);
+    try expectBlendedOnce(bm);
+}
+
+fn expectBlendedOnce(bm: Bitmap) !void {
+    var i: usize = 0;
+    while (i < bm.data.len) : (i += 4) {
+        try t.eq(bm.data[i], 128);
+        try t.eq(bm.data[i + 3], 64);
+    }
+}
+
+test "Rasterizer gradient matches the gpu shader" {
+    const bm = try Bitmap.init(t.alloc, 4, 1);
+    defer bm.deinit(t.alloc);
+    const r = Rasterizer.init(bm);
+
+    const verts = quadVerts(0, 0, 4, 1, Color.White);
+    r.drawTriangles(&verts, &QuadIndexes, .{ .Gradient = .{
+        .start_pos = vec2(0, 0),
+        .start_color = Color.Black,
+        .end_pos = vec2(4, 0),
+        .end_color = Color.White,
+    } });
+    try t.eq(bm.getPixel(0, 0).value, Color.init(32, 32, 32, 255).value);
+    try t.eq(bm.getPixel(1, 0).value, Color.init(96, 96, 96, 255).value);
+    try t.eq(bm.getPixel(2, 0).value, Color.init(159, 159, 159, 255).value);
+    try t.eq(bm.getPixel(3, 0).value, Color.init(223, 223, 223, 255).value);
+}
+
+test "Rasterizer samples textures" {
+    const tex = try Bitmap.init(t.alloc, 2, 2);
+    defer tex.deinit(t.alloc);
+    std.mem.copy(u8, tex.data, &.{
+        255, 0, 0,   255, 0,   255, 0,   255,
+        0,   0, 255, 255, 255, 255, 255, 128,
+    });
+    const bm = try Bitmap.init(t.alloc, 4, 4);
+    defer bm.deinit(t.alloc);
+    const r = Rasterizer.init(bm);
+
+    const verts = quadVerts(0, 0, 4, 4, Color.White);
+    r.drawTriangles(&verts, &QuadIndexes, .{ .Texture = .{ .bitmap = &tex, .linear_filter = false } });
+    try t.eq(bm.getPixel(1, 1).value, Color.init(255, 0, 0, 255).value);
+    try t.eq(bm.getPixel(2, 0).value, Color.init(0, 255, 0, 255).value);
+    try t.eq(bm.getPixel(0, 3).value, Color.init(0, 0, 255, 255).value);
+    try t.eq(bm.getPixel(3, 3).value, Color.init(128, 128, 128, 64).value);
+
+    // Texel centers sample exactly with linear filtering.
+    bm.fill(Color.Transparent);
+    const verts2 = quadVerts(0, 0, 2, 2, Color.White);
+    r.drawTriangles(&verts2, &QuadIndexes, .{ .Texture = .{ .bitmap = &tex } });
+    try t.eq(bm.getPixel(1, 0).value, Color.init(0, 255, 0, 255).value);
+}
@@ -1,7 +1,5 @@
 const std = @import("std");
 const stdx = @import("stdx");
-const Vec4 = stdx.math.Vec4;
-const Vec3 = stdx.math.Vec3;
 const Transform = stdx.math.Transform;
 const gl = @import("gl");
 
@@ -94,8 +92,7 @@ pub const Graphics = struct {
         const normal = xform.toRotationMat();
         self.renderer.ensurePushMeshData(mesh.verts, mesh.indexes);
         const tex_id = if (mesh.image_id) |image_id| b: {
-            const img = self.renderer.image_store.images.getNoCheck(image_id);
-            break :b img.tex_id;
+            break :b self.renderer.image_store.getOwnTexture(image_id).tex_id;
         } else self.gpu_ctx.white_tex.tex_id;
 
         const light = gpu.ShaderCamera{
@@ -141,41 +138,7 @@ pub const Graphics = struct {
         const normal = xform.toRotationMat();
 
         self.renderer.ensureUnusedBuffer(6*4, 6*6);
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(Color.White);
-        vert.setUV(0, 0);
-        const far_top_left = Vec4.init(-0.5, 0.5, -0.5, 1.0);
-        const far_top_right = Vec4.init(0.5, 0.5, -0.5, 1.0);
-        const far_bot_right = Vec4.init(0.5, -0.5, -0.5, 1.0);
-        const far_bot_left = Vec4.init(-0.5, -0.5, -0.5, 1.0);
-        const near_top_left = Vec4.init(-0.5, 0.5, 0.5, 1.0);
-        const near_top_right = Vec4.init(0.5, 0.5, 0.5, 1.0);
-        const near_bot_right = Vec4.init(0.5, -0.5, 0.5, 1.0);
-        const near_bot_left = Vec4.init(-0.5, -0.5, 0.5, 1.0);
-
-        // Far face.
-        vert.setNormal(Vec3.init(0, 0, -1));
-        self.mesh.pushQuad(far_top_right, far_top_left, far_bot_left, far_bot_right, vert);
-
-        // Left face.
-        vert.setNormal(Vec3.init(-1, 0, 0));
-        self.mesh.pushQuad(far_top_left, near_top_left, near_bot_left, far_bot_left, vert);
-
-        // Right face.
-        vert.setNormal(Vec3.init(1, 0, 0));
-        self.mesh.pushQuad(near_top_right, far_top_right, far_bot_right, near_bot_right, vert);
-
-        // Near face.
-        vert.setNormal(Vec3.init(0, 0, 1));
-        self.mesh.pushQuad(near_top_left, near_top_right, near_bot_right, near_bot_left, vert);
-
-        // Bottom face.
-        vert.setNormal(Vec3.init(0, -1, 0));
-        self.mesh.pushQuad(far_bot_right, far_bot_left, near_bot_left, near_bot_right, vert);
-
-        // Top face.
-        vert.setNormal(Vec3.init(0, 1, 0));
-        self.mesh.pushQuad(far_top_left, far_top_right, near_top_right, near_top_left, vert);
+        self.mesh.pushUnitCuboid();
 
         const light = gpu.ShaderCamera{
             .cam_pos = self.gpu_ctx.cur_cam_world_pos,
@@ -187,6 +150,28 @@ pub const Graphics = struct {
 
         self.renderer.pushTexPbr3D(vp.mat, xform.mat, normal, material, light, self.gpu_ctx.white_tex.tex_id);
     }
+
+    /// Draws the cuboids in a buffer with one instanced draw call.
+    pub fn drawCuboidsPbr3D(self: *Graphics, buf_id: gpu.CuboidBufferId) void {
+        const buf = self.gpu_ctx.cuboid_bufs.get(buf_id);
+        if (buf.num_instances == 0) {
+            return;
+        }
+        self.gpu_ctx.batcher.endCmd();
+        const vp = self.gpu_ctx.ps.view_xform.getAppliedTransform(self.gpu_ctx.ps.proj_xform);
+
+        self.renderer.ensureUnusedBuffer(6*4, 6*6);
+        self.mesh.pushUnitCuboid();
+
+        const light = gpu.ShaderCamera{
+            .cam_pos = self.gpu_ctx.cur_cam_world_pos,
+            .light_vec = self.gpu_ctx.light_vec,
+            .light_color = self.gpu_ctx.light_color,
+            .light_vp = undefined,
+            .enable_shadows = false,
+        };
+        self.renderer.pushCuboidsPbr3D(vp.mat, buf.inner.buf_id, buf.num_instances, light, self.gpu_ctx.white_tex.tex_id);
+    }
 };
 
 pub fn initImage(image: *gpu.Image, width: usize, height: usize, data: ?[]const u8, linear_filter: bool) void {
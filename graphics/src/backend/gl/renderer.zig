@@ -78,9 +78,11 @@ pub const Renderer = struct {
         // Initialize pipelines.
         self.pipelines = .{
             .tex = try shaders.TexShader.init(self.vert_buf_id),
+            .tex_sdf = try shaders.TexShader.initSdf(self.vert_buf_id),
             .gradient = try shaders.GradientShader.init(self.vert_buf_id),
             .plane = try shaders.PlaneShader.init(self.vert_buf_id),
             .tex_pbr = try shaders.TexPbrShader.init(alloc, self.vert_buf_id),
+            .cuboid_pbr = try shaders.CuboidPbrShader.init(alloc, self.vert_buf_id),
         };
 
         // Enable blending by default.
@@ -147,6 +149,19 @@ pub const Renderer = struct {
         self.pushCurrentElements();
     }
 
+    /// Draws the current mesh once per instance in a cuboid buffer.
+    pub fn pushCuboidsPbr3D(self: *Renderer, vp: Mat4, inst_buf_id: gl.GLuint, num_instances: u32, light: gpu.ShaderCamera, tex_id: TextureId) void {
+        const gl_tex_id = self.image_store.getTexture(tex_id).inner.tex_id;
+        self.setDepthTest(true);
+        self.pipelines.cuboid_pbr.bind(vp, gl_tex_id, light);
+        gl.bindVertexArray(self.pipelines.cuboid_pbr.shader.vao_id);
+        self.pipelines.cuboid_pbr.bindInstanceBuffer(inst_buf_id);
+
+        self.uploadCurrentElements();
+        gl.drawElementsInstanced(gl.GL_TRIANGLES, self.mesh.cur_index_buf_size, self.mesh.index_buffer_type, 0, num_instances);
+        self.mesh.reset();
+    }
+
     pub fn ensurePushMeshData(self: *Renderer, verts: []const TexShaderVertex, indexes: []const u16) void {
         self.ensureUnusedBuffer(verts.len, indexes.len);
         const vert_start = self.mesh.pushVertexes(verts);
@@ -162,6 +177,12 @@ pub const Renderer = struct {
     }
 
     fn pushCurrentElements(self: *Renderer) void {
+        self.uploadCurrentElements();
+        gl.drawElements(gl.GL_TRIANGLES, self.mesh.cur_index_buf_size, self.mesh.index_buffer_type, 0);
+        self.mesh.reset();
+    }
+
+    fn uploadCurrentElements(self: *Renderer) void {
         const num_verts = self.mesh.cur_vert_buf_size;
         const num_indexes = self.mesh.cur_index_buf_size;
 
@@ -172,9 +193,6 @@ pub const Renderer = struct {
         // Update index buffer.
         gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.index_buf_id);
         gl.bufferData(gl.GL_ELEMENT_ARRAY_BUFFER, @intCast(c_long, num_indexes * 2), self.mesh.index_buf.ptr, gl.GL_DYNAMIC_DRAW);
-
-        gl.drawElements(gl.GL_TRIANGLES, num_indexes, self.mesh.index_buffer_type, 0);
-        self.mesh.reset();
     }
 
     pub fn setDepthTest(self: *Renderer, depth_test: bool) void {
@@ -192,13 +210,17 @@ pub const Renderer = struct {
 
 pub const Pipelines = struct {
     tex: shaders.TexShader,
+    tex_sdf: shaders.TexShader,
     gradient: shaders.GradientShader,
     plane: shaders.PlaneShader,
     tex_pbr: shaders.TexPbrShader,
+    cuboid_pbr: shaders.CuboidPbrShader,
 
     pub fn deinit(self: Pipelines) void {
         self.tex.deinit();
+        self.tex_sdf.deinit();
         self.tex_pbr.deinit();
+        self.cuboid_pbr.deinit();
         self.gradient.deinit();
         self.plane.deinit();
     }
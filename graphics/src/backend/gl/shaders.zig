@@ -21,12 +21,21 @@ const tex_frag = @embedFile("shaders/tex_frag.glsl");
 const tex_vert_webgl2 = @embedFile("shaders/tex_vert_webgl2.glsl");
 const tex_frag_webgl2 = @embedFile("shaders/tex_frag_webgl2.glsl");
 
+const tex_sdf_frag = @embedFile("shaders/tex_sdf_frag.glsl");
+const tex_sdf_frag_webgl2 = @embedFile("shaders/tex_sdf_frag_webgl2.glsl");
+
 const tex_pbr_vert = @embedFile("shaders/tex_pbr_vert.glsl");
 const tex_pbr_frag = @embedFile("shaders/tex_pbr_frag.glsl");
 
 const tex_pbr_vert_webgl2 = @embedFile("shaders/tex_pbr_vert_webgl2.glsl");
 const tex_pbr_frag_webgl2 = @embedFile("shaders/tex_pbr_frag_webgl2.glsl");
 
+const cuboid_pbr_vert = @embedFile("shaders/cuboid_pbr_vert.glsl");
+const cuboid_pbr_frag = @embedFile("shaders/cuboid_pbr_frag.glsl");
+
+const cuboid_pbr_vert_webgl2 = @embedFile("shaders/cuboid_pbr_vert_webgl2.glsl");
+const cuboid_pbr_frag_webgl2 = @embedFile("shaders/cuboid_pbr_frag_webgl2.glsl");
+
 const pbr_src = @embedFile("shaders/pbr.glsl");
 
 const gradient_vert = @embedFile("shaders/gradient_vert.glsl");
@@ -135,6 +144,98 @@ pub const TexPbrShader = struct {
     }
 };
 
+/// Instanced pbr shader for axis aligned cuboids. Vertex attributes come from the shared vertex buffer
+/// and per instance attributes come from the buffer set with bindInstanceBuffer.
+pub const CuboidPbrShader = struct {
+    shader: Shader,
+    u_const_vp: gl.GLint,
+    u_light_cam_pos: gl.GLint,
+    u_light_vec: gl.GLint,
+    u_light_color: gl.GLint,
+    u_light_vp: gl.GLint,
+    u_light_enable_shadows: gl.GLint,
+    u_tex: gl.GLint,
+
+    const Instance = graphics.CuboidInstance;
+    const material_offset = @offsetOf(Instance, "material");
+    const inst_attrs = [_]ShaderAttribute{
+        // a_inst_pos
+        ShaderAttribute.init(3, @offsetOf(Instance, "pos"), gl.GL_FLOAT, 3),
+        // a_inst_extent
+        ShaderAttribute.init(4, @offsetOf(Instance, "extent"), gl.GL_FLOAT, 3),
+        // a_inst_material (emissivity, roughness, metallic)
+        ShaderAttribute.init(5, material_offset + @offsetOf(graphics.Material, "emissivity"), gl.GL_FLOAT, 3),
+        // a_inst_albedo
+        ShaderAttribute.init(6, material_offset + @offsetOf(graphics.Material, "albedo_color"), gl.GL_FLOAT, 4),
+    };
+
+    pub fn init(alloc: std.mem.Allocator, vert_buf_id: gl.GLuint) !CuboidPbrShader {
+        const needle = "#include \"pbr.glsl\"";
+        const frag_src = if (IsWasm) cuboid_pbr_frag_webgl2 else cuboid_pbr_frag;
+        const final_frag_size = std.mem.replacementSize(u8, frag_src, needle, pbr_src);
+        const final_frag = try alloc.alloc(u8, final_frag_size);
+        defer alloc.free(final_frag);
+        _ = std.mem.replace(u8, frag_src, needle, pbr_src, final_frag);
+        const shader = try Shader.init(if (IsWasm) cuboid_pbr_vert_webgl2 else cuboid_pbr_vert, final_frag);
+
+        gl.bindVertexArray(shader.vao_id);
+        defer gl.bindVertexArray(0);
+
+        gl.bindBuffer(gl.GL_ARRAY_BUFFER, vert_buf_id);
+        bindAttributes(@sizeOf(TexShaderVertex), &.{
+            // a_pos
+            ShaderAttribute.init(0, @offsetOf(TexShaderVertex, "pos"), gl.GL_FLOAT, 4),
+            // a_normal
+            ShaderAttribute.init(1, @offsetOf(TexShaderVertex, "normal"), gl.GL_FLOAT, 3),
+            // a_uv
+            ShaderAttribute.init(2, @offsetOf(TexShaderVertex, "uv"), gl.GL_FLOAT, 2),
+        });
+
+        for (inst_attrs) |attr| {
+            gl.vertexAttribDivisor(attr.pos, 1);
+        }
+
+        return CuboidPbrShader{
+            .shader = shader,
+            .u_const_vp = try shader.getUniformLocation("u_const.vp"),
+            .u_light_cam_pos = try shader.getUniformLocation("u_light.cam_pos"),
+            .u_light_vec = try shader.getUniformLocation("u_light.light_vec"),
+            .u_light_color = try shader.getUniformLocation("u_light.light_color"),
+            .u_light_vp = try shader.getUniformLocation("u_light.light_vp"),
+            .u_light_enable_shadows = try shader.getUniformLocation("u_light.enable_shadows"),
+            .u_tex = try shader.getUniformLocation("u_tex"),
+        };
+    }
+
+    pub fn deinit(self: CuboidPbrShader) void {
+        self.shader.deinit();
+    }
+
+    /// Points the per instance attributes at a cuboid buffer. Assumes the shader's vao is bound.
+    pub fn bindInstanceBuffer(self: CuboidPbrShader, buf_id: gl.GLuint) void {
+        _ = self;
+        gl.bindBuffer(gl.GL_ARRAY_BUFFER, buf_id);
+        bindAttributes(@sizeOf(Instance), &inst_attrs);
+    }
+
+    pub fn bind(self: CuboidPbrShader, vp: Mat4, tex_id: GLtextureId, light: gpu.ShaderCamera) void {
+        gl.useProgram(self.shader.prog_id);
+
+        gl.uniformMatrix4fv(self.u_const_vp, 1, gl.GL_FALSE, &vp);
+
+        gl.uniform3fv(self.u_light_cam_pos, 1, &light.cam_pos.x);
+        gl.uniform3fv(self.u_light_vec, 1, &light.light_vec.x);
+        gl.uniform3fv(self.u_light_color, 1, &light.light_color.x);
+        gl.uniformMatrix4fv(self.u_light_vp, 1, gl.GL_FALSE, &light.light_vp);
+        gl.uniform1i(self.u_light_enable_shadows, if (light.enable_shadows) 1 else 0);
+
+        gl.activeTexture(gl.GL_TEXTURE0);
+        gl.bindTexture(gl.GL_TEXTURE_2D, tex_id);
+        // set tex to active texture.
+        gl.uniform1i(self.u_tex, 0);
+    }
+};
+
 pub const PlaneShader = struct {
     shader: Shader,
     u_const: gl.GLint,
@@ -180,12 +281,24 @@ pub const TexShader = struct {
     u_tex: gl.GLint,
 
     pub fn init(vert_buf_id: gl.GLuint) !TexShader {
-        var shader: Shader = undefined;
         if (IsWasm) {
-            shader = Shader.init(tex_vert_webgl2, tex_frag_webgl2) catch unreachable;
+            return initFromSrc(vert_buf_id, tex_vert_webgl2, tex_frag_webgl2);
+        } else {
+            return initFromSrc(vert_buf_id, tex_vert, tex_frag);
+        }
+    }
+
+    /// Same vertex layout but the texture alpha is a distance field. Used for sdf glyphs.
+    pub fn initSdf(vert_buf_id: gl.GLuint) !TexShader {
+        if (IsWasm) {
+            return initFromSrc(vert_buf_id, tex_vert_webgl2, tex_sdf_frag_webgl2);
         } else {
-            shader = Shader.init(tex_vert, tex_frag) catch unreachable;
+            return initFromSrc(vert_buf_id, tex_vert, tex_sdf_frag);
         }
+    }
+
+    fn initFromSrc(vert_buf_id: gl.GLuint, vert_src: []const u8, frag_src: []const u8) !TexShader {
+        const shader = Shader.init(vert_src, frag_src) catch unreachable;
 
         gl.bindVertexArray(shader.vao_id);
         defer gl.bindVertexArray(0);
@@ -0,0 +1,49 @@
+#version 300 es
+
+precision mediump float;
+
+struct Light {
+    vec3 cam_pos;
+    // Directional light, assume normalized.
+    vec3 light_vec;
+    vec3 light_color;
+    mat4 light_vp;
+    bool enable_shadows;
+};
+
+struct VertConstants {
+    mat4 vp;
+};
+
+uniform VertConstants u_const;
+uniform Light u_light;
+
+layout(location = 0) in vec4 a_pos;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_uv;
+
+// Per instance.
+layout(location = 3) in vec3 a_inst_pos;
+layout(location = 4) in vec3 a_inst_extent;
+// Emissivity, roughness, metallic.
+layout(location = 5) in vec3 a_inst_material;
+layout(location = 6) in vec4 a_inst_albedo;
+
+smooth out vec2 v_uv;
+smooth out vec3 v_normal;
+smooth out vec3 v_pos;
+smooth out vec4 v_light_pos;
+flat out vec3 v_material;
+flat out vec4 v_albedo;
+
+void main() {
+    v_uv = a_uv;
+    // Cuboids are axis aligned so scaling doesn't change the normals.
+    v_normal = a_normal;
+    vec4 world_pos = vec4(a_pos.xyz * a_inst_extent + a_inst_pos, 1.0);
+    v_pos = world_pos.xyz;
+    v_light_pos = world_pos * u_light.light_vp;
+    v_material = a_inst_material;
+    v_albedo = a_inst_albedo;
+    gl_Position = world_pos * u_const.vp;
+}
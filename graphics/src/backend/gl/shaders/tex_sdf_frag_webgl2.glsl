@@ -0,0 +1,18 @@
+#version 300 es
+
+precision mediump float;
+
+uniform sampler2D u_tex;
+
+in vec2 v_uv;
+in vec4 v_color;
+
+out vec4 f_color;
+
+void main() {
+    // Alpha holds a distance field with the edge at 0.5. Antialias across a screen pixel.
+    float dist = texture(u_tex, v_uv).a;
+    float width = fwidth(dist);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+    f_color = vec4(v_color.rgb, v_color.a * alpha);
+}
@@ -46,6 +46,8 @@ const ShaderType = enum(u4) {
     Normal = 7,
     TexPbr3D = 8,
     AnimPbr3D = 9,
+    TexSdf = 10,
+    CuboidPbr3D = 11,
 };
 
 const PreFlushTask = struct {
@@ -77,6 +79,8 @@ pub const Batcher = struct {
     normal: stdx.math.Mat3,
     material_idx: u32,
     model_idx: u32,
+    /// Number of instances drawn by the next CuboidPbr3D command.
+    instance_count: u32,
 
     /// It's useful to store the current texture associated with the current buffer data, 
     /// so a resize op can know whether to trigger a force flush.
@@ -85,6 +89,13 @@ pub const Batcher = struct {
     /// Keep track of the current shader used.
     cur_shader_type: ShaderType,
 
+    /// The fill shader that was active before drawing sdf glyphs. eg. Gradient.
+    sdf_restore_shader_type: ShaderType,
+
+    /// Switches to a different image that shared the current texture and didn't end the batch. eg. Images in the same atlas page.
+    saved_draw_calls: u32,
+    last_frame_saved_draw_calls: u32,
+
     inner: switch (Backend) {
         .OpenGL => struct {
             renderer: *graphics.gl.Renderer,
@@ -112,6 +123,8 @@ pub const Batcher = struct {
             do_shadow_pass: bool,
             // Directional light shadow cast view * proj.
             light_cast_vp: Transform,
+            /// Instance buffer bound to binding 1 for the next CuboidPbr3D command.
+            cur_cuboid_buf: vk.VkBuffer,
         },
         else => void,
     },
@@ -142,11 +155,15 @@ pub const Batcher = struct {
             .mvp = undefined,
             .normal = undefined,
             .material_idx = undefined,
+            .instance_count = 1,
             .cur_image_tex = .{
                 .image_id = NullId,
                 .tex_id = NullId,
             },
+            .saved_draw_calls = 0,
+            .last_frame_saved_draw_calls = 0,
             .cur_shader_type = undefined,
+            .sdf_restore_shader_type = .Tex,
             .model_idx = undefined,
             .start_pos = undefined,
             .start_color = undefined,
@@ -179,11 +196,15 @@ pub const Batcher = struct {
             .normal = undefined,
             .material_idx = undefined,
             .model_idx = undefined,
+            .instance_count = 1,
             .cur_image_tex = .{
                 .image_id = NullId,
                 .tex_id = NullId,
             },
+            .saved_draw_calls = 0,
+            .last_frame_saved_draw_calls = 0,
             .cur_shader_type = undefined,
+            .sdf_restore_shader_type = .Tex,
             .start_pos = undefined,
             .start_color = undefined,
             .end_pos = undefined,
@@ -209,6 +230,7 @@ pub const Batcher = struct {
                 .host_materials_buf = undefined,
                 .do_shadow_pass = false,
                 .light_cast_vp = undefined,
+                .cur_cuboid_buf = undefined,
             },
             .image_store = image_store,
         };
@@ -272,6 +294,18 @@ pub const Batcher = struct {
         }) catch @panic("error");
     }
 
+    /// Removes queued tasks for a ctx that is about to be freed.
+    pub fn removePreFlushTasks(self: *Batcher, ctx: ?*anyopaque) void {
+        var i: usize = 0;
+        while (i < self.pre_flush_tasks.items.len) {
+            if (self.pre_flush_tasks.items[i].ctx == ctx) {
+                _ = self.pre_flush_tasks.orderedRemove(i);
+            } else {
+                i += 1;
+            }
+        }
+    }
+
     /// Begins the tex shader. Will flush previous batched command.
     pub fn beginTex(self: *Batcher, image: ImageTex) void {
         if (self.cur_shader_type != .Tex) {
@@ -317,6 +351,17 @@ pub const Batcher = struct {
         }
     }
 
+    pub fn beginCuboidPbr3D(self: *Batcher, image: ImageTex, cam_loc: stdx.math.Vec3) void {
+        if (self.cur_shader_type != .CuboidPbr3D) {
+            self.endCmd();
+            self.cur_shader_type = .CuboidPbr3D;
+        }
+        self.setTexture(image);
+        if (Backend == .Vulkan) {
+            self.inner.cur_batcher_frame.host_cam_buf.cam_pos = cam_loc;
+        }
+    }
+
     pub fn beginAnimPbr3D(self: *Batcher, image: ImageTex, cam_loc: stdx.math.Vec3) void {
         if (self.cur_shader_type != .AnimPbr3D) {
             self.endCmd();
@@ -363,6 +408,21 @@ pub const Batcher = struct {
 
     // TODO: we can use sample2d arrays and pass active tex ids in vertex data to further reduce number of flushes.
     pub fn beginTexture(self: *Batcher, image: ImageTex) void {
+        // Sdf glyphs don't carry over to other textured draws.
+        if (self.cur_shader_type == .TexSdf) {
+            self.endCmd();
+            self.cur_shader_type = self.sdf_restore_shader_type;
+        }
+        self.setTexture(image);
+    }
+
+    /// The texture's alpha channel is a distance field. eg. Sdf glyphs.
+    pub fn beginTexSdf(self: *Batcher, image: ImageTex) void {
+        if (self.cur_shader_type != .TexSdf) {
+            self.endCmd();
+            self.sdf_restore_shader_type = self.cur_shader_type;
+            self.cur_shader_type = .TexSdf;
+        }
         self.setTexture(image);
     }
 
@@ -379,10 +439,19 @@ pub const Batcher = struct {
                 },
                 else => {},
             }
+        } else if (self.cur_image_tex.image_id != image.image_id) {
+            self.saved_draw_calls += 1;
+            self.cur_image_tex.image_id = image.image_id;
         }
     }
 
+    fn resetSavedDrawCalls(self: *Batcher) void {
+        self.last_frame_saved_draw_calls = self.saved_draw_calls;
+        self.saved_draw_calls = 0;
+    }
+
     pub fn resetState(self: *Batcher, tex: ImageTex) void {
+        self.resetSavedDrawCalls();
         self.cur_image_tex = tex;
         self.cur_shader_type = .Tex;
         self.cmd_vert_start_idx = 0;
@@ -397,6 +466,7 @@ pub const Batcher = struct {
         self.inner.cur_tex_desc_set = self.image_store.getTexture(image_tex.tex_id).inner.desc_set;
         self.inner.do_shadow_pass = false;
 
+        self.resetSavedDrawCalls();
         self.cur_image_tex = image_tex;
         self.cur_shader_type = .Tex;
         self.cmd_vert_start_idx = 0;
@@ -604,6 +674,11 @@ pub const Batcher = struct {
                         // Recall how to pull data from the buffer for shader.
                         gl.bindVertexArray(self.inner.renderer.pipelines.tex.shader.vao_id);
                     },
+                    .TexSdf => {
+                        self.inner.renderer.setDepthTest(false);
+                        self.inner.renderer.pipelines.tex_sdf.bind(self.mvp.mat, self.inner.cur_gl_tex_id);
+                        gl.bindVertexArray(self.inner.renderer.pipelines.tex_sdf.shader.vao_id);
+                    },
                     .Gradient => {
                         self.inner.renderer.setDepthTest(false);
                         self.inner.renderer.pipelines.gradient.bind(self.mvp.mat, self.start_pos, self.start_color, self.end_pos, self.end_color);
@@ -612,6 +687,7 @@ pub const Batcher = struct {
                     },
                     .Tex3D,
                     .TexPbr3D,
+                    .CuboidPbr3D,
                     .Wireframe,
                     .Custom => unsupported(),
                 }
@@ -686,6 +762,39 @@ pub const Batcher = struct {
                         };
                         vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.TexLightingVertexConstant), &push_const);
                     },
+                    .CuboidPbr3D => {
+                        var offset: vk.VkDeviceSize = 0;
+                        if (self.inner.do_shadow_pass) {
+                            const shadow_p = self.inner.pipelines.cuboid_shadow_pipeline;
+                            const shadow_cmd = self.inner.cur_frame.shadow_cmd_buf;
+                            vk.cmdBindPipeline(shadow_cmd, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_p.pipeline);
+                            const desc_sets = [_]vk.VkDescriptorSet{
+                                self.inner.cur_tex_desc_set,
+                            };
+                            vk.cmdBindDescriptorSets(shadow_cmd, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_p.layout, 0, desc_sets.len, &desc_sets, 0, null);
+                            var push_const = gvk.CuboidVertexConstant{
+                                .vp = self.inner.light_cast_vp.mat,
+                            };
+                            vk.cmdPushConstants(shadow_cmd, shadow_p.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.CuboidVertexConstant), &push_const);
+                            vk.cmdBindVertexBuffers(shadow_cmd, 1, 1, &self.inner.cur_cuboid_buf, &offset);
+                            vk.cmdDrawIndexed(shadow_cmd, num_indexes, self.instance_count, self.cmd_index_start_idx, 0, 0);
+                        }
+                        const pipeline = self.inner.pipelines.cuboid_pbr_pipeline;
+                        vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+                        const desc_sets = [_]vk.VkDescriptorSet{
+                            self.inner.cur_tex_desc_set,
+                            self.inner.mats_desc_set,
+                            self.inner.cur_frame.cam_desc_set,
+                            self.inner.materials_desc_set,
+                            self.inner.cur_frame.shadowmap_desc_set,
+                        };
+                        vk.cmdBindDescriptorSets(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, desc_sets.len, &desc_sets, 0, null);
+                        var push_const = gvk.CuboidVertexConstant{
+                            .vp = self.mvp.mat,
+                        };
+                        vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.CuboidVertexConstant), &push_const);
+                        vk.cmdBindVertexBuffers(cmd_buf, 1, 1, &self.inner.cur_cuboid_buf, &offset);
+                    },
                     .AnimPbr3D => {
                         if (self.inner.do_shadow_pass) {
                             const shadow_p = self.inner.pipelines.anim_shadow_pipeline;
@@ -767,6 +876,20 @@ pub const Batcher = struct {
                         };
                         vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.ModelVertexConstant), &push_const);
                     },
+                    .TexSdf => {
+                        const pipeline = self.inner.pipelines.tex_sdf_pipeline_2d;
+                        vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+                        const desc_sets = [_]vk.VkDescriptorSet{
+                            self.inner.cur_tex_desc_set,
+                            self.inner.mats_desc_set,
+                        };
+                        vk.cmdBindDescriptorSets(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, desc_sets.len, &desc_sets, 0, null);
+                        var push_const = gvk.ModelVertexConstant{
+                            .vp = self.mvp.mat,
+                            .model_idx = 0,
+                        };
+                        vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.ModelVertexConstant), &push_const);
+                    },
                     .Gradient => {
                         const pipeline = self.inner.pipelines.gradient_pipeline_2d;
                         vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
@@ -786,7 +909,8 @@ pub const Batcher = struct {
                     },
                     else => stdx.unsupported(),
                 }
-                vk.cmdDrawIndexed(cmd_buf, num_indexes, 1, self.cmd_index_start_idx, 0, 0);
+                const instance_count: u32 = if (self.cur_shader_type == .CuboidPbr3D) self.instance_count else 1;
+                vk.cmdDrawIndexed(cmd_buf, num_indexes, instance_count, self.cmd_index_start_idx, 0, 0);
             },
             else => stdx.unsupported(),
         }
@@ -0,0 +1,166 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const build_options = @import("build_options");
+const Backend = build_options.GraphicsBackend;
+const gl = @import("gl");
+const vk = @import("vk");
+
+const graphics = @import("../../graphics.zig");
+const gvk = graphics.vk;
+const CuboidInstance = graphics.CuboidInstance;
+
+pub const CuboidBufferId = u32;
+
+/// Cuboid instances that stay on the gpu until they're updated or removed.
+/// The vertex shader expands each (pos, extent) record to a model matrix.
+pub const CuboidBuffer = struct {
+    num_instances: u32,
+    inner: switch (Backend) {
+        .OpenGL => struct {
+            buf_id: gl.GLuint,
+        },
+        .Vulkan => struct {
+            /// Null when there are no instances.
+            buf: ?gvk.Buffer,
+        },
+        else => void,
+    },
+};
+
+pub const CuboidBufferStore = struct {
+    alloc: std.mem.Allocator,
+    gpu: *graphics.gpu.Graphics,
+    bufs: stdx.ds.PooledHandleList(CuboidBufferId, CuboidBuffer),
+
+    /// Vulkan buffers are queued for removal due to multiple frames in flight.
+    removals: std.ArrayList(RemoveEntry),
+
+    pub fn init(alloc: std.mem.Allocator, gctx: *graphics.gpu.Graphics) CuboidBufferStore {
+        return .{
+            .alloc = alloc,
+            .gpu = gctx,
+            .bufs = stdx.ds.PooledHandleList(CuboidBufferId, CuboidBuffer).init(alloc),
+            .removals = std.ArrayList(RemoveEntry).init(alloc),
+        };
+    }
+
+    pub fn deinit(self: *CuboidBufferStore) void {
+        var iter = self.bufs.iterator();
+        while (iter.next()) |buf| {
+            self.deinitBuffer(buf);
+        }
+        self.bufs.deinit();
+
+        if (Backend == .Vulkan) {
+            for (self.removals.items) |entry| {
+                entry.buf.deinit(self.gpu.inner.ctx.device);
+            }
+        }
+        self.removals.deinit();
+    }
+
+    pub fn create(self: *CuboidBufferStore, instances: []const CuboidInstance) CuboidBufferId {
+        var buf = CuboidBuffer{
+            .num_instances = 0,
+            .inner = undefined,
+        };
+        switch (Backend) {
+            .OpenGL => gl.genBuffers(1, &buf.inner.buf_id),
+            .Vulkan => buf.inner.buf = null,
+            else => {},
+        }
+        const id = self.bufs.add(buf) catch stdx.fatal();
+        self.update(id, instances);
+        return id;
+    }
+
+    /// Replaces the instances. Only needs to be called when they change.
+    pub fn update(self: *CuboidBufferStore, id: CuboidBufferId, instances: []const CuboidInstance) void {
+        const buf = self.bufs.getPtrNoCheck(id);
+        buf.num_instances = @intCast(u32, instances.len);
+        switch (Backend) {
+            .OpenGL => {
+                gl.bindBuffer(gl.GL_ARRAY_BUFFER, buf.inner.buf_id);
+                gl.bufferData(gl.GL_ARRAY_BUFFER, @intCast(c_long, instances.len * @sizeOf(CuboidInstance)), instances.ptr, gl.GL_STATIC_DRAW);
+            },
+            .Vulkan => {
+                // Frames in flight could still be reading the old buffer so a new one is created.
+                if (buf.inner.buf) |old| {
+                    self.queueRemoval(old);
+                    buf.inner.buf = null;
+                }
+                if (instances.len > 0) {
+                    const ctx = self.gpu.inner.ctx;
+                    const size = instances.len * @sizeOf(CuboidInstance);
+                    const new = gvk.buffer.createVertexBuffer(ctx.physical, ctx.device, size);
+                    var data: [*]u8 = undefined;
+                    const res = vk.mapMemory(ctx.device, new.mem, 0, size, 0, @ptrCast([*c]?*anyopaque, &data));
+                    vk.assertSuccess(res);
+                    std.mem.copy(u8, data[0..size], std.mem.sliceAsBytes(instances));
+                    vk.unmapMemory(ctx.device, new.mem);
+                    buf.inner.buf = new;
+                }
+            },
+            else => stdx.unsupported(),
+        }
+    }
+
+    pub fn remove(self: *CuboidBufferStore, id: CuboidBufferId) void {
+        const buf = self.bufs.getNoCheck(id);
+        switch (Backend) {
+            .OpenGL => self.deinitBuffer(buf),
+            .Vulkan => {
+                if (buf.inner.buf) |vk_buf| {
+                    self.queueRemoval(vk_buf);
+                }
+            },
+            else => {},
+        }
+        self.bufs.remove(id);
+    }
+
+    pub inline fn get(self: CuboidBufferStore, id: CuboidBufferId) CuboidBuffer {
+        return self.bufs.getNoCheck(id);
+    }
+
+    /// Frees removed buffers that are no longer used by a frame in flight.
+    pub fn processRemovals(self: *CuboidBufferStore) void {
+        if (Backend == .Vulkan) {
+            var entry_idx: usize = 0;
+            while (entry_idx < self.removals.items.len) {
+                const entry = &self.removals.items[entry_idx];
+                if (entry.frame_age < gvk.MaxActiveFrames) {
+                    entry.frame_age += 1;
+                    entry_idx += 1;
+                    continue;
+                }
+                entry.buf.deinit(self.gpu.inner.ctx.device);
+                _ = self.removals.swapRemove(entry_idx);
+            }
+        }
+    }
+
+    fn queueRemoval(self: *CuboidBufferStore, buf: gvk.Buffer) void {
+        self.removals.append(.{
+            .buf = buf,
+            .frame_age = 0,
+        }) catch stdx.fatal();
+    }
+
+    fn deinitBuffer(self: CuboidBufferStore, buf: CuboidBuffer) void {
+        switch (Backend) {
+            .OpenGL => gl.deleteBuffers(1, &buf.inner.buf_id),
+            .Vulkan => {
+                if (buf.inner.buf) |vk_buf| {
+                    vk_buf.deinit(self.gpu.inner.ctx.device);
+                }
+            },
+            else => {},
+        }
+    }
+};
+
+const RemoveEntry = struct {
+    buf: gvk.Buffer,
+    frame_age: u32,
+};
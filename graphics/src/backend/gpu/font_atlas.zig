@@ -5,134 +5,302 @@ const Point2 = stdx.math.Point2;
 
 const graphics = @import("../../graphics.zig");
 const gpu = graphics.gpu;
+const Glyph = gpu.Glyph;
 const RectBinPacker = graphics.RectBinPacker;
 const log = stdx.log.scoped(.font_atlas);
 
-/// Holds a buffer of font glyphs in memory that is then synced to the gpu.
+/// A page with less than this fraction of its area covered by glyphs is compacted before a new page is added.
+const CompactMaxUsage = 0.6;
+
+/// Holds font glyphs in fixed size pages in memory that are synced to the gpu.
+/// Pages are added until max_pages is reached. After that, the least recently used page is repacked with only the glyphs used this frame
+/// and the rest are evicted. Evicted glyphs are detected lazily since their generation no longer matches their page.
 pub const FontAtlas = struct {
     g: *gpu.Graphics,
 
-    /// Uses a rect bin packer to allocate space.
-    packer: RectBinPacker,
+    /// Pages are heap allocated since they are referenced by pre flush tasks.
+    pages: std.ArrayListUnmanaged(*Page),
 
-    /// The gl buffer always contains 4 channels. This lets it use the same shader/batch for rendering outline text.
-    /// Kept in memory since it will be updated for glyphs on demand.
-    gl_buf: []u8,
+    page_width: u32,
+    page_height: u32,
 
-    width: u32,
-    height: u32,
+    /// Limits the memory used by the atlas. Each page uses page_width * page_height * 4 bytes on the cpu and gpu.
+    max_pages: u32,
+
+    /// The page buffers always contain 4 channels. This lets it use the same shader/batch for rendering outline text.
     channels: u8,
 
-    image: gpu.ImageTex,
+    /// Each new or repacked page gets the next generation.
+    next_generation: u32,
 
-    // The same allocator is used to do resizing.
+    // The same allocator is used to allocate pages.
     alloc: std.mem.Allocator,
 
     linear_filter: bool,
-    dirty: bool,
 
     /// Linear filter disabled is good for bitmap fonts that scale upwards.
     /// Outline glyphs and color bitmaps would use linear filtering. Although in the future, outline glyphs might also need to have linear filter disabled.
-    pub fn init(self: *FontAtlas, alloc: std.mem.Allocator, g: *gpu.Graphics, width: u32, height: u32, linear_filter: bool) void {
+    pub fn init(self: *FontAtlas, alloc: std.mem.Allocator, g: *gpu.Graphics, page_width: u32, page_height: u32, max_pages: u32, linear_filter: bool) void {
         self.* = .{
             .g = g,
             .alloc = alloc,
-            .packer = RectBinPacker.init(alloc, width, height),
-            .width = width,
-            .height = height,
+            .pages = .{},
+            .page_width = page_width,
+            .page_height = page_height,
+            .max_pages = std.math.max(max_pages, 1),
             // Always 4 to match the gpu texture data.
             .channels = 4,
-            .image = undefined,
-            .gl_buf = undefined,
+            .next_generation = 0,
             .linear_filter = linear_filter,
-            .dirty = false,
         };
-        self.image = g.image_store.createImageFromBitmap(width, height, null, .{
-            .linear_filter = linear_filter
-        });
+        self.addPage();
+    }
+
+    pub fn deinit(self: *FontAtlas) void {
+        for (self.pages.items) |page| {
+            page.deinit(self.alloc);
+            self.g.image_store.markForRemoval(page.image.image_id);
+            self.alloc.destroy(page);
+        }
+        self.pages.deinit(self.alloc);
+    }
+
+    /// Pages beyond the new limit are removed and their glyphs are evicted.
+    pub fn setMaxPages(self: *FontAtlas, max_pages: u32) void {
+        self.max_pages = std.math.max(max_pages, 1);
+        while (self.pages.items.len > self.max_pages) {
+            const page = self.pages.pop();
+            self.g.batcher.removePreFlushTasks(page);
+            page.deinit(self.alloc);
+            self.g.image_store.endCmdAndMarkForRemoval(page.image.image_id);
+            self.alloc.destroy(page);
+        }
+    }
+
+    pub fn getPageMemorySize(self: FontAtlas) usize {
+        return self.page_width * self.page_height * self.channels;
+    }
+
+    fn addPage(self: *FontAtlas) void {
+        const page = self.alloc.create(Page) catch stdx.fatal();
+        page.init(self, self.next_generation);
+        self.next_generation += 1;
+        self.pages.append(self.alloc, page) catch stdx.fatal();
+        log.debug("font atlas page {}", .{self.pages.items.len});
+    }
+
+    /// Finds space for a glyph rect including its padding.
+    /// A blank glyph (zero size) still gets a slot on the newest page so its image is tracked.
+    pub fn allocGlyph(self: *FontAtlas, width: u32, height: u32) GlyphSlot {
+        if (width > self.page_width or height > self.page_height) {
+            stdx.panicFmt("glyph {}x{} does not fit in a font atlas page", .{ width, height });
+        }
+        if (width == 0 or height == 0) {
+            return self.getSlot(@intCast(u32, self.pages.items.len - 1), 0, 0);
+        }
+        if (self.tryAllocGlyph(width, height)) |slot| {
+            return slot;
+        }
+
+        // Reclaim space from pages where skyline packing left large gaps.
+        for (self.pages.items) |page, i| {
+            const usage = @intToFloat(f32, page.glyph_area) / @intToFloat(f32, self.page_width * self.page_height);
+            if (usage < CompactMaxUsage and !page.compacted) {
+                self.repack(@intCast(u32, i), null);
+                if (page.packer.tryAllocRect(width, height)) |pos| {
+                    return self.allocSlot(@intCast(u32, i), pos, width, height);
+                }
+            }
+        }
 
-        self.gl_buf = alloc.alloc(u8, width * height * self.channels) catch @panic("error");
-        std.mem.set(u8, self.gl_buf, 0);
+        if (self.pages.items.len < self.max_pages) {
+            self.addPage();
+            return self.tryAllocGlyph(width, height).?;
+        }
 
+        // Evict from the least recently used pages first. Glyphs used this frame are kept.
+        const cur_frame = self.g.font_cache.cur_frame;
+        var order = self.alloc.alloc(u32, self.pages.items.len) catch stdx.fatal();
+        defer self.alloc.free(order);
+        for (order) |*it, i| {
+            it.* = @intCast(u32, i);
+        }
         const S = struct {
-            fn onResize(ptr: ?*anyopaque, width_: u32, height_: u32) void {
-                const self_ = stdx.mem.ptrCastAlign(*FontAtlas, ptr);
-                self_.resizeLocalBuffer(width_, height_);
+            fn lessThan(pages: []const *Page, a: u32, b: u32) bool {
+                return pages[a].last_used_frame < pages[b].last_used_frame;
             }
         };
-        self.packer.addResizeCallback(self, S.onResize);
+        std.sort.sort(u32, order, @as([]const *Page, self.pages.items), S.lessThan);
+        for (order) |page_idx| {
+            self.repack(page_idx, cur_frame);
+            if (self.pages.items[page_idx].packer.tryAllocRect(width, height)) |pos| {
+                return self.allocSlot(page_idx, pos, width, height);
+            }
+        }
+
+        // Every page is filled with glyphs from this frame. Their quads are already queued with the old textures so it's safe to clear one.
+        self.repack(order[0], cur_frame + 1);
+        const pos = self.pages.items[order[0]].packer.tryAllocRect(width, height).?;
+        return self.allocSlot(order[0], pos, width, height);
     }
 
-    pub fn deinit(self: FontAtlas) void {
-        self.packer.deinit();
-        self.alloc.free(self.gl_buf);
-        self.g.image_store.markForRemoval(self.image.image_id);
+    fn tryAllocGlyph(self: *FontAtlas, width: u32, height: u32) ?GlyphSlot {
+        for (self.pages.items) |page, i| {
+            if (page.packer.tryAllocRect(width, height)) |pos| {
+                return self.allocSlot(@intCast(u32, i), pos, width, height);
+            }
+        }
+        return null;
     }
 
-    fn resizeLocalBuffer(self: *FontAtlas, width: u32, height: u32) void {
-        const old_buf = self.gl_buf;
-        defer self.alloc.free(old_buf);
+    fn allocSlot(self: *FontAtlas, page_idx: u32, pos: Point2(u32), width: u32, height: u32) GlyphSlot {
+        const page = self.pages.items[page_idx];
+        page.glyph_area += width * height;
+        // New glyphs can leave gaps worth compacting again.
+        page.compacted = false;
+        return self.getSlot(page_idx, pos.x, pos.y);
+    }
 
-        self.gl_buf = self.alloc.alloc(u8, width * height * self.channels) catch @panic("error");
-        std.mem.set(u8, self.gl_buf, 0);
+    fn getSlot(self: *FontAtlas, page_idx: u32, x: u32, y: u32) GlyphSlot {
+        const page = self.pages.items[page_idx];
+        page.last_used_frame = self.g.font_cache.cur_frame;
+        return .{
+            .atlas = self,
+            .page = @intCast(u16, page_idx),
+            .generation = page.generation,
+            .image = page.image,
+            .x = x,
+            .y = y,
+        };
+    }
 
-        var old_width = self.width;
-        var old_height = self.height;
-        self.width = width;
-        self.height = height;
+    /// Whether the glyph's pixels are still in its page.
+    pub fn isGlyphValid(self: FontAtlas, glyph: Glyph) bool {
+        return glyph.page < self.pages.items.len and self.pages.items[glyph.page].generation == glyph.generation;
+    }
+
+    /// Stamps the glyph and its page with the current frame so they're evicted last.
+    pub fn markGlyphUsed(self: *FontAtlas, glyph: *Glyph) void {
+        const cur_frame = self.g.font_cache.cur_frame;
+        glyph.last_used_frame = cur_frame;
+        self.pages.items[glyph.page].last_used_frame = cur_frame;
+    }
 
-        // Copy over existing data.
-        self.copySubImageFrom(0, 0, old_width, old_height, old_buf);
+    /// Packs the page's glyphs that were used since min_used_frame into a new texture. Null keeps every glyph.
+    /// Other glyphs on the page are evicted. The old texture is removed once it's no longer in flight,
+    /// so quads already queued with its uvs still draw correctly.
+    fn repack(self: *FontAtlas, page_idx: u32, min_used_frame: ?u32) void {
+        const page = self.pages.items[page_idx];
+
+        // Collect the page's glyphs from every render font.
+        var glyphs = std.ArrayList(*Glyph).init(self.alloc);
+        defer glyphs.deinit();
+        for (self.g.font_cache.render_fonts.items) |*font| {
+            var iter = font.glyphIterator();
+            while (iter.next()) |glyph| {
+                if (self.isPageGlyph(glyph.*, page, min_used_frame)) {
+                    glyphs.append(glyph) catch stdx.fatal();
+                }
+            }
+        }
 
-        // End the current command so the current uv data still maps to correct texture data and create a new image.
-        const old_image_id = self.image.image_id;
-        self.g.image_store.endCmdAndMarkForRemoval(self.image.image_id);
-        self.image = self.g.image_store.createImageFromBitmap(self.width, self.height, null, .{
+        // End the current command so the current uv data still maps to correct texture data.
+        // This must happen before the buffer is replaced since the flush syncs the page to its old texture.
+        self.g.image_store.endCmdAndMarkForRemoval(page.image.image_id);
+        page.syncToOldTexture();
+        page.image = self.g.image_store.createImageFromBitmap(self.page_width, self.page_height, null, .{
             .linear_filter = self.linear_filter,
         });
 
-        // Update tex_id and uvs in existing glyphs.
-        const tex_width = @intToFloat(f32, self.width);
-        const tex_height = @intToFloat(f32, self.height);
-        for (self.g.font_cache.render_fonts.items) |font| {
-            var iter = font.glyphs.valueIterator();
-            while (iter.next()) |glyph| {
-                if (glyph.image.image_id == old_image_id) {
-                    glyph.image = self.image;
-                    const x = @intToFloat(f32, glyph.x);
-                    const y = @intToFloat(f32, glyph.y);
-                    const widthf = @intToFloat(f32, glyph.width);
-                    const heightf = @intToFloat(f32, glyph.height);
-                    glyph.u0 = x / tex_width;
-                    glyph.v0 = y / tex_height;
-                    glyph.u1 = (x + widthf) / tex_width;
-                    glyph.v1 = (y + heightf) / tex_height;
+        const old_buf = page.buf;
+        defer self.alloc.free(old_buf);
+        page.buf = self.alloc.alloc(u8, self.getPageMemorySize()) catch stdx.fatal();
+        std.mem.set(u8, page.buf, 0);
+        page.packer.reset();
+        page.glyph_area = 0;
+        // Repacked pages are already sorted so compacting again won't recover more space until new glyphs are added.
+        page.compacted = true;
+        page.generation = self.next_generation;
+        self.next_generation += 1;
+
+        // Taller glyphs first packs tighter with a skyline.
+        const S = struct {
+            fn lessThan(_: void, a: *Glyph, b: *Glyph) bool {
+                return a.height > b.height;
+            }
+        };
+        std.sort.sort(*Glyph, glyphs.items, {}, S.lessThan);
+
+        const row_size = self.page_width * self.channels;
+        for (glyphs.items) |glyph| {
+            if (glyph.width == 0 or glyph.height == 0) {
+                glyph.generation = page.generation;
+                glyph.image = page.image;
+                continue;
+            }
+            if (page.packer.tryAllocRect(glyph.width, glyph.height)) |pos| {
+                // Copy the glyph's rows including its padding.
+                const glyph_row_size = glyph.width * self.channels;
+                var row: u32 = 0;
+                while (row < glyph.height) : (row += 1) {
+                    const src_idx = (glyph.y + row) * row_size + glyph.x * self.channels;
+                    const dst_idx = (pos.y + row) * row_size + pos.x * self.channels;
+                    std.mem.copy(u8, page.buf[dst_idx .. dst_idx + glyph_row_size], old_buf[src_idx .. src_idx + glyph_row_size]);
                 }
+                page.glyph_area += glyph.width * glyph.height;
+                glyph.x = pos.x;
+                glyph.y = pos.y;
+                glyph.generation = page.generation;
+                glyph.image = page.image;
+                self.setGlyphUvs(glyph);
             }
+            // Glyphs that don't fit in the new order are evicted.
         }
+        self.markDirtyBuffer(page_idx);
+        log.debug("repacked font atlas page {}: {} glyphs", .{ page_idx, glyphs.items.len });
+    }
+
+    fn isPageGlyph(self: *FontAtlas, glyph: Glyph, page: *Page, min_used_frame: ?u32) bool {
+        if (glyph.atlas != self or glyph.generation != page.generation) {
+            return false;
+        }
+        if (min_used_frame) |frame| {
+            return glyph.last_used_frame >= frame;
+        }
+        return true;
+    }
+
+    pub fn setGlyphUvs(self: FontAtlas, glyph: *Glyph) void {
+        const page_width = @intToFloat(f32, self.page_width);
+        const page_height = @intToFloat(f32, self.page_height);
+        glyph.u0 = @intToFloat(f32, glyph.x) / page_width;
+        glyph.v0 = @intToFloat(f32, glyph.y) / page_height;
+        glyph.u1 = @intToFloat(f32, glyph.x + glyph.width) / page_width;
+        glyph.v1 = @intToFloat(f32, glyph.y + glyph.height) / page_height;
     }
 
     /// Copy from 1 channel row major sub image data. markDirtyBuffer needs to be called afterwards to queue a sync op to the gpu.
-    pub fn copySubImageFrom1Channel(self: *FontAtlas, x: usize, y: usize, width: usize, height: usize, src: []const u8) void {
+    pub fn copySubImageFrom1Channel(self: *FontAtlas, page_idx: u32, x: usize, y: usize, width: usize, height: usize, src: []const u8) void {
         // Ensure src has the correct data length.
         std.debug.assert(width * height == src.len);
         // Ensure bounds in atlas bitmap.
-        std.debug.assert(x + width <= self.width);
-        std.debug.assert(y + height <= self.height);
+        std.debug.assert(x + width <= self.page_width);
+        std.debug.assert(y + height <= self.page_height);
 
-        const dst_row_size = self.width * self.channels;
+        const buf = self.pages.items[page_idx].buf;
+        const dst_row_size = self.page_width * self.channels;
         const src_row_size = width;
 
         var row: usize = 0;
-        var buf_offset: usize = (x + y * self.width) * self.channels;
+        var buf_offset: usize = (x + y * self.page_width) * self.channels;
         var src_offset: usize = 0;
         while (row < height) : (row += 1) {
             for (src[src_offset .. src_offset + src_row_size]) |it, i| {
                 const dst_idx = buf_offset + (i * self.channels);
-                self.gl_buf[dst_idx + 0] = 255;
-                self.gl_buf[dst_idx + 1] = 255;
-                self.gl_buf[dst_idx + 2] = 255;
-                self.gl_buf[dst_idx + 3] = it;
+                buf[dst_idx + 0] = 255;
+                buf[dst_idx + 1] = 255;
+                buf[dst_idx + 2] = 255;
+                buf[dst_idx + 3] = it;
             }
             buf_offset += dst_row_size;
             src_offset += src_row_size;
@@ -140,46 +308,112 @@ pub const FontAtlas = struct {
     }
 
     /// Copy from 4 channel row major sub image data. markDirtyBuffer needs to be called afterwards to queue a sync op to the gpu.
-    pub fn copySubImageFrom(self: *FontAtlas, bm_x: usize, bm_y: usize, width: usize, height: usize, src: []const u8) void {
+    pub fn copySubImageFrom(self: *FontAtlas, page_idx: u32, bm_x: usize, bm_y: usize, width: usize, height: usize, src: []const u8) void {
         // Ensure src has the correct data length.
         std.debug.assert(width * height * self.channels == src.len);
         // Ensure bounds in atlas bitmap.
-        std.debug.assert(bm_x + width <= self.width);
-        std.debug.assert(bm_y + height <= self.height);
+        std.debug.assert(bm_x + width <= self.page_width);
+        std.debug.assert(bm_y + height <= self.page_height);
 
-        const dst_row_size = self.width * self.channels;
+        const buf = self.pages.items[page_idx].buf;
+        const dst_row_size = self.page_width * self.channels;
         const src_row_size = width * self.channels;
 
         var row: usize = 0;
-        var buf_offset: usize = (bm_x + bm_y * self.width) * self.channels;
+        var buf_offset: usize = (bm_x + bm_y * self.page_width) * self.channels;
         var src_offset: usize = 0;
         while (row < height) : (row += 1) {
-            std.mem.copy(u8, self.gl_buf[buf_offset .. buf_offset + src_row_size], src[src_offset .. src_offset + src_row_size]);
+            std.mem.copy(u8, buf[buf_offset .. buf_offset + src_row_size], src[src_offset .. src_offset + src_row_size]);
             buf_offset += dst_row_size;
             src_offset += src_row_size;
         }
     }
 
-    pub fn markDirtyBuffer(self: *FontAtlas) void {
-        if (!self.dirty) {
-            self.dirty = true;
-            self.g.batcher.addNextPreFlushTask(self, syncFontAtlasToGpu);
+    pub fn markDirtyBuffer(self: *FontAtlas, page_idx: u32) void {
+        const page = self.pages.items[page_idx];
+        if (!page.dirty) {
+            page.dirty = true;
+            self.g.batcher.addNextPreFlushTask(page, syncFontAtlasPageToGpu);
         }
     }
 
     pub fn dumpBufferToDisk(self: FontAtlas, filename: [*:0]const u8) void {
-        _ = stbi.stbi_write_bmp(filename, @intCast(c_int, self.width), @intCast(c_int, self.height), self.channels, &self.gl_buf[0]);
-        // _ = stbi.stbi_write_png("font_cache.png", @intCast(c_int, self.bm_width), @intCast(c_int, self.bm_height), 1, &self.bm_buf[0], @intCast(c_int, self.bm_width));
+        // Only the first page.
+        _ = stbi.stbi_write_bmp(filename, @intCast(c_int, self.page_width), @intCast(c_int, self.page_height), self.channels, &self.pages.items[0].buf[0]);
+    }
+};
+
+/// Where a new glyph was placed in the atlas.
+pub const GlyphSlot = struct {
+    atlas: *FontAtlas,
+    page: u16,
+    generation: u32,
+    image: gpu.ImageTex,
+    x: u32,
+    y: u32,
+};
+
+const Page = struct {
+    atlas: *FontAtlas,
+    image: gpu.ImageTex,
+
+    /// Uses a rect bin packer to allocate space. Never resizes.
+    packer: RectBinPacker,
+
+    /// Kept in memory since it will be updated for glyphs on demand.
+    buf: []u8,
+
+    /// Changes when the page is repacked. Glyphs with a different generation were evicted.
+    generation: u32,
+
+    last_used_frame: u32,
+
+    /// Area of the packed glyph rects.
+    glyph_area: u32,
+
+    compacted: bool,
+
+    dirty: bool,
+
+    fn init(self: *Page, atlas: *FontAtlas, generation: u32) void {
+        self.* = .{
+            .atlas = atlas,
+            .image = atlas.g.image_store.createImageFromBitmap(atlas.page_width, atlas.page_height, null, .{
+                .linear_filter = atlas.linear_filter,
+            }),
+            .packer = RectBinPacker.init(atlas.alloc, atlas.page_width, atlas.page_height),
+            .buf = atlas.alloc.alloc(u8, atlas.getPageMemorySize()) catch stdx.fatal(),
+            .generation = generation,
+            .last_used_frame = atlas.g.font_cache.cur_frame,
+            .glyph_area = 0,
+            .compacted = false,
+            .dirty = false,
+        };
+        std.mem.set(u8, self.buf, 0);
+    }
+
+    fn deinit(self: *Page, alloc: std.mem.Allocator) void {
+        self.packer.deinit();
+        alloc.free(self.buf);
+    }
+
+    /// Uploads pending writes before the page moves to a new texture, since quads queued this frame still sample the old one.
+    /// The queued sync task stays in place and uploads to the new texture.
+    fn syncToOldTexture(self: *Page) void {
+        if (self.dirty) {
+            const image = self.atlas.g.image_store.images.getNoCheck(self.image.image_id);
+            self.atlas.g.updateTextureData(image, self.buf);
+        }
     }
 };
 
 /// Updates gpu texture before current draw call batch is sent to gpu.
-fn syncFontAtlasToGpu(ptr: ?*anyopaque) void {
-    const self = stdx.mem.ptrCastAlign(*FontAtlas, ptr);
-    self.dirty = false;
+fn syncFontAtlasPageToGpu(ptr: ?*anyopaque) void {
+    const page = stdx.mem.ptrCastAlign(*Page, ptr);
+    page.dirty = false;
 
     // Send bitmap data.
     // TODO: send only subimage that changed.
-    const image = self.g.image_store.images.getNoCheck(self.image.image_id);
-    self.g.updateTextureData(image, self.gl_buf);
+    const image = page.atlas.g.image_store.images.getNoCheck(page.image.image_id);
+    page.atlas.g.updateTextureData(image, page.buf);
 }
@@ -15,6 +15,9 @@ const TextMetrics = graphics.TextMetrics;
 const FontAtlas = @import("font_atlas.zig").FontAtlas;
 const Batcher = @import("batcher.zig").Batcher;
 const font_renderer = @import("font_renderer.zig");
+const GlyphRasterizer = @import("glyph_rasterizer.zig").GlyphRasterizer;
+const shaper = @import("../../shaper.zig");
+const GlyphDiskCache = @import("glyph_disk_cache.zig").GlyphDiskCache;
 const FontDesc = graphics.FontDesc;
 const log = std.log.scoped(.font_cache);
 
@@ -30,11 +33,30 @@ const RenderFontKey = struct {
     font_size: u16,
 };
 
-// Once we support SDFs we can increase this to 2^16
+// Max size of bitmap render fonts. Larger outline font sizes are drawn with the sdf render font.
 pub const MaxRenderFontSize = 256; // 2^8
 
 pub const MinRenderFontSize = 1;
 
+/// Outline font sizes above this are drawn from a single signed distance field render font instead of a bitmap render font per size.
+pub const SdfMinFontSize = 32;
+
+/// Font size the distance field glyphs are generated at.
+pub const SdfRenderFontSize = 64;
+
+/// Max distance in px stored around a sdf glyph's edge. Also the extra border around the glyph.
+pub const SdfSpread = 6;
+
+/// Set on a render font size to request the font's sdf render font.
+/// Keeps it from sharing a cache entry with a bitmap render font of the same size.
+pub const SdfFontSizeFlag: u16 = 1 << 15;
+
+/// Default memory limit for the glyph atlases.
+pub const DefaultAtlasMemoryLimit = 36 * 1024 * 1024;
+
+/// Bitmap fonts are small so the bitmap atlas takes at most this many pages of the memory limit.
+const MaxBitmapAtlasPages = 16;
+
 // Used to insert initial RenderFontDesc mru that will always be a cache miss.
 const NullFontSize: u16 = 0;
 
@@ -65,6 +87,21 @@ pub const FontCache = struct {
     // System fallback fonts. Used when user fallback fonts was not enough.
     system_fonts: std.ArrayList(FontId),
 
+    /// Incremented every frame. Glyphs and atlas pages are stamped with it when they're used so the least recently used can be evicted.
+    cur_frame: u32,
+
+    /// Rasterizes outline glyphs off the render thread.
+    rasterizer: *GlyphRasterizer,
+
+    /// Shaped text for fonts with GSUB or GPOS tables.
+    shape_cache: shaper.ShapeCache,
+
+    /// OpenType features applied when shaping.
+    shape_features: std.ArrayList(shaper.Tag),
+
+    /// Rasterized glyphs saved between runs. Disabled by default.
+    disk_cache: ?GlyphDiskCache,
+
     pub fn init(self: *Self, alloc: std.mem.Allocator, gctx: *gpu.Graphics) void {
         self.* = .{
             .alloc = alloc,
@@ -77,25 +114,107 @@ pub const FontCache = struct {
             .font_groups = ds.PooledHandleList(FontGroupId, FontGroup).init(alloc),
             .fonts_by_lname = ds.OwnedKeyStringHashMap(FontId).init(alloc),
             .system_fonts = std.ArrayList(FontId).init(alloc),
+            .cur_frame = 0,
+            .rasterizer = GlyphRasterizer.init(alloc),
+            .shape_cache = shaper.ShapeCache.init(alloc, shaper.DefaultMaxShapeCacheEntries),
+            .shape_features = std.ArrayList(shaper.Tag).init(alloc),
+            .disk_cache = null,
+        };
+        self.shape_features.appendSlice(&shaper.DefaultFeatures) catch unreachable;
+        // For testing eviction:
+        // const main_atlas_page_size = 128;
+
+        const main_atlas_page_size = 1024;
+        self.main_atlas.init(alloc, gctx, main_atlas_page_size, main_atlas_page_size, 1, true);
+        self.bitmap_atlas.init(alloc, gctx, 256, 256, 1, false);
+        self.setAtlasMemoryLimit(DefaultAtlasMemoryLimit);
+    }
+
+    /// Packs glyphs that finished rasterizing since the last frame.
+    pub fn beginFrame(self: *Self, g: *gpu.Graphics) void {
+        self.cur_frame += 1;
+        self.shape_cache.beginFrame();
+        while (self.rasterizer.pollResult()) |res| {
+            defer self.alloc.free(res.raster.data);
+            const render_font = self.getOrCreateRenderFont(res.req.font_id, res.req.render_font_key);
+            if (render_font.getGlyph(res.req.cp)) |glyph| {
+                if (glyph.is_pending) {
+                    glyph.* = font_renderer.packOutlineGlyph(g, self.getFont(res.req.font_id), render_font, res.req.params.glyph_id, res.raster);
+                    glyph.atlas.markGlyphUsed(glyph);
+                }
+            }
+        }
+    }
+
+    /// Loads the codepoint ranges of a font group for each font size ahead of time.
+    /// Outline glyphs are queued on the rasterizer so this returns before they're ready.
+    pub fn prewarmGlyphs(self: *Self, g: *gpu.Graphics, font_gid: FontGroupId, font_sizes: []const f32, dpr: u32, ranges: []const graphics.CodepointRange) void {
+        const fgroup = self.getFontGroup(font_gid);
+        for (font_sizes) |font_size| {
+            var req_font_size = font_size;
+            const render_font_size = scaleRenderFontSize(computeRenderFontSize(fgroup.primary_font_desc, &req_font_size), dpr);
+            for (ranges) |range| {
+                // Inclusive end can be the max codepoint.
+                var cp = range.start;
+                while (true) : (cp += 1) {
+                    _ = self.getOrLoadFontGroupGlyph(g, fgroup, render_font_size, cp);
+                    if (cp >= range.end) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /// Limits the cpu (and equal gpu) memory used by the glyph atlases. Split between the main and bitmap atlas.
+    /// Each atlas keeps at least one page. Once the limit is reached, least recently used glyphs are evicted.
+    pub fn setAtlasMemoryLimit(self: *Self, bytes: usize) void {
+        const bitmap_bytes = std.math.min(bytes / 8, MaxBitmapAtlasPages * self.bitmap_atlas.getPageMemorySize());
+        const bitmap_pages = bitmap_bytes / self.bitmap_atlas.getPageMemorySize();
+        const main_pages = (bytes - bitmap_bytes) / self.main_atlas.getPageMemorySize();
+        self.main_atlas.setMaxPages(@intCast(u32, main_pages));
+        self.bitmap_atlas.setMaxPages(@intCast(u32, bitmap_pages));
+    }
+
+    /// Glyphs of render fonts created afterwards are loaded from the directory. Call before drawing text.
+    pub fn setGlyphCacheDir(self: *Self, path: []const u8) void {
+        if (self.disk_cache) |*cache| {
+            cache.deinit();
+            self.disk_cache = null;
+        }
+        self.disk_cache = GlyphDiskCache.init(self.alloc, path) catch |err| {
+            log.warn("Failed to open glyph cache dir {s}: {}", .{ path, err });
+            return;
         };
-        // For testing resizing:
-        // const main_atlas_width = 128;
-        // const main_atlas_height = 128;
-
-        // Start with a larger width since we currently just grow the height.
-        const main_atlas_width = 1024;
-        const main_atlas_height = 1024;
-        self.main_atlas.init(alloc, gctx, main_atlas_width, main_atlas_height, true);
-        self.bitmap_atlas.init(alloc, gctx, 256, 256, false);
+    }
+
+    /// Writes the render fonts that gained glyphs since they were loaded or last saved.
+    pub fn saveGlyphCache(self: *Self) void {
+        if (self.disk_cache) |*cache| {
+            for (self.render_fonts.items) |*render_font| {
+                cache.saveRenderFont(self.getFont(render_font.font_id), render_font);
+            }
+        }
     }
 
     pub fn deinit(self: *Self) void {
+        // Workers reference font data so they're stopped first.
+        self.rasterizer.deinit();
+
+        self.saveGlyphCache();
+        if (self.disk_cache) |*cache| {
+            cache.deinit();
+        }
+
         self.main_atlas.dumpBufferToDisk("main_atlas.bmp");
         self.bitmap_atlas.dumpBufferToDisk("bitmap_atlas.bmp");
 
         self.main_atlas.deinit();
         self.bitmap_atlas.deinit();
 
+        self.shape_cache.deinit();
+        self.shape_features.deinit();
+
         var iter = self.font_groups.iterator();
         while (iter.next()) |*it| {
             it.deinit();
@@ -116,6 +235,27 @@ pub const FontCache = struct {
         self.font_groups.deinit();
     }
 
+    /// Sets the OpenType features applied when shaping, eg. to turn off programming ligatures.
+    pub fn setShapeFeatures(self: *Self, features: []const shaper.Tag) void {
+        self.shape_features.clearRetainingCapacity();
+        self.shape_features.appendSlice(features) catch unreachable;
+        self.shape_cache.invalidate();
+    }
+
+    /// Returns the cached shaped text for the font. Valid until the next frame.
+    pub fn getOrShapeText(self: *Self, font: *Font, str: []const u8) []const shaper.ShapedGlyph {
+        return self.shape_cache.getOrShape(font.id, &font.ot_font, shaper.detectScript(str), self.shape_features.items, str);
+    }
+
+    pub fn getOrLoadSubstitutedGlyph(self: *Self, g: *gpu.Graphics, font: *Font, render_font_size: u16, glyph_id: u16) GlyphResult {
+        const render_font = self.getOrCreateRenderFont(font.id, render_font_size);
+        return .{
+            .font = font,
+            .render_font = render_font,
+            .glyph = font_renderer.getOrLoadSubstitutedGlyph(g, font, render_font, glyph_id),
+        };
+    }
+
     pub fn addSystemFont(self: *Self, id: FontId) !void {
         try self.system_fonts.append(id);
     }
@@ -180,7 +320,7 @@ pub const FontCache = struct {
         };
     }
 
-    // Assumes render_font_size is a valid size.
+    // Assumes render_font_size is a valid size. It can include SdfFontSizeFlag.
     pub fn getOrCreateRenderFont(self: *Self, font_id: FontId, render_font_size: u16) *RenderFont {
         const mru = self.render_font_mru.items[font_id];
         if (mru.font_size == render_font_size) {
@@ -198,10 +338,16 @@ pub const FontCache = struct {
                 const render_font = self.render_fonts.addOne() catch unreachable;
                 const font = self.getFont(font_id);
 
-                const ot_font = font.getOtFontBySize(render_font_size);
+                const sdf = render_font_size & SdfFontSizeFlag != 0;
+                const size = render_font_size & ~SdfFontSizeFlag;
+                const ot_font = font.getOtFontBySize(size);
                 switch (font.font_type) {
-                    .Outline => render_font.initOutline(self.alloc, font.id, ot_font, render_font_size),
-                    .Bitmap => render_font.initBitmap(self.alloc, font.id, ot_font, render_font_size),
+                    .Outline => render_font.initOutline(self.alloc, font.id, ot_font, size, sdf),
+                    .Bitmap => render_font.initBitmap(self.alloc, font.id, ot_font, size),
+                }
+                if (self.disk_cache) |*cache| {
+                    const atlas = if (font.font_type == .Bitmap) &self.bitmap_atlas else &self.main_atlas;
+                    cache.loadRenderFont(font, render_font, atlas);
                 }
 
                 self.render_font_map.put(.{ .font_id = font_id, .font_size = render_font_size }, render_font_id) catch unreachable;
@@ -353,6 +499,22 @@ pub const GlyphResult = struct {
     glyph: *Glyph,
 };
 
+/// Scales a render font size for the display's pixel ratio. The sdf render font already scales to any size.
+pub fn scaleRenderFontSize(render_font_size: u16, dpr: u32) u16 {
+    if (render_font_size & SdfFontSizeFlag != 0) {
+        return render_font_size;
+    }
+    return render_font_size * @intCast(u16, dpr);
+}
+
+/// Render font size as passed to getOrCreateRenderFont.
+pub fn getRenderFontKey(render_font: *const RenderFont) u16 {
+    if (render_font.sdf) {
+        return render_font.render_font_size | SdfFontSizeFlag;
+    }
+    return render_font.render_font_size;
+}
+
 // Computes bitmap font size and also updates the requested font size if necessary.
 pub fn computeRenderFontSize(desc: FontDesc, font_size: *f32) u16 {
     switch (desc.font_type) {
@@ -366,14 +528,12 @@ pub fn computeRenderFontSize(desc: FontDesc, font_size: *f32) u16 {
                     font_size.* = @ceil(font_size.*);
                     return @floatToInt(u16, font_size.*);
                 }
+            } else if (font_size.* <= SdfMinFontSize) {
+                var next_pow = @floatToInt(u4, @ceil(std.math.log2(font_size.*)));
+                return @as(u16, 1) << next_pow;
             } else {
-                if (font_size.* > MaxRenderFontSize) {
-                    font_size.* = MaxRenderFontSize;
-                    return MaxRenderFontSize;
-                } else {
-                    var next_pow = @floatToInt(u4, @ceil(std.math.log2(font_size.*)));
-                    return @as(u16, 1) << next_pow;
-                }
+                // Larger sizes scale the same distance field glyphs.
+                return SdfRenderFontSize | SdfFontSizeFlag;
             }
         },
         .Bitmap => {
@@ -12,25 +12,47 @@ const Font = graphics.Font;
 const RenderFont = gpu.RenderFont;
 const OpenTypeFont = graphics.OpenTypeFont;
 const Glyph = gpu.Glyph;
+const font_cache = @import("font_cache.zig");
+const GlyphSlot = @import("font_atlas.zig").GlyphSlot;
+const glyph_rasterizer = @import("glyph_rasterizer.zig");
+const RasterGlyph = glyph_rasterizer.RasterGlyph;
 const log = std.log.scoped(.font_renderer);
 
 pub fn getOrLoadMissingGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont) *Glyph {
     if (render_font.missing_glyph) |*glyph| {
+        if (!glyph.atlas.isGlyphValid(glyph.*)) {
+            // Evicted from the atlas.
+            const ot_font = font.getOtFontBySize(render_font.render_font_size);
+            glyph.* = generateGlyph(g, font, ot_font, render_font, 0);
+        }
+        glyph.atlas.markGlyphUsed(glyph);
         return glyph;
     } else {
         const ot_font = font.getOtFontBySize(render_font.render_font_size);
         const glyph = generateGlyph(g, font, ot_font, render_font, 0);
         render_font.missing_glyph = glyph;
-        return &render_font.missing_glyph.?;
+        const ptr = &render_font.missing_glyph.?;
+        ptr.atlas.markGlyphUsed(ptr);
+        return ptr;
     }
 }
 
 pub fn getOrLoadGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont, cp: u21) ?*Glyph {
     // var buf: [4]u8 = undefined;
-    if (render_font.glyphs.getEntry(cp)) |entry| {
+    if (render_font.getGlyph(cp)) |glyph| {
         // _ = std.unicode.utf8Encode(cp, &buf) catch unreachable;
         // log.debug("{} cache hit: {s}", .{render_font.render_font_size, buf});
-        return entry.value_ptr;
+        if (glyph.is_pending) {
+            // Still rasterizing.
+            return glyph;
+        }
+        if (!glyph.atlas.isGlyphValid(glyph.*)) {
+            // Evicted from the atlas. Rasterize it again in place.
+            const ot_font = font.getOtFontBySize(render_font.render_font_size);
+            glyph.* = loadGlyph(g, font, ot_font, render_font, cp, glyph.glyph_id);
+        }
+        glyph.atlas.markGlyphUsed(glyph);
+        return glyph;
     } else {
         // _ = std.unicode.utf8Encode(cp, &buf) catch unreachable;
         // log.debug("{} cache miss: {s}", .{render_font.render_font_size, buf});
@@ -39,13 +61,40 @@ pub fn getOrLoadGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont, c
 
         // Attempt to generate glyph.
         if (ot_font.getGlyphId(cp) catch unreachable) |glyph_id| {
-            const glyph = generateGlyph(g, font, ot_font, render_font, glyph_id);
-            const entry = render_font.glyphs.getOrPutValue(cp, glyph) catch unreachable;
-            return entry.value_ptr;
+            const glyph = loadGlyph(g, font, ot_font, render_font, cp, glyph_id);
+            const ptr = render_font.putGlyph(cp, glyph);
+            ptr.atlas.markGlyphUsed(ptr);
+            return ptr;
         } else return null;
     }
 }
 
+/// Loads a glyph the shaper substituted, eg. a ligature. They're rare so they're generated right away instead of on the rasterizer.
+pub fn getOrLoadSubstitutedGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont, glyph_id: u16) *Glyph {
+    const ot_font = font.getOtFontBySize(render_font.render_font_size);
+    if (render_font.substituted_glyphs.getPtr(glyph_id)) |glyph| {
+        if (!glyph.atlas.isGlyphValid(glyph.*)) {
+            // Evicted from the atlas.
+            glyph.* = generateGlyph(g, font, ot_font, render_font, glyph_id);
+        }
+        glyph.atlas.markGlyphUsed(glyph);
+        return glyph;
+    } else {
+        const glyph = generateGlyph(g, font, ot_font, render_font, glyph_id);
+        const ptr = render_font.putSubstitutedGlyph(glyph_id, glyph);
+        ptr.atlas.markGlyphUsed(ptr);
+        return ptr;
+    }
+}
+
+/// Plain outline glyphs are rasterized on worker threads when they're available. The rest are generated right away.
+fn loadGlyph(g: *gpu.Graphics, font: *Font, ot_font: OpenTypeFont, render_font: *const RenderFont, cp: u21, glyph_id: u16) Glyph {
+    if (g.font_cache.rasterizer.isAsync() and font.font_type == .Outline and !ot_font.hasEmbeddedBitmap() and !ot_font.hasColorBitmap()) {
+        return requestOutlineGlyph(g, font, render_font, cp, glyph_id);
+    }
+    return generateGlyph(g, font, ot_font, render_font, glyph_id);
+}
+
 /// Rasterizes glyph from ot font and into a FontAtlas.
 /// Then set flag to indicate the FontAtlas was updated.
 /// New glyph metadata is stored into Font's glyph cache and returned.
@@ -77,116 +126,75 @@ const h_padding = Glyph.Padding * 2;
 const v_padding = Glyph.Padding * 2;
 
 fn generateOutlineGlyph(g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, glyph_id: u16, set_size: bool) Glyph {
-    const scale = render_font.scale_from_ttf;
+    const params = getOutlineParams(render_font, glyph_id, set_size);
+    const raster = glyph_rasterizer.rasterizeOutline(&font.impl, params, &g.raster_glyph_buffer);
+    return packOutlineGlyph(g, font, render_font, glyph_id, raster);
+}
+
+fn getOutlineParams(render_font: *const RenderFont, glyph_id: u16, set_size: bool) glyph_rasterizer.OutlineParams {
+    return .{
+        .glyph_id = glyph_id,
+        .render_font_size = render_font.render_font_size,
+        .scale = render_font.scale_from_ttf,
+        .sdf = render_font.sdf,
+        .set_size = set_size,
+    };
+}
+
+/// Copies a rasterized outline glyph into the main atlas.
+pub fn packOutlineGlyph(g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, glyph_id: u16, raster: RasterGlyph) Glyph {
     const fc = &g.font_cache;
 
-    // negative y indicates upwards dist from baseline.
-    // positive y indicates downwards dist from baseline.
-    // x0, y0 represents top left.
-    // x1, y1 represents bot right.
-    var x0: c_int = 0;
-    var y0: c_int = 0;
-    var x1: c_int = 0;
-    var y1: c_int = 0;
-
-    var glyph_x: u32 = 0;
-    var glyph_y: u32 = 0;
     var glyph_width: u32 = 0;
     var glyph_height: u32 = 0;
-
-    switch (graphics.FontRendererBackend) {
-        .Freetype => {
-            if (set_size) {
-                // Freetype does not allow setting to arbitrary pixel size for color bitmaps: https://github.com/python-pillow/Pillow/issues/6166
-                const err = ft.FT_Set_Pixel_Sizes(font.impl, 0, render_font.render_font_size);
-                if (err != 0) {
-                    stdx.panicFmt("freetype error {}: {s}", .{err, ft.FT_Error_String(err)});
-                }
-            }
-            var err = ft.FT_Load_Glyph(font.impl, glyph_id, ft.FT_LOAD_DEFAULT);
-            if (err != 0) {
-                stdx.panicFmt("freetype error {}", .{err});
-            }
-            err = ft.FT_Render_Glyph(font.impl.glyph, ft.FT_RENDER_MODE_NORMAL);
-            if (err != 0) {
-                stdx.panicFmt("freetype error {}", .{err});
-            }
-            const src_width = font.impl.glyph[0].bitmap.width;
-            const src_height = font.impl.glyph[0].bitmap.rows;
-
-            x0 = font.impl.glyph[0].bitmap_left;
-            y0 = -font.impl.glyph[0].bitmap_top;
-
-            // log.debug("glyph {any} {} {}", .{font.impl.glyph[0].bitmap, x0, y0});
-
-            if (src_width > 0) {
-                glyph_width = src_width + h_padding;
-                glyph_height = src_height + v_padding;
-
-                const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
-                glyph_x = pos.x;
-                glyph_y = pos.y;
-
-                // Debug: Dump specific glyph.
-                // if (glyph_id == 76) {
-                //     _ = stbi.stbi_write_bmp("test.bmp", @intCast(c_int, src_width), @intCast(c_int, src_height), 1, font.impl.glyph[0].bitmap.buffer);
-                //     log.debug("{} {} {}", .{src_width, src_height, x0});
-                // }
-
-                fc.main_atlas.copySubImageFrom1Channel(glyph_x + Glyph.Padding, glyph_y + Glyph.Padding, src_width, src_height, font.impl.glyph[0].bitmap.buffer[0..src_width*src_height]);
-                fc.main_atlas.markDirtyBuffer();
-            } else {
-                // Some characters will be blank like the space char.
-                glyph_width = 0;
-                glyph_height = 0;
-                glyph_x = 0;
-                glyph_y = 0;
-            }
-        },
-        .Stbtt => {
-            stbtt.stbtt_GetGlyphBitmapBox(&font.impl, glyph_id, scale, scale, &x0, &y0, &x1, &y1);
-            // Draw glyph into bitmap buffer.
-            const src_width = @intCast(u32, x1 - x0);
-            const src_height = @intCast(u32, y1 - y0);
-            glyph_width = src_width + h_padding;
-            glyph_height = src_height + v_padding;
-
-            const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
-            glyph_x = pos.x;
-            glyph_y = pos.y;
-
-            g.raster_glyph_buffer.resize(src_width * src_height) catch @panic("error");
-            // Don't include extra padding when blitting to bitmap with stbtt.
-            stbtt.stbtt_MakeGlyphBitmap(&font.impl, g.raster_glyph_buffer.items.ptr, @intCast(c_int, src_width), @intCast(c_int, src_height), @intCast(c_int, src_width), scale, scale, glyph_id);
-            fc.main_atlas.copySubImageFrom1Channel(glyph_x + Glyph.Padding, glyph_y + Glyph.Padding, src_width, src_height, g.raster_glyph_buffer.items);
-            fc.main_atlas.markDirtyBuffer();
-        },
+    var slot: GlyphSlot = undefined;
+    if (raster.width > 0) {
+        glyph_width = raster.width + h_padding;
+        glyph_height = raster.height + v_padding;
+        slot = fc.main_atlas.allocGlyph(glyph_width, glyph_height);
+        fc.main_atlas.copySubImageFrom1Channel(slot.page, slot.x + Glyph.Padding, slot.y + Glyph.Padding, raster.width, raster.height, raster.data);
+        fc.main_atlas.markDirtyBuffer(slot.page);
+    } else {
+        // Some characters will be blank like the space char.
+        slot = fc.main_atlas.allocGlyph(0, 0);
     }
 
-    // log.debug("box {} {} {} {}", .{x0, y0, x1, y1});
-
     const h_metrics = font.ot_font.getGlyphHMetrics(glyph_id);
     // log.info("adv: {}, lsb: {}", .{h_metrics.advance_width, h_metrics.left_side_bearing});
 
-    var glyph = Glyph.init(glyph_id, fc.main_atlas.image);
+    var glyph = Glyph.init(glyph_id, slot);
     glyph.is_color_bitmap = false;
-    // Include padding in offsets.
-    // glyph.x_offset = scale * @intToFloat(f32, h_metrics.left_side_bearing) - Glyph.Padding;
-    glyph.x_offset = @intToFloat(f32, x0) - Glyph.Padding;
-    // log.warn("lsb: {} x: {}", .{scale * @intToFloat(f32, h_metrics.left_side_bearing), x0});
-    glyph.y_offset = @round(render_font.ascent) - @intToFloat(f32, -y0) - Glyph.Padding;
-    glyph.x = glyph_x;
-    glyph.y = glyph_y;
+    glyph.is_sdf = render_font.sdf;
+    // Include padding in offsets. The raster offsets already include the sdf border.
+    glyph.x_offset = @intToFloat(f32, raster.x0) - Glyph.Padding;
+    glyph.y_offset = @round(render_font.ascent) + @intToFloat(f32, raster.y0) - Glyph.Padding;
     glyph.width = glyph_width;
     glyph.height = glyph_height;
     glyph.render_font_size = @intToFloat(f32, render_font.render_font_size);
     glyph.dst_width = @intToFloat(f32, glyph_width);
     glyph.dst_height = @intToFloat(f32, glyph_height);
-    glyph.advance_width = scale * @intToFloat(f32, h_metrics.advance_width);
-    glyph.u0 = @intToFloat(f32, glyph_x) / @intToFloat(f32, fc.main_atlas.width);
-    glyph.v0 = @intToFloat(f32, glyph_y) / @intToFloat(f32, fc.main_atlas.height);
-    glyph.u1 = @intToFloat(f32, glyph_x + glyph_width) / @intToFloat(f32, fc.main_atlas.width);
-    glyph.v1 = @intToFloat(f32, glyph_y + glyph_height) / @intToFloat(f32, fc.main_atlas.height);
+    glyph.advance_width = render_font.scale_from_ttf * @intToFloat(f32, h_metrics.advance_width);
+    fc.main_atlas.setGlyphUvs(&glyph);
+    return glyph;
+}
+
+/// Queues the outline glyph on the rasterizer and returns a blank glyph with the final advance width so layout doesn't shift once it's loaded.
+fn requestOutlineGlyph(g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, cp: u21, glyph_id: u16) Glyph {
+    const fc = &g.font_cache;
+    fc.rasterizer.requestGlyph(.{
+        .font_id = font.id,
+        .font_data = font.data,
+        .render_font_key = font_cache.getRenderFontKey(render_font),
+        .cp = cp,
+        .params = getOutlineParams(render_font, glyph_id, true),
+    });
+
+    const h_metrics = font.ot_font.getGlyphHMetrics(glyph_id);
+    var glyph = Glyph.init(glyph_id, fc.main_atlas.allocGlyph(0, 0));
+    glyph.is_pending = true;
+    glyph.is_sdf = render_font.sdf;
+    glyph.render_font_size = @intToFloat(f32, render_font.render_font_size);
+    glyph.advance_width = render_font.scale_from_ttf * @intToFloat(f32, h_metrics.advance_width);
     return glyph;
 }
 
@@ -210,25 +218,26 @@ fn generateColorBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_font
         const glyph_width = @intCast(u32, src_width) + h_padding;
         const glyph_height = @intCast(u32, src_height) + v_padding;
 
-        const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
-        const glyph_x = pos.x;
-        const glyph_y = pos.y;
+        const slot = fc.main_atlas.allocGlyph(glyph_width, glyph_height);
+        const glyph_x = slot.x;
+        const glyph_y = slot.y;
 
         // Copy into atlas bitmap.
         const bitmap_len = @intCast(usize, src_width * src_height * channels);
         fc.main_atlas.copySubImageFrom(
+            slot.page,
             glyph_x + Glyph.Padding,
             glyph_y + Glyph.Padding,
             @intCast(usize, src_width),
             @intCast(usize, src_height),
             bitmap[0..bitmap_len],
         );
-        fc.main_atlas.markDirtyBuffer();
+        fc.main_atlas.markDirtyBuffer(slot.page);
 
         // const h_metrics = font.ttf_font.getGlyphHMetrics(glyph_id);
         // log.info("adv: {}, lsb: {}", .{h_metrics.advance_width, h_metrics.left_side_bearing});
 
-        var glyph = Glyph.init(glyph_id, fc.main_atlas.image);
+        var glyph = Glyph.init(glyph_id, slot);
         glyph.is_color_bitmap = true;
 
         const scale_from_xpx = @intToFloat(f32, render_font.render_font_size) / @intToFloat(f32, data.x_px_per_em);
@@ -256,10 +265,7 @@ fn generateColorBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_font
         // glyph.advance_width = scale_from_xpx * @intToFloat(f32, h_metrics.advance_width);
         // log.debug("{} {} {}", .{scale * @intToFloat(f32, h_metrics.advance_width), data.advance_width, data.width});
         glyph.advance_width = scale_from_xpx * @intToFloat(f32, data.advance_width);
-        glyph.u0 = @intToFloat(f32, glyph_x) / @intToFloat(f32, fc.main_atlas.width);
-        glyph.v0 = @intToFloat(f32, glyph_y) / @intToFloat(f32, fc.main_atlas.height);
-        glyph.u1 = @intToFloat(f32, glyph_x + glyph_width) / @intToFloat(f32, fc.main_atlas.width);
-        glyph.v1 = @intToFloat(f32, glyph_y + glyph_height) / @intToFloat(f32, fc.main_atlas.height);
+        fc.main_atlas.setGlyphUvs(&glyph);
         return glyph;
     } else return null;
 }
@@ -272,28 +278,25 @@ fn generateEmbeddedBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_f
         const dst_width: u32 = ot_glyph.width + h_padding;
         const dst_height: u32 = ot_glyph.height + v_padding;
 
-        const dst_pos = fc.bitmap_atlas.packer.allocRect(dst_width, dst_height);
+        const slot = fc.bitmap_atlas.allocGlyph(dst_width, dst_height);
 
-        fc.bitmap_atlas.copySubImageFrom1Channel(dst_pos.x + Glyph.Padding, dst_pos.y + Glyph.Padding, ot_glyph.width, ot_glyph.height, ot_glyph.data);
-        fc.bitmap_atlas.markDirtyBuffer();
+        fc.bitmap_atlas.copySubImageFrom1Channel(slot.page, slot.x + Glyph.Padding, slot.y + Glyph.Padding, ot_glyph.width, ot_glyph.height, ot_glyph.data);
+        fc.bitmap_atlas.markDirtyBuffer(slot.page);
 
-        var glyph = Glyph.init(glyph_id, fc.bitmap_atlas.image);
+        var glyph = Glyph.init(glyph_id, slot);
         glyph.is_color_bitmap = false;
 
         glyph.x_offset = @intToFloat(f32, ot_glyph.bearing_x) - Glyph.Padding;
         glyph.y_offset = render_font.ascent + @intToFloat(f32, -ot_glyph.bearing_y) - Glyph.Padding;
-        glyph.x = dst_pos.x;
-        glyph.y = dst_pos.y;
+        glyph.x = slot.x;
+        glyph.y = slot.y;
         glyph.width = dst_width;
         glyph.height = dst_height;
         glyph.render_font_size = @intToFloat(f32, render_font.render_font_size);
         glyph.dst_width = @intToFloat(f32, dst_width);
         glyph.dst_height = @intToFloat(f32, dst_height);
         glyph.advance_width = @intToFloat(f32, ot_glyph.advance);
-        glyph.u0 = @intToFloat(f32, dst_pos.x) / @intToFloat(f32, fc.bitmap_atlas.width);
-        glyph.v0 = @intToFloat(f32, dst_pos.y) / @intToFloat(f32, fc.bitmap_atlas.height);
-        glyph.u1 = @intToFloat(f32, dst_pos.x + dst_width) / @intToFloat(f32, fc.bitmap_atlas.width);
-        glyph.v1 = @intToFloat(f32, dst_pos.y + dst_height) / @intToFloat(f32, fc.bitmap_atlas.height);
+        fc.bitmap_atlas.setGlyphUvs(&glyph);
         return glyph;
     } else {
         stdx.panicFmt("expected embedded bitmap for glyph: {}", .{glyph_id});
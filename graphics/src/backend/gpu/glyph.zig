@@ -1,4 +1,6 @@
 const graphics = @import("graphics.zig");
+const font_atlas = @import("font_atlas.zig");
+const FontAtlas = font_atlas.FontAtlas;
 
 pub const Glyph = struct {
     pub const Padding = 1;
@@ -8,6 +10,16 @@ pub const Glyph = struct {
 
     image: graphics.ImageTex,
 
+    // Atlas page that holds the glyph's bitmap.
+    atlas: *FontAtlas,
+    page: u16,
+
+    // Generation of the page when the glyph was packed. A mismatch means the glyph was evicted and needs to be rasterized again.
+    generation: u32,
+
+    // Font cache frame the glyph was last drawn or measured in.
+    last_used_frame: u32,
+
     // Top-left tex coords.
     u0: f32,
     v0: f32,
@@ -45,11 +57,23 @@ pub const Glyph = struct {
 
     is_color_bitmap: bool,
 
-    pub fn init(glyph_id: u16, image: graphics.ImageTex) @This() {
+    /// Alpha is a signed distance field generated at render_font_size. Drawn with the sdf shader so it scales to any size.
+    is_sdf: bool,
+
+    /// Queued on the glyph rasterizer. Until it's loaded, the glyph is blank but has its advance width.
+    is_pending: bool,
+
+    pub fn init(glyph_id: u16, slot: font_atlas.GlyphSlot) @This() {
         return .{
             .glyph_id = glyph_id,
-            .image = image,
+            .image = slot.image,
+            .atlas = slot.atlas,
+            .page = slot.page,
+            .generation = slot.generation,
+            .last_used_frame = 0,
             .is_color_bitmap = false,
+            .is_sdf = false,
+            .is_pending = false,
             .u0 = 0,
             .v0 = 0,
             .u1 = 0,
@@ -57,8 +81,8 @@ pub const Glyph = struct {
             .x_offset = 0,
             .y_offset = 0,
             .render_font_size = 0,
-            .x = 0,
-            .y = 0,
+            .x = slot.x,
+            .y = slot.y,
             .width = 0,
             .height = 0,
             .dst_width = 0,
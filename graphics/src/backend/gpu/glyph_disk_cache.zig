@@ -0,0 +1,397 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const t = stdx.testing;
+
+const graphics = @import("../../graphics.zig");
+const gpu = graphics.gpu;
+const Font = graphics.Font;
+const FontId = graphics.FontId;
+const RenderFont = gpu.RenderFont;
+const Glyph = gpu.Glyph;
+const FontAtlas = @import("font_atlas.zig").FontAtlas;
+const font_cache = @import("font_cache.zig");
+const log = stdx.log.scoped(.glyph_disk_cache);
+
+const Magic = "CGLC".*;
+
+/// Bump when the file layout or how glyphs are rasterized changes.
+const Version: u16 = 1;
+
+/// Keys of glyphs substituted by the shaper are glyph ids with this flag.
+const SubstitutedKeyFlag: u32 = 1 << 31;
+const MissingGlyphKey: u32 = std.math.maxInt(u32);
+
+const FlagColorBitmap: u8 = 1;
+const FlagSdf: u8 = 2;
+
+/// File layout: Header, Record[num_glyphs], then the bitmaps.
+/// Values are in native endianness since the cache is only read on the machine that wrote it.
+const Header = extern struct {
+    magic: [4]u8,
+    version: u16,
+    reserved: u16,
+    num_glyphs: u32,
+    data_len: u32,
+};
+
+const Record = extern struct {
+    /// Codepoint, glyph id with SubstitutedKeyFlag or MissingGlyphKey.
+    key: u32,
+    glyph_id: u16,
+    flags: u8,
+    /// 1 for coverage or distance fields, 4 for color bitmaps.
+    channels: u8,
+    /// Includes the glyph padding.
+    width: u16,
+    height: u16,
+    x_offset: f32,
+    y_offset: f32,
+    dst_width: f32,
+    dst_height: f32,
+    render_font_size: f32,
+    advance_width: f32,
+    /// Offset of the bitmap after the records.
+    data_offset: u32,
+};
+
+/// Saves rasterized glyphs and their metrics per (font hash, render font size) to a directory
+/// so the next process start can fill the atlas from the files instead of rasterizing again.
+/// Files are mapped into memory and copied into the atlas when a render font is created.
+pub const GlyphDiskCache = struct {
+    alloc: std.mem.Allocator,
+    dir: std.fs.Dir,
+
+    /// Hash of the font data. Computed once per font.
+    font_hashes: std.AutoHashMapUnmanaged(FontId, u64),
+
+    /// Number of glyphs in each render font's file. Render fonts that didn't gain glyphs aren't written again.
+    file_glyph_counts: std.AutoHashMapUnmanaged(FileKey, u32),
+
+    const FileKey = struct {
+        font_id: FontId,
+        render_font_key: u16,
+    };
+
+    pub fn init(alloc: std.mem.Allocator, dir_path: []const u8) !GlyphDiskCache {
+        try std.fs.cwd().makePath(dir_path);
+        return GlyphDiskCache{
+            .alloc = alloc,
+            .dir = try std.fs.cwd().openDir(dir_path, .{}),
+            .font_hashes = .{},
+            .file_glyph_counts = .{},
+        };
+    }
+
+    pub fn deinit(self: *GlyphDiskCache) void {
+        self.dir.close();
+        self.font_hashes.deinit(self.alloc);
+        self.file_glyph_counts.deinit(self.alloc);
+    }
+
+    /// Packs the render font's cached glyphs into the atlas. Does nothing if the render font wasn't saved before.
+    pub fn loadRenderFont(self: *GlyphDiskCache, font: *const Font, render_font: *RenderFont, atlas: *FontAtlas) void {
+        var name_buf: [64]u8 = undefined;
+        const name = self.getFileName(&name_buf, font, render_font);
+        const file = self.dir.openFile(name, .{}) catch return;
+        defer file.close();
+
+        const mapped = stdx.fs.mapOpenFile(self.alloc, file) catch |err| {
+            log.warn("Failed to read glyph cache {s}: {}", .{ name, err });
+            return;
+        };
+        defer mapped.deinit(self.alloc);
+
+        const count = loadGlyphs(mapped.data, render_font, atlas) catch |err| {
+            log.warn("Invalid glyph cache {s}: {}", .{ name, err });
+            return;
+        };
+        const key = FileKey{ .font_id = font.id, .render_font_key = font_cache.getRenderFontKey(render_font) };
+        self.file_glyph_counts.put(self.alloc, key, count) catch fatal();
+    }
+
+    /// Writes the render font's glyphs that are in the atlas. Pending and evicted glyphs are skipped.
+    pub fn saveRenderFont(self: *GlyphDiskCache, font: *const Font, render_font: *RenderFont) void {
+        var records = std.ArrayList(Record).init(self.alloc);
+        defer records.deinit();
+        var bitmaps = std.ArrayList(u8).init(self.alloc);
+        defer bitmaps.deinit();
+
+        var dense_iter = render_font.dense_loaded.iterator(.{});
+        while (dense_iter.next()) |idx| {
+            appendGlyph(&records, &bitmaps, RenderFont.denseIndexToCp(@intCast(u32, idx)), &render_font.dense_glyphs.?[idx]);
+        }
+        var iter = render_font.glyphs.iterator();
+        while (iter.next()) |entry| {
+            appendGlyph(&records, &bitmaps, entry.key_ptr.*, entry.value_ptr);
+        }
+        var sub_iter = render_font.substituted_glyphs.iterator();
+        while (sub_iter.next()) |entry| {
+            appendGlyph(&records, &bitmaps, entry.key_ptr.* | SubstitutedKeyFlag, entry.value_ptr);
+        }
+        if (render_font.missing_glyph) |*glyph| {
+            appendGlyph(&records, &bitmaps, MissingGlyphKey, glyph);
+        }
+
+        const key = FileKey{ .font_id = font.id, .render_font_key = font_cache.getRenderFontKey(render_font) };
+        if (records.items.len <= self.file_glyph_counts.get(key) orelse 0) {
+            return;
+        }
+
+        var name_buf: [64]u8 = undefined;
+        const name = self.getFileName(&name_buf, font, render_font);
+        self.writeFile(name, records.items, bitmaps.items) catch |err| {
+            log.warn("Failed to write glyph cache {s}: {}", .{ name, err });
+            return;
+        };
+        self.file_glyph_counts.put(self.alloc, key, @intCast(u32, records.items.len)) catch fatal();
+    }
+
+    fn writeFile(self: *GlyphDiskCache, name: []const u8, records: []const Record, bitmaps: []const u8) !void {
+        // Write to a temporary file first so a reader never sees a partial file.
+        var tmp_buf: [68]u8 = undefined;
+        const tmp_name = try std.fmt.bufPrint(&tmp_buf, "{s}.tmp", .{name});
+        {
+            const file = try self.dir.createFile(tmp_name, .{});
+            defer file.close();
+            const header = Header{
+                .magic = Magic,
+                .version = Version,
+                .reserved = 0,
+                .num_glyphs = @intCast(u32, records.len),
+                .data_len = @intCast(u32, bitmaps.len),
+            };
+            try file.writeAll(std.mem.asBytes(&header));
+            try file.writeAll(std.mem.sliceAsBytes(records));
+            try file.writeAll(bitmaps);
+        }
+        try self.dir.rename(tmp_name, name);
+    }
+
+    fn getFileName(self: *GlyphDiskCache, buf: []u8, font: *const Font, render_font: *const RenderFont) []const u8 {
+        const res = self.font_hashes.getOrPut(self.alloc, font.id) catch fatal();
+        if (!res.found_existing) {
+            res.value_ptr.* = computeFontHash(font);
+        }
+        const sdf_suffix = if (render_font.sdf) "_sdf" else "";
+        return std.fmt.bufPrint(buf, "{x:0>16}_{}{s}.glyphs", .{ res.value_ptr.*, render_font.render_font_size, sdf_suffix }) catch unreachable;
+    }
+};
+
+/// The rasterizer backend and glyph layout constants are included since they change the bitmaps.
+fn computeFontHash(font: *const Font) u64 {
+    var hasher = std.hash.Wyhash.init(0);
+    std.hash.autoHash(&hasher, Version);
+    std.hash.autoHash(&hasher, @enumToInt(graphics.FontRendererBackend));
+    std.hash.autoHash(&hasher, @as(u32, Glyph.Padding));
+    std.hash.autoHash(&hasher, @as(u32, font_cache.SdfSpread));
+    switch (font.font_type) {
+        .Outline => hasher.update(font.data),
+        .Bitmap => {
+            for (font.bmfont_strikes) |strike| {
+                hasher.update(strike.data);
+            }
+        },
+    }
+    return hasher.final();
+}
+
+fn appendGlyph(records: *std.ArrayList(Record), bitmaps: *std.ArrayList(u8), key: u32, glyph: *const Glyph) void {
+    if (glyph.is_pending or !glyph.atlas.isGlyphValid(glyph.*)) {
+        return;
+    }
+    const channels: u8 = if (glyph.is_color_bitmap) 4 else 1;
+    records.append(.{
+        .key = key,
+        .glyph_id = glyph.glyph_id,
+        .flags = (if (glyph.is_color_bitmap) FlagColorBitmap else 0) | (if (glyph.is_sdf) FlagSdf else 0),
+        .channels = channels,
+        .width = @intCast(u16, glyph.width),
+        .height = @intCast(u16, glyph.height),
+        .x_offset = glyph.x_offset,
+        .y_offset = glyph.y_offset,
+        .dst_width = glyph.dst_width,
+        .dst_height = glyph.dst_height,
+        .render_font_size = glyph.render_font_size,
+        .advance_width = glyph.advance_width,
+        .data_offset = @intCast(u32, bitmaps.items.len),
+    }) catch fatal();
+
+    // Atlas pages have 4 channels. Coverage is only in alpha.
+    const atlas = glyph.atlas;
+    const buf = atlas.pages.items[glyph.page].buf;
+    var row: u32 = 0;
+    while (row < glyph.height) : (row += 1) {
+        const start = ((glyph.y + row) * atlas.page_width + glyph.x) * atlas.channels;
+        const row_buf = buf[start .. start + glyph.width * atlas.channels];
+        if (channels == 4) {
+            bitmaps.appendSlice(row_buf) catch fatal();
+        } else {
+            var i: usize = 3;
+            while (i < row_buf.len) : (i += 4) {
+                bitmaps.append(row_buf[i]) catch fatal();
+            }
+        }
+    }
+}
+
+const CacheFile = struct {
+    records: []align(1) const Record,
+    bitmaps: []const u8,
+};
+
+/// Checks the header and every record so nothing is packed into the atlas from a corrupt or truncated file.
+fn parseCacheFile(data: []const u8, page_width: u32, page_height: u32) !CacheFile {
+    if (data.len < @sizeOf(Header)) {
+        return error.InvalidCache;
+    }
+    const header = std.mem.bytesToValue(Header, data[0..@sizeOf(Header)]);
+    if (!std.meta.eql(header.magic, Magic) or header.version != Version) {
+        return error.InvalidCache;
+    }
+    const records_end = @sizeOf(Header) + @as(usize, header.num_glyphs) * @sizeOf(Record);
+    if (data.len < records_end + header.data_len) {
+        return error.InvalidCache;
+    }
+    const records = std.mem.bytesAsSlice(Record, data[@sizeOf(Header)..records_end]);
+    const bitmaps = data[records_end .. records_end + header.data_len];
+
+    for (records) |rec| {
+        if (rec.key != MissingGlyphKey) {
+            if (rec.key & SubstitutedKeyFlag != 0) {
+                if (rec.key & ~SubstitutedKeyFlag > std.math.maxInt(u16)) {
+                    return error.InvalidCache;
+                }
+            } else if (rec.key > 0x10FFFF) {
+                return error.InvalidCache;
+            }
+        }
+        if (rec.channels != 1 and rec.channels != 4) {
+            return error.InvalidCache;
+        }
+        if (rec.width > page_width or rec.height > page_height) {
+            return error.InvalidCache;
+        }
+        const len = @as(usize, rec.width) * rec.height * rec.channels;
+        if (@as(usize, rec.data_offset) + len > bitmaps.len) {
+            return error.InvalidCache;
+        }
+    }
+    return CacheFile{
+        .records = records,
+        .bitmaps = bitmaps,
+    };
+}
+
+/// Returns the number of glyphs loaded. The whole file is validated first so a bad record doesn't leave a partially loaded render font.
+fn loadGlyphs(data: []const u8, render_font: *RenderFont, atlas: *FontAtlas) !u32 {
+    const file = try parseCacheFile(data, atlas.page_width, atlas.page_height);
+    const bitmaps = file.bitmaps;
+
+    for (file.records) |rec| {
+        const len = @as(usize, rec.width) * rec.height * rec.channels;
+        const slot = atlas.allocGlyph(rec.width, rec.height);
+        if (len > 0) {
+            const src = bitmaps[rec.data_offset .. rec.data_offset + len];
+            if (rec.channels == 1) {
+                atlas.copySubImageFrom1Channel(slot.page, slot.x, slot.y, rec.width, rec.height, src);
+            } else {
+                atlas.copySubImageFrom(slot.page, slot.x, slot.y, rec.width, rec.height, src);
+            }
+            atlas.markDirtyBuffer(slot.page);
+        }
+
+        var glyph = Glyph.init(rec.glyph_id, slot);
+        glyph.is_color_bitmap = rec.flags & FlagColorBitmap != 0;
+        glyph.is_sdf = rec.flags & FlagSdf != 0;
+        glyph.x_offset = rec.x_offset;
+        glyph.y_offset = rec.y_offset;
+        glyph.width = rec.width;
+        glyph.height = rec.height;
+        glyph.dst_width = rec.dst_width;
+        glyph.dst_height = rec.dst_height;
+        glyph.render_font_size = rec.render_font_size;
+        glyph.advance_width = rec.advance_width;
+        atlas.setGlyphUvs(&glyph);
+
+        if (rec.key == MissingGlyphKey) {
+            render_font.missing_glyph = glyph;
+        } else if (rec.key & SubstitutedKeyFlag != 0) {
+            _ = render_font.putSubstitutedGlyph(@intCast(u16, rec.key & ~SubstitutedKeyFlag), glyph);
+        } else {
+            _ = render_font.putGlyph(@intCast(u21, rec.key), glyph);
+        }
+    }
+    return @intCast(u32, file.records.len);
+}
+
+test "Glyph cache file layout" {
+    try t.eq(@sizeOf(Header), 16);
+    try t.eq(@sizeOf(Record), 40);
+}
+
+test "Glyph cache save and load" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir_path = try tmp.dir.realpathAlloc(t.alloc, ".");
+    defer t.alloc.free(dir_path);
+
+    var cache = try GlyphDiskCache.init(t.alloc, dir_path);
+    defer cache.deinit();
+
+    const base = Record{
+        .key = 'a',
+        .glyph_id = 1,
+        .flags = 0,
+        .channels = 1,
+        .width = 2,
+        .height = 2,
+        .x_offset = 0.5,
+        .y_offset = 1,
+        .dst_width = 2,
+        .dst_height = 2,
+        .render_font_size = 16,
+        .advance_width = 3,
+        .data_offset = 0,
+    };
+    var records = [_]Record{ base, base, base };
+    records[1].key = 7 | SubstitutedKeyFlag;
+    records[1].flags = FlagColorBitmap;
+    records[1].channels = 4;
+    records[1].width = 1;
+    records[1].height = 1;
+    records[1].data_offset = 4;
+    records[2].key = MissingGlyphKey;
+    records[2].width = 0;
+    records[2].height = 0;
+    records[2].data_offset = 8;
+    const bitmaps = [_]u8{ 1, 2, 3, 4, 5, 6, 7, 8 };
+    try cache.writeFile("test.glyphs", &records, &bitmaps);
+
+    const file = try cache.dir.openFile("test.glyphs", .{});
+    defer file.close();
+    const mapped = try stdx.fs.mapOpenFile(t.alloc, file);
+    defer mapped.deinit(t.alloc);
+    const data = mapped.data;
+
+    const res = try parseCacheFile(data, 4, 4);
+    try t.eq(res.records.len, 3);
+    for (records) |rec, i| {
+        try t.eq(std.meta.eql(res.records[i], rec), true);
+    }
+    try t.eqSlice(u8, res.bitmaps, &bitmaps);
+
+    // Glyphs that don't fit in an atlas page.
+    try t.expectError(parseCacheFile(data, 1, 4), error.InvalidCache);
+
+    // Truncated file.
+    try t.expectError(parseCacheFile(data[0 .. data.len - 1], 4, 4), error.InvalidCache);
+
+    // Keys out of range.
+    const corrupt = try t.alloc.dupe(u8, data);
+    defer t.alloc.free(corrupt);
+    std.mem.writeIntNative(u32, corrupt[@sizeOf(Header)..][0..4], 0x110000);
+    try t.expectError(parseCacheFile(corrupt, 4, 4), error.InvalidCache);
+    std.mem.writeIntNative(u32, corrupt[@sizeOf(Header)..][0..4], 0x10000 | SubstitutedKeyFlag);
+    try t.expectError(parseCacheFile(corrupt, 4, 4), error.InvalidCache);
+}
@@ -0,0 +1,337 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const stbtt = @import("stbtt");
+const ft = @import("freetype");
+
+const graphics = @import("../../graphics.zig");
+const FontId = graphics.FontId;
+const FreetypeBackend = @import("../../font.zig").FreetypeBackend;
+const font_cache = @import("font_cache.zig");
+const log = stdx.log.scoped(.glyph_rasterizer);
+
+/// Rasterizing is cpu bound so more workers would compete with the render thread.
+const MaxWorkers = 4;
+
+/// Handle used to rasterize outlines. FreeType faces aren't thread safe so every thread opens its own from the font data.
+pub const Face = switch (graphics.FontRendererBackend) {
+    .Freetype => *ft.Face,
+    .Stbtt => stbtt.fontinfo,
+};
+
+pub const OutlineParams = struct {
+    glyph_id: u16,
+    render_font_size: u16,
+    /// From design units to px.
+    scale: f32,
+    /// Generate a distance field with an empty border of SdfSpread px.
+    sdf: bool,
+    /// Freetype does not allow setting to arbitrary pixel size for color bitmaps, so the face size can be kept as is.
+    set_size: bool,
+};
+
+/// 1 channel coverage of a glyph, or its distance field for sdf render fonts.
+pub const RasterGlyph = struct {
+    /// Top left of the bitmap relative to the pen position on the baseline. Includes the sdf border.
+    x0: i32,
+    y0: i32,
+    width: u32,
+    height: u32,
+    data: []const u8,
+};
+
+/// Rasterizes an outline glyph into buf. The returned data points into buf.
+pub fn rasterizeOutline(face: *Face, params: OutlineParams, buf: *std.ArrayList(u8)) RasterGlyph {
+    // negative y indicates upwards dist from baseline.
+    // positive y indicates downwards dist from baseline.
+    var x0: c_int = 0;
+    var y0: c_int = 0;
+    var src_width: u32 = 0;
+    var src_height: u32 = 0;
+    const border: u32 = if (params.sdf) font_cache.SdfSpread else 0;
+
+    switch (graphics.FontRendererBackend) {
+        .Freetype => {
+            if (params.set_size) {
+                const err = ft.FT_Set_Pixel_Sizes(face.*, 0, params.render_font_size);
+                if (err != 0) {
+                    stdx.panicFmt("freetype error {}: {s}", .{err, ft.FT_Error_String(err)});
+                }
+            }
+            var err = ft.FT_Load_Glyph(face.*, params.glyph_id, ft.FT_LOAD_DEFAULT);
+            if (err != 0) {
+                stdx.panicFmt("freetype error {}", .{err});
+            }
+            err = ft.FT_Render_Glyph(face.*.glyph, ft.FT_RENDER_MODE_NORMAL);
+            if (err != 0) {
+                stdx.panicFmt("freetype error {}", .{err});
+            }
+            const bitmap = face.*.glyph[0].bitmap;
+            src_width = bitmap.width;
+            src_height = bitmap.rows;
+            x0 = face.*.glyph[0].bitmap_left;
+            y0 = -face.*.glyph[0].bitmap_top;
+
+            if (src_width > 0) {
+                const width = src_width + border * 2;
+                const height = src_height + border * 2;
+                buf.resize(width * height) catch fatal();
+                if (border > 0) {
+                    std.mem.set(u8, buf.items, 0);
+                }
+                const src = bitmap.buffer[0 .. src_width * src_height];
+                var row: u32 = 0;
+                while (row < src_height) : (row += 1) {
+                    const dst_idx = (row + border) * width + border;
+                    std.mem.copy(u8, buf.items[dst_idx .. dst_idx + src_width], src[row * src_width .. (row + 1) * src_width]);
+                }
+            }
+        },
+        .Stbtt => {
+            var x1: c_int = 0;
+            var y1: c_int = 0;
+            stbtt.stbtt_GetGlyphBitmapBox(face, params.glyph_id, params.scale, params.scale, &x0, &y0, &x1, &y1);
+            src_width = @intCast(u32, x1 - x0);
+            src_height = @intCast(u32, y1 - y0);
+
+            if (src_width > 0) {
+                const width = src_width + border * 2;
+                const height = src_height + border * 2;
+                buf.resize(width * height) catch fatal();
+                if (border > 0) {
+                    std.mem.set(u8, buf.items, 0);
+                }
+                // Draw inside the border by offsetting the start and using the bordered stride.
+                const start = buf.items.ptr + border * width + border;
+                stbtt.stbtt_MakeGlyphBitmap(face, start, @intCast(c_int, src_width), @intCast(c_int, src_height), @intCast(c_int, width), params.scale, params.scale, params.glyph_id);
+            }
+        },
+    }
+
+    if (src_width == 0) {
+        // Some characters will be blank like the space char.
+        return .{
+            .x0 = x0,
+            .y0 = y0,
+            .width = 0,
+            .height = 0,
+            .data = &.{},
+        };
+    }
+
+    const width = src_width + border * 2;
+    const height = src_height + border * 2;
+    const len = width * height;
+    if (params.sdf) {
+        // Coverage is in the first half and the distance field goes into the second half.
+        buf.resize(len * 2) catch fatal();
+        graphics.sdf.coverageToSdf(buf.items[len .. len * 2], buf.items[0..len], width, height, border);
+    }
+    return .{
+        .x0 = x0 - @intCast(i32, border),
+        .y0 = y0 - @intCast(i32, border),
+        .width = width,
+        .height = height,
+        .data = if (params.sdf) buf.items[len .. len * 2] else buf.items[0..len],
+    };
+}
+
+const Request = union(enum) {
+    rasterize: GlyphRequest,
+    close: void,
+};
+
+pub const GlyphRequest = struct {
+    font_id: FontId,
+    /// Owned by the font which outlives the rasterizer.
+    font_data: []const u8,
+    /// Render font key in the font cache. Can include SdfFontSizeFlag.
+    render_font_key: u16,
+    cp: u21,
+    params: OutlineParams,
+};
+
+pub const GlyphResult = struct {
+    req: GlyphRequest,
+    /// Owned by the receiver and freed with the rasterizer's allocator.
+    raster: RasterGlyph,
+};
+
+/// Rasterizes outline glyphs on worker threads so a cache miss doesn't stall the render thread.
+/// Requests are pulled by any idle worker. Results are polled by the render thread and packed into the font atlas there.
+pub const GlyphRasterizer = struct {
+    alloc: std.mem.Allocator,
+
+    mutex: std.Thread.Mutex,
+    cond: std.Thread.Condition,
+    /// Guarded by mutex.
+    requests: std.fifo.LinearFifo(Request, .Dynamic),
+
+    results: std.atomic.Queue(GlyphResult),
+
+    workers: []Worker,
+    /// Workers that were spawned.
+    num_workers: usize,
+
+    /// Requests that haven't been polled as results.
+    num_pending: u32,
+
+    /// Heap allocated since the workers keep a pointer to it.
+    pub fn init(alloc: std.mem.Allocator) *GlyphRasterizer {
+        const new = alloc.create(GlyphRasterizer) catch fatal();
+        new.* = .{
+            .alloc = alloc,
+            .mutex = .{},
+            .cond = .{},
+            .requests = std.fifo.LinearFifo(Request, .Dynamic).init(alloc),
+            .results = std.atomic.Queue(GlyphResult).init(),
+            .workers = &.{},
+            .num_workers = 0,
+            .num_pending = 0,
+        };
+        if (!builtin.single_threaded) {
+            const cpu_count = std.Thread.getCpuCount() catch 1;
+            // Leave a core for the render thread.
+            const num_workers = std.math.clamp(cpu_count -| 1, 1, MaxWorkers);
+            new.workers = alloc.alloc(Worker, num_workers) catch fatal();
+            while (new.num_workers < num_workers) : (new.num_workers += 1) {
+                const worker = &new.workers[new.num_workers];
+                worker.init(new);
+                worker.thread = std.Thread.spawn(.{}, Worker.loop, .{ worker }) catch |err| {
+                    log.warn("Failed to spawn glyph rasterizer thread: {}", .{err});
+                    worker.deinit();
+                    break;
+                };
+            }
+        }
+        return new;
+    }
+
+    /// Waits for the workers to finish queued requests and drops unpolled results.
+    pub fn deinit(self: *GlyphRasterizer) void {
+        const workers = self.workers[0..self.num_workers];
+        for (workers) |_| {
+            self.putRequest(.close);
+        }
+        for (workers) |*worker| {
+            worker.thread.join();
+            worker.deinit();
+        }
+        self.alloc.free(self.workers);
+        while (self.results.get()) |node| {
+            self.alloc.free(node.data.raster.data);
+            self.alloc.destroy(node);
+        }
+        self.requests.deinit();
+        self.alloc.destroy(self);
+    }
+
+    /// Without workers, glyphs are rasterized synchronously by the caller.
+    pub fn isAsync(self: GlyphRasterizer) bool {
+        return self.num_workers > 0;
+    }
+
+    pub fn requestGlyph(self: *GlyphRasterizer, req: GlyphRequest) void {
+        self.num_pending += 1;
+        self.putRequest(.{ .rasterize = req });
+    }
+
+    /// Returns the next rasterized glyph. The caller frees GlyphResult.raster.data with the rasterizer's allocator.
+    pub fn pollResult(self: *GlyphRasterizer) ?GlyphResult {
+        const node = self.results.get() orelse return null;
+        defer self.alloc.destroy(node);
+        self.num_pending -= 1;
+        return node.data;
+    }
+
+    fn putRequest(self: *GlyphRasterizer, req: Request) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.requests.writeItem(req) catch fatal();
+        self.cond.signal();
+    }
+
+    fn getRequest(self: *GlyphRasterizer) Request {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        while (true) {
+            if (self.requests.readItem()) |req| {
+                return req;
+            }
+            self.cond.wait(&self.mutex);
+        }
+    }
+};
+
+const Worker = struct {
+    rasterizer: *GlyphRasterizer,
+    thread: std.Thread,
+
+    /// Faces opened by this worker.
+    faces: std.AutoHashMapUnmanaged(FontId, Face),
+    ft_library: switch (graphics.FontRendererBackend) {
+        .Freetype => ft.FT_Library,
+        .Stbtt => void,
+    },
+    buf: std.ArrayList(u8),
+
+    fn init(self: *Worker, rasterizer: *GlyphRasterizer) void {
+        self.* = .{
+            .rasterizer = rasterizer,
+            .thread = undefined,
+            .faces = .{},
+            .ft_library = undefined,
+            .buf = std.ArrayList(u8).init(rasterizer.alloc),
+        };
+        if (graphics.FontRendererBackend == .Freetype) {
+            const err = ft.FT_Init_FreeType(&self.ft_library);
+            if (err != 0) {
+                stdx.panicFmt("freetype error: {}", .{err});
+            }
+        }
+    }
+
+    fn deinit(self: *Worker) void {
+        if (graphics.FontRendererBackend == .Freetype) {
+            var iter = self.faces.valueIterator();
+            while (iter.next()) |face| {
+                _ = ft.FT_Done_Face(face.*);
+            }
+            _ = ft.FT_Done_FreeType(self.ft_library);
+        }
+        self.faces.deinit(self.rasterizer.alloc);
+        self.buf.deinit();
+    }
+
+    fn getFace(self: *Worker, font_id: FontId, data: []const u8) *Face {
+        const res = self.faces.getOrPut(self.rasterizer.alloc, font_id) catch fatal();
+        if (!res.found_existing) {
+            switch (graphics.FontRendererBackend) {
+                .Freetype => FreetypeBackend.initFont(self.ft_library, res.value_ptr, data, 0),
+                .Stbtt => stbtt.InitFont(res.value_ptr, data, 0) catch @panic("failed to load font"),
+            }
+        }
+        return res.value_ptr;
+    }
+
+    fn loop(self: *Worker) void {
+        const alloc = self.rasterizer.alloc;
+        while (true) {
+            const req = switch (self.rasterizer.getRequest()) {
+                .rasterize => |req| req,
+                .close => return,
+            };
+            const face = self.getFace(req.font_id, req.font_data);
+            var raster = rasterizeOutline(face, req.params, &self.buf);
+            raster.data = alloc.dupe(u8, raster.data) catch fatal();
+
+            const node = alloc.create(std.atomic.Queue(GlyphResult).Node) catch fatal();
+            node.data = .{
+                .req = req,
+                .raster = raster,
+            };
+            self.rasterizer.results.put(node);
+        }
+    }
+};
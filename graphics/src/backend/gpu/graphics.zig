@@ -62,6 +62,9 @@ const ggl = graphics.gl;
 const VkContext = gvk.VkContext;
 const image = @import("image.zig");
 pub const ImageStore = image.ImageStore;
+const cuboid_buffer = @import("cuboid_buffer.zig");
+pub const CuboidBufferStore = cuboid_buffer.CuboidBufferStore;
+pub const CuboidBufferId = cuboid_buffer.CuboidBufferId;
 pub const Image = image.Image;
 pub const ImageTex = image.ImageTex;
 pub const TextureId = image.TextureId;
@@ -115,6 +118,7 @@ pub const Graphics = struct {
     tmp_joint_idxes: [50]u16,
 
     image_store: image.ImageStore,
+    cuboid_bufs: cuboid_buffer.CuboidBufferStore,
 
     // Depth pixel ratio:
     // This is used to fetch a higher res font bitmap for high dpi displays.
@@ -177,6 +181,10 @@ pub const Graphics = struct {
             self.inner.pipelines.tex_pipeline = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, true, false);
             self.inner.pipelines.tex_pipeline_2d = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, false, false);
             self.inner.pipelines.wireframe_pipeline = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, true, true);
+
+            const sdf_frag_spv = try shader.compileGLSL(alloc, .Fragment, gvk.shaders.tex_sdf_frag_glsl, .{});
+            defer alloc.free(sdf_frag_spv);
+            self.inner.pipelines.tex_sdf_pipeline_2d = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, sdf_frag_spv, false, false);
         }
         self.inner.pipelines.norm_pipeline = try gvk.createNormPipeline(alloc, device, pass, fb_size);
         self.inner.pipelines.anim_pipeline = try gvk.createAnimPipeline(alloc, device, pass, fb_size, self.inner.mats_desc_set_layout, self.inner.tex_desc_set_layout);
@@ -188,6 +196,8 @@ pub const Graphics = struct {
         const shadow_dim = vk.VkExtent2D{ .width = gvk.Renderer.ShadowMapSize, .height = gvk.Renderer.ShadowMapSize };
         self.inner.pipelines.shadow_pipeline = try gvk.createShadowPipeline(alloc, device, shadow_pass, shadow_dim, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout);
         self.inner.pipelines.anim_shadow_pipeline = try gvk.createAnimShadowPipeline(alloc, device, shadow_pass, shadow_dim, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout);
+        self.inner.pipelines.cuboid_pbr_pipeline = try gvk.createCuboidPbrPipeline(alloc, device, pass, fb_size, self.inner.tex_desc_set_layout, renderer.shadowmap_desc_set_layout, self.inner.mats_desc_set_layout, renderer.cam_desc_set_layout, self.inner.materials_desc_set_layout);
+        self.inner.pipelines.cuboid_shadow_pipeline = try gvk.createCuboidShadowPipeline(alloc, device, shadow_pass, shadow_dim, self.inner.tex_desc_set_layout);
 
         try self.batcher.initVK(alloc, vert_buf, index_buf, mats_buf, mats_desc_set, materials_buf, materials_desc_set, vk_ctx, renderer, self.inner.pipelines, &self.image_store);
         for (self.batcher.inner.batcher_frames) |frame| {
@@ -212,6 +222,7 @@ pub const Graphics = struct {
             .cur_cam_world_pos = undefined,
             .tmp_joint_idxes = undefined,
             .image_store = image.ImageStore.init(alloc, self),
+            .cuboid_bufs = cuboid_buffer.CuboidBufferStore.init(alloc, self),
             .dpr = dpr,
             .dpr_ceil = @floatToInt(u8, std.math.ceil(dpr)),
             .vec2_helper_buf = std.ArrayList(Vec2).init(alloc),
@@ -230,6 +241,8 @@ pub const Graphics = struct {
         std.mem.set(u32, &buf, 0xFFFFFFFF);
         self.white_tex = self.image_store.createImageFromBitmap(4, 4, std.mem.sliceAsBytes(buf[0..]), .{
             .linear_filter = false,
+            // Shapes sample the entire texture.
+            .atlas = false,
         });
 
         self.font_cache.init(alloc, self);
@@ -276,6 +289,7 @@ pub const Graphics = struct {
             lyon.deinit();
         }
 
+        self.cuboid_bufs.deinit();
         self.image_store.deinit();
 
         self.vec2_helper_buf.deinit();
@@ -516,6 +530,10 @@ pub const Graphics = struct {
         text_renderer.measureText(self, self.ps.font_gid, self.ps.font_size, self.dpr_ceil, str, res, true);
     }
 
+    pub fn prewarmGlyphs(self: *Graphics, group_id: FontGroupId, font_sizes: []const f32, ranges: []const graphics.CodepointRange) void {
+        self.font_cache.prewarmGlyphs(self, group_id, font_sizes, self.dpr_ceil, ranges);
+    }
+
     pub fn measureFontText(self: *Graphics, group_id: FontGroupId, size: f32, str: []const u8, res: *TextMetrics) void {
         text_renderer.measureText(self, group_id, size, self.dpr_ceil, str, res, true);
     }
@@ -561,7 +579,11 @@ pub const Graphics = struct {
         var iter = text_renderer.RenderTextIterator.init(self, self.ps.font_gid, self.ps.font_size, self.dpr_ceil, start_x, start_y, str);
 
         while (iter.nextCodepointQuad(true)) {
-            self.setCurrentTexture(iter.quad.image);
+            if (iter.quad.is_sdf) {
+                self.batcher.beginTexSdf(iter.quad.image);
+            } else {
+                self.setCurrentTexture(iter.quad.image);
+            }
 
             if (iter.quad.is_color_bitmap) {
                 vert.setColor(Color.White);
@@ -1870,41 +1892,30 @@ pub const Graphics = struct {
         self.batcher.mesh.pushMaterial(material);
 
         self.batcher.ensureUnusedBuffer(6*4, 6*6);
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(Color.White);
-        vert.setUV(0, 0);
-        const far_top_left = Vec4.init(-0.5, 0.5, -0.5, 1.0);
-        const far_top_right = Vec4.init(0.5, 0.5, -0.5, 1.0);
-        const far_bot_right = Vec4.init(0.5, -0.5, -0.5, 1.0);
-        const far_bot_left = Vec4.init(-0.5, -0.5, -0.5, 1.0);
-        const near_top_left = Vec4.init(-0.5, 0.5, 0.5, 1.0);
-        const near_top_right = Vec4.init(0.5, 0.5, 0.5, 1.0);
-        const near_bot_right = Vec4.init(0.5, -0.5, 0.5, 1.0);
-        const near_bot_left = Vec4.init(-0.5, -0.5, 0.5, 1.0);
-
-        // Far face.
-        vert.setNormal(Vec3.init(0, 0, -1));
-        self.batcher.mesh.pushQuad(far_top_right, far_top_left, far_bot_left, far_bot_right, vert);
-
-        // Left face.
-        vert.setNormal(Vec3.init(-1, 0, 0));
-        self.batcher.mesh.pushQuad(far_top_left, near_top_left, near_bot_left, far_bot_left, vert);
-
-        // Right face.
-        vert.setNormal(Vec3.init(1, 0, 0));
-        self.batcher.mesh.pushQuad(near_top_right, far_top_right, far_bot_right, near_bot_right, vert);
-
-        // Near face.
-        vert.setNormal(Vec3.init(0, 0, 1));
-        self.batcher.mesh.pushQuad(near_top_left, near_top_right, near_bot_right, near_bot_left, vert);
-
-        // Bottom face.
-        vert.setNormal(Vec3.init(0, -1, 0));
-        self.batcher.mesh.pushQuad(far_bot_right, far_bot_left, near_bot_left, near_bot_right, vert);
-
-        // Top face.
-        vert.setNormal(Vec3.init(0, 1, 0));
-        self.batcher.mesh.pushQuad(far_top_left, far_top_right, near_top_right, near_top_left, vert);
+        self.batcher.mesh.pushUnitCuboid();
+
+        self.batcher.beginMvp(cur_mvp);
+    }
+
+    /// Draws the cuboids in a buffer with one instanced draw call.
+    pub fn drawCuboidsPbr3D(self: *Graphics, buf_id: CuboidBufferId) void {
+        const buf = self.cuboid_bufs.get(buf_id);
+        if (buf.num_instances == 0) {
+            return;
+        }
+        self.batcher.beginCuboidPbr3D(self.white_tex, self.cur_cam_world_pos);
+        const cur_mvp = self.batcher.mvp;
+        // Create temp mvp.
+        const vp = self.ps.view_xform.getAppliedTransform(self.ps.proj_xform);
+        self.batcher.beginMvp(vp);
+
+        self.batcher.ensureUnusedBuffer(6*4, 6*6);
+        self.batcher.mesh.pushUnitCuboid();
+        if (Backend == .Vulkan) {
+            self.batcher.inner.cur_cuboid_buf = buf.inner.buf.?.buf;
+        }
+        self.batcher.instance_count = buf.num_instances;
+        self.batcher.endCmd();
 
         self.batcher.beginMvp(cur_mvp);
     }
@@ -1934,8 +1945,7 @@ pub const Graphics = struct {
 
     pub fn drawTintedMesh3D(self: *Graphics, xform: Transform, mesh: graphics.Mesh3D, color: Color) void {
         if (mesh.image_id) |image_id| {
-            const img = self.image_store.images.getNoCheck(image_id);
-            self.batcher.beginTex3D(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
+            self.batcher.beginTex3D(self.image_store.getOwnTexture(image_id));
         } else {
             self.batcher.beginTex3D(self.white_tex);
         }
@@ -1989,8 +1999,7 @@ pub const Graphics = struct {
 
     pub fn drawMesh3D(self: *Graphics, xform: Transform, mesh: graphics.Mesh3D) void {
         if (mesh.image_id) |image_id| {
-            const img = self.image_store.images.getNoCheck(image_id);
-            self.batcher.beginTex3D(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
+            self.batcher.beginTex3D(self.image_store.getOwnTexture(image_id));
         } else {
             self.batcher.beginTex3D(self.white_tex);
         }
@@ -2005,8 +2014,7 @@ pub const Graphics = struct {
 
     pub fn drawMeshPbrCustom3D(self: *Graphics, xform: Transform, mesh: graphics.Mesh3D, mat: graphics.Material) void {
         if (mesh.image_id) |image_id| {
-            const img = self.image_store.images.getNoCheck(image_id);
-            self.batcher.beginTexPbr3D(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id }, self.cur_cam_world_pos);
+            self.batcher.beginTexPbr3D(self.image_store.getOwnTexture(image_id), self.cur_cam_world_pos);
         } else {
             self.batcher.beginTexPbr3D(self.white_tex, self.cur_cam_world_pos);
         }
@@ -2030,8 +2038,7 @@ pub const Graphics = struct {
 
     pub fn drawMeshPbr3D(self: *Graphics, xform: Transform, mesh: graphics.Mesh3D) void {
         if (mesh.image_id) |image_id| {
-            const img = self.image_store.images.getNoCheck(image_id);
-            self.batcher.beginTexPbr3D(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id }, self.cur_cam_world_pos);
+            self.batcher.beginTexPbr3D(self.image_store.getOwnTexture(image_id), self.cur_cam_world_pos);
         } else {
             self.batcher.beginTexPbr3D(self.white_tex, self.cur_cam_world_pos);
         }
@@ -2108,8 +2115,7 @@ pub const Graphics = struct {
             for (node.primitives) |prim| {
                 const tex = if (fill) self.white_tex else b: {
                     if (prim.image_id) |image_id| {
-                        const img = self.image_store.images.getNoCheck(image_id);
-                        break :b image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id };
+                        break :b self.image_store.getOwnTexture(image_id);
                     } else {
                         break :b self.white_tex;
                     }
@@ -2257,9 +2263,30 @@ pub const Graphics = struct {
         self.pushLyonVertexData(&data, self.ps.stroke_color);
     }
 
+    /// Source rect is in image pixels.
     pub fn drawSubImage(self: *Graphics, src_x: f32, src_y: f32, src_width: f32, src_height: f32, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
-        const img = self.image_store.images.get(image_id);
-        self.batcher.beginTex(image.ImageDesc{ .image_id = image_id, .tex_id = img.tex_id });
+        const img = self.image_store.images.getNoCheck(image_id);
+        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
+        self.pushImageQuad(img, src_x, src_y, src_width, src_height, x, y, width, height);
+    }
+
+    pub fn drawImageSized(self: *Graphics, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
+        const img = self.image_store.images.getNoCheck(image_id);
+        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
+        self.pushImageQuad(img, 0, 0, @intToFloat(f32, img.width), @intToFloat(f32, img.height), x, y, width, height);
+    }
+
+    pub fn drawImage(self: *Graphics, x: f32, y: f32, image_id: ImageId) void {
+        const img = self.image_store.images.getNoCheck(image_id);
+        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
+        const width = @intToFloat(f32, img.width);
+        const height = @intToFloat(f32, img.height);
+        self.pushImageQuad(img, 0, 0, width, height, x, y, width, height);
+    }
+
+    /// Maps the source rect within the image's texture region to the destination rect.
+    /// Atlas images only cover part of their texture.
+    fn pushImageQuad(self: *Graphics, img: image.Image, src_x: f32, src_y: f32, src_width: f32, src_height: f32, x: f32, y: f32, width: f32, height: f32) void {
         self.batcher.ensureUnusedBuffer(4, 6);
 
         var vert: TexShaderVertex = undefined;
@@ -2267,10 +2294,22 @@ pub const Graphics = struct {
 
         const start_idx = self.batcher.mesh.getNextIndexId();
 
-        const u_start = src_x / width;
-        const u_end = (src_x + src_width) / width;
-        const v_start = src_y / height;
-        const v_end = (src_y + src_height) / height;
+        const img_width = @intToFloat(f32, img.width);
+        const img_height = @intToFloat(f32, img.height);
+        const du = img.u1 - img.u0;
+        const dv = img.v1 - img.v0;
+        const u_start = img.u0 + du * src_x / img_width;
+        const u_end = img.u0 + du * (src_x + src_width) / img_width;
+        var v_start: f32 = undefined;
+        var v_end: f32 = undefined;
+        if (Backend == .OpenGL) {
+            // Images are flipped for gl so the top of the image is at v1.
+            v_start = img.v1 - dv * src_y / img_height;
+            v_end = img.v1 - dv * (src_y + src_height) / img_height;
+        } else {
+            v_start = img.v0 + dv * src_y / img_height;
+            v_end = img.v0 + dv * (src_y + src_height) / img_height;
+        }
 
         // top left
         vert.setXY(x, y);
@@ -2296,118 +2335,6 @@ pub const Graphics = struct {
         self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
     }
 
-    pub fn drawImageSized(self: *Graphics, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
-        const img = self.image_store.images.getNoCheck(image_id);
-        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
-        self.batcher.ensureUnusedBuffer(4, 6);
-
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(Color.White);
-
-        const start_idx = self.batcher.mesh.getNextIndexId();
-
-        if (Backend == .OpenGL) {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + width, y);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + width, y + height);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + height);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-        } else {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + width, y);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + width, y + height);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + height);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-        }
-
-        // add rect
-        self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
-    }
-
-    pub fn drawImage(self: *Graphics, x: f32, y: f32, image_id: ImageId) void {
-        const img = self.image_store.images.getNoCheck(image_id);
-        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
-        self.batcher.ensureUnusedBuffer(4, 6);
-
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(Color.White);
-
-        const start_idx = self.batcher.mesh.getNextIndexId();
-
-        if (Backend == .OpenGL) {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + @intToFloat(f32, img.width), y);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + @intToFloat(f32, img.width), y + @intToFloat(f32, img.height));
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + @intToFloat(f32, img.height));
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-        } else {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + @intToFloat(f32, img.width), y);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + @intToFloat(f32, img.width), y + @intToFloat(f32, img.height));
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + @intToFloat(f32, img.height));
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-        }
-
-        // add rect
-        self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
-    }
-
     /// Like beginFrame but only adjusts the viewport and binds the fbo.
     pub fn bindFramebuffer(self: *Graphics, buf_width: u32, buf_height: u32, fbo: gl.GLuint) void {
         self.endCmd();
@@ -2461,6 +2388,7 @@ pub const Graphics = struct {
         self.buf_height = buf_height;
         self.inner.cur_frame = self.inner.renderer.frames[frame_idx];
         self.batcher.resetStateVK(self.white_tex, frame_idx, framebuffer, self.ps.clear_color);
+        self.font_cache.beginFrame(self);
 
         self.ps.clip_rect = .{
             .x = 0,
@@ -2485,6 +2413,7 @@ pub const Graphics = struct {
         gl.viewport(0, 0, @intCast(c_int, buf_width), @intCast(c_int, buf_height));
 
         self.batcher.resetState(self.white_tex);
+        self.font_cache.beginFrame(self);
 
         // Scissor affects glClear so reset it first.
         self.ps.clip_rect = .{
@@ -2514,12 +2443,15 @@ pub const Graphics = struct {
     pub fn endFrameVK(self: *Graphics) graphics.FrameResultVK {
         self.endCmd();
         self.image_store.processRemovals();
+        self.cuboid_bufs.processRemovals();
         return self.batcher.endFrameVK();
     }
 
     pub fn endFrame(self: *Graphics, buf_width: u32, buf_height: u32, custom_fbo: gl.GLuint) void {
         // log.debug("endFrame", .{});
         self.endCmd();
+        self.image_store.processRemovals();
+        self.cuboid_bufs.processRemovals();
         if (custom_fbo != 0) {
             // If we were drawing to custom framebuffer such as msaa buffer, then blit the custom buffer into the default ogl buffer.
             gl.bindFramebuffer(gl.GL_READ_FRAMEBUFFER, custom_fbo);
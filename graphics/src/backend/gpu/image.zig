@@ -12,6 +12,7 @@ const Color = graphics.Color;
 const svg = graphics.svg;
 const gpu = graphics.gpu;
 const gvk = graphics.vk;
+const ImageAtlas = @import("image_atlas.zig").ImageAtlas;
 const log = stdx.log.scoped(.image);
 
 const ImageId = graphics.ImageId;
@@ -25,6 +26,9 @@ pub const ImageStore = struct {
 
     textures: stdx.ds.PooledHandleList(TextureId, Texture),
 
+    /// Small images are packed into shared textures.
+    atlas: ImageAtlas,
+
     /// Images are queued for removal due to multiple frames in flight.
     removals: std.ArrayList(RemoveEntry),
 
@@ -36,13 +40,15 @@ pub const ImageStore = struct {
             .gpu = gctx,
             .gctx = @fieldParentPtr(graphics.Graphics, "impl", gctx),
             .removals = std.ArrayList(RemoveEntry).init(alloc),
+            .atlas = ImageAtlas.init(alloc),
         };
         return ret;
     }
 
-    pub fn deinit(self: ImageStore) void {
+    pub fn deinit(self: *ImageStore) void {
         // Delete images after since some deinit could have removed images.
         self.images.deinit();
+        self.atlas.deinit();
 
         var iter = self.textures.iterator();
         while (iter.next()) |tex| {
@@ -59,32 +65,41 @@ pub const ImageStore = struct {
 
     /// Cleans up images and their textures that are no longer used.
     pub fn processRemovals(self: *ImageStore) void {
-        for (self.removals.items) |*entry, entry_idx| {
+        var entry_idx: usize = 0;
+        while (entry_idx < self.removals.items.len) {
+            const entry = &self.removals.items[entry_idx];
             if (entry.frame_age < gvk.MaxActiveFrames) {
                 entry.frame_age += 1;
+                entry_idx += 1;
                 continue;
             }
             const image = self.images.getNoCheck(entry.image_id);
-            const tex_id = image.tex_id;
-            const tex = self.textures.getPtrNoCheck(tex_id);
-
             self.images.remove(entry.image_id);
 
-            // Remove from texture's image list.
-            for (tex.inner.cs_images.items) |id, i| {
-                if (id == entry.image_id) {
-                    _ = tex.inner.cs_images.swapRemove(i);
+            if (image.atlas != null) {
+                // The page texture is shared so only the space is released.
+                self.atlas.removeImage(image, entry.image_id);
+            } else if (Backend == .Vulkan) {
+                const tex_id = image.tex_id;
+                const tex = self.textures.getPtrNoCheck(tex_id);
+
+                // Remove from texture's image list.
+                for (tex.inner.cs_images.items) |id, i| {
+                    if (id == entry.image_id) {
+                        _ = tex.inner.cs_images.swapRemove(i);
+                        break;
+                    }
                 }
-            }
 
-            // No more images in the texture. Cleanup.
-            if (tex.inner.cs_images.items.len == 0) {
-                if (Backend == .Vulkan) {
+                // No more images in the texture. Cleanup.
+                if (tex.inner.cs_images.items.len == 0) {
                     tex.deinitVK(self.gpu.inner.ctx.device);
-                } else if (Backend == .OpenGL) {
-                    tex.deinitGL();
+                    self.textures.remove(tex_id);
                 }
-                self.textures.remove(tex_id);
+            } else if (Backend == .OpenGL) {
+                // Each image that isn't in the atlas owns its texture.
+                self.textures.getNoCheck(image.tex_id).deinitGL();
+                self.textures.remove(image.tex_id);
             }
             // Remove the entry.
             _ = self.removals.swapRemove(entry_idx);
@@ -171,9 +186,20 @@ pub const ImageStore = struct {
         };
     }
 
-    // TODO: Each texture resource should be an atlas of images since the number of textures is limited on the gpu.
     /// Assumes rgba data.
+    /// Small images with data are packed into the atlas unless they're used for offscreen rendering.
     pub fn createImageFromBitmapInto(self: *ImageStore, image: *Image, width: usize, height: usize, data: ?[]const u8, opts: graphics.CreateImageOptions) ImageId {
+        if (opts.atlas and !opts.offscreen_rendering and data != null and ImageAtlas.fits(width, height)) {
+            const id = self.atlas.addImage(self, width, height, data.?, opts.linear_filter);
+            image.* = self.images.getNoCheck(id);
+            return id;
+        }
+        self.initTexture(image, width, height, data, opts);
+        return self.images.add(image.*) catch stdx.fatal();
+    }
+
+    /// Inits the image with its own texture resource.
+    fn initTexture(self: *ImageStore, image: *Image, width: usize, height: usize, data: ?[]const u8, opts: graphics.CreateImageOptions) void {
         self.initImage(image, width, height, data, opts.linear_filter);
 
         if (Backend == .Vulkan) {
@@ -216,7 +242,33 @@ pub const ImageStore = struct {
                 image.fbo_id = self.gpu.createTextureFramebuffer(gl_tex_id);
             }
         }
-        return self.images.add(image.*) catch stdx.fatal();
+    }
+
+    /// Gives an image its own texture from rgba data. The image keeps its id.
+    pub fn moveToOwnTexture(self: *ImageStore, id: ImageId, data: []const u8, linear_filter: bool) void {
+        const image = self.images.getPtrNoCheck(id);
+        var own: Image = undefined;
+        self.initTexture(&own, image.width, image.height, data, .{ .linear_filter = linear_filter });
+        own.remove = image.remove;
+        image.* = own;
+    }
+
+    /// Returns the image's texture for draws that sample with their own uvs. eg. 3D meshes.
+    /// An image in the atlas is moved to its own texture first.
+    pub fn getOwnTexture(self: *ImageStore, id: ImageId) ImageTex {
+        const image = self.images.getNoCheck(id);
+        if (image.atlas) |slot| {
+            const pixels = self.alloc.alloc(u8, image.width * image.height * 4) catch stdx.fatal();
+            defer self.alloc.free(pixels);
+            self.atlas.copyImagePixels(image, pixels);
+            const linear_filter = self.atlas.isLinearFilter(slot);
+            self.atlas.removeImage(image, id);
+            self.moveToOwnTexture(id, pixels, linear_filter);
+        }
+        return .{
+            .image_id = id,
+            .tex_id = self.images.getNoCheck(id).tex_id,
+        };
     }
 
     // TODO: Rename to initTexture.
@@ -305,6 +357,22 @@ pub const Image = struct {
     /// Framebuffer used to draw to the texture.
     fbo_id: ?gl.GLuint = null,
     remove: bool, 
+
+    /// Region of the texture covered by the image.
+    u0: f32 = 0,
+    v0: f32 = 0,
+    u1: f32 = 1,
+    v1: f32 = 1,
+
+    /// Set when the image is packed into an atlas page.
+    atlas: ?AtlasSlot = null,
+};
+
+/// Top-left of an atlas image's padded rect in its page.
+pub const AtlasSlot = struct {
+    page: u32,
+    x: u32,
+    y: u32,
 };
 
 pub const Texture = struct {
@@ -0,0 +1,320 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+
+const graphics = @import("../../graphics.zig");
+const gpu = graphics.gpu;
+const ImageId = graphics.ImageId;
+const RectBinPacker = graphics.RectBinPacker;
+const image = @import("image.zig");
+const log = stdx.log.scoped(.image_atlas);
+
+/// Images up to this size in both dimensions are packed into atlas pages.
+pub const MaxImageSize = 256;
+pub const PageSize = 1024;
+
+/// Each image is surrounded by a copy of its edge pixels so linear filtering doesn't sample its neighbors.
+const Padding = 1;
+
+/// Packs small images into shared page textures so drawing different images doesn't end the current batch.
+/// Pages keep their pixels in memory. Space from removed images is reclaimed by repacking the live images into a new page texture,
+/// which keeps the uvs of draws already queued for the old texture valid.
+pub const ImageAtlas = struct {
+    alloc: std.mem.Allocator,
+    /// Pages are heap allocated since they are referenced by pre flush tasks.
+    pages: std.ArrayListUnmanaged(*Page),
+
+    pub fn init(alloc: std.mem.Allocator) ImageAtlas {
+        return .{
+            .alloc = alloc,
+            .pages = .{},
+        };
+    }
+
+    /// Page textures are owned by the image store.
+    pub fn deinit(self: *ImageAtlas) void {
+        for (self.pages.items) |page| {
+            page.deinit(self.alloc);
+            self.alloc.destroy(page);
+        }
+        self.pages.deinit(self.alloc);
+    }
+
+    pub fn fits(width: usize, height: usize) bool {
+        return width > 0 and height > 0 and width <= MaxImageSize and height <= MaxImageSize;
+    }
+
+    /// Finds space for an image in a page with the same filtering, repacking or adding a page when necessary.
+    /// Copies the rgba data into the page and returns the image's record.
+    pub fn addImage(self: *ImageAtlas, store: *image.ImageStore, width: usize, height: usize, data: []const u8, linear_filter: bool) ImageId {
+        const slot = self.allocSlot(store, @intCast(u32, width), @intCast(u32, height), linear_filter);
+        const page = self.pages.items[slot.page];
+        page.copyImage(slot, @intCast(u32, width), @intCast(u32, height), data);
+        page.markDirtyBuffer();
+
+        // Atlas images share the page's texture resource.
+        var img = store.images.getNoCheck(page.image.image_id);
+        img.width = width;
+        img.height = height;
+        img.fbo_id = null;
+        img.remove = false;
+        setSlot(&img, slot);
+        const id = store.images.add(img) catch stdx.fatal();
+        page.image_ids.append(self.alloc, id) catch stdx.fatal();
+        return id;
+    }
+
+    /// Releases the image's space. The space is reclaimed the next time the page is repacked.
+    pub fn removeImage(self: *ImageAtlas, img: image.Image, id: ImageId) void {
+        const slot = img.atlas.?;
+        const page = self.pages.items[slot.page];
+        for (page.image_ids.items) |it, i| {
+            if (it == id) {
+                _ = page.image_ids.swapRemove(i);
+                break;
+            }
+        }
+        page.freed_area += slotArea(@intCast(u32, img.width), @intCast(u32, img.height));
+    }
+
+    /// Copies an atlas image's pixels into a tightly packed rgba buffer.
+    pub fn copyImagePixels(self: ImageAtlas, img: image.Image, dst: []u8) void {
+        const slot = img.atlas.?;
+        const page = self.pages.items[slot.page];
+        const row_size = img.width * 4;
+        var row: usize = 0;
+        while (row < img.height) : (row += 1) {
+            const src_idx = ((slot.y + Padding + row) * PageSize + slot.x + Padding) * 4;
+            std.mem.copy(u8, dst[row * row_size .. (row + 1) * row_size], page.buf[src_idx .. src_idx + row_size]);
+        }
+    }
+
+    pub fn isLinearFilter(self: ImageAtlas, slot: image.AtlasSlot) bool {
+        return self.pages.items[slot.page].linear_filter;
+    }
+
+    pub fn getNumPages(self: ImageAtlas) u32 {
+        return @intCast(u32, self.pages.items.len);
+    }
+
+    pub fn getNumImages(self: ImageAtlas) u32 {
+        var res: u32 = 0;
+        for (self.pages.items) |page| {
+            res += @intCast(u32, page.image_ids.items.len);
+        }
+        return res;
+    }
+
+    fn allocSlot(self: *ImageAtlas, store: *image.ImageStore, width: u32, height: u32, linear_filter: bool) image.AtlasSlot {
+        const slot_width = width + Padding * 2;
+        const slot_height = height + Padding * 2;
+        for (self.pages.items) |page, i| {
+            if (page.linear_filter == linear_filter) {
+                if (page.packer.tryAllocRect(slot_width, slot_height)) |pos| {
+                    return .{ .page = @intCast(u32, i), .x = pos.x, .y = pos.y };
+                }
+            }
+        }
+        for (self.pages.items) |page, i| {
+            if (page.linear_filter == linear_filter and page.freed_area >= slot_width * slot_height) {
+                self.repack(store, page);
+                if (page.packer.tryAllocRect(slot_width, slot_height)) |pos| {
+                    return .{ .page = @intCast(u32, i), .x = pos.x, .y = pos.y };
+                }
+            }
+        }
+
+        const page = self.alloc.create(Page) catch stdx.fatal();
+        page.init(self.alloc, store, linear_filter);
+        self.pages.append(self.alloc, page) catch stdx.fatal();
+        log.debug("new atlas page {}", .{self.pages.items.len});
+        const pos = page.packer.tryAllocRect(slot_width, slot_height).?;
+        return .{ .page = @intCast(u32, self.pages.items.len - 1), .x = pos.x, .y = pos.y };
+    }
+
+    /// Packs the page's live images into a new texture. The old texture is removed once it's no longer in flight.
+    fn repack(self: *ImageAtlas, store: *image.ImageStore, page: *Page) void {
+        // End the current batch so queued uvs still map to the old texture.
+        // This must happen before the buffer is replaced since the flush syncs the page to its old texture.
+        store.endCmdAndMarkForRemoval(page.image.image_id);
+        page.syncToOldTexture();
+        page.image = store.createImageFromBitmap(PageSize, PageSize, null, .{
+            .linear_filter = page.linear_filter,
+        });
+
+        const old_buf = page.buf;
+        defer self.alloc.free(old_buf);
+        page.buf = self.alloc.alloc(u8, PageSize * PageSize * 4) catch stdx.fatal();
+        std.mem.set(u8, page.buf, 0);
+        page.packer.reset();
+        page.freed_area = 0;
+        const page_img = store.images.getNoCheck(page.image.image_id);
+
+        // Taller images first packs tighter with a skyline.
+        const S = struct {
+            fn lessThan(store_: *image.ImageStore, a: ImageId, b: ImageId) bool {
+                return store_.images.getNoCheck(a).height > store_.images.getNoCheck(b).height;
+            }
+        };
+        std.sort.sort(ImageId, page.image_ids.items, store, S.lessThan);
+
+        var i: usize = 0;
+        while (i < page.image_ids.items.len) {
+            const id = page.image_ids.items[i];
+            const img = store.images.getPtrNoCheck(id);
+            const old_slot = img.atlas.?;
+            const slot_width = @intCast(u32, img.width) + Padding * 2;
+            const slot_height = @intCast(u32, img.height) + Padding * 2;
+            if (page.packer.tryAllocRect(slot_width, slot_height)) |pos| {
+                const slot = image.AtlasSlot{ .page = old_slot.page, .x = pos.x, .y = pos.y };
+                copyRect(page.buf, PageSize, slot.x, slot.y, old_buf, PageSize, old_slot.x, old_slot.y, slot_width, slot_height);
+                img.tex_id = page_img.tex_id;
+                img.inner = page_img.inner;
+                setSlot(img, slot);
+                i += 1;
+            } else {
+                // A different order doesn't always fit. Give the image its own texture instead.
+                var pixels = self.alloc.alloc(u8, img.width * img.height * 4) catch stdx.fatal();
+                defer self.alloc.free(pixels);
+                copyRect(pixels, @intCast(u32, img.width), 0, 0, old_buf, PageSize, old_slot.x + Padding, old_slot.y + Padding, @intCast(u32, img.width), @intCast(u32, img.height));
+                _ = page.image_ids.swapRemove(i);
+                store.moveToOwnTexture(id, pixels, page.linear_filter);
+            }
+        }
+        page.markDirtyBuffer();
+    }
+};
+
+const Page = struct {
+    image: image.ImageTex,
+    packer: RectBinPacker,
+    /// Rgba pixels of the entire page. Synced to the gpu before the next batch is flushed.
+    buf: []u8,
+    linear_filter: bool,
+    image_ids: std.ArrayListUnmanaged(ImageId),
+    /// Packed area of removed images.
+    freed_area: u32,
+    dirty: bool,
+    g: *gpu.Graphics,
+
+    fn init(self: *Page, alloc: std.mem.Allocator, store: *image.ImageStore, linear_filter: bool) void {
+        self.* = .{
+            .image = store.createImageFromBitmap(PageSize, PageSize, null, .{
+                .linear_filter = linear_filter,
+            }),
+            .packer = RectBinPacker.init(alloc, PageSize, PageSize),
+            .buf = alloc.alloc(u8, PageSize * PageSize * 4) catch stdx.fatal(),
+            .linear_filter = linear_filter,
+            .image_ids = .{},
+            .freed_area = 0,
+            .dirty = false,
+            .g = store.gpu,
+        };
+        std.mem.set(u8, self.buf, 0);
+    }
+
+    fn deinit(self: *Page, alloc: std.mem.Allocator) void {
+        self.packer.deinit();
+        alloc.free(self.buf);
+        self.image_ids.deinit(alloc);
+    }
+
+    /// Copies the image into the slot and extrudes its edges into the padding.
+    fn copyImage(self: *Page, slot: image.AtlasSlot, width: u32, height: u32, data: []const u8) void {
+        const x = slot.x + Padding;
+        const y = slot.y + Padding;
+        copyRect(self.buf, PageSize, x, y, data, width, 0, 0, width, height);
+        // Left and right columns.
+        var row: u32 = y;
+        while (row < y + height) : (row += 1) {
+            const start = (row * PageSize + x) * 4;
+            const end = (row * PageSize + x + width - 1) * 4;
+            std.mem.copy(u8, self.buf[start - 4 .. start], self.buf[start .. start + 4]);
+            std.mem.copy(u8, self.buf[end + 4 .. end + 8], self.buf[end .. end + 4]);
+        }
+        // Top and bottom rows including the corners.
+        const row_size = (width + Padding * 2) * 4;
+        const top = (slot.y * PageSize + slot.x) * 4;
+        const first = ((slot.y + 1) * PageSize + slot.x) * 4;
+        std.mem.copy(u8, self.buf[top .. top + row_size], self.buf[first .. first + row_size]);
+        const bottom = ((y + height) * PageSize + slot.x) * 4;
+        const last = ((y + height - 1) * PageSize + slot.x) * 4;
+        std.mem.copy(u8, self.buf[bottom .. bottom + row_size], self.buf[last .. last + row_size]);
+    }
+
+    fn markDirtyBuffer(self: *Page) void {
+        if (!self.dirty) {
+            self.dirty = true;
+            self.g.batcher.addNextPreFlushTask(self, syncPageToGpu);
+        }
+    }
+
+    /// Uploads pending writes before the page moves to a new texture, since quads queued this frame still sample the old one.
+    /// The queued sync task stays in place and uploads to the new texture.
+    fn syncToOldTexture(self: *Page) void {
+        if (self.dirty) {
+            const img = self.g.image_store.images.getNoCheck(self.image.image_id);
+            self.g.updateTextureData(img, self.buf);
+        }
+    }
+};
+
+/// Updates the page texture before the current batch is sent to the gpu.
+fn syncPageToGpu(ptr: ?*anyopaque) void {
+    const self = stdx.mem.ptrCastAlign(*Page, ptr);
+    self.dirty = false;
+    const img = self.g.image_store.images.getNoCheck(self.image.image_id);
+    self.g.updateTextureData(img, self.buf);
+}
+
+fn setSlot(img: *image.Image, slot: image.AtlasSlot) void {
+    img.atlas = slot;
+    const page_size = @intToFloat(f32, PageSize);
+    img.u0 = @intToFloat(f32, slot.x + Padding) / page_size;
+    img.v0 = @intToFloat(f32, slot.y + Padding) / page_size;
+    img.u1 = @intToFloat(f32, slot.x + Padding + @intCast(u32, img.width)) / page_size;
+    img.v1 = @intToFloat(f32, slot.y + Padding + @intCast(u32, img.height)) / page_size;
+}
+
+fn slotArea(width: u32, height: u32) u32 {
+    return (width + Padding * 2) * (height + Padding * 2);
+}
+
+/// Copies a rect of rgba pixels. Strides are in pixels.
+fn copyRect(dst: []u8, dst_stride: u32, dst_x: u32, dst_y: u32, src: []const u8, src_stride: u32, src_x: u32, src_y: u32, width: u32, height: u32) void {
+    const row_size = width * 4;
+    var row: u32 = 0;
+    while (row < height) : (row += 1) {
+        const dst_idx = ((dst_y + row) * dst_stride + dst_x) * 4;
+        const src_idx = ((src_y + row) * src_stride + src_x) * 4;
+        std.mem.copy(u8, dst[dst_idx .. dst_idx + row_size], src[src_idx .. src_idx + row_size]);
+    }
+}
+
+test "Page.copyImage extrudes image edges into the padding" {
+    var page: Page = undefined;
+    page.buf = try t.alloc.alloc(u8, PageSize * PageSize * 4);
+    defer t.alloc.free(page.buf);
+    std.mem.set(u8, page.buf, 0);
+
+    // 2x1 image with a red and a blue pixel.
+    const data = [_]u8{ 255, 0, 0, 255, 0, 0, 255, 255 };
+    page.copyImage(.{ .page = 0, .x = 0, .y = 0 }, 2, 1, &data);
+
+    const S = struct {
+        fn pixel(buf: []const u8, x: u32, y: u32) [4]u8 {
+            const idx = (y * PageSize + x) * 4;
+            return buf[idx..][0..4].*;
+        }
+    };
+    const red = [4]u8{ 255, 0, 0, 255 };
+    const blue = [4]u8{ 0, 0, 255, 255 };
+    try t.eq(S.pixel(page.buf, 1, 1), red);
+    try t.eq(S.pixel(page.buf, 2, 1), blue);
+    // Extruded columns, rows and corners.
+    try t.eq(S.pixel(page.buf, 0, 1), red);
+    try t.eq(S.pixel(page.buf, 3, 1), blue);
+    try t.eq(S.pixel(page.buf, 0, 0), red);
+    try t.eq(S.pixel(page.buf, 3, 2), blue);
+    try t.eq(S.pixel(page.buf, 4, 1), [4]u8{ 0, 0, 0, 0 });
+}
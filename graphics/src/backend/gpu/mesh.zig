@@ -147,6 +147,46 @@ pub const Mesh = struct {
         self.cur_index_buf_size += 6;
     }
 
+    /// Pushes a unit cube centered at the origin. Vertices are duped so that each side reflects light without interpolating the normals.
+    /// Caller must check that there is space for 24 vertices and 36 indexes.
+    pub fn pushUnitCuboid(self: *Mesh) void {
+        var vert: TexShaderVertex = undefined;
+        vert.setColor(Color.White);
+        vert.setUV(0, 0);
+        const far_top_left = Vec4.init(-0.5, 0.5, -0.5, 1.0);
+        const far_top_right = Vec4.init(0.5, 0.5, -0.5, 1.0);
+        const far_bot_right = Vec4.init(0.5, -0.5, -0.5, 1.0);
+        const far_bot_left = Vec4.init(-0.5, -0.5, -0.5, 1.0);
+        const near_top_left = Vec4.init(-0.5, 0.5, 0.5, 1.0);
+        const near_top_right = Vec4.init(0.5, 0.5, 0.5, 1.0);
+        const near_bot_right = Vec4.init(0.5, -0.5, 0.5, 1.0);
+        const near_bot_left = Vec4.init(-0.5, -0.5, 0.5, 1.0);
+
+        // Far face.
+        vert.setNormal(Vec3.init(0, 0, -1));
+        self.pushQuad(far_top_right, far_top_left, far_bot_left, far_bot_right, vert);
+
+        // Left face.
+        vert.setNormal(Vec3.init(-1, 0, 0));
+        self.pushQuad(far_top_left, near_top_left, near_bot_left, far_bot_left, vert);
+
+        // Right face.
+        vert.setNormal(Vec3.init(1, 0, 0));
+        self.pushQuad(near_top_right, far_top_right, far_bot_right, near_bot_right, vert);
+
+        // Near face.
+        vert.setNormal(Vec3.init(0, 0, 1));
+        self.pushQuad(near_top_left, near_top_right, near_bot_right, near_bot_left, vert);
+
+        // Bottom face.
+        vert.setNormal(Vec3.init(0, -1, 0));
+        self.pushQuad(far_bot_right, far_bot_left, near_bot_left, near_bot_right, vert);
+
+        // Top face.
+        vert.setNormal(Vec3.init(0, 1, 0));
+        self.pushQuad(far_top_left, far_top_right, near_top_right, near_top_left, vert);
+    }
+
     // Add vertex data that should be together.
     pub fn pushVertexData(self: *Mesh, comptime num_verts: usize, comptime num_indices: usize, vdata: *VertexData(num_verts, num_indices)) void {
         const first_idx = self.pushVertexes(&vdata.verts);
@@ -9,6 +9,15 @@ const FontId = graphics.FontId;
 const VMetrics = graphics.VMetrics;
 const log = std.log.scoped(.font);
 
+/// Codepoints below this (ASCII, Latin-1 and Latin Extended-A) are stored in a dense table instead of the glyph hashmap.
+pub const DenseLatinEnd = 0x180;
+
+/// General punctuation is also common in UI text.
+pub const DensePunctStart = 0x2000;
+pub const DensePunctEnd = 0x2070;
+
+const DenseGlyphCount = DenseLatinEnd + (DensePunctEnd - DensePunctStart);
+
 // Represents a font rendered at a specific bitmap font size.
 pub const RenderFont = struct {
     const Self = @This();
@@ -18,8 +27,19 @@ pub const RenderFont = struct {
     // The font size of the underlying bitmap data.
     render_font_size: u16,
 
+    // Outline glyphs are generated as distance fields.
+    sdf: bool,
+
+    // Glyphs with codepoints outside of the dense table.
     glyphs: std.AutoHashMap(u21, Glyph),
 
+    // Allocated with the first dense glyph. Indexed by denseIndex.
+    dense_glyphs: ?*[DenseGlyphCount]Glyph,
+    dense_loaded: std.StaticBitSet(DenseGlyphCount),
+
+    // Glyphs substituted by the shaper don't map to a codepoint so they're keyed by glyph id.
+    substituted_glyphs: std.AutoHashMap(u16, Glyph),
+
     // Special missing glyph, every font should have this. glyph_id = 0.
     missing_glyph: ?Glyph,
 
@@ -38,7 +58,7 @@ pub const RenderFont = struct {
     // should just be ascent + descent amounts.
     font_height: f32,
 
-    pub fn initOutline(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16) void {
+    pub fn initOutline(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16, sdf: bool) void {
         const scale = ot_font.getScaleToUserFontSize(@intToFloat(f32, render_font_size));
 
         const v_metrics = ot_font.getVerticalMetrics();
@@ -49,16 +69,18 @@ pub const RenderFont = struct {
         self.* = .{
             .font_id = font_id,
             .render_font_size = render_font_size,
+            .sdf = sdf,
             .scale_from_ttf = scale,
             .ascent = s_ascent,
             .descent = s_descent,
             .line_gap = s_line_gap,
             .font_height = s_ascent - s_descent,
             .glyphs = std.AutoHashMap(u21, Glyph).init(alloc),
+            .dense_glyphs = null,
+            .dense_loaded = std.StaticBitSet(DenseGlyphCount).initEmpty(),
+            .substituted_glyphs = std.AutoHashMap(u16, Glyph).init(alloc),
             .missing_glyph = null,
         };
-        // Start with enough memory for ascii codepoints.
-        self.glyphs.ensureTotalCapacity(256) catch unreachable;
     }
 
     pub fn initBitmap(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16) void {
@@ -66,22 +88,117 @@ pub const RenderFont = struct {
         self.* = .{
             .font_id = font_id,
             .render_font_size = render_font_size,
+            .sdf = false,
             .scale_from_ttf = 1,
             .ascent = @intToFloat(f32, v_metrics.ascender),
             .descent = @intToFloat(f32, v_metrics.descender),
             .line_gap = @intToFloat(f32, v_metrics.line_gap),
             .font_height = @intToFloat(f32, v_metrics.ascender - v_metrics.descender),
             .glyphs = std.AutoHashMap(u21, Glyph).init(alloc),
+            .dense_glyphs = null,
+            .dense_loaded = std.StaticBitSet(DenseGlyphCount).initEmpty(),
+            .substituted_glyphs = std.AutoHashMap(u16, Glyph).init(alloc),
             .missing_glyph = null,
         };
-        // Start with enough memory for ascii codepoints.
-        self.glyphs.ensureTotalCapacity(256) catch unreachable;
     }
 
     pub fn deinit(self: *Self) void {
+        if (self.dense_glyphs) |dense| {
+            self.glyphs.allocator.destroy(dense);
+        }
         self.glyphs.deinit();
+        self.substituted_glyphs.deinit();
     }
 
+    inline fn denseIndex(cp: u21) ?u32 {
+        if (cp < DenseLatinEnd) {
+            return cp;
+        }
+        if (cp >= DensePunctStart and cp < DensePunctEnd) {
+            return DenseLatinEnd + (cp - DensePunctStart);
+        }
+        return null;
+    }
+
+    pub fn denseIndexToCp(idx: u32) u21 {
+        if (idx < DenseLatinEnd) {
+            return @intCast(u21, idx);
+        }
+        return @intCast(u21, DensePunctStart + (idx - DenseLatinEnd));
+    }
+
+    pub inline fn getGlyph(self: *Self, cp: u21) ?*Glyph {
+        if (denseIndex(cp)) |idx| {
+            if (self.dense_loaded.isSet(idx)) {
+                return &self.dense_glyphs.?[idx];
+            }
+            return null;
+        }
+        return self.glyphs.getPtr(cp);
+    }
+
+    /// Returned pointer is invalidated by the next putGlyph.
+    pub fn putGlyph(self: *Self, cp: u21, glyph: Glyph) *Glyph {
+        if (denseIndex(cp)) |idx| {
+            if (self.dense_glyphs == null) {
+                self.dense_glyphs = self.glyphs.allocator.create([DenseGlyphCount]Glyph) catch unreachable;
+            }
+            self.dense_glyphs.?[idx] = glyph;
+            self.dense_loaded.set(idx);
+            return &self.dense_glyphs.?[idx];
+        }
+        const entry = self.glyphs.getOrPutValue(cp, glyph) catch unreachable;
+        return entry.value_ptr;
+    }
+
+    /// Returned pointer is invalidated by the next putSubstitutedGlyph.
+    pub fn putSubstitutedGlyph(self: *Self, glyph_id: u16, glyph: Glyph) *Glyph {
+        const entry = self.substituted_glyphs.getOrPutValue(glyph_id, glyph) catch unreachable;
+        return entry.value_ptr;
+    }
+
+    /// Iterates the dense glyphs, the hashmap glyphs, the substituted glyphs and then the missing glyph.
+    pub fn glyphIterator(self: *Self) GlyphIterator {
+        return .{
+            .font = self,
+            .dense_idx = 0,
+            .map_iter = self.glyphs.valueIterator(),
+            .substituted_iter = self.substituted_glyphs.valueIterator(),
+            .missing_done = false,
+        };
+    }
+
+    pub const GlyphIterator = struct {
+        font: *Self,
+        dense_idx: u32,
+        map_iter: std.AutoHashMap(u21, Glyph).ValueIterator,
+        substituted_iter: std.AutoHashMap(u16, Glyph).ValueIterator,
+        missing_done: bool,
+
+        pub fn next(self: *GlyphIterator) ?*Glyph {
+            while (self.dense_idx < DenseGlyphCount) {
+                const idx = self.dense_idx;
+                self.dense_idx += 1;
+                if (self.font.dense_loaded.isSet(idx)) {
+                    return &self.font.dense_glyphs.?[idx];
+                }
+            }
+            if (self.map_iter.next()) |glyph| {
+                return glyph;
+            }
+            if (self.substituted_iter.next()) |glyph| {
+                return glyph;
+            }
+            if (!self.missing_done) {
+                self.missing_done = true;
+                if (self.font.missing_glyph) |*glyph| {
+                    return glyph;
+                }
+            }
+            return null;
+        }
+    };
+
     pub fn getScaleToUserFontSize(self: *const Self, size: f32) f32 {
         return size / @intToFloat(f32, self.render_font_size);
     }
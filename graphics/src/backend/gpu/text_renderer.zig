@@ -1,5 +1,6 @@
 const std = @import("std");
 const stdx = @import("stdx");
+const t = stdx.testing;
 const stbtt = @import("stbtt");
 const gl = @import("gl");
 
@@ -16,6 +17,7 @@ const font_cache = @import("font_cache.zig");
 const BitmapFontStrike = graphics.BitmapFontStrike;
 const log = stdx.log.scoped(.text_renderer);
 const Glyph = @import("glyph.zig").Glyph;
+const ShapedGlyph = @import("../../shaper.zig").ShapedGlyph;
 
 /// Returns an glyph iterator over UTF8 text.
 pub fn textGlyphIter(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dpr: u32, str: []const u8) graphics.TextGlyphIterator {
@@ -63,6 +65,8 @@ pub const TextGlyphIterator = struct {
     fgroup: *FontGroup,
 
     cp_iter: std.unicode.Utf8Iterator,
+    // Bytes before this index are ASCII and don't need to be decoded.
+    ascii_end: usize,
     user_scale: f32,
 
     prev_glyph_id_opt: ?u16,
@@ -74,11 +78,18 @@ pub const TextGlyphIterator = struct {
     primary_font: graphics.FontId,
     primary_ascent: f32,
 
+    // Set when the primary font has GSUB or GPOS tables. Glyphs then come from the cached shaped text instead of the codepoint iterator.
+    shaped_font: ?*Font,
+    shaped: []const ShapedGlyph,
+    shaped_idx: usize,
+    // End of the source bytes whose codepoints were already counted in State.num_chars.
+    shaped_chars_end: usize,
+
     const Self = @This();
 
     fn init(self: *Self, g: *gpu.Graphics, fgroup: *FontGroup, font_size: f32, dpr: u32, str: []const u8, iter: *graphics.TextGlyphIterator) void {
         var req_font_size = font_size;
-        const render_font_size = font_cache.computeRenderFontSize(fgroup.primary_font_desc, &req_font_size) * @intCast(u16, dpr);
+        const render_font_size = font_cache.scaleRenderFontSize(font_cache.computeRenderFontSize(fgroup.primary_font_desc, &req_font_size), dpr);
 
         const primary = g.font_cache.getOrCreateRenderFont(fgroup.primary_font, render_font_size);
         const user_scale = primary.getScaleToUserFontSize(req_font_size);
@@ -87,6 +98,14 @@ pub const TextGlyphIterator = struct {
         iter.primary_descent = -primary.descent * user_scale;
         iter.primary_height = primary.font_height * user_scale;
 
+        var shaped_font: ?*Font = null;
+        var shaped: []const ShapedGlyph = &.{};
+        const primary_font = g.font_cache.getFont(fgroup.primary_font);
+        if (primary_font.font_type == .Outline and primary_font.ot_font.hasLayoutTables()) {
+            shaped_font = primary_font;
+            shaped = g.font_cache.getOrShapeText(primary_font, str);
+        }
+
         iter.state = .{
             // TODO: Update ascent, descent, height depending on current font.
             .ascent = iter.primary_ascent,
@@ -94,34 +113,61 @@ pub const TextGlyphIterator = struct {
             .height = iter.primary_height,
             .start_idx = 0,
             .end_idx = 0,
+            .num_chars = 0,
             .cp = undefined,
             .kern = undefined,
             .advance_width = undefined,
             .primary_offset_y = 0,
+            .offset_x = 0,
+            .offset_y = 0,
         };
         self.* = .{
             .g = g,
             .fgroup = fgroup,
             .user_scale = user_scale,
             .cp_iter = std.unicode.Utf8View.initUnchecked(str).iterator(),
+            .ascii_end = stdx.unicode.indexOfNonAscii(str, 0),
             .prev_glyph_id_opt = null,
             .prev_glyph_font = null,
             .req_font_size = req_font_size,
             .render_font_size = render_font_size,
             .primary_font = fgroup.primary_font,
             .primary_ascent = iter.primary_ascent,
+            .shaped_font = shaped_font,
+            .shaped = shaped,
+            .shaped_idx = 0,
+            .shaped_chars_end = 0,
         };
     }
 
     pub fn setIndex(self: *Self, i: usize) void {
         self.cp_iter.i = i;
+        self.ascii_end = stdx.unicode.indexOfNonAscii(self.cp_iter.bytes, i);
+        if (self.shaped_font != null) {
+            self.shaped_chars_end = i;
+            self.shaped_idx = 0;
+            while (self.shaped_idx < self.shaped.len and self.shaped[self.shaped_idx].start_idx < i) {
+                self.shaped_idx += 1;
+            }
+        }
     }
 
     /// Provide a callback to the glyph data so a renderer can prepare a quad.
     pub fn nextCodepoint(self: *Self, state: *graphics.TextGlyphIterator.State, ctx: anytype, comptime m_cb: ?fn (@TypeOf(ctx), Glyph) void) bool {
+        if (self.shaped_font) |font| {
+            return self.nextShapedGlyph(font, state, ctx, m_cb);
+        }
         state.start_idx = self.cp_iter.i;
-        state.cp = self.cp_iter.nextCodepoint() orelse return false;
+        if (self.cp_iter.i < self.ascii_end) {
+            state.cp = self.cp_iter.bytes[self.cp_iter.i];
+            self.cp_iter.i += 1;
+        } else {
+            state.cp = self.cp_iter.nextCodepoint() orelse return false;
+            // Find the next ASCII run.
+            self.ascii_end = stdx.unicode.indexOfNonAscii(self.cp_iter.bytes, self.cp_iter.i);
+        }
         state.end_idx = self.cp_iter.i;
+        state.num_chars = 1;
 
         const glyph_info = self.g.font_cache.getOrLoadFontGroupGlyph(self.g, self.fgroup, self.render_font_size, state.cp);
         const glyph = glyph_info.glyph;
@@ -163,6 +209,79 @@ pub const TextGlyphIterator = struct {
         return true;
     }
 
+    /// Steps through the shaped glyphs instead of codepoints. A ligature is one step that covers all of its codepoints,
+    /// so consumers that map steps to chars should advance by State.num_chars.
+    fn nextShapedGlyph(self: *Self, font: *Font, state: *graphics.TextGlyphIterator.State, ctx: anytype, comptime m_cb: ?fn (@TypeOf(ctx), Glyph) void) bool {
+        const shaped = self.nextShapedCluster(state) orelse return false;
+
+        const glyph_info = if (shaped.substituted)
+            self.g.font_cache.getOrLoadSubstitutedGlyph(self.g, font, self.render_font_size, shaped.glyph_id)
+        else
+            // Glyphs missing from the primary font still go through the fallback fonts.
+            self.g.font_cache.getOrLoadFontGroupGlyph(self.g, self.fgroup, self.render_font_size, shaped.cp);
+        const glyph = glyph_info.glyph;
+
+        if (self.prev_glyph_font != glyph_info.font) {
+            // Recompute the scale for the new font.
+            self.user_scale = glyph_info.render_font.getScaleToUserFontSize(self.req_font_size);
+            if (glyph_info.font.id != self.primary_font) {
+                state.primary_offset_y = self.primary_ascent - glyph_info.render_font.ascent * self.user_scale;
+            } else {
+                state.primary_offset_y = 0;
+            }
+        }
+
+        if (glyph_info.font == font) {
+            const scale = glyph_info.render_font.scale_from_ttf * self.user_scale;
+            state.advance_width = @intToFloat(f32, shaped.x_advance) * scale;
+            state.offset_x = @intToFloat(f32, shaped.x_offset) * scale;
+            // Shaper offsets point up.
+            state.offset_y = -@intToFloat(f32, shaped.y_offset) * scale;
+            state.kern = 0;
+            if (font.ot_font.gpos_offset == null) {
+                // Without GPOS, kerning comes from the kern table.
+                if (self.prev_glyph_id_opt) |prev_glyph_id| {
+                    state.kern = computeKern(prev_glyph_id, self.prev_glyph_font.?, glyph.glyph_id, font, glyph_info.render_font, self.user_scale, state.cp);
+                }
+            }
+        } else {
+            state.advance_width = glyph.advance_width * self.user_scale;
+            state.offset_x = 0;
+            state.offset_y = 0;
+            state.kern = 0;
+        }
+
+        if (m_cb) |cb| {
+            cb(ctx, glyph.*);
+        }
+
+        self.prev_glyph_id_opt = glyph.glyph_id;
+        self.prev_glyph_font = glyph_info.font;
+        return true;
+    }
+
+    /// Advances to the next shaped glyph and sets the source range it covers.
+    fn nextShapedCluster(self: *Self, state: *graphics.TextGlyphIterator.State) ?ShapedGlyph {
+        if (self.shaped_idx == self.shaped.len) {
+            return null;
+        }
+        const shaped = self.shaped[self.shaped_idx];
+        self.shaped_idx += 1;
+        state.start_idx = shaped.start_idx;
+        state.end_idx = shaped.end_idx;
+        state.cp = shaped.cp;
+        self.cp_iter.i = shaped.end_idx;
+        // Glyphs from a multiple substitution share the source range so only the first one counts its chars.
+        const chars_start = std.math.max(shaped.start_idx, self.shaped_chars_end);
+        if (shaped.end_idx > chars_start) {
+            state.num_chars = @intCast(u32, std.unicode.utf8CountCodepoints(self.cp_iter.bytes[chars_start..shaped.end_idx]) catch shaped.end_idx - chars_start);
+            self.shaped_chars_end = shaped.end_idx;
+        } else {
+            state.num_chars = 0;
+        }
+        return shaped;
+    }
+
     // Consumes until the next non space cp or end of string.
     pub fn nextNonSpaceCodepoint(self: *Self) bool {
         const parent = @fieldParentPtr(graphics.MeasureTextIterator, "inner", self);
@@ -244,10 +363,11 @@ pub const RenderTextIterator = struct {
                 self_.quad.image = glyph.image;
                 self_.quad.cp = self_.iter.state.cp;
                 self_.quad.is_color_bitmap = glyph.is_color_bitmap;
+                self_.quad.is_sdf = glyph.is_sdf;
                 // quad.x0 = ctx.x + glyph.x_offset * user_scale;
                 // Snap to pixel for consistent glyph rendering.
-                self_.quad.x0 = @round(self_.x + glyph.x_offset * scale);
-                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y;
+                self_.quad.x0 = @round(self_.x + glyph.x_offset * scale + self_.iter.state.offset_x);
+                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y + self_.iter.state.offset_y;
                 self_.quad.x1 = self_.quad.x0 + glyph.dst_width * scale;
                 self_.quad.y1 = self_.quad.y0 + glyph.dst_height * scale;
                 self_.quad.u0 = glyph.u0;
@@ -266,8 +386,9 @@ pub const RenderTextIterator = struct {
                 self_.quad.image = glyph.image;
                 self_.quad.cp = self_.iter.state.cp;
                 self_.quad.is_color_bitmap = glyph.is_color_bitmap;
-                self_.quad.x0 = self_.x + glyph.x_offset * scale;
-                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y;
+                self_.quad.is_sdf = glyph.is_sdf;
+                self_.quad.x0 = self_.x + glyph.x_offset * scale + self_.iter.state.offset_x;
+                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y + self_.iter.state.offset_y;
                 self_.quad.x1 = self_.quad.x0 + glyph.dst_width * scale;
                 self_.quad.y1 = self_.quad.y0 + glyph.dst_height * scale;
                 self_.quad.u0 = glyph.u0;
@@ -288,6 +409,7 @@ pub const TextureQuad = struct {
     image: ImageTex,
     cp: u21,
     is_color_bitmap: bool,
+    is_sdf: bool,
     x0: f32,
     y0: f32,
     x1: f32,
@@ -297,3 +419,59 @@ pub const TextureQuad = struct {
     u1: f32,
     v1: f32,
 };
+
+test "Shaped clusters" {
+    const S = struct {
+        fn glyph(cp: u21, start_idx: u32, end_idx: u32) ShapedGlyph {
+            return .{
+                .glyph_id = 0,
+                .cp = cp,
+                .start_idx = start_idx,
+                .end_idx = end_idx,
+                .x_advance = 0,
+                .x_offset = 0,
+                .y_offset = 0,
+                .substituted = true,
+                .class = .none,
+                .form = .none,
+            };
+        }
+    };
+    // "fié" where "fi" is a ligature and "é" was substituted with two glyphs.
+    const str = "fi\u{e9}x";
+    const shaped = [_]ShapedGlyph{
+        S.glyph('f', 0, 2),
+        S.glyph(0xe9, 2, 4),
+        S.glyph(0xe9, 2, 4),
+        S.glyph('x', 4, 5),
+    };
+    var iter: TextGlyphIterator = undefined;
+    iter.cp_iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+    iter.shaped = &shaped;
+    iter.shaped_idx = 0;
+    iter.shaped_chars_end = 0;
+    var state: graphics.TextGlyphIterator.State = undefined;
+
+    _ = iter.nextShapedCluster(&state).?;
+    try t.eq(state.start_idx, 0);
+    try t.eq(state.end_idx, 2);
+    try t.eq(state.num_chars, 2);
+    try t.eq(iter.cp_iter.i, 2);
+
+    _ = iter.nextShapedCluster(&state).?;
+    try t.eq(state.start_idx, 2);
+    try t.eq(state.end_idx, 4);
+    try t.eq(state.num_chars, 1);
+    _ = iter.nextShapedCluster(&state).?;
+    try t.eq(state.num_chars, 0);
+
+    _ = iter.nextShapedCluster(&state).?;
+    try t.eq(state.num_chars, 1);
+    try t.eq(iter.nextShapedCluster(&state) == null, true);
+
+    // Restarting inside the text counts from the new index.
+    iter.shaped_idx = 1;
+    iter.shaped_chars_end = 2;
+    _ = iter.nextShapedCluster(&state).?;
+    try t.eq(state.num_chars, 1);
+}
@@ -66,6 +66,7 @@ pub const TextGlyphIterator = struct {
         state.start_idx = self.cp_iter.i;
         state.cp = self.cp_iter.nextCodepoint() orelse return false;
         state.end_idx = self.cp_iter.i;
+        state.num_chars = 1;
 
         state.kern = 0;
         const factor = self.font_size / self.g.default_font_size;
@@ -73,6 +74,8 @@ pub const TextGlyphIterator = struct {
         state.ascent = factor * self.g.default_font_metrics.ascender;
         state.descent = 0;
         state.height = factor * self.g.default_font_metrics.height;
+        state.offset_x = 0;
+        state.offset_y = 0;
         return true;
     }
 
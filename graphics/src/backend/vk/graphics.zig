@@ -601,11 +601,155 @@ pub fn createTexPbrPipeline(alloc: std.mem.Allocator, device: vk.VkDevice, pass:
     });
 }
 
+/// Per instance attributes come from the cuboid buffer bound to binding 1.
+pub fn createCuboidPbrPipeline(alloc: std.mem.Allocator, device: vk.VkDevice, pass: vk.VkRenderPass, view_dim: vk.VkExtent2D, tex_desc_set_layout: vk.VkDescriptorSetLayout, shadowmap_desc_set_layout: vk.VkDescriptorSetLayout,
+    mats_desc_set_layout: vk.VkDescriptorSetLayout, cam_desc_set_layout: vk.VkDescriptorSetLayout, materials_desc_set_layout: vk.VkDescriptorSetLayout) !Pipeline {
+    const bind_descriptors = [_]vk.VkVertexInputBindingDescription{
+        vk.VkVertexInputBindingDescription{
+            .binding = 0,
+            .stride = @sizeOf(gpu.TexShaderVertex),
+            .inputRate = vk.VK_VERTEX_INPUT_RATE_VERTEX,
+        },
+        vk.VkVertexInputBindingDescription{
+            .binding = 1,
+            .stride = @sizeOf(graphics.CuboidInstance),
+            .inputRate = vk.VK_VERTEX_INPUT_RATE_INSTANCE,
+        },
+    };
+    const material_offset = @offsetOf(graphics.CuboidInstance, "material");
+    const attr_descriptors = [_]vk.VkVertexInputAttributeDescription{
+        initAttrDesc(gpu.TexShaderVertex, "pos", vk.VK_FORMAT_R32G32B32A32_SFLOAT, 0),
+        initAttrDesc(gpu.TexShaderVertex, "normal", vk.VK_FORMAT_R32G32B32_SFLOAT, 1),
+        initAttrDesc(gpu.TexShaderVertex, "uv", vk.VK_FORMAT_R32G32_SFLOAT, 2),
+        initInstanceAttrDesc(@offsetOf(graphics.CuboidInstance, "pos"), vk.VK_FORMAT_R32G32B32_SFLOAT, 3),
+        initInstanceAttrDesc(@offsetOf(graphics.CuboidInstance, "extent"), vk.VK_FORMAT_R32G32B32_SFLOAT, 4),
+        // Emissivity, roughness, metallic.
+        initInstanceAttrDesc(material_offset + @offsetOf(graphics.Material, "emissivity"), vk.VK_FORMAT_R32G32B32_SFLOAT, 5),
+        initInstanceAttrDesc(material_offset + @offsetOf(graphics.Material, "albedo_color"), vk.VK_FORMAT_R32G32B32A32_SFLOAT, 6),
+    };
+    const pvis_info = vk.VkPipelineVertexInputStateCreateInfo{
+        .sType = vk.VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = bind_descriptors.len,
+        .pVertexBindingDescriptions = &bind_descriptors,
+        .vertexAttributeDescriptionCount = attr_descriptors.len,
+        .pVertexAttributeDescriptions = &attr_descriptors,
+        .pNext = null,
+        .flags = 0,
+    };
+
+    const push_const_range = [_]vk.VkPushConstantRange{
+        vk.VkPushConstantRange{
+            .offset = 0,
+            .size = @sizeOf(CuboidVertexConstant),
+            .stageFlags = vk.VK_SHADER_STAGE_VERTEX_BIT,
+        },
+    };
+
+    // Same sets as the tex pbr pipeline since the fragment shader is shared.
+    const desc_set_layouts = [_]vk.VkDescriptorSetLayout{
+        tex_desc_set_layout,
+        mats_desc_set_layout,
+        cam_desc_set_layout,
+        materials_desc_set_layout,
+        shadowmap_desc_set_layout,
+    };
+
+    const pl_info = vk.VkPipelineLayoutCreateInfo{
+        .sType = vk.VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = desc_set_layouts.len,
+        .pSetLayouts = &desc_set_layouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_const_range,
+        .pNext = null,
+        .flags = 0,
+    };
+
+    var include_map = std.StringHashMap([]const u8).init(alloc);
+    defer include_map.deinit();
+    try include_map.put("pbr.glsl", shaders.pbr_glsl);
+    const vert_spv = try gpu.shader.compileGLSL(alloc, .Vertex, shaders.cuboid_pbr_vert_glsl, .{});
+    defer alloc.free(vert_spv);
+    const frag_spv = try gpu.shader.compileGLSL(alloc, .Fragment, shaders.tex_pbr_frag_glsl, .{ .include_map = include_map.unmanaged });
+    defer alloc.free(frag_spv);
+    return pipeline.createDefaultPipeline(device, pass, view_dim, pvis_info, pl_info, .{
+        .vert_spv = vert_spv,
+        .frag_spv = frag_spv,
+        .depth_test = true,
+        .line_mode = false,
+    });
+}
+
+pub fn createCuboidShadowPipeline(alloc: std.mem.Allocator, device: vk.VkDevice, pass: vk.VkRenderPass, view_dim: vk.VkExtent2D, tex_desc_set_layout: vk.VkDescriptorSetLayout) !Pipeline {
+    const bind_descriptors = [_]vk.VkVertexInputBindingDescription{
+        vk.VkVertexInputBindingDescription{
+            .binding = 0,
+            .stride = @sizeOf(gpu.TexShaderVertex),
+            .inputRate = vk.VK_VERTEX_INPUT_RATE_VERTEX,
+        },
+        vk.VkVertexInputBindingDescription{
+            .binding = 1,
+            .stride = @sizeOf(graphics.CuboidInstance),
+            .inputRate = vk.VK_VERTEX_INPUT_RATE_INSTANCE,
+        },
+    };
+    const attr_descriptors = [_]vk.VkVertexInputAttributeDescription{
+        initAttrDesc(gpu.TexShaderVertex, "pos", vk.VK_FORMAT_R32G32B32A32_SFLOAT, 0),
+        initInstanceAttrDesc(@offsetOf(graphics.CuboidInstance, "pos"), vk.VK_FORMAT_R32G32B32_SFLOAT, 1),
+        initInstanceAttrDesc(@offsetOf(graphics.CuboidInstance, "extent"), vk.VK_FORMAT_R32G32B32_SFLOAT, 2),
+    };
+    const pvis_info = vk.VkPipelineVertexInputStateCreateInfo{
+        .sType = vk.VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = bind_descriptors.len,
+        .pVertexBindingDescriptions = &bind_descriptors,
+        .vertexAttributeDescriptionCount = attr_descriptors.len,
+        .pVertexAttributeDescriptions = &attr_descriptors,
+        .pNext = null,
+        .flags = 0,
+    };
+
+    const push_const_range = [_]vk.VkPushConstantRange{
+        vk.VkPushConstantRange{
+            .offset = 0,
+            .size = @sizeOf(CuboidVertexConstant),
+            .stageFlags = vk.VK_SHADER_STAGE_VERTEX_BIT,
+        },
+    };
+
+    const desc_set_layouts = [_]vk.VkDescriptorSetLayout{
+        tex_desc_set_layout,
+    };
+
+    const pl_info = vk.VkPipelineLayoutCreateInfo{
+        .sType = vk.VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = desc_set_layouts.len,
+        .pSetLayouts = &desc_set_layouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_const_range,
+        .pNext = null,
+        .flags = 0,
+    };
+
+    const vert_spv = try gpu.shader.compileGLSL(alloc, .Vertex, shaders.cuboid_shadow_vert_glsl, .{});
+    defer alloc.free(vert_spv);
+    const frag_spv = try gpu.shader.compileGLSL(alloc, .Fragment, shaders.shadow_frag_glsl, .{});
+    defer alloc.free(frag_spv);
+    return pipeline.createDefaultPipeline(device, pass, view_dim, pvis_info, pl_info, .{
+        .vert_spv = vert_spv,
+        .frag_spv = frag_spv,
+        .depth_test = true,
+        .line_mode = false,
+    });
+}
+
 pub const ModelVertexConstant = struct {
     vp: stdx.math.Mat4,
     model_idx: u32,
 };
 
+pub const CuboidVertexConstant = struct {
+    vp: stdx.math.Mat4,
+};
+
 pub const ShadowVertexConstant = struct {
     vp: stdx.math.Mat4,
     model_idx: u32,
@@ -650,6 +794,16 @@ fn initAttrDesc(comptime Vertex: type, comptime field_name: []const u8, comptime
     };
 }
 
+/// Attribute read per instance from binding 1.
+fn initInstanceAttrDesc(offset: u32, format: vk.VkFormat, location: u32) vk.VkVertexInputAttributeDescription {
+    return .{
+        .binding = 1,
+        .location = location,
+        .format = format,
+        .offset = offset,
+    };
+}
+
 pub fn createAnimPipeline(alloc: std.mem.Allocator, device: vk.VkDevice, pass: vk.VkRenderPass, view_dim: vk.VkExtent2D, mats_desc_set_layout: vk.VkDescriptorSetLayout, tex_desc_set_layout: vk.VkDescriptorSetLayout) !Pipeline {
     const bind_descriptors = [_]vk.VkVertexInputBindingDescription{
         vk.VkVertexInputBindingDescription{
@@ -868,6 +1022,7 @@ pub const Pipelines = struct {
     wireframe_pipeline: Pipeline,
     tex_pipeline: Pipeline,
     tex_pipeline_2d: Pipeline,
+    tex_sdf_pipeline_2d: Pipeline,
     tex_pbr_pipeline: Pipeline,
     anim_pipeline: Pipeline,
     anim_pbr_pipeline: Pipeline,
@@ -876,11 +1031,14 @@ pub const Pipelines = struct {
     norm_pipeline: Pipeline,
     shadow_pipeline: Pipeline,
     anim_shadow_pipeline: Pipeline,
+    cuboid_pbr_pipeline: Pipeline,
+    cuboid_shadow_pipeline: Pipeline,
 
     pub fn deinit(self: Pipelines, device: vk.VkDevice) void {
         self.wireframe_pipeline.deinit(device);
         self.tex_pipeline.deinit(device);
         self.tex_pipeline_2d.deinit(device);
+        self.tex_sdf_pipeline_2d.deinit(device);
         self.tex_pbr_pipeline.deinit(device);
         self.anim_pipeline.deinit(device);
         self.anim_pbr_pipeline.deinit(device);
@@ -889,6 +1047,8 @@ pub const Pipelines = struct {
         self.norm_pipeline.deinit(device);
         self.shadow_pipeline.deinit(device);
         self.anim_shadow_pipeline.deinit(device);
+        self.cuboid_pbr_pipeline.deinit(device);
+        self.cuboid_shadow_pipeline.deinit(device);
     }
 };
 
@@ -3,6 +3,7 @@ pub const norm_frag_glsl = @embedFile("shaders/norm_frag.glsl");
 
 pub const tex_vert_glsl = @embedFile("shaders/tex_vert.glsl");
 pub const tex_frag_glsl = @embedFile("shaders/tex_frag.glsl");
+pub const tex_sdf_frag_glsl = @embedFile("shaders/tex_sdf_frag.glsl");
 
 pub const anim_vert_glsl = @embedFile("shaders/anim_vert.glsl");
 pub const anim_frag_glsl = @embedFile("shaders/anim_frag.glsl");
@@ -22,6 +23,9 @@ pub const tex_pbr_frag_glsl = @embedFile("shaders/tex_pbr_frag.glsl");
 pub const shadow_vert_glsl = @embedFile("shaders/shadow_vert.glsl");
 pub const shadow_frag_glsl = @embedFile("shaders/shadow_frag.glsl");
 
+pub const cuboid_pbr_vert_glsl = @embedFile("shaders/cuboid_pbr_vert.glsl");
+pub const cuboid_shadow_vert_glsl = @embedFile("shaders/cuboid_shadow_vert.glsl");
+
 pub const anim_shadow_vert_glsl = @embedFile("shaders/anim_shadow_vert.glsl");
 pub const anim_shadow_frag_glsl = @embedFile("shaders/anim_shadow_frag.glsl");
 
@@ -0,0 +1,57 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout(set = 2, binding = 2) uniform Camera {
+    vec3 pos;
+    // Directional light, assume normalized.
+    vec3 light_vec;
+    vec3 light_color;
+    mat4 light_vp;
+    bool enable_shadows;
+} u_cam;
+
+layout(push_constant) uniform VertConstants {
+    mat4 vp;
+} u_const;
+
+layout(location = 0) in vec4 a_pos;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_uv;
+
+// Per instance.
+layout(location = 3) in vec3 a_inst_pos;
+layout(location = 4) in vec3 a_inst_extent;
+// Emissivity, roughness, metallic.
+layout(location = 5) in vec3 a_inst_material;
+layout(location = 6) in vec4 a_inst_albedo;
+
+layout(location = 0) out vec2 v_uv;
+layout(location = 1) out vec4 v_color;
+layout(location = 2) out vec3 v_normal;
+layout(location = 3) out vec3 v_pos;
+layout(location = 4) out float v_emissivity;
+layout(location = 5) out float v_roughness;
+layout(location = 6) out float v_metallic;
+layout(location = 7) out vec4 v_light_pos;
+
+void main()
+{
+    v_uv = a_uv;
+    // Cuboids are axis aligned so scaling doesn't change the normals.
+    v_normal = a_normal;
+    // Model matrix of the unit cuboid: scale by the extent and translate to the center.
+    mat4 model = mat4(
+        a_inst_extent.x, 0, 0, a_inst_pos.x,
+        0, a_inst_extent.y, 0, a_inst_pos.y,
+        0, 0, a_inst_extent.z, a_inst_pos.z,
+        0, 0, 0, 1
+    );
+    vec4 world_pos = a_pos * model;
+    v_pos = world_pos.xyz;
+    v_light_pos = vec4(world_pos.xyz, 1.0) * u_cam.light_vp;
+    v_color = a_inst_albedo;
+    v_emissivity = a_inst_material.x;
+    v_roughness = a_inst_material.y;
+    v_metallic = a_inst_material.z;
+    gl_Position = world_pos * u_const.vp;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout(push_constant) uniform VertConstants {
+    mat4 vp;
+} u_const;
+
+layout(location = 0) in vec4 a_pos;
+
+// Per instance.
+layout(location = 1) in vec3 a_inst_pos;
+layout(location = 2) in vec3 a_inst_extent;
+
+void main() {
+    mat4 model = mat4(
+        a_inst_extent.x, 0, 0, a_inst_pos.x,
+        0, a_inst_extent.y, 0, a_inst_pos.y,
+        0, 0, a_inst_extent.z, a_inst_pos.z,
+        0, 0, 0, 1
+    );
+    vec4 world_pos = a_pos * model;
+    gl_Position = world_pos * u_const.vp;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout(binding = 0) uniform sampler2D u_tex;
+
+layout(location = 0) in vec2 v_uv;
+layout(location = 1) in vec4 v_color;
+
+layout(location = 0) out vec4 f_color;
+
+void main() {
+    // Alpha holds a distance field with the edge at 0.5. Antialias across a screen pixel.
+    float dist = texture(u_tex, v_uv).a;
+    float width = fwidth(dist);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+    f_color = vec4(v_color.rgb, v_color.a * alpha);
+}
@@ -136,6 +136,35 @@ pub const Camera = struct {
         };
     }
 
+    /// Returns the perspective view volume in world space. Independent of the backend's clip space.
+    pub fn computeFrustum(self: Camera) Frustum {
+        return self.computeFrustumFar(self.far);
+    }
+
+    /// Same as computeFrustum but with a closer far plane, eg. to apply a draw distance.
+    pub fn computeFrustumFar(self: Camera, far: f32) Frustum {
+        const tan_v = std.math.tan(self.vert_fov_rad/2);
+        const tan_h = tan_v * self.aspect_ratio;
+        const fwd = self.forward_nvec;
+        // Side planes go through the eye. Their normals point inward.
+        const left = self.right_nvec.add(fwd.mul(tan_h)).normalize();
+        const right = self.right_nvec.mul(-1).add(fwd.mul(tan_h)).normalize();
+        const bottom = self.up_nvec.add(fwd.mul(tan_v)).normalize();
+        const top = self.up_nvec.mul(-1).add(fwd.mul(tan_v)).normalize();
+        const near_pt = self.world_pos.add(fwd.mul(self.near));
+        const far_pt = self.world_pos.add(fwd.mul(far));
+        return .{
+            .planes = .{
+                Plane.init(fwd, near_pt),
+                Plane.init(fwd.mul(-1), far_pt),
+                Plane.init(left, self.world_pos),
+                Plane.init(right, self.world_pos),
+                Plane.init(bottom, self.world_pos),
+                Plane.init(top, self.world_pos),
+            },
+        };
+    }
+
     // TODO: Convert to rotate_x, rotate_y.
     // pub fn setForward(self: *Camera, forward: Vec3) void {
     //     self.forward_nvec = forward.normalize();
@@ -162,6 +191,78 @@ pub const Camera = struct {
     }
 };
 
+/// Points on the positive side satisfy dot(normal, pt) + d >= 0.
+pub const Plane = struct {
+    normal: Vec3,
+    d: f32,
+
+    pub fn init(normal: Vec3, pt: Vec3) Plane {
+        return .{
+            .normal = normal,
+            .d = -normal.dot(pt),
+        };
+    }
+
+    pub inline fn distance(self: Plane, pt: Vec3) f32 {
+        return self.normal.dot(pt) + self.d;
+    }
+};
+
+/// Six planes facing inward: near, far, left, right, bottom, top.
+pub const Frustum = struct {
+    planes: [6]Plane,
+
+    /// Conservative test that can report true for boxes near a corner of the frustum.
+    pub fn intersectsAabb(self: Frustum, min: Vec3, max: Vec3) bool {
+        for (self.planes) |plane| {
+            // Test the box corner farthest along the plane normal.
+            const pt = Vec3.init(
+                if (plane.normal.x >= 0) max.x else min.x,
+                if (plane.normal.y >= 0) max.y else min.y,
+                if (plane.normal.z >= 0) max.z else min.z,
+            );
+            if (plane.distance(pt) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    pub fn intersectsSphere(self: Frustum, center: Vec3, radius: f32) bool {
+        for (self.planes) |plane| {
+            if (plane.distance(center) < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+test "Frustum" {
+    var cam: Camera = undefined;
+    cam.initPerspective3D(90, 1, 1, 100);
+    cam.setPos(0, 0, 0);
+    const frustum = cam.computeFrustum();
+    const fwd = cam.forward_nvec;
+
+    // In front.
+    const front = fwd.mul(10);
+    try t.eq(frustum.intersectsAabb(front.add3(-1, -1, -1), front.add3(1, 1, 1)), true);
+    try t.eq(frustum.intersectsSphere(front, 1), true);
+    // Behind.
+    const back = fwd.mul(-10);
+    try t.eq(frustum.intersectsAabb(back.add3(-1, -1, -1), back.add3(1, 1, 1)), false);
+    try t.eq(frustum.intersectsSphere(back, 1), false);
+    // Past the far plane.
+    const far = fwd.mul(200);
+    try t.eq(frustum.intersectsAabb(far.add3(-1, -1, -1), far.add3(1, 1, 1)), false);
+    // Outside the 90 degree horizontal fov.
+    const side = fwd.mul(10).add(cam.right_nvec.mul(20));
+    try t.eq(frustum.intersectsSphere(side, 1), false);
+    // Draw distance.
+    try t.eq(cam.computeFrustumFar(5).intersectsSphere(front, 1), false);
+}
+
 pub fn initDisplayProjection(width: f32, height: f32) Transform {
     return initDisplayProjection2(width, height, gfx_backend);
 }
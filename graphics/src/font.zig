@@ -259,7 +259,7 @@ pub const BitmapFontStrike = struct {
     }
 };
 
-const FreetypeBackend = struct {
+pub const FreetypeBackend = struct {
 
     pub fn initFont(lib: ft.FT_Library, face: **ft.Face, data: []const u8, face_idx: u32) void {
         const err = ft.FT_New_Memory_Face(lib, data.ptr, @intCast(c_long, data.len), @intCast(c_long, face_idx), @ptrCast([*c][*c]ft.Face, face));
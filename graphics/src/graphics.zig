@@ -35,22 +35,31 @@ const log = stdx.log.scoped(.graphics);
 pub const curve = @import("curve.zig");
 pub const camera = @import("camera.zig");
 pub const Camera = camera.Camera;
+pub const Frustum = camera.Frustum;
 pub const CameraModule = camera.CameraModule;
 pub const initTextureProjection = camera.initTextureProjection;
 pub const initPerspectiveProjection = camera.initPerspectiveProjection;
 
 pub const tessellator = @import("tessellator.zig");
 pub const RectBinPacker = @import("rect_bin_packer.zig").RectBinPacker;
+pub const sdf = @import("sdf.zig");
 pub const SwapChain = @import("swapchain.zig").SwapChain;
 pub const Renderer = @import("renderer.zig").Renderer;
 pub const WindowRenderer = @import("renderer.zig").WindowRenderer;
 pub const FrameResultVK = @import("renderer.zig").FrameResultVK;
 
 const _text = @import("text.zig");
+const text_cache = @import("text_cache.zig");
 pub const TextMeasure = _text.TextMeasure;
 pub const TextMetrics = _text.TextMetrics;
+pub const CodepointRange = _text.CodepointRange;
 pub const TextGlyphIterator = _text.TextGlyphIterator;
 pub const TextLayout = _text.TextLayout;
+pub const TextLine = _text.TextLine;
+pub const TextCache = @import("text_cache.zig").TextCache;
+pub const shaper = @import("shaper.zig");
+/// OpenType feature tag, eg. "liga".
+pub const FontFeature = shaper.Tag;
 
 const FontRendererBackendType = enum(u1) {
     /// Default renderer for desktop.
@@ -82,6 +91,7 @@ pub const gpu = @import("backend/gpu/graphics.zig");
 pub const vk = @import("backend/vk/graphics.zig");
 pub const gl = @import("backend/gl/graphics.zig");
 pub const testg = @import("backend/test/graphics.zig");
+pub const cpu = @import("backend/cpu/graphics.zig");
 
 /// Global freetype library handle.
 pub var ft_library: ft.FT_Library = undefined;
@@ -91,6 +101,7 @@ pub const Graphics = struct {
         .OpenGL, .Vulkan => gpu.Graphics,
         .WasmCanvas => canvas.Graphics,
         .Test => testg.Graphics,
+        .Cpu => cpu.Graphics,
         else => void,
     },
     /// Part of migration towards specific backend.
@@ -103,6 +114,9 @@ pub const Graphics = struct {
     svg_parser: svg.SvgParser,
     text_buf: std.ArrayList(u8),
 
+    /// Reuses measurements and layouts of the same text.
+    text_cache: TextCache,
+
     pub fn init(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *gl.Renderer) !void {
         self.initCommon(alloc);
         switch (Backend) {
@@ -123,12 +137,19 @@ pub const Graphics = struct {
         gpu.Graphics.initVK(&self.impl, alloc, dpr, renderer, vk_ctx) catch fatal();
     }
 
+    /// Headless graphics that renders into an in-memory RGBA buffer of the given size.
+    pub fn initCpu(self: *Graphics, alloc: std.mem.Allocator, width: u32, height: u32) !void {
+        self.initCommon(alloc);
+        try cpu.Graphics.init(&self.impl, alloc, width, height);
+    }
+
     fn initCommon(self: *Graphics, alloc: std.mem.Allocator) void {
         self.* = .{
             .alloc = alloc,
             .path_parser = svg.PathParser.init(alloc),
             .svg_parser = svg.SvgParser.init(alloc),
             .text_buf = std.ArrayList(u8).init(alloc),
+            .text_cache = TextCache.init(alloc, text_cache.DefaultMaxEntries),
             .impl = undefined,
             .new_impl = undefined,
         };
@@ -145,6 +166,7 @@ pub const Graphics = struct {
         self.path_parser.deinit();
         self.svg_parser.deinit();
         self.text_buf.deinit();
+        self.text_cache.deinit();
         switch (Backend) {
             .OpenGL => {
                 self.impl.deinit();
@@ -153,6 +175,7 @@ pub const Graphics = struct {
             .Vulkan => self.impl.deinit(),
             .WasmCanvas => self.impl.deinit(),
             .Test => {},
+            .Cpu => self.impl.deinit(),
             else => stdx.unsupported(),
         }
     }
@@ -177,6 +200,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.translate(&self.impl, x, y),
             .WasmCanvas => canvas.Graphics.translate(&self.impl, x, y),
+            .Cpu => cpu.Graphics.translate(&self.impl, x, y),
             else => stdx.unsupported(),
         }
     }
@@ -194,6 +218,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.scale(&self.impl, x, y),
             .WasmCanvas => canvas.Graphics.scale(&self.impl, x, y),
+            .Cpu => cpu.Graphics.scale(&self.impl, x, y),
             else => stdx.unsupported(),
         }
     }
@@ -203,6 +228,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.rotateZ(&self.impl, rad),
             .WasmCanvas => canvas.Graphics.rotate(&self.impl, rad),
+            .Cpu => cpu.Graphics.rotateZ(&self.impl, rad),
             else => stdx.unsupported(),
         }
     }
@@ -214,6 +240,7 @@ pub const Graphics = struct {
     pub fn rotateZ(self: *Graphics, rad: f32) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.rotateZ(&self.impl, rad),
+            .Cpu => cpu.Graphics.rotateZ(&self.impl, rad),
             else => stdx.unsupported(),
         }
     }
@@ -237,6 +264,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.resetTransform(&self.impl),
             .WasmCanvas => canvas.Graphics.resetTransform(&self.impl),
+            .Cpu => cpu.Graphics.resetTransform(&self.impl),
             else => stdx.unsupported(),
         }
     }
@@ -259,6 +287,7 @@ pub const Graphics = struct {
         return switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.getFillColor(self.impl),
             .WasmCanvas => canvas.Graphics.getFillColor(self.impl),
+            .Cpu => cpu.Graphics.getFillColor(self.impl),
             else => stdx.unsupported(),
         };
     }
@@ -267,6 +296,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.setFillColor(&self.impl, color),
             .WasmCanvas => canvas.Graphics.setFillColor(&self.impl, color),
+            .Cpu => cpu.Graphics.setFillColor(&self.impl, color),
             else => stdx.unsupported(),
         }
     }
@@ -289,6 +319,7 @@ pub const Graphics = struct {
     pub fn setFillGradient(self: *Graphics, start_x: f32, start_y: f32, start_color: Color, end_x: f32, end_y: f32, end_color: Color) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.setFillGradient(&self.impl, start_x, start_y, start_color, end_x, end_y, end_color),
+            .Cpu => cpu.Graphics.setFillGradient(&self.impl, start_x, start_y, start_color, end_x, end_y, end_color),
             else => stdx.unsupported(),
         }
     }
@@ -297,6 +328,7 @@ pub const Graphics = struct {
         return switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.getStrokeColor(self.impl),
             .WasmCanvas => canvas.Graphics.getStrokeColor(self.impl),
+            .Cpu => cpu.Graphics.getStrokeColor(self.impl),
             else => stdx.unsupported(),
         };
     }
@@ -305,6 +337,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.setStrokeColor(&self.impl, color),
             .WasmCanvas => canvas.Graphics.setStrokeColor(&self.impl, color),
+            .Cpu => cpu.Graphics.setStrokeColor(&self.impl, color),
             else => stdx.unsupported(),
         }
     }
@@ -313,6 +346,7 @@ pub const Graphics = struct {
         return switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.getLineWidth(self.impl),
             .WasmCanvas => canvas.Graphics.getLineWidth(self.impl),
+            .Cpu => cpu.Graphics.getLineWidth(self.impl),
             else => stdx.unsupported(),
         };
     }
@@ -321,6 +355,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.setLineWidth(&self.impl, width),
             .WasmCanvas => canvas.Graphics.setLineWidth(&self.impl, width),
+            .Cpu => cpu.Graphics.setLineWidth(&self.impl, width),
             else => stdx.unsupported(),
         }
     }
@@ -329,6 +364,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillRectBounds(&self.impl, x, y, x + width, y + height),
             .WasmCanvas => canvas.Graphics.fillRect(&self.impl, x, y, width, height),
+            .Cpu => cpu.Graphics.fillRect(&self.impl, x, y, width, height),
             else => stdx.unsupported(),
         }
     }
@@ -336,6 +372,7 @@ pub const Graphics = struct {
     pub fn fillRectBounds(self: *Graphics, x0: f32, y0: f32, x1: f32, y1: f32) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillRectBounds(&self.impl, x0, y0, x1, y1),
+            .Cpu => cpu.Graphics.fillRectBounds(&self.impl, x0, y0, x1, y1),
             else => stdx.unsupported(),
         }
     }
@@ -344,6 +381,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.drawRectBounds(&self.impl, x, y, x + width, y + height),
             .WasmCanvas => canvas.Graphics.drawRect(&self.impl, x, y, width, height),
+            .Cpu => cpu.Graphics.drawRect(&self.impl, x, y, width, height),
             else => stdx.unsupported(),
         }
     }
@@ -351,6 +389,7 @@ pub const Graphics = struct {
     pub fn drawRectBounds(self: *Graphics, x0: f32, y0: f32, x1: f32, y1: f32) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.drawRectBounds(&self.impl, x0, y0, x1, y1),
+            .Cpu => cpu.Graphics.drawRectBounds(&self.impl, x0, y0, x1, y1),
             else => stdx.unsupported(),
         }
     }
@@ -390,6 +429,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillCircleSector(&self.impl, x, y, radius, start_rad, sweep_rad),
             .WasmCanvas => canvas.Graphics.fillCircleSector(&self.impl, x, y, radius, start_rad, sweep_rad),
+            .Cpu => cpu.Graphics.fillCircleSector(&self.impl, x, y, radius, start_rad, sweep_rad),
             else => stdx.unsupported(),
         }
     }
@@ -415,6 +455,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillCircle(&self.impl, x, y, radius),
             .WasmCanvas => canvas.Graphics.fillCircle(&self.impl, x, y, radius),
+            .Cpu => cpu.Graphics.fillCircle(&self.impl, x, y, radius),
             else => stdx.unsupported(),
         }
     }
@@ -431,6 +472,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillEllipse(&self.impl, x, y, h_radius, v_radius),
             .WasmCanvas => canvas.Graphics.fillEllipse(&self.impl, x, y, h_radius, v_radius),
+            .Cpu => cpu.Graphics.fillEllipse(&self.impl, x, y, h_radius, v_radius),
             else => stdx.unsupported(),
         }
     }
@@ -440,6 +482,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillEllipseSector(&self.impl, x, y, h_radius, v_radius, start_rad, sweep_rad),
             .WasmCanvas => canvas.Graphics.fillEllipseSector(&self.impl, x, y, h_radius, v_radius, start_rad, sweep_rad),
+            .Cpu => cpu.Graphics.fillEllipseSector(&self.impl, x, y, h_radius, v_radius, start_rad, sweep_rad),
             else => stdx.unsupported(),
         }
     }
@@ -481,6 +524,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.drawLine(&self.impl, x1, y1, x2, y2),
             .WasmCanvas => canvas.Graphics.drawLine(&self.impl, x1, y1, x2, y2),
+            .Cpu => cpu.Graphics.drawLine(&self.impl, x1, y1, x2, y2),
             else => stdx.unsupported(),
         }
     }
@@ -506,6 +550,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillTriangle(&self.impl, x1, y1, x2, y2, x3, y3),
             .WasmCanvas => canvas.Graphics.fillTriangle(&self.impl, x1, y1, x2, y2, x3, y3),
+            .Cpu => cpu.Graphics.fillTriangle(&self.impl, x1, y1, x2, y2, x3, y3),
             else => stdx.unsupported(),
         }
     }
@@ -522,6 +567,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillConvexPolygon(&self.impl, pts),
             .WasmCanvas => canvas.Graphics.fillPolygon(&self.impl, pts),
+            .Cpu => cpu.Graphics.fillConvexPolygon(&self.impl, pts),
             else => stdx.unsupported(),
         }
     }
@@ -530,6 +576,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillPolygon(&self.impl, pts),
             .WasmCanvas => canvas.Graphics.fillPolygon(&self.impl, pts),
+            .Cpu => cpu.Graphics.fillPolygon(&self.impl, pts),
             else => stdx.unsupported(),
         }
     }
@@ -738,10 +785,62 @@ pub const Graphics = struct {
                 const image = gpu.ImageStore.createImageFromBitmap(&self.impl.image_store, width, height, data, opts);
                 return image.image_id;
             },
+            .Cpu => return cpu.Graphics.createImageFromBitmap(&self.impl, width, height, data, opts),
             else => stdx.unsupported(),
         }
     }
 
+    /// Saved draw calls are counted for the last completed frame.
+    pub fn getImageAtlasStats(self: *Graphics) ImageAtlasStats {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return .{
+                .num_pages = self.impl.image_store.atlas.getNumPages(),
+                .num_images = self.impl.image_store.atlas.getNumImages(),
+                .saved_draw_calls = self.impl.batcher.last_frame_saved_draw_calls,
+            },
+            else => return .{
+                .num_pages = 0,
+                .num_images = 0,
+                .saved_draw_calls = 0,
+            },
+        }
+    }
+
+    /// Limits the memory used by the glyph atlases. Least recently used glyphs are evicted and rasterized again when they're needed.
+    /// Only the gpu backends cache glyphs in atlas pages.
+    pub fn setFontAtlasMemoryLimit(self: *Graphics, bytes: usize) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => self.impl.font_cache.setAtlasMemoryLimit(bytes),
+            else => {},
+        }
+    }
+
+    /// Loads rasterized glyphs from the directory and saves new ones there on deinit or saveGlyphCache.
+    /// Should be set before any text is drawn. Only the gpu backends rasterize glyphs into atlases.
+    pub fn setGlyphCacheDir(self: *Graphics, path: []const u8) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => self.impl.font_cache.setGlyphCacheDir(path),
+            else => {},
+        }
+    }
+
+    pub fn saveGlyphCache(self: *Graphics) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => self.impl.font_cache.saveGlyphCache(),
+            else => {},
+        }
+    }
+
+    /// Sets the OpenType features used to shape text, eg. to turn off programming ligatures by leaving out "calt" and "liga".
+    /// Defaults to shaper.DefaultFeatures.
+    pub fn setFontFeatures(self: *Graphics, features: []const FontFeature) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => self.impl.font_cache.setShapeFeatures(features),
+            else => {},
+        }
+        self.text_cache.invalidate();
+    }
+
     pub fn dumpImageAsBMP(_: Graphics, data: []const u8, path: [:0]const u8) void {
         var src_width: c_int = undefined;
         var src_height: c_int = undefined;
@@ -777,6 +876,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.drawImage(&self.impl, x, y, image_id),
             .WasmCanvas => return canvas.Graphics.drawImage(&self.impl, x, y, image_id),
+            .Cpu => return cpu.Graphics.drawImage(&self.impl, x, y, image_id),
             else => stdx.unsupported(),
         }
     }
@@ -785,6 +885,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.drawImageSized(&self.impl, x, y, width, height, image_id),
             .WasmCanvas => return canvas.Graphics.drawImageSized(&self.impl, x, y, width, height, image_id),
+            .Cpu => return cpu.Graphics.drawImageSized(&self.impl, x, y, width, height, image_id),
             else => stdx.unsupported(),
         }
     }
@@ -792,6 +893,7 @@ pub const Graphics = struct {
     pub fn drawSubImage(self: *Graphics, src_x: f32, src_y: f32, src_width: f32, src_height: f32, x: f32, y: f32, width: f32, height: f32, image_id: ImageId) void {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.drawSubImage(&self.impl, src_x, src_y, src_width, src_height, x, y, width, height, image_id),
+            .Cpu => return cpu.Graphics.drawSubImage(&self.impl, src_x, src_y, src_width, src_height, x, y, width, height, image_id),
             else => stdx.unsupported(),
         }
     }
@@ -801,6 +903,8 @@ pub const Graphics = struct {
             .OpenGL, .Vulkan => gpu.Graphics.addFallbackFont(&self.impl, font_id),
             else => stdx.unsupported(),
         }
+        // Text that used the missing glyph could now be measured with the fallback font.
+        self.text_cache.invalidate();
     }
 
     /// Adds .otb bitmap font with data at different font sizes.
@@ -816,6 +920,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.addFontTTF(&self.impl, data),
             .WasmCanvas => stdx.panic("Unsupported for WasmCanvas. Use addTTF_FontPathForName instead."),
+            .Cpu => return cpu.Graphics.addFontTTF(&self.impl, data),
             else => stdx.unsupported(),
         }
     }
@@ -836,6 +941,7 @@ pub const Graphics = struct {
                 return self.addFontFromPathTTF(path);
             },
             .WasmCanvas => return canvas.Graphics.addFontFromPathTTF(&self.impl, path, name),
+            .Cpu => return self.addFontFromPathTTF(path),
             else => stdx.unsupported(),
         }
     }
@@ -843,6 +949,7 @@ pub const Graphics = struct {
     pub fn getFontSize(self: *Graphics) f32 {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.getFontSize(self.impl),
+            .Cpu => return cpu.Graphics.getFontSize(self.impl),
             else => stdx.unsupported(),
         }
     }
@@ -851,6 +958,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.setFontSize(&self.impl, font_size),
             .WasmCanvas => canvas.Graphics.setFontSize(&self.impl, font_size),
+            .Cpu => cpu.Graphics.setFontSize(&self.impl, font_size),
             else => stdx.unsupported(),
         }
     }
@@ -862,6 +970,7 @@ pub const Graphics = struct {
                 gpu.Graphics.setFontSize(&self.impl, font_size);
             },
             .WasmCanvas => canvas.Graphics.setFont(&self.impl, font_id, font_size),
+            .Cpu => cpu.Graphics.setFont(&self.impl, font_id, font_size),
             else => stdx.unsupported(),
         }
     }
@@ -882,6 +991,7 @@ pub const Graphics = struct {
             .OpenGL, .Vulkan =>  {
                 gpu.Graphics.setTextAlign(&self.impl, align_);
             },
+            .Cpu => cpu.Graphics.setTextAlign(&self.impl, align_),
             else => stdx.unsupported(),
         }
     }
@@ -891,6 +1001,7 @@ pub const Graphics = struct {
             .OpenGL, .Vulkan =>  {
                 gpu.Graphics.setTextBaseline(&self.impl, baseline);
             },
+            .Cpu => cpu.Graphics.setTextBaseline(&self.impl, baseline),
             else => stdx.unsupported(),
         }
     }
@@ -899,6 +1010,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.fillText(&self.impl, x, y, text),
             .WasmCanvas => canvas.Graphics.fillText(&self.impl, x, y, text),
+            .Cpu => cpu.Graphics.fillText(&self.impl, x, y, text),
             else => stdx.unsupported(),
         }
     }
@@ -923,7 +1035,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => {
                 for (arr) |measure| {
-                    gpu.Graphics.measureFontText(&self.impl, measure.font_gid, measure.font_size, measure.text, &measure.res);
+                    self.measureFontText(measure.font_gid, measure.font_size, measure.text, &measure.res);
                 }
             },
             .WasmCanvas => canvas.Graphics.measureTexts(&self.impl, arr),
@@ -932,6 +1044,15 @@ pub const Graphics = struct {
         }
     }
 
+    /// Loads glyphs for the codepoint ranges at each font size, eg. at startup so the first frame with new text doesn't stall.
+    /// The gpu backends rasterize them on worker threads and they're ready over the next frames.
+    pub fn prewarmGlyphs(self: *Graphics, font_gid: FontGroupId, font_sizes: []const f32, ranges: []const CodepointRange) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.prewarmGlyphs(&self.impl, font_gid, font_sizes, ranges),
+            else => {},
+        }
+    }
+
     /// Measure the char advance between two codepoints.
     pub fn measureCharAdvance(self: *Graphics, font_gid: FontGroupId, font_size: f32, prev_cp: u21, cp: u21) f32 {
         switch (Backend) {
@@ -947,13 +1068,24 @@ pub const Graphics = struct {
     /// Measure some text with a given font.
     pub fn measureFontText(self: *Graphics, font_gid: FontGroupId, font_size: f32, str: []const u8, out: *TextMetrics) void {
         switch (Backend) {
-            .OpenGL, .Vulkan => return self.impl.measureFontText(font_gid, font_size, str, out),
+            .OpenGL, .Vulkan => {
+                if (self.text_cache.getMetrics(font_gid, font_size, str)) |metrics| {
+                    out.* = metrics;
+                    return;
+                }
+                self.impl.measureFontText(font_gid, font_size, str, out);
+                self.text_cache.putMetrics(font_gid, font_size, str, out.*);
+            },
             else => stdx.unsupported(),
         }
     }
 
     /// Perform text layout and save the results.
     pub fn textLayout(self: *Graphics, font_gid: FontGroupId, size: f32, str: []const u8, preferred_width: f32, buf: *TextLayout) void {
+        if (self.text_cache.getLayout(font_gid, size, str, preferred_width, buf)) {
+            return;
+        }
+        defer self.text_cache.putLayout(font_gid, size, str, preferred_width, buf.*);
         buf.lines.clearRetainingCapacity();
         var iter = self.textGlyphIter(font_gid, size, str);
         var y: f32 = 0;
@@ -1124,6 +1256,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.pushState(&self.impl),
             .WasmCanvas => canvas.Graphics.save(&self.impl),
+            .Cpu => cpu.Graphics.pushState(&self.impl),
             else => stdx.unsupported(),
         }
     }
@@ -1132,6 +1265,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.clipRect(&self.impl, x, y, width, height),
             .WasmCanvas => canvas.Graphics.clipRect(&self.impl, x, y, width, height),
+            .Cpu => cpu.Graphics.clipRect(&self.impl, x, y, width, height),
             else => stdx.unsupported(),
         }
     }
@@ -1139,6 +1273,7 @@ pub const Graphics = struct {
     pub fn clipRectBounds(self: *Graphics, x0: f32, y0: f32, x1: f32, y1: f32) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.clipRect(&self.impl, x0, y0, x1 - x0, y1 - y0),
+            .Cpu => cpu.Graphics.clipRect(&self.impl, x0, y0, x1 - x0, y1 - y0),
             else => stdx.unsupported(),
         }
     }
@@ -1147,6 +1282,7 @@ pub const Graphics = struct {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.popState(&self.impl),
             .WasmCanvas => canvas.Graphics.restore(&self.impl),
+            .Cpu => cpu.Graphics.popState(&self.impl),
             else => stdx.unsupported(),
         }
     }
@@ -1154,6 +1290,7 @@ pub const Graphics = struct {
     pub fn getViewTransform(self: Graphics) Transform {
         switch (Backend) {
             .OpenGL, .Vulkan => return gpu.Graphics.getViewTransform(self.impl),
+            .Cpu => return cpu.Graphics.getViewTransform(self.impl),
             else => stdx.unsupported(),
         }
     }
@@ -1201,6 +1338,38 @@ pub const Graphics = struct {
         }
     }
 
+    /// Uploads cuboid instances to the gpu. They stay there until the buffer is updated or removed.
+    pub fn createCuboidBuffer(self: *Graphics, instances: []const CuboidInstance) CuboidBufferId {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.CuboidBufferStore.create(&self.impl.cuboid_bufs, instances),
+            else => unsupported(),
+        }
+    }
+
+    /// Replaces the instances in a cuboid buffer. Only call this when they change.
+    pub fn updateCuboidBuffer(self: *Graphics, buf_id: CuboidBufferId, instances: []const CuboidInstance) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.CuboidBufferStore.update(&self.impl.cuboid_bufs, buf_id, instances),
+            else => unsupported(),
+        }
+    }
+
+    pub fn removeCuboidBuffer(self: *Graphics, buf_id: CuboidBufferId) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.CuboidBufferStore.remove(&self.impl.cuboid_bufs, buf_id),
+            else => unsupported(),
+        }
+    }
+
+    /// Draws the axis aligned cuboids in a cuboid buffer with one instanced draw call.
+    pub fn drawCuboidsPbr3D(self: *Graphics, buf_id: CuboidBufferId) void {
+        switch (Backend) {
+            .OpenGL => gl.Graphics.drawCuboidsPbr3D(&self.new_impl, buf_id),
+            .Vulkan => gpu.Graphics.drawCuboidsPbr3D(&self.impl, buf_id),
+            else => unsupported(),
+        }
+    }
+
     pub fn drawScene3D(self: *Graphics, xform: Transform, scene: GLTFscene) void {
         switch (Backend) {
             .OpenGL, .Vulkan => gpu.Graphics.drawScene3D(&self.impl, xform, scene),
@@ -2304,6 +2473,17 @@ pub const Mesh3D = struct {
 
 const MaterialId = u32;
 
+pub const CuboidBufferId = gpu.CuboidBufferId;
+
+/// An axis aligned cuboid stored in a cuboid buffer. See Graphics.createCuboidBuffer.
+pub const CuboidInstance = struct {
+    /// Center of the cuboid.
+    pos: Vec3,
+    /// Size along each axis.
+    extent: Vec3,
+    material: Material,
+};
+
 pub const Material = struct {
     emissivity: f32,
     roughness: f32,
@@ -2337,4 +2517,15 @@ pub const CreateImageOptions = struct {
 
     /// Whether image samplers will use linear filtering.
     linear_filter: bool = true,
+
+    /// Whether a small image can be packed into a shared atlas texture.
+    /// Disable for textures that are sampled with uvs outside of the image's own region.
+    atlas: bool = true,
+};
+
+pub const ImageAtlasStats = struct {
+    num_pages: u32,
+    num_images: u32,
+    /// Image draws that continued the current batch since the image shared its texture with the previous image.
+    saved_draw_calls: u32,
 };
\ No newline at end of file
@@ -101,6 +101,20 @@ pub const RectBinPacker = struct {
         }
     }
 
+    /// Allocates a rect without resizing. Returns null if there is no space left.
+    pub fn tryAllocRect(self: *Self, width: u32, height: u32) ?Point2 {
+        if (self.findRectSpace(width, height)) |res| {
+            self.allocRectResult(res);
+            return Point2.init(res.x, res.y);
+        } else return null;
+    }
+
+    /// Frees all rects. Keeps the current size.
+    pub fn reset(self: *Self) void {
+        self.spans.clearRetainingCapacity();
+        self.head = self.spans.add(.{ .x = 0, .y = 0, .width = self.width }) catch @panic("error");
+    }
+
     fn allocRectResult(self: *Self, res: FindSpaceResult) void {
         // Remove all spans that are covered by the requested width.
         var visited_width: u32 = 0;
@@ -277,6 +291,19 @@ const FindSpaceResult = struct {
     height: u32,
 };
 
+test "tryAllocRect does not resize." {
+    var packer = RectBinPacker.init(t.alloc, 10, 10);
+    defer packer.deinit();
+
+    try t.eq(packer.tryAllocRect(10, 6), Point2.init(0, 0));
+    try t.eq(packer.tryAllocRect(10, 6), null);
+    try t.eq(packer.width, 10);
+
+    packer.reset();
+    try t.eq(packer.spans.size(), 1);
+    try t.eq(packer.tryAllocRect(10, 6), Point2.init(0, 0));
+}
+
 test "Extend prev span after insert." {
     var packer = RectBinPacker.init(t.alloc, 10, 10);
     defer packer.deinit();
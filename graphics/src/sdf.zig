@@ -0,0 +1,86 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+
+/// Distance field value of a pixel on the edge. Inside pixels are larger and outside pixels are smaller.
+pub const OnEdgeValue = 128;
+
+/// Converts an 8 bit coverage bitmap into a signed distance field of the same size.
+/// Distances are in px and map to OnEdgeValue +/- 127 at the spread. Anything further is clamped.
+/// The source should have an empty border of spread px so the field doesn't get cut off.
+/// Every pixel within the spread is searched, so this is meant for small bitmaps like glyphs.
+pub fn coverageToSdf(dst: []u8, src: []const u8, width: u32, height: u32, spread: u32) void {
+    std.debug.assert(src.len == width * height);
+    std.debug.assert(dst.len == width * height);
+    const spreadf = @intToFloat(f32, spread);
+    const max_dist_sq = (spread + 1) * (spread + 1);
+
+    var y: u32 = 0;
+    while (y < height) : (y += 1) {
+        const y_start = if (y > spread) y - spread else 0;
+        const y_end = std.math.min(y + spread + 1, height);
+        var x: u32 = 0;
+        while (x < width) : (x += 1) {
+            const x_start = if (x > spread) x - spread else 0;
+            const x_end = std.math.min(x + spread + 1, width);
+            const coverage = src[y * width + x];
+            const inside = coverage >= OnEdgeValue;
+
+            // Find the nearest pixel on the other side of the edge.
+            var min_dist_sq: u32 = max_dist_sq;
+            var sy = y_start;
+            while (sy < y_end) : (sy += 1) {
+                const dy = absDiff(sy, y);
+                if (dy * dy >= min_dist_sq) {
+                    continue;
+                }
+                var sx = x_start;
+                while (sx < x_end) : (sx += 1) {
+                    if ((src[sy * width + sx] >= OnEdgeValue) != inside) {
+                        const dx = absDiff(sx, x);
+                        min_dist_sq = std.math.min(min_dist_sq, dx * dx + dy * dy);
+                    }
+                }
+            }
+
+            var dist: f32 = undefined;
+            if (min_dist_sq == 1) {
+                // Pixels next to the edge use their coverage for a subpixel distance.
+                dist = (@intToFloat(f32, coverage) - 127.5) / 255;
+            } else {
+                // The edge is about half a pixel before the nearest pixel on the other side.
+                dist = @sqrt(@intToFloat(f32, min_dist_sq)) - 0.5;
+                if (!inside) {
+                    dist = -dist;
+                }
+            }
+            const val = @intToFloat(f32, OnEdgeValue) + dist / spreadf * 127;
+            dst[y * width + x] = @floatToInt(u8, std.math.clamp(@round(val), 0, 255));
+        }
+    }
+}
+
+inline fn absDiff(a: u32, b: u32) u32 {
+    return if (a > b) a - b else b - a;
+}
+
+test "coverageToSdf" {
+    // 4x4 filled square with a 4px border.
+    const size = 12;
+    var src = [_]u8{0} ** (size * size);
+    var y: u32 = 4;
+    while (y < 8) : (y += 1) {
+        std.mem.set(u8, src[y * size + 4 .. y * size + 8], 255);
+    }
+    var dst: [size * size]u8 = undefined;
+    coverageToSdf(&dst, &src, size, size, 4);
+
+    // Inside the edge.
+    try t.eq(dst[4 * size + 4], 144);
+    try t.eq(dst[5 * size + 5], 176);
+    // Outside the edge.
+    try t.eq(dst[4 * size + 3], 112);
+    try t.eq(dst[4 * size + 2], 80);
+    // Beyond the spread.
+    try t.eq(dst[0], 0);
+}
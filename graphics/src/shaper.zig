@@ -0,0 +1,1189 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const t = stdx.testing;
+
+const graphics = @import("graphics.zig");
+const FontId = graphics.FontId;
+const OpenTypeFont = @import("ttf.zig").OpenTypeFont;
+const log = stdx.log.scoped(.shaper);
+
+// OpenType layout common table formats: https://docs.microsoft.com/en-us/typography/opentype/spec/chapter2
+// GSUB: https://docs.microsoft.com/en-us/typography/opentype/spec/gsub
+// GPOS: https://docs.microsoft.com/en-us/typography/opentype/spec/gpos
+// GDEF: https://docs.microsoft.com/en-us/typography/opentype/spec/gdef
+
+// Not supported yet:
+// - Reverse chaining substitution (GSUB 8) and mark to ligature positioning (GPOS 5).
+// - Mark attachment classes and mark filtering sets in lookup flags.
+// - Indic reordering and bidi. Glyphs are returned in logical order.
+
+/// OpenType script or feature tag.
+pub const Tag = [4]u8;
+
+/// Features applied when the user hasn't set any.
+pub const DefaultFeatures = [_]Tag{
+    "ccmp".*, "locl".*, "rlig".*, "liga".*, "clig".*, "calt".*, "kern".*, "mark".*, "mkmk".*,
+};
+
+/// Arabic features that only apply to glyphs in the matching joining form.
+const JoiningFeatures = [_]Tag{ "isol".*, "init".*, "medi".*, "fina".* };
+
+/// Nested contextual lookups deeper than this are skipped.
+const MaxNesting = 6;
+
+/// Max glyphs matched by a ligature or contextual rule.
+const MaxContextLen = 32;
+
+const LookupFlagIgnoreBaseGlyphs = 0x2;
+const LookupFlagIgnoreLigatures = 0x4;
+const LookupFlagIgnoreMarks = 0x8;
+
+const GsubExtensionType = 7;
+const GposExtensionType = 9;
+
+/// A glyph after shaping. Positions are in font design units and y points up.
+pub const ShapedGlyph = struct {
+    glyph_id: u16,
+
+    /// First codepoint of the source text this glyph was shaped from.
+    cp: u21,
+
+    /// Byte range of the source text. Ligatures cover several codepoints.
+    start_idx: u32,
+    end_idx: u32,
+
+    /// How much this glyph advances the pen. Includes GPOS adjustments.
+    x_advance: i32,
+
+    /// Offset of the glyph from the pen position. Used to place marks.
+    x_offset: i32,
+    y_offset: i32,
+
+    /// The glyph was replaced by GSUB so it can't be looked up by codepoint.
+    substituted: bool,
+
+    /// GDEF glyph class. Used to skip glyphs with lookup flags and to find mark bases.
+    class: GlyphClass,
+
+    /// Arabic joining form.
+    form: JoiningForm,
+};
+
+pub const GlyphClass = enum(u3) {
+    none = 0,
+    base = 1,
+    ligature = 2,
+    mark = 3,
+    component = 4,
+};
+
+pub const JoiningForm = enum(u3) {
+    none,
+    isol,
+    init,
+    medi,
+    fina,
+};
+
+/// Maps codepoints to glyphs and applies the font's GSUB and GPOS lookups for the script and features.
+/// Results are appended to buf in logical order.
+pub fn shape(alloc: std.mem.Allocator, font: *const OpenTypeFont, script: Tag, features: []const Tag, str: []const u8, buf: *std.ArrayList(ShapedGlyph)) void {
+    const start = buf.items.len;
+    var ctx = Context.init(font.data, font, buf, start);
+
+    var iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+    var idx: u32 = 0;
+    while (iter.nextCodepoint()) |cp| {
+        const glyph_id = (font.getGlyphId(cp) catch null) orelse 0;
+        buf.append(.{
+            .glyph_id = glyph_id,
+            .cp = cp,
+            .start_idx = idx,
+            .end_idx = @intCast(u32, iter.i),
+            .x_advance = font.getGlyphHMetrics(glyph_id).advance_width,
+            .x_offset = 0,
+            .y_offset = 0,
+            .substituted = false,
+            .class = ctx.glyphClass(glyph_id),
+            .form = .none,
+        }) catch fatal();
+        idx = @intCast(u32, iter.i);
+    }
+    ctx.max_len = start + (buf.items.len - start) * 8 + 64;
+
+    if (std.meta.eql(script, "arab".*)) {
+        assignJoiningForms(buf.items[start..]);
+    }
+
+    if (font.gsub_offset) |offset| {
+        applyTable(alloc, &ctx, offset, false, script, features);
+    }
+    if (font.gpos_offset) |offset| {
+        applyTable(alloc, &ctx, offset, true, script, features);
+    }
+}
+
+/// Returns the script tag of the first codepoint that belongs to a script. Mixed script text is shaped with the first script.
+pub fn detectScript(str: []const u8) Tag {
+    var iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+    while (iter.nextCodepoint()) |cp| {
+        switch (cp) {
+            'A'...'Z', 'a'...'z', 0xC0...0x24F, 0x1E00...0x1EFF => return "latn".*,
+            0x370...0x3FF => return "grek".*,
+            0x400...0x52F => return "cyrl".*,
+            0x590...0x5FF => return "hebr".*,
+            0x600...0x6FF, 0x750...0x77F, 0xFB50...0xFDFF, 0xFE70...0xFEFF => return "arab".*,
+            0x900...0x97F => return "dev2".*,
+            0xE00...0xE7F => return "thai".*,
+            0x1100...0x11FF, 0xAC00...0xD7AF => return "hang".*,
+            0x3040...0x30FF => return "kana".*,
+            0x4E00...0x9FFF => return "hani".*,
+            else => {},
+        }
+    }
+    return "DFLT".*;
+}
+
+const Context = struct {
+    data: []const u8,
+    font: *const OpenTypeFont,
+    glyphs: *std.ArrayList(ShapedGlyph),
+    /// Glyphs before this index belong to previous runs in the buffer.
+    start: usize,
+    /// Multiple substitutions stop once the buffer reaches this length.
+    max_len: usize,
+
+    /// Offset of the GDEF glyph class definitions.
+    glyph_class_def: ?usize,
+
+    is_gpos: bool,
+    lookup_list: usize,
+    depth: u32,
+
+    fn init(data: []const u8, font: *const OpenTypeFont, glyphs: *std.ArrayList(ShapedGlyph), start: usize) Context {
+        var glyph_class_def: ?usize = null;
+        if (font.gdef_offset) |gdef| {
+            const offset = readU16(data, gdef + 4);
+            if (offset != 0) {
+                glyph_class_def = gdef + offset;
+            }
+        }
+        return .{
+            .data = data,
+            .font = font,
+            .glyphs = glyphs,
+            .start = start,
+            .max_len = std.math.maxInt(usize),
+            .glyph_class_def = glyph_class_def,
+            .is_gpos = false,
+            .lookup_list = 0,
+            .depth = 0,
+        };
+    }
+
+    fn glyphClass(self: Context, glyph_id: u16) GlyphClass {
+        const offset = self.glyph_class_def orelse return .none;
+        const class = classDefValue(self.data, offset, glyph_id);
+        if (class > 4) {
+            return .none;
+        }
+        return @intToEnum(GlyphClass, @intCast(u3, class));
+    }
+
+    fn substitute(self: *Context, pos: usize, glyph_id: u16) void {
+        const glyph = &self.glyphs.items[pos];
+        glyph.glyph_id = glyph_id;
+        glyph.substituted = true;
+        glyph.class = self.glyphClass(glyph_id);
+        glyph.x_advance = self.font.getGlyphHMetrics(glyph_id).advance_width;
+    }
+
+    fn isIgnored(self: Context, flag: u16, pos: usize) bool {
+        return switch (self.glyphs.items[pos].class) {
+            .base => flag & LookupFlagIgnoreBaseGlyphs != 0,
+            .ligature => flag & LookupFlagIgnoreLigatures != 0,
+            .mark => flag & LookupFlagIgnoreMarks != 0,
+            else => false,
+        };
+    }
+
+    fn nextIndex(self: Context, flag: u16, pos: usize) ?usize {
+        var i = pos + 1;
+        while (i < self.glyphs.items.len) : (i += 1) {
+            if (!self.isIgnored(flag, i)) {
+                return i;
+            }
+        }
+        return null;
+    }
+
+    fn prevIndex(self: Context, flag: u16, pos: usize) ?usize {
+        var i = pos;
+        while (i > self.start) {
+            i -= 1;
+            if (!self.isIgnored(flag, i)) {
+                return i;
+            }
+        }
+        return null;
+    }
+};
+
+const LookupRef = struct {
+    index: u16,
+    /// Only applies to glyphs in this joining form.
+    form: JoiningForm,
+};
+
+fn applyTable(alloc: std.mem.Allocator, ctx: *Context, table: usize, is_gpos: bool, script: Tag, features: []const Tag) void {
+    ctx.is_gpos = is_gpos;
+    ctx.lookup_list = table + readU16(ctx.data, table + 8);
+
+    var lookups = std.ArrayList(LookupRef).init(alloc);
+    defer lookups.deinit();
+    collectLookups(ctx.data, table, script, features, &lookups);
+
+    for (lookups.items) |ref| {
+        var i: usize = ctx.start;
+        while (i < ctx.glyphs.items.len) {
+            if (ref.form != .none and ctx.glyphs.items[i].form != ref.form) {
+                i += 1;
+                continue;
+            }
+            if (applyLookupAt(ctx, ref.index, i)) |next| {
+                i = std.math.max(next, i + 1);
+            } else {
+                i += 1;
+            }
+        }
+    }
+}
+
+/// Uses the script's default language system, falling back to DFLT and then latn.
+fn findLangSys(data: []const u8, table: usize, script: Tag) ?usize {
+    const script_list = table + readU16(data, table + 4);
+    const script_count = readU16(data, script_list);
+    const fallbacks = [_]Tag{ script, "DFLT".*, "latn".* };
+    for (fallbacks) |tag| {
+        var i: usize = 0;
+        while (i < script_count) : (i += 1) {
+            const rec = script_list + 2 + i * 6;
+            if (std.mem.eql(u8, data[rec .. rec + 4], &tag)) {
+                const script_table = script_list + readU16(data, rec + 4);
+                const default_lang_sys = readU16(data, script_table);
+                if (default_lang_sys != 0) {
+                    return script_table + default_lang_sys;
+                }
+                if (readU16(data, script_table + 2) > 0) {
+                    return script_table + readU16(data, script_table + 8);
+                }
+                return null;
+            }
+        }
+    }
+    return null;
+}
+
+/// Appends the lookups of the enabled features in lookup list order, which is the order they're applied in.
+fn collectLookups(data: []const u8, table: usize, script: Tag, features: []const Tag, res: *std.ArrayList(LookupRef)) void {
+    const lang_sys = findLangSys(data, table, script) orelse return;
+    const feature_list = table + readU16(data, table + 6);
+    const feature_count = readU16(data, feature_list);
+
+    const required = readU16(data, lang_sys + 2);
+    const num_indexes = readU16(data, lang_sys + 4);
+    var i: usize = 0;
+    while (i < @as(usize, num_indexes) + 1) : (i += 1) {
+        const feature_idx = if (i == num_indexes) required else readU16(data, lang_sys + 6 + i * 2);
+        if (feature_idx >= feature_count) {
+            // Also skips a missing required feature (0xFFFF).
+            continue;
+        }
+        const rec = feature_list + 2 + @as(usize, feature_idx) * 6;
+        const tag = data[rec .. rec + 4][0..4].*;
+        var form = JoiningForm.none;
+        if (i != num_indexes and !hasTag(features, tag)) {
+            form = joiningFormForTag(tag) orelse continue;
+        }
+        const feature = feature_list + readU16(data, rec + 4);
+        const lookup_count = readU16(data, feature + 2);
+        var j: usize = 0;
+        while (j < lookup_count) : (j += 1) {
+            res.append(.{
+                .index = readU16(data, feature + 4 + j * 2),
+                .form = form,
+            }) catch fatal();
+        }
+    }
+
+    const S = struct {
+        fn lessThan(_: void, a: LookupRef, b: LookupRef) bool {
+            if (a.index == b.index) {
+                return @enumToInt(a.form) < @enumToInt(b.form);
+            }
+            return a.index < b.index;
+        }
+    };
+    std.sort.sort(LookupRef, res.items, {}, S.lessThan);
+
+    // Features can share lookups.
+    var len: usize = 0;
+    for (res.items) |ref| {
+        if (len > 0 and std.meta.eql(res.items[len - 1], ref)) {
+            continue;
+        }
+        res.items[len] = ref;
+        len += 1;
+    }
+    res.shrinkRetainingCapacity(len);
+}
+
+fn joiningFormForTag(tag: Tag) ?JoiningForm {
+    for (JoiningFeatures) |it, i| {
+        if (std.mem.eql(u8, &it, &tag)) {
+            return @intToEnum(JoiningForm, @intCast(u3, i + 1));
+        }
+    }
+    return null;
+}
+
+fn hasTag(tags: []const Tag, tag: Tag) bool {
+    for (tags) |it| {
+        if (std.mem.eql(u8, &it, &tag)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Tries each subtable of the lookup at pos. Returns the position after the glyphs it applied to.
+fn applyLookupAt(ctx: *Context, lookup_idx: u16, pos: usize) ?usize {
+    const data = ctx.data;
+    if (lookup_idx >= readU16(data, ctx.lookup_list)) {
+        return null;
+    }
+    const lookup = ctx.lookup_list + readU16(data, ctx.lookup_list + 2 + @as(usize, lookup_idx) * 2);
+    const lookup_type = readU16(data, lookup);
+    const flag = readU16(data, lookup + 2);
+    if (ctx.isIgnored(flag, pos)) {
+        return null;
+    }
+    const subtable_count = readU16(data, lookup + 4);
+    var i: usize = 0;
+    while (i < subtable_count) : (i += 1) {
+        var subtable = lookup + readU16(data, lookup + 6 + i * 2);
+        var subtable_type = lookup_type;
+        if (lookup_type == (if (ctx.is_gpos) @as(u16, GposExtensionType) else GsubExtensionType)) {
+            subtable_type = readU16(data, subtable + 2);
+            subtable += readU32(data, subtable + 4);
+        }
+        const res = if (ctx.is_gpos) applyGpos(ctx, subtable_type, subtable, flag, pos) else applyGsub(ctx, subtable_type, subtable, flag, pos);
+        if (res) |next| {
+            return next;
+        }
+    }
+    return null;
+}
+
+fn applyGsub(ctx: *Context, lookup_type: u16, subtable: usize, flag: u16, pos: usize) ?usize {
+    const data = ctx.data;
+    const glyphs = ctx.glyphs;
+    const glyph_id = glyphs.items[pos].glyph_id;
+    switch (lookup_type) {
+        5 => return applyContext(ctx, subtable, flag, pos, false),
+        6 => return applyContext(ctx, subtable, flag, pos, true),
+        1...4 => {},
+        // Reverse chaining is not supported.
+        else => return null,
+    }
+    const cov_idx = coverageIndex(data, subtable + readU16(data, subtable + 2), glyph_id) orelse return null;
+    const format = readU16(data, subtable);
+    switch (lookup_type) {
+        // Single.
+        1 => {
+            if (format == 1) {
+                ctx.substitute(pos, glyph_id +% readU16(data, subtable + 4));
+            } else if (format == 2) {
+                if (cov_idx >= readU16(data, subtable + 4)) {
+                    return null;
+                }
+                ctx.substitute(pos, readU16(data, subtable + 6 + cov_idx * 2));
+            } else return null;
+            return pos + 1;
+        },
+        // Multiple and alternate share a layout. The first alternate is used.
+        2, 3 => {
+            if (cov_idx >= readU16(data, subtable + 4)) {
+                return null;
+            }
+            const seq = subtable + readU16(data, subtable + 6 + cov_idx * 2);
+            const count: usize = if (lookup_type == 3) std.math.min(readU16(data, seq), 1) else readU16(data, seq);
+            if (count == 0 or glyphs.items.len + count - 1 > ctx.max_len) {
+                return null;
+            }
+            ctx.substitute(pos, readU16(data, seq + 2));
+            var i: usize = 1;
+            while (i < count) : (i += 1) {
+                var glyph = glyphs.items[pos];
+                glyph.glyph_id = readU16(data, seq + 2 + i * 2);
+                glyph.class = ctx.glyphClass(glyph.glyph_id);
+                glyph.x_advance = ctx.font.getGlyphHMetrics(glyph.glyph_id).advance_width;
+                glyphs.insert(pos + i, glyph) catch fatal();
+            }
+            return pos + count;
+        },
+        // Ligature.
+        4 => {
+            if (cov_idx >= readU16(data, subtable + 4)) {
+                return null;
+            }
+            const set = subtable + readU16(data, subtable + 6 + cov_idx * 2);
+            const lig_count = readU16(data, set);
+            var i: usize = 0;
+            lig: while (i < lig_count) : (i += 1) {
+                const lig = set + readU16(data, set + 2 + i * 2);
+                const comp_count = readU16(data, lig + 2);
+                if (comp_count == 0 or comp_count > MaxContextLen) {
+                    continue;
+                }
+                var positions: [MaxContextLen]usize = undefined;
+                positions[0] = pos;
+                var c: usize = 1;
+                while (c < comp_count) : (c += 1) {
+                    const next = ctx.nextIndex(flag, positions[c - 1]) orelse continue :lig;
+                    if (glyphs.items[next].glyph_id != readU16(data, lig + 4 + (c - 1) * 2)) {
+                        continue :lig;
+                    }
+                    positions[c] = next;
+                }
+                const end_idx = glyphs.items[positions[comp_count - 1]].end_idx;
+                // Remove the components from the back so the earlier positions stay valid.
+                c = comp_count - 1;
+                while (c > 0) : (c -= 1) {
+                    _ = glyphs.orderedRemove(positions[c]);
+                }
+                ctx.substitute(pos, readU16(data, lig));
+                glyphs.items[pos].end_idx = std.math.max(glyphs.items[pos].end_idx, end_idx);
+                return pos + 1;
+            }
+            return null;
+        },
+        else => unreachable,
+    }
+}
+
+fn applyGpos(ctx: *Context, lookup_type: u16, subtable: usize, flag: u16, pos: usize) ?usize {
+    const data = ctx.data;
+    const glyphs = ctx.glyphs.items;
+    const glyph_id = glyphs[pos].glyph_id;
+    switch (lookup_type) {
+        // Single adjustment.
+        1 => {
+            const cov_idx = coverageIndex(data, subtable + readU16(data, subtable + 2), glyph_id) orelse return null;
+            const format = readU16(data, subtable);
+            const value_format = readU16(data, subtable + 4);
+            const rec = switch (format) {
+                1 => subtable + 6,
+                2 => b: {
+                    if (cov_idx >= readU16(data, subtable + 6)) {
+                        return null;
+                    }
+                    break :b subtable + 8 + cov_idx * valueRecordSize(value_format);
+                },
+                else => return null,
+            };
+            readValueRecord(data, rec, value_format).apply(&glyphs[pos]);
+            return pos + 1;
+        },
+        // Pair adjustment.
+        2 => {
+            const cov_idx = coverageIndex(data, subtable + readU16(data, subtable + 2), glyph_id) orelse return null;
+            const next = ctx.nextIndex(flag, pos) orelse return null;
+            const second_id = glyphs[next].glyph_id;
+            const format1 = readU16(data, subtable + 4);
+            const format2 = readU16(data, subtable + 6);
+            const size1 = valueRecordSize(format1);
+            const size2 = valueRecordSize(format2);
+            var rec: usize = undefined;
+            switch (readU16(data, subtable)) {
+                1 => {
+                    if (cov_idx >= readU16(data, subtable + 8)) {
+                        return null;
+                    }
+                    const set = subtable + readU16(data, subtable + 10 + cov_idx * 2);
+                    const rec_size = 2 + size1 + size2;
+                    // Pair value records are sorted by the second glyph.
+                    var lo: usize = 0;
+                    var hi: usize = readU16(data, set);
+                    while (lo < hi) {
+                        const mid = (lo + hi) / 2;
+                        const mid_rec = set + 2 + mid * rec_size;
+                        const mid_id = readU16(data, mid_rec);
+                        if (mid_id == second_id) {
+                            rec = mid_rec + 2;
+                            break;
+                        } else if (mid_id < second_id) {
+                            lo = mid + 1;
+                        } else {
+                            hi = mid;
+                        }
+                    } else return null;
+                },
+                2 => {
+                    const class1 = classDefValue(data, subtable + readU16(data, subtable + 8), glyph_id);
+                    const class2 = classDefValue(data, subtable + readU16(data, subtable + 10), second_id);
+                    const class1_count = readU16(data, subtable + 12);
+                    const class2_count = readU16(data, subtable + 14);
+                    if (class1 >= class1_count or class2 >= class2_count) {
+                        return null;
+                    }
+                    rec = subtable + 16 + (@as(usize, class1) * class2_count + class2) * (size1 + size2);
+                },
+                else => return null,
+            }
+            readValueRecord(data, rec, format1).apply(&glyphs[pos]);
+            readValueRecord(data, rec + size1, format2).apply(&glyphs[next]);
+            // The second glyph is skipped if it was also adjusted.
+            return if (format2 != 0) next + 1 else next;
+        },
+        4 => return applyMarkAttach(ctx, subtable, pos, false),
+        6 => return applyMarkAttach(ctx, subtable, pos, true),
+        7 => return applyContext(ctx, subtable, flag, pos, false),
+        8 => return applyContext(ctx, subtable, flag, pos, true),
+        else => return null,
+    }
+}
+
+/// Mark to base and mark to mark attachment. They share the same layout.
+fn applyMarkAttach(ctx: *Context, subtable: usize, pos: usize, to_mark: bool) ?usize {
+    const data = ctx.data;
+    const glyphs = ctx.glyphs.items;
+    const mark_idx = coverageIndex(data, subtable + readU16(data, subtable + 2), glyphs[pos].glyph_id) orelse return null;
+
+    // Find the glyph to attach to.
+    if (pos == ctx.start) {
+        return null;
+    }
+    var base = pos - 1;
+    if (to_mark) {
+        if (glyphs[base].class != .mark) {
+            return null;
+        }
+    } else {
+        while (glyphs[base].class == .mark) {
+            if (base == ctx.start) {
+                return null;
+            }
+            base -= 1;
+        }
+    }
+    const base_idx = coverageIndex(data, subtable + readU16(data, subtable + 4), glyphs[base].glyph_id) orelse return null;
+
+    const class_count = readU16(data, subtable + 6);
+    const mark_array = subtable + readU16(data, subtable + 8);
+    const base_array = subtable + readU16(data, subtable + 10);
+    if (mark_idx >= readU16(data, mark_array) or base_idx >= readU16(data, base_array)) {
+        return null;
+    }
+    const mark_class = readU16(data, mark_array + 2 + mark_idx * 4);
+    if (mark_class >= class_count) {
+        return null;
+    }
+    const mark_anchor = readAnchor(data, mark_array + readU16(data, mark_array + 4 + mark_idx * 4));
+    const base_anchor_offset = readU16(data, base_array + 2 + (base_idx * class_count + mark_class) * 2);
+    if (base_anchor_offset == 0) {
+        return null;
+    }
+    const base_anchor = readAnchor(data, base_array + base_anchor_offset);
+
+    // Attached marks don't advance. Offset the mark back to the base's pen position.
+    glyphs[pos].x_advance = 0;
+    var advance: i32 = 0;
+    for (glyphs[base..pos]) |glyph| {
+        advance += glyph.x_advance;
+    }
+    glyphs[pos].x_offset = glyphs[base].x_offset + base_anchor.x - mark_anchor.x - advance;
+    glyphs[pos].y_offset = glyphs[base].y_offset + base_anchor.y - mark_anchor.y;
+    return pos + 1;
+}
+
+const MatchKind = enum {
+    glyph,
+    class,
+    coverage,
+};
+
+/// A u16 array of glyph ids, classes or coverage offsets to match against the glyph buffer.
+const Sequence = struct {
+    kind: MatchKind,
+    array: usize,
+    count: usize,
+    /// The class def for classes or the subtable that coverage offsets are relative to.
+    base: usize,
+
+    fn matches(self: Sequence, data: []const u8, i: usize, glyph_id: u16) bool {
+        const val = readU16(data, self.array + i * 2);
+        return switch (self.kind) {
+            .glyph => glyph_id == val,
+            .class => classDefValue(data, self.base, glyph_id) == val,
+            .coverage => coverageIndex(data, self.base + val, glyph_id) != null,
+        };
+    }
+};
+
+const Rule = struct {
+    backtrack: Sequence,
+    /// Input glyphs after the first one.
+    input: Sequence,
+    lookahead: Sequence,
+    lookup_records: usize,
+    lookup_count: usize,
+};
+
+/// Contextual and chained contextual substitution or positioning. GSUB and GPOS share the same layout.
+fn applyContext(ctx: *Context, subtable: usize, flag: u16, pos: usize, chained: bool) ?usize {
+    const data = ctx.data;
+    const glyph_id = ctx.glyphs.items[pos].glyph_id;
+    const format = readU16(data, subtable);
+    switch (format) {
+        1, 2 => {
+            const cov_idx = coverageIndex(data, subtable + readU16(data, subtable + 2), glyph_id) orelse return null;
+            var kind = MatchKind.glyph;
+            var backtrack_def: usize = 0;
+            var input_def: usize = 0;
+            var lookahead_def: usize = 0;
+            var sets = subtable + 4;
+            var set_idx: usize = cov_idx;
+            if (format == 2) {
+                kind = .class;
+                if (chained) {
+                    backtrack_def = subtable + readU16(data, subtable + 4);
+                    input_def = subtable + readU16(data, subtable + 6);
+                    lookahead_def = subtable + readU16(data, subtable + 8);
+                    sets = subtable + 10;
+                } else {
+                    input_def = subtable + readU16(data, subtable + 4);
+                    sets = subtable + 6;
+                }
+                set_idx = classDefValue(data, input_def, glyph_id);
+            }
+            if (set_idx >= readU16(data, sets)) {
+                return null;
+            }
+            const set_offset = readU16(data, sets + 2 + set_idx * 2);
+            if (set_offset == 0) {
+                return null;
+            }
+            const set = subtable + set_offset;
+            const rule_count = readU16(data, set);
+            var i: usize = 0;
+            while (i < rule_count) : (i += 1) {
+                var off = set + readU16(data, set + 2 + i * 2);
+                var rule: Rule = undefined;
+                if (chained) {
+                    rule.backtrack = .{ .kind = kind, .array = off + 2, .count = readU16(data, off), .base = backtrack_def };
+                    off += 2 + rule.backtrack.count * 2;
+                    const input_count = readU16(data, off);
+                    if (input_count == 0) {
+                        continue;
+                    }
+                    rule.input = .{ .kind = kind, .array = off + 2, .count = input_count - 1, .base = input_def };
+                    off += 2 + rule.input.count * 2;
+                    rule.lookahead = .{ .kind = kind, .array = off + 2, .count = readU16(data, off), .base = lookahead_def };
+                    off += 2 + rule.lookahead.count * 2;
+                    rule.lookup_count = readU16(data, off);
+                    rule.lookup_records = off + 2;
+                } else {
+                    const input_count = readU16(data, off);
+                    if (input_count == 0) {
+                        continue;
+                    }
+                    rule.backtrack = .{ .kind = kind, .array = 0, .count = 0, .base = 0 };
+                    rule.input = .{ .kind = kind, .array = off + 4, .count = input_count - 1, .base = input_def };
+                    rule.lookahead = rule.backtrack;
+                    rule.lookup_count = readU16(data, off + 2);
+                    rule.lookup_records = off + 4 + rule.input.count * 2;
+                }
+                if (applyRule(ctx, flag, pos, rule)) |next| {
+                    return next;
+                }
+            }
+            return null;
+        },
+        3 => {
+            var rule: Rule = undefined;
+            var first_cov: usize = undefined;
+            if (chained) {
+                var off = subtable + 2;
+                rule.backtrack = .{ .kind = .coverage, .array = off + 2, .count = readU16(data, off), .base = subtable };
+                off += 2 + rule.backtrack.count * 2;
+                const input_count = readU16(data, off);
+                if (input_count == 0) {
+                    return null;
+                }
+                first_cov = readU16(data, off + 2);
+                rule.input = .{ .kind = .coverage, .array = off + 4, .count = input_count - 1, .base = subtable };
+                off += 2 + input_count * 2;
+                rule.lookahead = .{ .kind = .coverage, .array = off + 2, .count = readU16(data, off), .base = subtable };
+                off += 2 + rule.lookahead.count * 2;
+                rule.lookup_count = readU16(data, off);
+                rule.lookup_records = off + 2;
+            } else {
+                const input_count = readU16(data, subtable + 2);
+                if (input_count == 0) {
+                    return null;
+                }
+                first_cov = readU16(data, subtable + 6);
+                rule.backtrack = .{ .kind = .coverage, .array = 0, .count = 0, .base = subtable };
+                rule.input = .{ .kind = .coverage, .array = subtable + 8, .count = input_count - 1, .base = subtable };
+                rule.lookahead = rule.backtrack;
+                rule.lookup_count = readU16(data, subtable + 4);
+                rule.lookup_records = subtable + 6 + input_count * 2;
+            }
+            if (coverageIndex(data, subtable + first_cov, glyph_id) == null) {
+                return null;
+            }
+            return applyRule(ctx, flag, pos, rule);
+        },
+        else => return null,
+    }
+}
+
+fn applyRule(ctx: *Context, flag: u16, pos: usize, rule: Rule) ?usize {
+    const data = ctx.data;
+    const input_len = rule.input.count + 1;
+    if (input_len > MaxContextLen) {
+        return null;
+    }
+    var positions: [MaxContextLen]usize = undefined;
+    positions[0] = pos;
+    var i: usize = 0;
+    while (i < rule.input.count) : (i += 1) {
+        const next = ctx.nextIndex(flag, positions[i]) orelse return null;
+        if (!rule.input.matches(data, i, ctx.glyphs.items[next].glyph_id)) {
+            return null;
+        }
+        positions[i + 1] = next;
+    }
+    var cur = positions[input_len - 1];
+    i = 0;
+    while (i < rule.lookahead.count) : (i += 1) {
+        cur = ctx.nextIndex(flag, cur) orelse return null;
+        if (!rule.lookahead.matches(data, i, ctx.glyphs.items[cur].glyph_id)) {
+            return null;
+        }
+    }
+    // Backtrack glyphs are listed from the nearest to the farthest.
+    cur = pos;
+    i = 0;
+    while (i < rule.backtrack.count) : (i += 1) {
+        cur = ctx.prevIndex(flag, cur) orelse return null;
+        if (!rule.backtrack.matches(data, i, ctx.glyphs.items[cur].glyph_id)) {
+            return null;
+        }
+    }
+
+    var len = ctx.glyphs.items.len;
+    i = 0;
+    while (i < rule.lookup_count) : (i += 1) {
+        const seq_idx = readU16(data, rule.lookup_records + i * 4);
+        const lookup_idx = readU16(data, rule.lookup_records + i * 4 + 2);
+        if (seq_idx >= input_len or ctx.depth >= MaxNesting) {
+            continue;
+        }
+        ctx.depth += 1;
+        _ = applyLookupAt(ctx, lookup_idx, positions[seq_idx]);
+        ctx.depth -= 1;
+
+        // Shift the remaining input positions if the nested lookup added or removed glyphs.
+        const new_len = ctx.glyphs.items.len;
+        if (new_len != len) {
+            for (positions[seq_idx + 1 .. input_len]) |*it| {
+                if (new_len > len) {
+                    it.* += new_len - len;
+                } else {
+                    it.* -|= len - new_len;
+                }
+            }
+            len = new_len;
+        }
+    }
+    return std.math.min(positions[input_len - 1] + 1, len);
+}
+
+const ValueRecord = struct {
+    x_placement: i16,
+    y_placement: i16,
+    x_advance: i16,
+
+    fn apply(self: ValueRecord, glyph: *ShapedGlyph) void {
+        glyph.x_offset += self.x_placement;
+        glyph.y_offset += self.y_placement;
+        glyph.x_advance += self.x_advance;
+    }
+};
+
+/// Device and variation tables are ignored.
+fn readValueRecord(data: []const u8, offset: usize, format: u16) ValueRecord {
+    var res = ValueRecord{ .x_placement = 0, .y_placement = 0, .x_advance = 0 };
+    var off = offset;
+    if (format & 0x1 != 0) {
+        res.x_placement = readI16(data, off);
+        off += 2;
+    }
+    if (format & 0x2 != 0) {
+        res.y_placement = readI16(data, off);
+        off += 2;
+    }
+    if (format & 0x4 != 0) {
+        res.x_advance = readI16(data, off);
+    }
+    return res;
+}
+
+fn valueRecordSize(format: u16) usize {
+    var size: usize = 0;
+    var bits = format & 0xFF;
+    while (bits != 0) : (bits >>= 1) {
+        size += (bits & 1) * 2;
+    }
+    return size;
+}
+
+const Anchor = struct {
+    x: i32,
+    y: i32,
+};
+
+/// All anchor formats start with the coordinates.
+fn readAnchor(data: []const u8, offset: usize) Anchor {
+    return .{
+        .x = readI16(data, offset + 2),
+        .y = readI16(data, offset + 4),
+    };
+}
+
+/// Returns the glyph's index in the coverage table.
+fn coverageIndex(data: []const u8, offset: usize, glyph_id: u16) ?usize {
+    const count = readU16(data, offset + 2);
+    var lo: usize = 0;
+    var hi: usize = count;
+    switch (readU16(data, offset)) {
+        1 => {
+            while (lo < hi) {
+                const mid = (lo + hi) / 2;
+                const mid_id = readU16(data, offset + 4 + mid * 2);
+                if (mid_id == glyph_id) {
+                    return mid;
+                } else if (mid_id < glyph_id) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+        },
+        2 => {
+            while (lo < hi) {
+                const mid = (lo + hi) / 2;
+                const rec = offset + 4 + mid * 6;
+                if (glyph_id < readU16(data, rec)) {
+                    hi = mid;
+                } else if (glyph_id > readU16(data, rec + 2)) {
+                    lo = mid + 1;
+                } else {
+                    return @as(usize, readU16(data, rec + 4)) + glyph_id - readU16(data, rec);
+                }
+            }
+        },
+        else => {},
+    }
+    return null;
+}
+
+/// Glyphs that aren't assigned a class are in class 0.
+fn classDefValue(data: []const u8, offset: usize, glyph_id: u16) u16 {
+    switch (readU16(data, offset)) {
+        1 => {
+            const start_id = readU16(data, offset + 2);
+            const count = readU16(data, offset + 4);
+            if (glyph_id >= start_id and glyph_id - start_id < count) {
+                return readU16(data, offset + 6 + (glyph_id - start_id) * 2);
+            }
+        },
+        2 => {
+            var lo: usize = 0;
+            var hi: usize = readU16(data, offset + 2);
+            while (lo < hi) {
+                const mid = (lo + hi) / 2;
+                const rec = offset + 4 + mid * 6;
+                if (glyph_id < readU16(data, rec)) {
+                    hi = mid;
+                } else if (glyph_id > readU16(data, rec + 2)) {
+                    lo = mid + 1;
+                } else {
+                    return readU16(data, rec + 4);
+                }
+            }
+        },
+        else => {},
+    }
+    return 0;
+}
+
+const Joining = enum {
+    none,
+    right,
+    dual,
+    /// Joins on both sides without changing form, eg. tatweel and ZWJ.
+    causing,
+    /// Marks are skipped when determining the form of their neighbors.
+    transparent,
+};
+
+fn arabicJoining(cp: u21) Joining {
+    return switch (cp) {
+        0x0640, 0x200D => .causing,
+        0x0610...0x061A, 0x064B...0x065F, 0x0670, 0x06D6...0x06DC, 0x06DF...0x06E4, 0x06E7, 0x06E8, 0x06EA...0x06ED => .transparent,
+        0x0622...0x0625, 0x0627, 0x0629, 0x062F...0x0632, 0x0648, 0x0671...0x0673, 0x0675...0x0677, 0x0688...0x0699, 0x06C0, 0x06C3...0x06CB, 0x06CD, 0x06CF, 0x06D2, 0x06D3, 0x06D5, 0x06EE, 0x06EF => .right,
+        0x0620, 0x0626, 0x0628, 0x062A...0x062E, 0x0633...0x063F, 0x0641...0x0647, 0x0649, 0x064A, 0x066E, 0x066F, 0x0678...0x0687, 0x069A...0x06BF, 0x06C1, 0x06C2, 0x06CC, 0x06CE, 0x06D0, 0x06D1, 0x06FA...0x06FC, 0x06FF => .dual,
+        else => .none,
+    };
+}
+
+/// Picks the isolated, initial, medial or final form of each Arabic letter from its neighbors.
+fn assignJoiningForms(glyphs: []ShapedGlyph) void {
+    // Whether the previous non transparent letter joins to the next letter.
+    var prev_joins_next = false;
+    var i: usize = 0;
+    while (i < glyphs.len) : (i += 1) {
+        const joining = arabicJoining(glyphs[i].cp);
+        if (joining == .transparent) {
+            continue;
+        }
+        var next_joins_prev = false;
+        var j = i + 1;
+        while (j < glyphs.len) : (j += 1) {
+            const next = arabicJoining(glyphs[j].cp);
+            if (next != .transparent) {
+                next_joins_prev = next == .right or next == .dual or next == .causing;
+                break;
+            }
+        }
+        const joins_prev = prev_joins_next and joining != .none;
+        const joins_next = next_joins_prev and (joining == .dual or joining == .causing);
+        if (joining == .right or joining == .dual) {
+            glyphs[i].form = if (joins_prev and joins_next) .medi else if (joins_prev) .fina else if (joins_next) .init else .isol;
+        }
+        prev_joins_next = joining == .dual or joining == .causing;
+    }
+}
+
+pub const DefaultMaxShapeCacheEntries = 2048;
+
+/// Caches shaped text by font, script, features and string so text drawn every frame is only shaped once.
+/// Entries are only evicted in beginFrame, so runs returned during a frame stay valid until the next one.
+pub const ShapeCache = struct {
+    alloc: std.mem.Allocator,
+    entries: std.HashMapUnmanaged(Key, Entry, KeyContext, std.hash_map.default_max_load_percentage),
+    max_entries: u32,
+    cur_frame: u32,
+    buf: std.ArrayList(ShapedGlyph),
+
+    pub fn init(alloc: std.mem.Allocator, max_entries: u32) ShapeCache {
+        return .{
+            .alloc = alloc,
+            .entries = .{},
+            .max_entries = max_entries,
+            .cur_frame = 0,
+            .buf = std.ArrayList(ShapedGlyph).init(alloc),
+        };
+    }
+
+    pub fn deinit(self: *ShapeCache) void {
+        self.invalidate();
+        self.entries.deinit(self.alloc);
+        self.buf.deinit();
+    }
+
+    /// Removes all entries. Previously returned runs are freed.
+    pub fn invalidate(self: *ShapeCache) void {
+        var iter = self.entries.iterator();
+        while (iter.next()) |entry| {
+            self.alloc.free(entry.key_ptr.str);
+            self.alloc.free(entry.value_ptr.glyphs);
+        }
+        self.entries.clearRetainingCapacity();
+    }
+
+    /// Once the cache is over its limit, removes entries that weren't used in the last frame.
+    pub fn beginFrame(self: *ShapeCache) void {
+        defer self.cur_frame +%= 1;
+        if (self.entries.count() <= self.max_entries) {
+            return;
+        }
+        var keys = std.ArrayList(Key).init(self.alloc);
+        defer keys.deinit();
+        var iter = self.entries.iterator();
+        while (iter.next()) |entry| {
+            if (entry.value_ptr.last_used_frame != self.cur_frame) {
+                keys.append(entry.key_ptr.*) catch fatal();
+            }
+        }
+        for (keys.items) |key| {
+            const kv = self.entries.fetchRemove(key).?;
+            self.alloc.free(kv.key.str);
+            self.alloc.free(kv.value.glyphs);
+        }
+    }
+
+    pub fn getOrShape(self: *ShapeCache, font_id: FontId, font: *const OpenTypeFont, script: Tag, features: []const Tag, str: []const u8) []const ShapedGlyph {
+        const key = Key{
+            .font_id = font_id,
+            .script = script,
+            .features_hash = std.hash.Wyhash.hash(0, std.mem.sliceAsBytes(features)),
+            .str = str,
+        };
+        const res = self.entries.getOrPut(self.alloc, key) catch fatal();
+        if (!res.found_existing) {
+            res.key_ptr.str = self.alloc.dupe(u8, str) catch fatal();
+            self.buf.clearRetainingCapacity();
+            shape(self.alloc, font, script, features, str, &self.buf);
+            res.value_ptr.glyphs = self.alloc.dupe(ShapedGlyph, self.buf.items) catch fatal();
+        }
+        res.value_ptr.last_used_frame = self.cur_frame;
+        return res.value_ptr.glyphs;
+    }
+};
+
+const Key = struct {
+    font_id: FontId,
+    script: Tag,
+    features_hash: u64,
+    /// Owned by the cache once inserted.
+    str: []const u8,
+};
+
+const KeyContext = struct {
+    pub fn hash(_: KeyContext, key: Key) u64 {
+        var hasher = std.hash.Wyhash.init(0);
+        std.hash.autoHash(&hasher, key.font_id);
+        hasher.update(&key.script);
+        std.hash.autoHash(&hasher, key.features_hash);
+        hasher.update(key.str);
+        return hasher.final();
+    }
+
+    pub fn eql(_: KeyContext, a: Key, b: Key) bool {
+        return a.font_id == b.font_id and
+            std.mem.eql(u8, &a.script, &b.script) and
+            a.features_hash == b.features_hash and
+            std.mem.eql(u8, a.str, b.str);
+    }
+};
+
+const Entry = struct {
+    last_used_frame: u32,
+    glyphs: []ShapedGlyph,
+};
+
+inline fn readU16(data: []const u8, offset: usize) u16 {
+    return std.mem.readIntBig(u16, data[offset..][0..2]);
+}
+
+inline fn readI16(data: []const u8, offset: usize) i16 {
+    return std.mem.readIntBig(i16, data[offset..][0..2]);
+}
+
+inline fn readU32(data: []const u8, offset: usize) u32 {
+    return std.mem.readIntBig(u32, data[offset..][0..4]);
+}
+
+const vera_ttf = @embedFile("../../assets/vera.ttf");
+
+test "shape without layout tables" {
+    const font = try OpenTypeFont.init(t.alloc, vera_ttf, 0);
+    defer font.deinit();
+
+    var buf = std.ArrayList(ShapedGlyph).init(t.alloc);
+    defer buf.deinit();
+    shape(t.alloc, &font, detectScript("fi é"), &DefaultFeatures, "fi é", &buf);
+    try t.eq(buf.items.len, 4);
+    try t.eq(buf.items[0].glyph_id, (try font.getGlyphId('f')).?);
+    try t.eq(buf.items[0].x_advance, font.getGlyphHMetrics(buf.items[0].glyph_id).advance_width);
+    try t.eq(buf.items[3].cp, 'é');
+    try t.eq(buf.items[3].start_idx, 3);
+    try t.eq(buf.items[3].end_idx, 5);
+}
+
+test "GSUB ligature" {
+    const font = try OpenTypeFont.init(t.alloc, vera_ttf, 0);
+    defer font.deinit();
+    const f = (try font.getGlyphId('f')).?;
+    const i = (try font.getGlyphId('i')).?;
+    const lig = (try font.getGlyphId('X')).?;
+
+    // DFLT script with a liga feature that maps "f i" to X.
+    const table = [_]u16{
+        // Header: version, script list, feature list, lookup list.
+        1, 0, 10, 30, 44,
+        // Script list with DFLT at 18.
+        1, 'D' << 8 | 'F', 'L' << 8 | 'T', 8,
+        // Script and its default lang sys with feature 0.
+        4, 0, 0, 0xFFFF, 1, 0,
+        // Feature list with liga at 38.
+        1, 'l' << 8 | 'i', 'g' << 8 | 'a', 8,
+        // Feature with lookup 0.
+        0, 1, 0,
+        // Lookup list with the lookup at 48.
+        1, 4,
+        // Ligature lookup with one subtable at 56.
+        4, 0, 1, 8,
+        // Ligature subtable: coverage at 64, ligature set at 70.
+        1, 8, 1, 14,
+        // Coverage of f.
+        1, 1, f,
+        // Ligature set and the ligature.
+        1, 4, lig, 2, i,
+    };
+    var data: [table.len * 2]u8 = undefined;
+    for (table) |val, idx| {
+        std.mem.writeIntBig(u16, data[idx * 2 ..][0..2], val);
+    }
+
+    var buf = std.ArrayList(ShapedGlyph).init(t.alloc);
+    defer buf.deinit();
+    shape(t.alloc, &font, "latn".*, &DefaultFeatures, "fix", &buf);
+
+    var ctx = Context.init(&data, &font, &buf, 0);
+    applyTable(t.alloc, &ctx, 0, false, "latn".*, &DefaultFeatures);
+    try t.eq(buf.items.len, 2);
+    try t.eq(buf.items[0].glyph_id, lig);
+    try t.eq(buf.items[0].substituted, true);
+    try t.eq(buf.items[0].start_idx, 0);
+    try t.eq(buf.items[0].end_idx, 2);
+    try t.eq(buf.items[1].cp, 'x');
+
+    // Disabled feature.
+    buf.clearRetainingCapacity();
+    shape(t.alloc, &font, "latn".*, &.{}, "fi", &buf);
+    ctx = Context.init(&data, &font, &buf, 0);
+    applyTable(t.alloc, &ctx, 0, false, "latn".*, &.{});
+    try t.eq(buf.items.len, 2);
+}
+
+test "Arabic joining forms" {
+    var glyphs: [4]ShapedGlyph = undefined;
+    // beh, alef, beh, beh
+    const cps = [_]u21{ 0x0628, 0x0627, 0x0628, 0x0628 };
+    for (glyphs) |*glyph, i| {
+        glyph.cp = cps[i];
+        glyph.form = .none;
+    }
+    assignJoiningForms(&glyphs);
+    try t.eq(glyphs[0].form, .init);
+    try t.eq(glyphs[1].form, .fina);
+    try t.eq(glyphs[2].form, .init);
+    try t.eq(glyphs[3].form, .fina);
+    try t.eq(detectScript("12 \u{0628}"), "arab".*);
+}
@@ -19,6 +19,19 @@ pub const TextMetrics = struct {
     }
 };
 
+/// Inclusive range of codepoints.
+pub const CodepointRange = struct {
+    start: u21,
+    end: u21,
+
+    pub fn init(start: u21, end: u21) @This() {
+        return .{
+            .start = start,
+            .end = end,
+        };
+    }
+};
+
 // Result is stored with text description.
 pub const TextMeasure = struct {
     text: []const u8,
@@ -82,6 +95,10 @@ pub const TextGlyphIterator = struct {
         /// THe current codepoint's end idx in the given UTF-8 buffer. Not inclusive.
         end_idx: usize,
 
+        /// Number of codepoints this step covers. A ligature covers several.
+        /// Zero for extra glyphs that a codepoint was substituted with, since the first glyph already counted it.
+        num_chars: u32,
+
         /// The kern with the previous codepoint.
         kern: f32,
 
@@ -101,6 +118,23 @@ pub const TextGlyphIterator = struct {
         /// y-offset needed in final glyph position in order to be aligned with the primary font.
         /// If the glyph is from the primary font, this should be zero.
         primary_offset_y: f32,
+
+        /// Offset of the glyph from the current x position and baseline set by the shaper. Used to place marks.
+        offset_x: f32,
+        offset_y: f32,
+
+        /// Returns the char offset within this step that is closest to x, relative to where the step starts.
+        /// Returns null if x is closer to the end of the step. A ligature's advance is split evenly between its chars.
+        pub fn getCaretCharOffset(self: State, x: f32) ?u32 {
+            if (self.num_chars == 0) {
+                return null;
+            }
+            const char_width = self.advance_width / @intToFloat(f32, self.num_chars);
+            if (x < self.advance_width - char_width / 2) {
+                return @floatToInt(u32, std.math.max(0, @round(x / char_width)));
+            }
+            return null;
+        }
     };
 
     pub inline fn nextCodepoint(self: *Self) bool {
@@ -0,0 +1,245 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const t = stdx.testing;
+
+const graphics = @import("graphics.zig");
+const FontGroupId = graphics.FontGroupId;
+const TextMetrics = graphics.TextMetrics;
+const TextLayout = graphics.TextLayout;
+const TextLine = graphics.TextLine;
+
+/// Longer strings are measured every time. They're unlikely to repeat and would take up a lot of memory.
+pub const MaxCachedStrLen = 256;
+
+pub const DefaultMaxEntries = 4096;
+
+/// Caches text measurements and layouts by font group, font size and string.
+/// Most UI labels are the same every frame, so they don't need to go through the glyph iterator again.
+/// When the cache is full, the least recently used half is evicted.
+/// Results depend on the loaded fonts, so the cache needs to be invalidated when fallback fonts change.
+pub const TextCache = struct {
+    alloc: std.mem.Allocator,
+    entries: std.HashMapUnmanaged(Key, Entry, KeyContext, std.hash_map.default_max_load_percentage),
+    max_entries: u32,
+
+    /// Incremented on every lookup and insert to order entries by recent use.
+    tick: u64,
+
+    num_hits: u64,
+    num_misses: u64,
+
+    pub fn init(alloc: std.mem.Allocator, max_entries: u32) TextCache {
+        return .{
+            .alloc = alloc,
+            .entries = .{},
+            .max_entries = std.math.max(max_entries, 2),
+            .tick = 0,
+            .num_hits = 0,
+            .num_misses = 0,
+        };
+    }
+
+    pub fn deinit(self: *TextCache) void {
+        self.invalidate();
+        self.entries.deinit(self.alloc);
+    }
+
+    /// Removes all entries.
+    pub fn invalidate(self: *TextCache) void {
+        var iter = self.entries.iterator();
+        while (iter.next()) |entry| {
+            self.freeEntry(entry.key_ptr.*, entry.value_ptr.*);
+        }
+        self.entries.clearRetainingCapacity();
+    }
+
+    pub fn getMetrics(self: *TextCache, font_gid: FontGroupId, font_size: f32, str: []const u8) ?TextMetrics {
+        const entry = self.get(Key.initMeasure(font_gid, font_size, str)) orelse return null;
+        return entry.metrics;
+    }
+
+    pub fn putMetrics(self: *TextCache, font_gid: FontGroupId, font_size: f32, str: []const u8, metrics: TextMetrics) void {
+        if (str.len > MaxCachedStrLen) {
+            return;
+        }
+        self.put(Key.initMeasure(font_gid, font_size, str), metrics, &.{});
+    }
+
+    /// Copies a cached layout into buf. Returns false if it's not cached.
+    pub fn getLayout(self: *TextCache, font_gid: FontGroupId, font_size: f32, str: []const u8, preferred_width: f32, buf: *TextLayout) bool {
+        const entry = self.get(Key.initLayout(font_gid, font_size, str, preferred_width)) orelse return false;
+        buf.lines.clearRetainingCapacity();
+        buf.lines.appendSlice(entry.lines) catch fatal();
+        buf.width = entry.metrics.width;
+        buf.height = entry.metrics.height;
+        return true;
+    }
+
+    pub fn putLayout(self: *TextCache, font_gid: FontGroupId, font_size: f32, str: []const u8, preferred_width: f32, layout: TextLayout) void {
+        if (str.len > MaxCachedStrLen) {
+            return;
+        }
+        const metrics = TextMetrics.init(layout.width, layout.height);
+        self.put(Key.initLayout(font_gid, font_size, str, preferred_width), metrics, layout.lines.items);
+    }
+
+    fn get(self: *TextCache, key: Key) ?*Entry {
+        if (key.str.len > MaxCachedStrLen) {
+            return null;
+        }
+        self.tick += 1;
+        if (self.entries.getPtr(key)) |entry| {
+            entry.last_used = self.tick;
+            self.num_hits += 1;
+            return entry;
+        }
+        self.num_misses += 1;
+        return null;
+    }
+
+    fn put(self: *TextCache, key: Key, metrics: TextMetrics, lines: []const TextLine) void {
+        self.tick += 1;
+        if (self.entries.count() >= self.max_entries) {
+            self.evictOldestHalf();
+        }
+        const res = self.entries.getOrPut(self.alloc, key) catch fatal();
+        if (res.found_existing) {
+            self.alloc.free(res.value_ptr.lines);
+        } else {
+            res.key_ptr.str = self.alloc.dupe(u8, key.str) catch fatal();
+        }
+        res.value_ptr.* = .{
+            .last_used = self.tick,
+            .metrics = metrics,
+            .lines = self.alloc.dupe(TextLine, lines) catch fatal(),
+        };
+    }
+
+    fn evictOldestHalf(self: *TextCache) void {
+        const ticks = self.alloc.alloc(u64, self.entries.count()) catch fatal();
+        defer self.alloc.free(ticks);
+        var iter = self.entries.valueIterator();
+        var i: usize = 0;
+        while (iter.next()) |entry| : (i += 1) {
+            ticks[i] = entry.last_used;
+        }
+        std.sort.sort(u64, ticks, {}, comptime std.sort.asc(u64));
+        const min_tick = ticks[ticks.len / 2];
+
+        var keys = std.ArrayList(Key).init(self.alloc);
+        defer keys.deinit();
+        var entry_iter = self.entries.iterator();
+        while (entry_iter.next()) |entry| {
+            if (entry.value_ptr.last_used < min_tick) {
+                keys.append(entry.key_ptr.*) catch fatal();
+            }
+        }
+        for (keys.items) |key| {
+            const kv = self.entries.fetchRemove(key).?;
+            self.freeEntry(kv.key, kv.value);
+        }
+    }
+
+    fn freeEntry(self: *TextCache, key: Key, entry: Entry) void {
+        self.alloc.free(key.str);
+        self.alloc.free(entry.lines);
+    }
+};
+
+const Key = struct {
+    font_gid: FontGroupId,
+    font_size: f32,
+    /// Layouts also depend on the preferred width.
+    is_layout: bool,
+    preferred_width: f32,
+    /// Owned by the cache once inserted.
+    str: []const u8,
+
+    fn initMeasure(font_gid: FontGroupId, font_size: f32, str: []const u8) Key {
+        return .{
+            .font_gid = font_gid,
+            .font_size = font_size,
+            .is_layout = false,
+            .preferred_width = 0,
+            .str = str,
+        };
+    }
+
+    fn initLayout(font_gid: FontGroupId, font_size: f32, str: []const u8, preferred_width: f32) Key {
+        return .{
+            .font_gid = font_gid,
+            .font_size = font_size,
+            .is_layout = true,
+            .preferred_width = preferred_width,
+            .str = str,
+        };
+    }
+};
+
+const KeyContext = struct {
+    pub fn hash(_: KeyContext, key: Key) u64 {
+        var hasher = std.hash.Wyhash.init(0);
+        std.hash.autoHash(&hasher, key.font_gid);
+        std.hash.autoHash(&hasher, @bitCast(u32, key.font_size));
+        std.hash.autoHash(&hasher, key.is_layout);
+        std.hash.autoHash(&hasher, @bitCast(u32, key.preferred_width));
+        hasher.update(key.str);
+        return hasher.final();
+    }
+
+    pub fn eql(_: KeyContext, a: Key, b: Key) bool {
+        return a.font_gid == b.font_gid and
+            @bitCast(u32, a.font_size) == @bitCast(u32, b.font_size) and
+            a.is_layout == b.is_layout and
+            @bitCast(u32, a.preferred_width) == @bitCast(u32, b.preferred_width) and
+            std.mem.eql(u8, a.str, b.str);
+    }
+};
+
+const Entry = struct {
+    last_used: u64,
+    /// For layouts, the max line width and total height.
+    metrics: TextMetrics,
+    /// Line breaks. Empty for measurements.
+    lines: []TextLine,
+};
+
+test "TextCache" {
+    var cache = TextCache.init(t.alloc, 4);
+    defer cache.deinit();
+
+    try t.eq(cache.getMetrics(1, 16, "foo"), null);
+    cache.putMetrics(1, 16, "foo", TextMetrics.init(30, 16));
+    try t.eq(cache.getMetrics(1, 16, "foo").?.width, 30);
+    // Different size or font group is a different entry.
+    try t.eq(cache.getMetrics(1, 18, "foo"), null);
+    try t.eq(cache.getMetrics(2, 16, "foo"), null);
+
+    var layout = TextLayout.init(t.alloc);
+    defer layout.deinit();
+    try layout.lines.append(.{ .start_idx = 0, .end_idx = 3, .height = 16 });
+    layout.width = 30;
+    layout.height = 16;
+    cache.putLayout(1, 16, "foo", 100, layout);
+
+    var res = TextLayout.init(t.alloc);
+    defer res.deinit();
+    try t.eq(cache.getLayout(1, 16, "foo", 50, &res), false);
+    try t.eq(cache.getLayout(1, 16, "foo", 100, &res), true);
+    try t.eq(res.lines.items.len, 1);
+    try t.eq(res.lines.items[0].end_idx, 3);
+    try t.eq(res.height, 16);
+
+    // Filling the cache evicts the least recently used half.
+    cache.putMetrics(1, 16, "bar", TextMetrics.init(30, 16));
+    cache.putMetrics(1, 16, "baz", TextMetrics.init(30, 16));
+    _ = cache.getMetrics(1, 16, "foo");
+    cache.putMetrics(1, 16, "qux", TextMetrics.init(30, 16));
+    try t.eq(cache.entries.count(), 3);
+    try t.eq(cache.getMetrics(1, 16, "foo").?.width, 30);
+    try t.eq(cache.getMetrics(1, 16, "bar"), null);
+
+    cache.invalidate();
+    try t.eq(cache.getMetrics(1, 16, "foo"), null);
+}
@@ -143,6 +143,14 @@ pub const OpenTypeFont = struct {
     cblc_offset: ?usize,
     glyf_offset: ?usize,
     cff_offset: ?usize,
+
+    // OpenType layout tables used by the shaper.
+    // https://docs.microsoft.com/en-us/typography/opentype/spec/gsub
+    gsub_offset: ?usize,
+    // https://docs.microsoft.com/en-us/typography/opentype/spec/gpos
+    gpos_offset: ?usize,
+    // https://docs.microsoft.com/en-us/typography/opentype/spec/gdef
+    gdef_offset: ?usize,
     glyph_map_format: u16,
     glyph_mapper: GlyphMapperIface,
     glyph_mapper_box: ds.SizedBox,
@@ -175,6 +183,9 @@ pub const OpenTypeFont = struct {
             .eblc_offset = null,
             .glyf_offset = null,
             .cff_offset = null,
+            .gsub_offset = null,
+            .gpos_offset = null,
+            .gdef_offset = null,
             .glyph_mapper = undefined,
             .glyph_mapper_box = undefined,
             .glyph_map_format = 0,
@@ -202,6 +213,11 @@ pub const OpenTypeFont = struct {
         return self.glyf_offset != null or self.cff_offset != null;
     }
 
+    /// Text needs to go through the shaper to apply ligatures, contextual forms and mark positioning.
+    pub fn hasLayoutTables(self: Self) bool {
+        return self.gsub_offset != null or self.gpos_offset != null;
+    }
+
     pub fn hasColorBitmap(self: Self) bool {
         return self.cbdt_offset != null;
     }
@@ -563,6 +579,12 @@ pub const OpenTypeFont = struct {
                 self.glyf_offset = fromBigU32(&data[loc + 8]);
             } else if (std.meta.eql(val, "CFF ".*)) {
                 self.cff_offset = fromBigU32(&data[loc + 8]);
+            } else if (std.meta.eql(val, "GSUB".*)) {
+                self.gsub_offset = fromBigU32(&data[loc + 8]);
+            } else if (std.meta.eql(val, "GPOS".*)) {
+                self.gpos_offset = fromBigU32(&data[loc + 8]);
+            } else if (std.meta.eql(val, "GDEF".*)) {
+                self.gdef_offset = fromBigU32(&data[loc + 8]);
             } else if (std.meta.eql(val, "maxp".*)) {
                 const offset = fromBigU32(&data[loc + 8]);
                 // https://docs.microsoft.com/en-us/typography/opentype/spec/maxp
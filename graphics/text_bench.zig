@@ -0,0 +1,116 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const graphics = @import("graphics");
+const RenderFont = graphics.gpu.RenderFont;
+const Glyph = graphics.gpu.Glyph;
+
+/// Micro benchmark of the per codepoint work done when text is drawn or measured: UTF-8 decoding and glyph lookup.
+/// Compares the ASCII fast path against std's UTF-8 iterator and the dense glyph table against a hashmap.
+/// Usage: bench-text [iterations] [font_path]
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    const args = try std.process.argsAlloc(alloc);
+    defer std.process.argsFree(alloc, args);
+
+    const iterations = if (args.len > 1) try std.fmt.parseInt(u32, args[1], 10) else 20000;
+    const font_path = if (args.len > 2) args[2] else "assets/vera.ttf";
+
+    const data = try std.fs.cwd().readFileAlloc(alloc, font_path, 20e6);
+    defer alloc.free(data);
+    const ot_font = try graphics.OpenTypeFont.init(alloc, data, 0);
+    defer ot_font.deinit();
+
+    const text =
+        \\The quick brown fox jumps over the lazy dog. 0123456789 (x, y) = [1, 2]; "quoted" — naïve café résumé…
+        \\Pack my box with five dozen liquor jugs! Sphinx of black quartz, judge my vow? It’s 100% ‰ done • ok
+    ;
+    const num_cps = @intCast(u32, try std.unicode.utf8CountCodepoints(text));
+
+    var render_font: RenderFont = undefined;
+    render_font.initOutline(alloc, 0, ot_font, 16, false);
+    defer render_font.deinit();
+    var map = std.AutoHashMap(u21, Glyph).init(alloc);
+    defer map.deinit();
+
+    // Fill both with placeholder glyphs. Only the lookup is measured.
+    var iter = std.unicode.Utf8View.initUnchecked(text).iterator();
+    while (iter.nextCodepoint()) |cp| {
+        const glyph_id = (try ot_font.getGlyphId(cp)) orelse 0;
+        var glyph = Glyph.init(glyph_id, .{
+            .atlas = undefined,
+            .page = 0,
+            .generation = 0,
+            .image = undefined,
+            .x = 0,
+            .y = 0,
+        });
+        glyph.advance_width = @intToFloat(f32, cp % 16);
+        _ = render_font.putGlyph(cp, glyph);
+        try map.put(cp, glyph);
+    }
+
+    const stdout = std.io.getStdOut().writer();
+    try stdout.print("text bench iterations={} codepoints/iteration={}\n", .{ iterations, num_cps });
+
+    var timer = try std.time.Timer.start();
+    var sum: u64 = 0;
+    var i: u32 = 0;
+    while (i < iterations) : (i += 1) {
+        var cp_iter = std.unicode.Utf8View.initUnchecked(text).iterator();
+        while (cp_iter.nextCodepoint()) |cp| {
+            sum +%= cp;
+        }
+    }
+    std.mem.doNotOptimizeAway(sum);
+    try report(stdout, "utf8 decode", iterations * num_cps, timer.lap());
+
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        var idx: usize = 0;
+        var ascii_end = stdx.unicode.indexOfNonAscii(text, 0);
+        while (idx < text.len) {
+            if (idx < ascii_end) {
+                sum +%= text[idx];
+                idx += 1;
+            } else {
+                const len = std.unicode.utf8ByteSequenceLength(text[idx]) catch unreachable;
+                sum +%= std.unicode.utf8Decode(text[idx .. idx + len]) catch unreachable;
+                idx += len;
+                ascii_end = stdx.unicode.indexOfNonAscii(text, idx);
+            }
+        }
+    }
+    std.mem.doNotOptimizeAway(sum);
+    try report(stdout, "utf8 decode ascii fast path", iterations * num_cps, timer.lap());
+
+    var advance: f32 = 0;
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        var cp_iter = std.unicode.Utf8View.initUnchecked(text).iterator();
+        while (cp_iter.nextCodepoint()) |cp| {
+            advance += map.getPtr(cp).?.advance_width;
+        }
+    }
+    std.mem.doNotOptimizeAway(advance);
+    try report(stdout, "glyph lookup hashmap", iterations * num_cps, timer.lap());
+
+    i = 0;
+    while (i < iterations) : (i += 1) {
+        var cp_iter = std.unicode.Utf8View.initUnchecked(text).iterator();
+        while (cp_iter.nextCodepoint()) |cp| {
+            advance += render_font.getGlyph(cp).?.advance_width;
+        }
+    }
+    std.mem.doNotOptimizeAway(advance);
+    try report(stdout, "glyph lookup dense table", iterations * num_cps, timer.lap());
+}
+
+fn report(writer: anytype, name: []const u8, count: u64, elapsed_ns: u64) !void {
+    const elapsed_s = @intToFloat(f64, elapsed_ns) / std.time.ns_per_s;
+    try writer.print("{s}: {} glyphs time={d:.3}s glyphs/sec={d:.0}\n", .{
+        name, count, elapsed_s, @intToFloat(f64, count) / elapsed_s,
+    });
+}
@@ -60,6 +60,8 @@ extern "graphics" fn jsGlUniform3fv(location: i32, value_ptr: *const f32) void;
 extern "graphics" fn jsGlUniform4fv(location: i32, value_ptr: *const f32) void;
 extern "graphics" fn jsGlBufferData(target: u32, data_ptr: ?*const u8, data_size: u32, usage: u32) void;
 extern "graphics" fn jsGlDrawElements(mode: u32, num_indices: u32, index_type: u32, index_offset: u32) void;
+extern "graphics" fn jsGlDrawElementsInstanced(mode: u32, num_indices: u32, index_type: u32, index_offset: u32, instance_count: u32) void;
+extern "graphics" fn jsGlVertexAttribDivisor(index: u32, divisor: u32) void;
 extern "graphics" fn jsGlCreateRenderbuffer() u32;
 extern "graphics" fn jsGlPolygonOffset(factor: f32, units: f32) void;
 extern "graphics" fn jsGlFramebufferRenderbuffer(target: u32, attachment: u32, renderbuffertarget: u32, renderbuffer: u32) void;
@@ -289,6 +291,16 @@ pub inline fn drawElements(mode: c.GLenum, num_indices: usize, index_type: c.GLe
     }
 }
 
+pub inline fn drawElementsInstanced(mode: c.GLenum, num_indices: usize, index_type: c.GLenum, index_offset: usize, instance_count: usize) void {
+    if (IsWasm) {
+        jsGlDrawElementsInstanced(mode, num_indices, index_type, index_offset, instance_count);
+    } else if (IsWindows) {
+        winDrawElementsInstanced(mode, @intCast(c_int, num_indices), index_type, @intToPtr(?*const c.GLvoid, index_offset), @intCast(c_int, instance_count));
+    } else {
+        sdl.glDrawElementsInstanced(mode, @intCast(c_int, num_indices), index_type, @intToPtr(?*const c.GLvoid, index_offset), @intCast(c_int, instance_count));
+    }
+}
+
 pub inline fn flush() void {
     if (IsWasm) {
         jsGlFlush();
@@ -689,6 +701,16 @@ pub inline fn vertexAttribPointer(index: c.GLuint, size: c.GLint, @"type": c.GLe
     }
 }
 
+pub inline fn vertexAttribDivisor(index: c.GLuint, divisor: c.GLuint) void {
+    if (IsWasm) {
+        jsGlVertexAttribDivisor(index, divisor);
+    } else if (IsWindows) {
+        winVertexAttribDivisor(index, divisor);
+    } else {
+        sdl.glVertexAttribDivisor(index, divisor);
+    }
+}
+
 pub inline fn deleteVertexArrays(n: c.GLsizei, arrays: [*c]const c.GLuint) void {
     if (IsWasm) {
         var i: u32 = 0;
@@ -849,6 +871,8 @@ var winBlendEquation: fn (mode: c.GLenum) void = undefined;
 var winBlitFramebuffer: fn (srcX0: c.GLint, srcY0: c.GLint, srcX1: c.GLint, srcY1: c.GLint, dstX0: c.GLint, dstY0: c.GLint, dstX1: c.GLint, dstY1: c.GLint, mask: c.GLbitfield, filter: c.GLenum) void = undefined;
 var winDeleteVertexArrays: fn (n: c.GLsizei, arrays: [*c]const c.GLuint) void = undefined;
 var winVertexAttribPointer: fn (index: c.GLuint, size: c.GLint, @"type": c.GLenum, normalized: c.GLboolean, stride: c.GLsizei, pointer: ?*const anyopaque) void = undefined;
+var winVertexAttribDivisor: fn (index: c.GLuint, divisor: c.GLuint) void = undefined;
+var winDrawElementsInstanced: fn (mode: c.GLenum, count: c.GLsizei, @"type": c.GLenum, indices: ?*const anyopaque, instancecount: c.GLsizei) void = undefined;
 var winBindVertexArray: fn (array: c.GLuint) void = undefined;
 var winDetachShader: fn (program: c.GLuint, shader: c.GLuint) void = undefined;
 var winFramebufferTexture2D: fn (target: c.GLenum, attachment: c.GLenum, textarget: c.GLenum, texture: c.GLuint, level: c.GLint) void = undefined;
@@ -892,6 +916,8 @@ pub fn initWinGL_Functions() void {
     loadGlFunc(&winTexImage2DMultisample, "glTexImage2DMultisample");
     loadGlFunc(&winFramebufferTexture2D, "glFramebufferTexture2D");
     loadGlFunc(&winVertexAttribPointer, "glVertexAttribPointer");
+    loadGlFunc(&winVertexAttribDivisor, "glVertexAttribDivisor");
+    loadGlFunc(&winDrawElementsInstanced, "glDrawElementsInstanced");
     loadGlFunc(&winDeleteVertexArrays, "glDeleteVertexArrays");
     loadGlFunc(&winGenBuffers, "glGenBuffers");
     loadGlFunc(&winDeleteBuffers, "glDeleteBuffers");
@@ -0,0 +1,76 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const build_options = @import("build_options");
+const Vec3 = stdx.math.Vec3;
+const Quaternion = stdx.math.Quaternion;
+const jolt = @import("jolt");
+
+/// Steps a pile of falling boxes without graphics and reports steps/sec.
+/// Usage: bench-jolt [num_bodies] [num_steps] [num_threads]
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    const args = try std.process.argsAlloc(alloc);
+    defer std.process.argsFree(alloc, args);
+
+    const num_bodies = if (args.len > 1) try std.fmt.parseInt(u32, args[1], 10) else 5000;
+    const num_steps = if (args.len > 2) try std.fmt.parseInt(u32, args[2], 10) else 300;
+    const num_threads: ?u32 = if (args.len > 3) try std.fmt.parseInt(u32, args[3], 10) else null;
+
+    jolt.init();
+
+    const bp_layer_iface = jolt.BPLayerInterfaceImpl.init();
+    defer bp_layer_iface.deinit();
+    const physics_sys = jolt.PhysicsSystem.init(num_bodies + 1, 0, 65536, 65536, bp_layer_iface.handle, jolt.defaultBroadPhaseCanCollide, jolt.defaultObjectCanCollide);
+    defer physics_sys.deinit();
+    const temp_alloc = jolt.initTempAllocatorImpl(64 * 1024 * 1024);
+    defer jolt.deinitTempAllocatorImpl(temp_alloc);
+    const job_sys = jolt.JobSystem.initThreadPool(2048, 8, num_threads);
+    defer job_sys.deinitJobSystemThreadPool();
+    var states = jolt.BodyStates.init(alloc);
+    defer states.deinit();
+
+    const body_iface = physics_sys.getBodyInterface();
+
+    // Floor.
+    const floor_shape = jolt.BoxShape.init(Vec3.init(500, 1, 500), 0, null).shape();
+    const floor_opts = jolt.BodyCreationSettings.initShape(floor_shape, Vec3.init(0, -1, 0), Quaternion.initIdent(), .Static, jolt.Layers.NonMoving);
+    const floor = try body_iface.createBody(floor_opts);
+    body_iface.addBody(floor.getId(), .DontActivate);
+
+    // Boxes stacked in columns so they collide with each other while settling.
+    const box_shape = jolt.BoxShape.init(Vec3.init(0.5, 0.5, 0.5), 0, null).shape();
+    const cols = @floatToInt(u32, @ceil(@sqrt(@intToFloat(f32, num_bodies) / 10)));
+    var i: u32 = 0;
+    while (i < num_bodies) : (i += 1) {
+        const col = i % (cols * cols);
+        const x = @intToFloat(f32, col % cols) * 1.5;
+        const z = @intToFloat(f32, col / cols) * 1.5;
+        const y = 1 + @intToFloat(f32, i / (cols * cols)) * 1.2;
+        const opts = jolt.BodyCreationSettings.initShape(box_shape, Vec3.init(x, y, z), Quaternion.initIdent(), .Dynamic, jolt.Layers.Moving);
+        const body = try body_iface.createBody(opts);
+        body.setUserData(i);
+        body_iface.addBody(body.getId(), .Activate);
+    }
+
+    var timer = try std.time.Timer.start();
+    var step: u32 = 0;
+    var synced: usize = 0;
+    while (step < num_steps) : (step += 1) {
+        physics_sys.update(1.0 / 60.0, 1, 1, temp_alloc, job_sys);
+        physics_sys.getActiveBodyStates(&states);
+        synced += states.len;
+    }
+    const elapsed_s = @intToFloat(f64, timer.read()) / std.time.ns_per_s;
+
+    const stdout = std.io.getStdOut().writer();
+    try stdout.print("jolt multi_threaded={} simd={} threads={s}\n", .{
+        build_options.multi_threaded, build_options.enable_simd,
+        if (num_threads) |_| args[3] else "auto",
+    });
+    try stdout.print("bodies={} steps={} time={d:.3}s steps/sec={d:.1} synced/step={}\n", .{
+        num_bodies, num_steps, elapsed_s, @intToFloat(f64, num_steps) / elapsed_s, synced / std.math.max(num_steps, 1),
+    });
+}
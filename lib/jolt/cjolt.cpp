@@ -3,9 +3,17 @@
 #include "Jolt/Core/Factory.h"
 #include "Jolt/Core/IssueReporting.h"
 #include "Jolt/Core/JobSystemThreadPool.h"
+#include "Jolt/Core/FPFlushDenormals.h"
 #include "Jolt/Physics/PhysicsSystem.h"
 #include "Jolt/Physics/Collision/Shape/BoxShape.h"
 #include "Jolt/Physics/Body/BodyCreationSettings.h"
+#include "Jolt/Physics/Body/BodyLockMulti.h"
+#include "Jolt/Physics/Collision/RayCast.h"
+#include "Jolt/Physics/Collision/CastResult.h"
+#include "Jolt/Physics/Collision/ShapeCast.h"
+#include "Jolt/Physics/Collision/CollideShape.h"
+#include "Jolt/Physics/Collision/CollisionCollectorImpl.h"
+#include "Jolt/Physics/Collision/NarrowPhaseQuery.h"
 
 JPH_NAMESPACE_BEGIN
 
@@ -60,6 +68,79 @@ class BPLayerInterfaceImpl final : public BroadPhaseLayerInterface {
         BroadPhaseLayer mObjectToBroadPhase[Layers::NUM_LAYERS];
 };
 
+// Matches BodyStates in cjolt.h.
+struct BodyStates {
+    BodyID* ids;
+    float* positions;
+    float* rotations;
+    float* linear_velocities;
+    float* angular_velocities;
+    uint64* user_data;
+};
+
+// Matches RayCastHit in cjolt.h.
+struct RayCastHit {
+    BodyID body_id;
+    float fraction;
+};
+
+// Matches ShapeHit in cjolt.h.
+struct ShapeHit {
+    BodyID body_id;
+    float fraction;
+    float penetration_depth;
+    float contact_point[3];
+    float penetration_axis[3];
+};
+
+// Minimum number of queries per job.
+static constexpr size_t QueryBatchSize = 256;
+
+// Runs inFunc(start, end) over [0, inNum) split into jobs. Small batches or a null job system run on the calling thread.
+template <typename F>
+static void ParallelFor(JobSystem* inJobSystem, size_t inNum, const F& inFunc) {
+    if (inJobSystem == nullptr || inNum <= QueryBatchSize) {
+        inFunc(0, inNum);
+        return;
+    }
+    // Bound the number of jobs so large batches don't exceed the job system's max jobs.
+    size_t max_jobs = (size_t)max(1, inJobSystem->GetMaxConcurrency()) * 4;
+    size_t batch_size = max(QueryBatchSize, (inNum + max_jobs - 1) / max_jobs);
+
+    JobSystem::Barrier* barrier = inJobSystem->CreateBarrier();
+    for (size_t start = 0; start < inNum; start += batch_size) {
+        size_t end = min(start + batch_size, inNum);
+        JobHandle job = inJobSystem->CreateJob("BatchQuery", Color::sGreen, [&inFunc, start, end]() {
+            inFunc(start, end);
+        });
+        barrier->AddJob(job);
+    }
+    inJobSystem->WaitForJobs(barrier);
+    inJobSystem->DestroyBarrier(barrier);
+}
+
+static void WriteShapeHit(ShapeHit& out, const CollideShapeResult& hit) {
+    out.body_id = hit.mBodyID2;
+    out.penetration_depth = hit.mPenetrationDepth;
+    out.contact_point[0] = hit.mContactPointOn2.GetX();
+    out.contact_point[1] = hit.mContactPointOn2.GetY();
+    out.contact_point[2] = hit.mContactPointOn2.GetZ();
+    Vec3 axis = hit.mPenetrationAxis.NormalizedOr(Vec3::sZero());
+    out.penetration_axis[0] = axis.GetX();
+    out.penetration_axis[1] = axis.GetY();
+    out.penetration_axis[2] = axis.GetZ();
+}
+
+static void WriteNoShapeHit(ShapeHit& out) {
+    out.body_id = BodyID();
+    out.fraction = 1.0f;
+    out.penetration_depth = 0.0f;
+    for (int i = 0; i < 3; i += 1) {
+        out.contact_point[i] = 0.0f;
+        out.penetration_axis[i] = 0.0f;
+    }
+}
+
 extern "C" {
 
 void JPH__InitDefaultFactory() {
@@ -110,6 +191,9 @@ void JPH__PhysicsSystem__Update(
     TempAllocator* inTempAllocator,
     JobSystem* inJobSystem
 ) {
+    // Worker threads flush denormals in JobSystemThreadPool::ThreadMain. The calling thread also runs jobs so flush here too.
+    FPFlushDenormals flush_denormals;
+    JPH_UNUSED(flush_denormals);
     self->Update(inDeltaTime, inCollisionSteps, inIntegrationSubSteps, inTempAllocator, inJobSystem);
 }
 
@@ -142,6 +226,128 @@ void JPH__PhysicsSystem__GetActiveBodies(const PhysicsSystem& self, BodyID* out)
     self.GetActiveBodiesBuf(out);
 }
 
+// Writes the ids and state of all active bodies into out under one multi body read lock.
+// Returns the number of active bodies. If it's greater than max_bodies nothing is written and the caller should retry with larger buffers.
+size_t JPH__PhysicsSystem__GetActiveBodyStates(const PhysicsSystem& self, size_t max_bodies, BodyStates* out) {
+    size_t num_active = self.GetNumActiveBodies();
+    if (num_active > max_bodies) {
+        return num_active;
+    }
+    self.GetActiveBodiesBuf(out->ids);
+
+    BodyLockMultiRead lock(self.GetBodyLockInterface(), out->ids, (int)num_active);
+    size_t n = 0;
+    for (size_t i = 0; i < num_active; i += 1) {
+        const Body* body = lock.GetBody((int)i);
+        if (body == nullptr) {
+            continue;
+        }
+        out->ids[n] = out->ids[i];
+        if (out->positions != nullptr) {
+            Vec3 pos = body->GetPosition();
+            out->positions[n * 3] = pos.GetX();
+            out->positions[n * 3 + 1] = pos.GetY();
+            out->positions[n * 3 + 2] = pos.GetZ();
+        }
+        if (out->rotations != nullptr) {
+            Quat rot = body->GetRotation();
+            out->rotations[n * 4] = rot.GetX();
+            out->rotations[n * 4 + 1] = rot.GetY();
+            out->rotations[n * 4 + 2] = rot.GetZ();
+            out->rotations[n * 4 + 3] = rot.GetW();
+        }
+        if (out->linear_velocities != nullptr) {
+            Vec3 vel = body->GetLinearVelocity();
+            out->linear_velocities[n * 3] = vel.GetX();
+            out->linear_velocities[n * 3 + 1] = vel.GetY();
+            out->linear_velocities[n * 3 + 2] = vel.GetZ();
+        }
+        if (out->angular_velocities != nullptr) {
+            Vec3 vel = body->GetAngularVelocity();
+            out->angular_velocities[n * 3] = vel.GetX();
+            out->angular_velocities[n * 3 + 1] = vel.GetY();
+            out->angular_velocities[n * 3 + 2] = vel.GetZ();
+        }
+        if (out->user_data != nullptr) {
+            out->user_data[n] = body->GetUserData();
+        }
+        n += 1;
+    }
+    return n;
+}
+
+// Batched queries use the non locking narrow phase query since bodies are only read.
+// They must not run concurrently with PhysicsSystem::Update or with adding/removing bodies.
+
+// Casts rays and writes the closest hit for each. origins and directions are 3 floats per ray, the direction's length is the ray's length.
+void JPH__PhysicsSystem__CastRays(const PhysicsSystem& self, JobSystem* job_sys, const float* origins, const float* directions, size_t num_rays, RayCastHit* out) {
+    const NarrowPhaseQuery& query = self.GetNarrowPhaseQueryNoLock();
+    ParallelFor(job_sys, num_rays, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i += 1) {
+            RayCast ray {
+                Vec3(origins[i * 3], origins[i * 3 + 1], origins[i * 3 + 2]),
+                Vec3(directions[i * 3], directions[i * 3 + 1], directions[i * 3 + 2]),
+            };
+            RayCastResult hit;
+            if (query.CastRay(ray, hit)) {
+                out[i].body_id = hit.mBodyID;
+                out[i].fraction = hit.mFraction;
+            } else {
+                out[i].body_id = BodyID();
+                out[i].fraction = 1.0f;
+            }
+        }
+    });
+}
+
+// Sweeps the shape from each world transform along its direction and writes the closest hit.
+// positions and directions are 3 floats per cast and rotations are 4 floats per cast (x, y, z, w).
+void JPH__PhysicsSystem__CastShapes(const PhysicsSystem& self, JobSystem* job_sys, const Shape* shape, const float* positions, const float* rotations, const float* directions, size_t num_casts, ShapeHit* out) {
+    const NarrowPhaseQuery& query = self.GetNarrowPhaseQueryNoLock();
+    ParallelFor(job_sys, num_casts, [&](size_t start, size_t end) {
+        ShapeCastSettings settings;
+        for (size_t i = start; i < end; i += 1) {
+            Mat44 xform = Mat44::sRotationTranslation(
+                Quat(rotations[i * 4], rotations[i * 4 + 1], rotations[i * 4 + 2], rotations[i * 4 + 3]),
+                Vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2])
+            );
+            ShapeCast cast = ShapeCast::sFromWorldTransform(shape, Vec3::sReplicate(1.0f), xform,
+                Vec3(directions[i * 3], directions[i * 3 + 1], directions[i * 3 + 2]));
+            ClosestHitCollisionCollector<CastShapeCollector> collector;
+            query.CastShape(cast, settings, collector);
+            if (collector.HadHit()) {
+                WriteShapeHit(out[i], collector.mHit);
+                out[i].fraction = collector.mHit.mFraction;
+            } else {
+                WriteNoShapeHit(out[i]);
+            }
+        }
+    });
+}
+
+// Tests the shape at each world transform for overlap and writes the deepest hit.
+// positions are 3 floats per query and rotations are 4 floats per query (x, y, z, w).
+void JPH__PhysicsSystem__CollideShapes(const PhysicsSystem& self, JobSystem* job_sys, const Shape* shape, const float* positions, const float* rotations, size_t num_queries, ShapeHit* out) {
+    const NarrowPhaseQuery& query = self.GetNarrowPhaseQueryNoLock();
+    ParallelFor(job_sys, num_queries, [&](size_t start, size_t end) {
+        CollideShapeSettings settings;
+        for (size_t i = start; i < end; i += 1) {
+            Mat44 xform = Mat44::sRotationTranslation(
+                Quat(rotations[i * 4], rotations[i * 4 + 1], rotations[i * 4 + 2], rotations[i * 4 + 3]),
+                Vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2])
+            );
+            ClosestHitCollisionCollector<CollideShapeCollector> collector;
+            query.CollideShape(shape, Vec3::sReplicate(1.0f), xform.PreTranslated(shape->GetCenterOfMass()), settings, collector);
+            if (collector.HadHit()) {
+                WriteShapeHit(out[i], collector.mHit);
+                out[i].fraction = 0.0f;
+            } else {
+                WriteNoShapeHit(out[i]);
+            }
+        }
+    });
+}
+
 /// BPLayerInterfaceImpl
 
 BPLayerInterfaceImpl* JPH__BPLayerInterfaceImpl__NEW() {
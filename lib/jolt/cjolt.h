@@ -102,6 +102,31 @@ typedef struct BodyLock {
 	uint32_t mBodyLockMutex;
 	Body* mBody;
 } BodyLock;
+// Structure of arrays for exporting the state of all active bodies in one call.
+// Positions and velocities are 3 floats per body and rotations are 4 floats per body (x, y, z, w).
+// Arrays other than ids can be null to skip that state.
+typedef struct BodyStates {
+    BodyId* ids;
+    float* positions;
+    float* rotations;
+    float* linear_velocities;
+    float* angular_velocities;
+    uint64* user_data;
+} BodyStates;
+// Result of a ray cast. body_id is invalid (0xffffffff) if nothing was hit.
+typedef struct RayCastHit {
+    BodyId body_id;
+    float fraction;
+} RayCastHit;
+// Result of a shape cast or shape collide query. body_id is invalid (0xffffffff) if nothing was hit.
+// fraction is only set for shape casts. contact_point is on the hit body and penetration_axis points from the query shape into the hit body.
+typedef struct ShapeHit {
+    BodyId body_id;
+    float fraction;
+    float penetration_depth;
+    float contact_point[3];
+    float penetration_axis[3];
+} ShapeHit;
 
 void JPH__InitDefaultFactory();
 void JPH__RegisterDefaultAllocator();
@@ -134,6 +159,10 @@ void JPH__PhysicsSystem__Update(
 Vec3 JPH__PhysicsSystem__GetGravity(const PhysicsSystem* self);
 usize JPH__PhysicsSystem__GetNumActiveBodies(const PhysicsSystem* self);
 void JPH__PhysicsSystem__GetActiveBodies(const PhysicsSystem* self, BodyId* out);
+usize JPH__PhysicsSystem__GetActiveBodyStates(const PhysicsSystem* self, usize max_bodies, BodyStates* out);
+void JPH__PhysicsSystem__CastRays(const PhysicsSystem* self, JobSystem* job_sys, const float* origins, const float* directions, usize num_rays, RayCastHit* out);
+void JPH__PhysicsSystem__CastShapes(const PhysicsSystem* self, JobSystem* job_sys, const Shape* shape, const float* positions, const float* rotations, const float* directions, usize num_casts, ShapeHit* out);
+void JPH__PhysicsSystem__CollideShapes(const PhysicsSystem* self, JobSystem* job_sys, const Shape* shape, const float* positions, const float* rotations, usize num_queries, ShapeHit* out);
 
 BPLayerInterfaceImpl* JPH__BPLayerInterfaceImpl__NEW();
 void JPH__BPLayerInterfaceImpl__DELETE(BPLayerInterfaceImpl* handle);
@@ -18,6 +18,10 @@ const Quat = c.Quat;
 pub const ObjectLayer = c.ObjectLayer;
 pub const BroadPhaseLayer = c.BroadPhaseLayer;
 pub const BodyId = c.BodyId;
+pub const RayCastHit = c.RayCastHit;
+pub const ShapeHit = c.ShapeHit;
+/// Body id reported by queries that didn't hit anything.
+pub const InvalidBodyId = BodyId{ .mID = 0xffffffff };
 pub const TempAllocator = c.TempAllocator;
 
 pub const Layers = struct {
@@ -41,6 +45,37 @@ pub const BroadPhaseLayers = struct {
     pub const NumLayers: u32 = 5;
 };
 
+/// Broad phase filter that matches the default object to broad phase layer mapping in BPLayerInterfaceImpl.
+pub fn defaultBroadPhaseCanCollide(layer1: ObjectLayer, layer2_: BroadPhaseLayer) bool {
+    const layer2 = layer2_.mValue;
+    switch (layer1) {
+        Layers.NonMoving => return layer2 == BroadPhaseLayers.Moving,
+        Layers.Moving => return layer2 == BroadPhaseLayers.NonMoving or layer2 == BroadPhaseLayers.Moving or layer2 == BroadPhaseLayers.Sensor,
+        Layers.Debris => return layer2 == BroadPhaseLayers.NonMoving,
+        Layers.Sensor => return layer2 == BroadPhaseLayers.Moving,
+        Layers.Unused1,
+        Layers.Unused2,
+        Layers.Unused3,
+        Layers.Unused4 => return false,
+        else => unreachable,
+    }
+}
+
+/// Object layer pair filter for the default layers.
+pub fn defaultObjectCanCollide(obj1: ObjectLayer, obj2: ObjectLayer) bool {
+    switch (obj1) {
+        Layers.Unused1,
+        Layers.Unused2,
+        Layers.Unused3,
+        Layers.Unused4 => return false,
+        Layers.NonMoving => return obj2 == Layers.Moving or obj2 == Layers.Debris,
+        Layers.Moving => return obj2 == Layers.NonMoving or obj2 == Layers.Moving or obj2 == Layers.Sensor,
+        Layers.Debris => return obj2 == Layers.NonMoving,
+        Layers.Sensor => return obj2 == Layers.Moving,
+        else => unreachable,
+    }
+}
+
 pub const EMotionType = enum(c.EMotionType) {
     Static = 0,
     Kinematic = 1,
@@ -153,6 +188,52 @@ pub const PhysicsSystem = struct {
         c.JPH__PhysicsSystem__GetActiveBodies(self.handle, out.ptr);
     }
 
+    /// Exports the state of all active bodies into states with one call into jolt.
+    /// The buffers grow to fit the number of active bodies.
+    pub fn getActiveBodyStates(self: PhysicsSystem, states: *BodyStates) void {
+        while (true) {
+            var out = c.BodyStates{
+                .ids = states.ids.ptr,
+                .positions = states.positions.ptr,
+                .rotations = states.rotations.ptr,
+                .linear_velocities = states.linear_velocities.ptr,
+                .angular_velocities = states.angular_velocities.ptr,
+                .user_data = states.user_data.ptr,
+            };
+            const num = c.JPH__PhysicsSystem__GetActiveBodyStates(self.handle, states.ids.len, &out);
+            if (num > states.ids.len) {
+                states.ensureTotalCapacity(num);
+                continue;
+            }
+            states.len = num;
+            return;
+        }
+    }
+
+    /// Casts a batch of rays and writes the closest hit per ray into out. origins and directions are 3 floats per ray.
+    /// Large batches are split across job_sys. Must not run concurrently with update or while adding/removing bodies.
+    pub fn castRays(self: PhysicsSystem, job_sys: ?JobSystem, origins: []const f32, directions: []const f32, out: []RayCastHit) void {
+        std.debug.assert(origins.len == out.len * 3);
+        std.debug.assert(directions.len == out.len * 3);
+        c.JPH__PhysicsSystem__CastRays(self.handle, if (job_sys) |sys| sys.handle else null, origins.ptr, directions.ptr, out.len, out.ptr);
+    }
+
+    /// Sweeps shape along each direction from each transform and writes the closest hit into out.
+    /// positions and directions are 3 floats per cast and rotations are 4 floats per cast.
+    pub fn castShapes(self: PhysicsSystem, job_sys: ?JobSystem, shape: *const c.Shape, positions: []const f32, rotations: []const f32, directions: []const f32, out: []ShapeHit) void {
+        std.debug.assert(positions.len == out.len * 3);
+        std.debug.assert(rotations.len == out.len * 4);
+        std.debug.assert(directions.len == out.len * 3);
+        c.JPH__PhysicsSystem__CastShapes(self.handle, if (job_sys) |sys| sys.handle else null, shape, positions.ptr, rotations.ptr, directions.ptr, out.len, out.ptr);
+    }
+
+    /// Tests shape for overlap at each transform and writes the deepest hit into out.
+    pub fn collideShapes(self: PhysicsSystem, job_sys: ?JobSystem, shape: *const c.Shape, positions: []const f32, rotations: []const f32, out: []ShapeHit) void {
+        std.debug.assert(positions.len == out.len * 3);
+        std.debug.assert(rotations.len == out.len * 4);
+        c.JPH__PhysicsSystem__CollideShapes(self.handle, if (job_sys) |sys| sys.handle else null, shape, positions.ptr, rotations.ptr, out.len, out.ptr);
+    }
+
     pub fn getGravity(self: PhysicsSystem) StdVec3 {
         const res = c.JPH__PhysicsSystem__GetGravity(self.handle);
         return StdVec3.init(res.x, res.y, res.z);
@@ -163,6 +244,74 @@ pub const PhysicsSystem = struct {
     }
 };
 
+/// Structure of arrays for the state of active bodies. Filled by PhysicsSystem.getActiveBodyStates.
+pub const BodyStates = struct {
+    alloc: std.mem.Allocator,
+    /// Number of bodies from the last export.
+    len: usize,
+
+    /// Buffers are sized by capacity. Vectors are 3 floats per body and rotations are 4 floats per body.
+    ids: []BodyId,
+    positions: []f32,
+    rotations: []f32,
+    linear_velocities: []f32,
+    angular_velocities: []f32,
+    user_data: []u64,
+
+    pub fn init(alloc: std.mem.Allocator) BodyStates {
+        return .{
+            .alloc = alloc,
+            .len = 0,
+            .ids = &.{},
+            .positions = &.{},
+            .rotations = &.{},
+            .linear_velocities = &.{},
+            .angular_velocities = &.{},
+            .user_data = &.{},
+        };
+    }
+
+    pub fn deinit(self: BodyStates) void {
+        self.alloc.free(self.ids);
+        self.alloc.free(self.positions);
+        self.alloc.free(self.rotations);
+        self.alloc.free(self.linear_velocities);
+        self.alloc.free(self.angular_velocities);
+        self.alloc.free(self.user_data);
+    }
+
+    pub fn ensureTotalCapacity(self: *BodyStates, cap: usize) void {
+        if (cap <= self.ids.len) {
+            return;
+        }
+        // Contents don't need to be preserved since every export overwrites them.
+        self.deinit();
+        self.ids = self.alloc.alloc(BodyId, cap) catch @panic("error");
+        self.positions = self.alloc.alloc(f32, cap * 3) catch @panic("error");
+        self.rotations = self.alloc.alloc(f32, cap * 4) catch @panic("error");
+        self.linear_velocities = self.alloc.alloc(f32, cap * 3) catch @panic("error");
+        self.angular_velocities = self.alloc.alloc(f32, cap * 3) catch @panic("error");
+        self.user_data = self.alloc.alloc(u64, cap) catch @panic("error");
+    }
+
+    pub inline fn getPosition(self: BodyStates, idx: usize) StdVec3 {
+        return StdVec3.init(self.positions[idx * 3], self.positions[idx * 3 + 1], self.positions[idx * 3 + 2]);
+    }
+
+    pub inline fn getRotation(self: BodyStates, idx: usize) Quaternion {
+        const i = idx * 4;
+        return Quaternion.init(StdVec4.init(self.rotations[i], self.rotations[i + 1], self.rotations[i + 2], self.rotations[i + 3]));
+    }
+
+    pub inline fn getLinearVelocity(self: BodyStates, idx: usize) StdVec3 {
+        return StdVec3.init(self.linear_velocities[idx * 3], self.linear_velocities[idx * 3 + 1], self.linear_velocities[idx * 3 + 2]);
+    }
+
+    pub inline fn getAngularVelocity(self: BodyStates, idx: usize) StdVec3 {
+        return StdVec3.init(self.angular_velocities[idx * 3], self.angular_velocities[idx * 3 + 1], self.angular_velocities[idx * 3 + 2]);
+    }
+};
+
 pub const BodyLockInterface = struct {
     handle: *c.BodyLockInterface,
 
@@ -15,7 +15,8 @@ pub fn addPackage(step: *std.build.LibExeObjStep) void {
     step.addIncludeDir(srcPath() ++ "/");
 }
 
-const BuildOptions = struct {
+/// SSE4/AVX2 paths in jolt are enabled from the target cpu features. Native builds use the host cpu, cross builds can pass -Dcpu (eg. x86_64_v3).
+pub const BuildOptions = struct {
     multi_threaded: bool = true,
     enable_simd: bool = true,
 };
@@ -46,7 +47,7 @@ pub fn createTest(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.
             "/vendor/UnitTests/Core/FPFlushDenormalsTest.cpp",
         }) catch @panic("error");
     }
-    // Many tests won't pass with simd disabled due to not having denormalize mechanism.
+    // Many tests won't pass with simd disabled since denormals can only be flushed with simd control registers.
     // However the Math tests should pass.
     sources.appendSlice(&.{
         "/vendor/UnitTests/Math/HalfFloatTests.cpp",
@@ -109,6 +110,24 @@ pub fn createTest(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.
     return exe;
 }
 
+/// Headless benchmark that steps falling boxes and reports steps/sec.
+pub fn createBench(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.builtin.Mode, opts: BuildOptions) *std.build.LibExeObjStep {
+    const name = if (opts.multi_threaded and opts.enable_simd) "bench-jolt" else "bench-jolt-baseline";
+    const exe = b.addExecutable(name, srcPath() ++ "/bench.zig");
+    exe.setBuildMode(mode);
+    exe.setTarget(target);
+    exe.linkLibC();
+    exe.addPackage(stdx.getPackage(b, .{}));
+    addPackage(exe);
+    buildAndLink(exe, opts);
+
+    const build_options = b.addOptions();
+    build_options.addOption(bool, "multi_threaded", opts.multi_threaded);
+    build_options.addOption(bool, "enable_simd", opts.enable_simd);
+    exe.addPackage(build_options.getPackage("build_options"));
+    return exe;
+}
+
 pub fn buildAndLink(step: *std.build.LibExeObjStep, opts: BuildOptions) void {
     const b = step.builder;
     const lib = b.addStaticLibrary("jolt", null);
@@ -266,6 +266,12 @@ function initGraphicsImports(wasm, canvas) {
         jsGlDrawElements(mode, num_indices, index_type, index_offset) {
             ctx.drawElements(mode, num_indices, index_type, index_offset)
         },
+        jsGlDrawElementsInstanced(mode, num_indices, index_type, index_offset, instance_count) {
+            ctx.drawElementsInstanced(mode, num_indices, index_type, index_offset, instance_count)
+        },
+        jsGlVertexAttribDivisor(index, divisor) {
+            ctx.vertexAttribDivisor(index, divisor)
+        },
         jsGlBindRenderbuffer(target, id) {
             ctx.bindRenderbuffer(target, renderbuffers.get(id))
         },
@@ -4,13 +4,19 @@ const stdx = @import("../stdx/lib.zig");
 
 pub const pkg = std.build.Pkg{
     .name = "parser",
-    .path = .{ .path = srcPath() ++ "/parser.zig" },
+    .source = .{ .path = srcPath() ++ "/parser.zig" },
 };
 
+pub fn getPackage(b: *std.build.Builder) std.build.Pkg {
+    var ret = pkg;
+    ret.dependencies = b.allocator.dupe(std.build.Pkg, &.{
+        stdx.getPackage(b, .{}),
+    }) catch @panic("error");
+    return ret;
+}
+
 pub fn addPackage(step: *std.build.LibExeObjStep) void {
-    var new_pkg = pkg;
-    new_pkg.dependencies = &.{stdx.pkg};
-    step.addPackage(new_pkg);
+    step.addPackage(getPackage(step.builder));
 }
 
 fn srcPath() []const u8 {
@@ -13,18 +13,21 @@ const LineChunkId = document.LineChunkId;
 
 const log = stdx.log.scoped(.parser);
 const tokenizer = @import("tokenizer.zig");
-const Tokenizer = tokenizer.Tokenizer;
+pub const Tokenizer = tokenizer.Tokenizer;
 const grammar = @import("grammar.zig");
 const RuleId = grammar.RuleId;
 const RuleDecl = grammar.RuleDecl;
 const MatchOp = grammar.MatchOp;
 const MatchOpId = grammar.MatchOpId;
-const Grammar = grammar.Grammar;
+pub const TokenTag = grammar.TokenTag;
+pub const Grammar = grammar.Grammar;
+pub const builder = @import("builder.zig");
+pub const grammars = @import("grammars.zig");
 const _ast = @import("ast.zig");
 const Tree = _ast.Tree;
 const TokenId = _ast.TokenId;
 const TokenListId = _ast.TokenListId;
-const Token = _ast.Token;
+pub const Token = _ast.Token;
 const LineTokenBuffer = _ast.LineTokenBuffer;
 const NullToken = stdx.ds.CompactNull(TokenId);
 
@@ -69,6 +69,26 @@ test "Parse zig simple" {
     try t.eqStr(ast.getNodeTagName(stmts[1]), "FunctionDecl");
 }
 
+test "Tokenize line" {
+    var grammar: Grammar = undefined;
+    try builder.initGrammar(&grammar, t.alloc, grammars.ZigGrammar);
+    defer grammar.deinit();
+
+    var tokenizer = _parser.Tokenizer.init(&grammar);
+    var buf = std.ArrayList(_parser.Token).init(t.alloc);
+    defer buf.deinit();
+
+    // The comment is skipped by the parser but emitted for highlighting even though the line has no newline.
+    const line = "const a = 123; // foo";
+    tokenizer.tokenizeLine(line, &buf);
+    try t.eq(buf.items.len, 6);
+    try t.eqStr(grammar.getTokenName(buf.items[0].tag), "Keyword");
+    try t.eqStr(line[buf.items[0].loc.start..buf.items[0].loc.end], "const");
+    try t.eqStr(grammar.getTokenName(buf.items[3].tag), "DecLiteral");
+    try t.eqStr(grammar.getTokenName(buf.items[5].tag), "Comment");
+    try t.eqStr(line[buf.items[5].loc.start..buf.items[5].loc.end], "// foo");
+}
+
 // test "Parse Typescript" {
 // const ts =
 //     \\type Item = {
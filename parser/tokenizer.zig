@@ -69,6 +69,23 @@ pub const Tokenizer = struct {
         self.tokenizeMain(TConfig, &ctx);
     }
 
+    // Tokenizes one line without a Document, as if it ended with a newline.
+    // Token locations are offsets into the line. Used for highlighting so skipped tokens (eg. comments) are included.
+    pub fn tokenizeLine(self: *Self, line: []const u8, buf: *std.ArrayList(Token)) void {
+        const Context = TokenizeContext(LineStringState, false);
+        const TConfig: TokenizeConfig = .{
+            .Context = Context,
+            .debug = false,
+            .emit_skipped = true,
+        };
+
+        var ctx: Context = undefined;
+        ctx.state.init(line, buf);
+        defer ctx.state.deinit();
+
+        self.tokenizeMain(TConfig, &ctx);
+    }
+
     // col_idx is the start of the change.
     pub fn retokenizeChange(self: *Self, doc: *Document, buf: *LineTokenBuffer, line_idx: u32, col_idx: u32, change_size: i32, debug: anytype) void {
         const t = trace(@src());
@@ -117,6 +134,10 @@ pub const Tokenizer = struct {
                     const op = &self.ops[it.op_id];
                     if (self.advanceWithOp(&ctx.state, op) == MatchAdvance) {
                         if (it.skip) {
+                            if (Config.emit_skipped) {
+                                const tok = Token.init(@intCast(u32, it.tag), NullLiteralTokenTag, start, ctx.state.mark());
+                                ctx.state.appendToken(Config.debug, ctx.debug, tok);
+                            }
                             // Stop matching and advance.
                             break :inner;
                         }
@@ -134,7 +155,7 @@ pub const Tokenizer = struct {
                         } else NullLiteralTokenTag;
 
                         switch (Config.Context.State) {
-                            StringBufferState => {
+                            StringBufferState, LineStringState => {
                                 const tok = Token.init(@intCast(u32, it.tag), literal_tag, start, next);
                                 ctx.state.appendToken(Config.debug, ctx.debug, tok);
                             },
@@ -171,7 +192,7 @@ pub const Tokenizer = struct {
             }
 
             switch (Config.Context.State) {
-                StringBufferState => {
+                StringBufferState, LineStringState => {
                     const tok = Token.init(replace_rule_tag, literal_tag.?, start, end);
                     ctx.state.appendToken(Config.debug, ctx.debug, tok);
                 },
@@ -518,6 +539,71 @@ const StringBufferState = struct {
     }
 };
 
+// Single line source that reports a newline after the last char, so tokens that end with a newline (eg. line comments) still match.
+const LineStringState = struct {
+    const Self = @This();
+    const Mark = u32;
+    const Type = StateType{
+        .StringBuffer = {},
+    };
+
+    next_ch_idx: u32,
+    end_idx: u32,
+    src: []const u8,
+    buf: *std.ArrayList(Token),
+
+    fn init(self: *Self, src: []const u8, buf: *std.ArrayList(Token)) void {
+        self.* = .{
+            .src = src,
+            .end_idx = @intCast(u32, src.len) + 1,
+            .next_ch_idx = 0,
+            .buf = buf,
+        };
+    }
+
+    fn deinit(self: *Self) void {
+        _ = self;
+    }
+
+    inline fn appendToken(self: *Self, comptime Debug: bool, debug: anytype, token: Token) void {
+        _ = Debug;
+        _ = debug;
+        var tok = token;
+        // Exclude the implicit newline.
+        tok.loc.end = std.math.min(tok.loc.end, @intCast(u32, self.src.len));
+        self.buf.append(tok) catch unreachable;
+    }
+
+    inline fn mark(self: *const Self) u32 {
+        return self.next_ch_idx;
+    }
+
+    inline fn gotoMark(self: *Self, _mark: u32) void {
+        self.next_ch_idx = _mark;
+    }
+
+    inline fn nextAtEnd(self: *const Self) bool {
+        return self.next_ch_idx >= self.end_idx;
+    }
+
+    inline fn peekNext(self: *Self) u8 {
+        if (self.next_ch_idx == self.src.len) {
+            return '\n';
+        }
+        return self.src[self.next_ch_idx];
+    }
+
+    inline fn getString(self: *Self, start: u32, end: u32) []const u8 {
+        return self.src[start..std.math.min(end, self.src.len)];
+    }
+
+    inline fn consumeNext(self: *Self) u8 {
+        const ch = self.peekNext();
+        self.next_ch_idx += 1;
+        return ch;
+    }
+};
+
 // This is fast at iterating a document line tree since it will track the current leaf and continue to the next.
 // This also means that it won't pick up inserts/deletes from the document during parsing.
 // TODO: move Incremental into inner function comptime.
@@ -564,8 +650,8 @@ fn LineSourceState(comptime Incremental: bool) type {
             const last_leaf_id = doc.getLastLeaf();
             const last_leaf = doc.getNode(last_leaf_id);
 
-            // Ensure doc line map is big enough.
-            buf.lines.resize(doc.lines.size()) catch unreachable;
+            // Ensure doc line map is big enough. Line ids can be past the number of lines after lines are removed.
+            buf.lines.resize(doc.lines.data.items.len) catch unreachable;
 
             self.* = .{
                 .doc = doc,
@@ -946,6 +1032,7 @@ const StateType = union(enum) {
 const TokenizeConfig = struct {
     Context: type,
     debug: bool,
+    emit_skipped: bool = false,
 };
 
 fn TokenizeContext(comptime StateT: type, debug: bool) type {
@@ -11,6 +11,8 @@ pub const GraphicsBackend = enum(u3) {
     Vulkan = 3,
     /// Dummy, lets switch statements always have an else clause.
     Dummy = 4,
+    /// Software rasterizer into an in-memory RGBA buffer. Headless, 2D only.
+    Cpu = 5,
 };
 
 pub fn getGraphicsBackend(step: *std.build.LibExeObjStep) GraphicsBackend {
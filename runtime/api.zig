@@ -320,9 +320,9 @@ pub const cs_files = struct {
     /// Reads a file as raw bytes.
     /// Returns the contents on success or null.
     /// @param path
-    pub fn read(rt: *RuntimeContext, path: []const u8) Error!ManagedStruct(Uint8Array) {
+    pub fn read(rt: *RuntimeContext, path: []const u8) Error!runtime.OwnedUint8Array {
         const res = try readInternal(rt.alloc, path);
-        return ManagedStruct(Uint8Array).init(rt.alloc, Uint8Array{ .buf = res });
+        return runtime.OwnedUint8Array{ .buf = res };
     }
 
     /// @param path
@@ -1135,13 +1135,14 @@ pub const cs_core = struct {
     /// Converts a buffer to a UTF-8 string.
     /// @param buffer
     pub fn bufferToUtf8(buf: v8.Uint8Array) ?[]const u8 {
-        var shared_ptr_store = v8.ArrayBufferView.castFrom(buf).getBuffer().getBackingStore();
-        defer v8.BackingStore.sharedPtrReset(&shared_ptr_store);
-
-        const store = v8.BackingStore.sharedPtrGet(&shared_ptr_store);
-        const len = store.getByteLength();
+        const view = v8.ArrayBufferView.castFrom(buf);
+        const len = view.getByteLength();
         if (len > 0) {
-            const ptr = @ptrCast([*]u8, store.getData().?);
+            var shared_ptr_store = view.getBuffer().getBackingStore();
+            defer v8.BackingStore.sharedPtrReset(&shared_ptr_store);
+
+            const store = v8.BackingStore.sharedPtrGet(&shared_ptr_store);
+            const ptr = @ptrCast([*]u8, store.getData().?) + view.getByteOffset();
             if (std.unicode.utf8ValidateSlice(ptr[0..len])) {
                 return ptr[0..len];
             } else return null;
@@ -3,12 +3,14 @@ const stdx = @import("stdx");
 const t = stdx.testing;
 const graphics = @import("graphics");
 const Graphics = graphics.Graphics;
+const CpuGraphics = graphics.cpu.Graphics;
 const FontId = graphics.FontId;
 const StdColor = graphics.Color;
 const Vec2 = stdx.math.Vec2;
 const vec2 = Vec2.init;
 const Mat4 = stdx.math.Mat4;
 const v8 = @import("v8");
+const stbi = @import("stbi");
 
 const runtime = @import("runtime.zig");
 const RuntimeContext = runtime.RuntimeContext;
@@ -17,11 +19,16 @@ const ManagedStruct = adapter.ManagedStruct;
 const This = adapter.This;
 const ThisValue = adapter.ThisValue;
 const Handle = adapter.Handle;
+const ThisHandle = adapter.ThisHandle;
 const RuntimeValue = runtime.RuntimeValue;
 const v8x = @import("v8x.zig");
 
 const log = stdx.log.scoped(.api_graphics);
 
+const vera_ttf = @embedFile("../assets/vera.ttf");
+const MaxRenderTargetSize = 16384;
+const MaxFontFileSize = 20e6;
+
 /// @title Graphics
 /// @name graphics
 /// @ns cs.graphics
@@ -468,6 +475,316 @@ pub const cs_graphics = struct {
         pub fn imageSized(g: *Graphics, x: f32, y: f32, width: f32, height: f32, image: graphics.Image) void {
             g.drawImageSized(x, y, width, height, image.id);
         }
+
+        /// Executes a batch of draw commands encoded into a Float32Array.
+        /// Each command starts with a DrawOp followed by its float args. Polygon ops are followed by the number of points and then the x,y pairs.
+        /// Use DrawBatch to record commands instead of encoding them by hand.
+        /// @param cmds
+        pub fn executeDrawBatch(rt: *RuntimeContext, g: *Graphics, cmds: []const f32) void {
+            var iter = DrawBatchIterator.init(cmds);
+            while (iter.next() catch |err| {
+                v8x.throwErrorExceptionFmt(rt.alloc, rt.isolate, "Invalid draw batch at {}: {}", .{iter.idx, err});
+                return;
+            }) |cmd| {
+                switch (cmd) {
+                    .fillColor => |c| g.setFillColor(c),
+                    .strokeColor => |c| g.setStrokeColor(c),
+                    .lineWidth => |args| g.setLineWidth(args[0]),
+                    .rect => |args| g.fillRect(args[0], args[1], args[2], args[3]),
+                    .rectOutline => |args| g.drawRect(args[0], args[1], args[2], args[3]),
+                    .roundRect => |args| g.fillRoundRect(args[0], args[1], args[2], args[3], args[4]),
+                    .roundRectOutline => |args| g.drawRoundRect(args[0], args[1], args[2], args[3], args[4]),
+                    .circle => |args| g.fillCircle(args[0], args[1], args[2]),
+                    .circleOutline => |args| g.drawCircle(args[0], args[1], args[2]),
+                    .ellipse => |args| g.fillEllipse(args[0], args[1], args[2], args[3]),
+                    .ellipseOutline => |args| g.drawEllipse(args[0], args[1], args[2], args[3]),
+                    .point => |args| g.drawPoint(args[0], args[1]),
+                    .line => |args| g.drawLine(args[0], args[1], args[2], args[3]),
+                    .triangle => |args| g.fillTriangle(args[0], args[1], args[2], args[3], args[4], args[5]),
+                    .translate => |args| g.translate(args[0], args[1]),
+                    .scale => |args| g.scale(args[0], args[1]),
+                    .rotate => |args| g.rotate(args[0]),
+                    .resetTransform => g.resetTransform(),
+                    .pushState => g.pushState(),
+                    .popState => g.popState(),
+                    .polygon => |pts| g.fillPolygon(toVec2Buf(rt, pts)),
+                    .polygonOutline => |pts| g.drawPolygon(toVec2Buf(rt, pts)),
+                    .convexPolygon => |pts| g.fillConvexPolygon(toVec2Buf(rt, pts)),
+                }
+            }
+        }
+    };
+
+    /// Creates an offscreen render target of the given size. It doesn't need a window so it can be used in server scripts.
+    /// Throws an error if the size is zero or larger than 16384 in either dimension.
+    /// @param width
+    /// @param height
+    pub fn createRenderTarget(rt: *RuntimeContext, width: u32, height: u32) ?v8.Object {
+        if (width == 0 or height == 0 or width > MaxRenderTargetSize or height > MaxRenderTargetSize) {
+            v8x.throwErrorExceptionFmt(rt.alloc, rt.isolate, "Invalid render target size: {}x{}", .{ width, height });
+            return null;
+        }
+        const g = rt.alloc.create(CpuGraphics) catch unreachable;
+        g.init(rt.alloc, width, height) catch unreachable;
+        // The first font becomes the current font.
+        _ = g.addFontTTF(vera_ttf);
+        return runtime.createWeakHandle(rt, .RenderTarget, g);
+    }
+
+    /// An offscreen render target with its own drawing state. Create one with createRenderTarget.
+    /// Drawing is rasterized in memory on the cpu, so it works without a window and every render target is independent.
+    /// Supports a 2D subset of the Graphics context.
+    pub const RenderTarget = struct {
+
+        /// Returns the width in pixels.
+        pub fn getWidth(this: ThisHandle(.RenderTarget)) u32 {
+            return this.ptr.buf.width;
+        }
+
+        /// Returns the height in pixels.
+        pub fn getHeight(this: ThisHandle(.RenderTarget)) u32 {
+            return this.ptr.buf.height;
+        }
+
+        /// Fills every pixel with a color. Ignores the current transform and clip rect.
+        /// @param color
+        pub fn clear(this: ThisHandle(.RenderTarget), color: Color) void {
+            this.ptr.clear(toStdColor(color));
+        }
+
+        /// Sets the current fill color for painting shapes.
+        /// @param color
+        pub fn fillColor(this: ThisHandle(.RenderTarget), color: Color) void {
+            this.ptr.setFillColor(toStdColor(color));
+        }
+
+        /// Sets the current stroke color for painting shape outlines.
+        /// @param color
+        pub fn strokeColor(this: ThisHandle(.RenderTarget), color: Color) void {
+            this.ptr.setStrokeColor(toStdColor(color));
+        }
+
+        /// Sets the current line width for painting shape outlines.
+        /// @param width
+        pub fn lineWidth(this: ThisHandle(.RenderTarget), width: f32) void {
+            this.ptr.setLineWidth(width);
+        }
+
+        /// Shifts the origin x units to the right and y units down.
+        /// @param x
+        /// @param y
+        pub fn translate(this: ThisHandle(.RenderTarget), x: f32, y: f32) void {
+            this.ptr.translate(x, y);
+        }
+
+        /// Scales from the origin x units horizontally and y units vertically.
+        /// @param x
+        /// @param y
+        pub fn scale(this: ThisHandle(.RenderTarget), x: f32, y: f32) void {
+            this.ptr.scale(x, y);
+        }
+
+        /// Rotates the origin by radians clockwise.
+        /// @param rad
+        pub fn rotate(this: ThisHandle(.RenderTarget), rad: f32) void {
+            this.ptr.rotateZ(rad);
+        }
+
+        /// Resets the current transform to identity.
+        pub fn resetTransform(this: ThisHandle(.RenderTarget)) void {
+            this.ptr.resetTransform();
+        }
+
+        /// Saves the current graphics state by pushing onto a stack.
+        pub fn pushState(this: ThisHandle(.RenderTarget)) void {
+            this.ptr.pushState();
+        }
+
+        /// Restores the graphics state on top of the stack.
+        pub fn popState(this: ThisHandle(.RenderTarget)) void {
+            this.ptr.popState();
+        }
+
+        /// Restricts drawing to a rectangle until the state is popped.
+        /// @param x
+        /// @param y
+        /// @param width
+        /// @param height
+        pub fn clipRect(this: ThisHandle(.RenderTarget), x: f32, y: f32, width: f32, height: f32) void {
+            this.ptr.clipRect(x, y, width, height);
+        }
+
+        /// Paints a rectangle with the current fill color.
+        /// @param x
+        /// @param y
+        /// @param width
+        /// @param height
+        pub fn rect(this: ThisHandle(.RenderTarget), x: f32, y: f32, width: f32, height: f32) void {
+            this.ptr.fillRect(x, y, width, height);
+        }
+
+        /// Paints a rectangle outline with the current stroke color.
+        /// @param x
+        /// @param y
+        /// @param width
+        /// @param height
+        pub fn rectOutline(this: ThisHandle(.RenderTarget), x: f32, y: f32, width: f32, height: f32) void {
+            this.ptr.drawRect(x, y, width, height);
+        }
+
+        /// Paints a circle with the current fill color.
+        /// @param x
+        /// @param y
+        /// @param radius
+        pub fn circle(this: ThisHandle(.RenderTarget), x: f32, y: f32, radius: f32) void {
+            this.ptr.fillCircle(x, y, radius);
+        }
+
+        /// Paints a circle sector in radians with the current fill color.
+        /// @param x
+        /// @param y
+        /// @param radius
+        /// @param startRad
+        /// @param sweepRad
+        pub fn circleSector(this: ThisHandle(.RenderTarget), x: f32, y: f32, radius: f32, start_rad: f32, sweep_rad: f32) void {
+            this.ptr.fillCircleSector(x, y, radius, start_rad, sweep_rad);
+        }
+
+        /// Paints an ellipse with the current fill color.
+        /// @param x
+        /// @param y
+        /// @param hRadius
+        /// @param vRadius
+        pub fn ellipse(this: ThisHandle(.RenderTarget), x: f32, y: f32, h_radius: f32, v_radius: f32) void {
+            this.ptr.fillEllipse(x, y, h_radius, v_radius);
+        }
+
+        /// Paints a triangle with the current fill color.
+        /// @param x1
+        /// @param y1
+        /// @param x2
+        /// @param y2
+        /// @param x3
+        /// @param y3
+        pub fn triangle(this: ThisHandle(.RenderTarget), x1: f32, y1: f32, x2: f32, y2: f32, x3: f32, y3: f32) void {
+            this.ptr.fillTriangle(x1, y1, x2, y2, x3, y3);
+        }
+
+        /// Paints a line with the current stroke color.
+        /// @param x1
+        /// @param y1
+        /// @param x2
+        /// @param y2
+        pub fn line(this: ThisHandle(.RenderTarget), x1: f32, y1: f32, x2: f32, y2: f32) void {
+            this.ptr.drawLine(x1, y1, x2, y2);
+        }
+
+        /// Paints a convex polygon with the current fill color.
+        /// @param pts
+        pub fn convexPolygon(rt: *RuntimeContext, this: ThisHandle(.RenderTarget), pts: []const f32) void {
+            this.ptr.fillConvexPolygon(toVec2Buf(rt, pts));
+        }
+
+        /// Paints any polygon with the current fill color.
+        /// @param pts
+        pub fn polygon(rt: *RuntimeContext, this: ThisHandle(.RenderTarget), pts: []const f32) void {
+            this.ptr.fillPolygon(toVec2Buf(rt, pts));
+        }
+
+        /// Path can be absolute or relative to the cwd.
+        /// @param path
+        pub fn addTtfFont(rt: *RuntimeContext, this: ThisHandle(.RenderTarget), path: []const u8) FontId {
+            const data = std.fs.cwd().readFileAlloc(rt.alloc, path, MaxFontFileSize) catch |err| {
+                if (err == error.FileNotFound) {
+                    v8x.throwErrorExceptionFmt(rt.alloc, rt.isolate, "Could not find file: {s}", .{path});
+                    return 0;
+                } else {
+                    unreachable;
+                }
+            };
+            defer rt.alloc.free(data);
+            return this.ptr.addFontTTF(data);
+        }
+
+        /// Sets the current font and font size.
+        /// @param fontId
+        /// @param size
+        pub fn font(this: ThisHandle(.RenderTarget), font_id: FontId, font_size: f32) void {
+            this.ptr.setFont(font_id, font_size);
+        }
+
+        /// Sets the current font size.
+        /// @param size
+        pub fn fontSize(this: ThisHandle(.RenderTarget), font_size: f32) void {
+            this.ptr.setFontSize(font_size);
+        }
+
+        /// Sets the current text align.
+        /// @param align
+        pub fn textAlign(this: ThisHandle(.RenderTarget), align_: TextAlign) void {
+            this.ptr.setTextAlign(toStdTextAlign(align_));
+        }
+
+        /// Sets the current text baseline.
+        /// @param baseline
+        pub fn textBaseline(this: ThisHandle(.RenderTarget), baseline: TextBaseline) void {
+            this.ptr.setTextBaseline(toStdTextBaseline(baseline));
+        }
+
+        /// Paints text with the current fill color. Uses the default font until another font is set.
+        /// @param x
+        /// @param y
+        /// @param text
+        pub fn text(this: ThisHandle(.RenderTarget), x: f32, y: f32, str: []const u8) void {
+            this.ptr.fillText(x, y, str);
+        }
+
+        /// Returns the width of the text in the current font.
+        /// @param text
+        pub fn measureText(this: ThisHandle(.RenderTarget), str: []const u8) f32 {
+            return this.ptr.measureText(str);
+        }
+
+        /// Returns a copy of the pixels as tightly packed RGBA rows starting from the top-left.
+        pub fn readPixels(rt: *RuntimeContext, this: ThisHandle(.RenderTarget)) runtime.OwnedUint8Array {
+            const pixels = rt.alloc.dupe(u8, this.ptr.buf.data) catch unreachable;
+            return runtime.OwnedUint8Array{ .buf = pixels };
+        }
+
+        /// Encodes the pixels into a PNG on a worker thread.
+        /// The pixels are copied immediately so drawing can continue while the promise is pending.
+        pub fn encodePngAsync(rt: *RuntimeContext, this: ThisHandle(.RenderTarget)) v8.Promise {
+            const buf = this.ptr.buf;
+            const pixels = rt.alloc.dupe(u8, buf.data) catch unreachable;
+            return runtime.invokeFuncAsync(rt, encodePng, .{ rt, buf.width, buf.height, pixels });
+        }
+    };
+
+    /// Opcodes for Context.executeDrawBatch. The values must stay in sync with DrawBatch in api_init.js.
+    pub const DrawOp = enum(u8) {
+        fillColor = 0,
+        strokeColor = 1,
+        lineWidth = 2,
+        rect = 3,
+        rectOutline = 4,
+        roundRect = 5,
+        roundRectOutline = 6,
+        circle = 7,
+        circleOutline = 8,
+        ellipse = 9,
+        ellipseOutline = 10,
+        point = 11,
+        line = 12,
+        triangle = 13,
+        translate = 14,
+        scale = 15,
+        rotate = 16,
+        resetTransform = 17,
+        pushState = 18,
+        popState = 19,
+        polygon = 20,
+        polygonOutline = 21,
+        convexPolygon = 22,
     };
 
     pub const TextAlign = enum {
@@ -564,6 +881,162 @@ pub const cs_graphics = struct {
     }
 };
 
+/// Runs on a worker thread so it only touches the pixel snapshot and the thread safe allocator.
+fn encodePng(rt: *RuntimeContext, width: u32, height: u32, pixels: []const u8) runtime.CsError!runtime.OwnedUint8Array {
+    var png = std.ArrayList(u8).init(rt.alloc);
+    errdefer png.deinit();
+    const S = struct {
+        fn write(ctx: ?*anyopaque, data: ?*anyopaque, size: c_int) callconv(.C) void {
+            const png_ = stdx.mem.ptrCastAlign(*std.ArrayList(u8), ctx);
+            const bytes = @ptrCast([*]const u8, data.?)[0..@intCast(usize, size)];
+            png_.appendSlice(bytes) catch unreachable;
+        }
+    };
+    const res = stbi.stbi_write_png_to_func(S.write, &png, @intCast(c_int, width), @intCast(c_int, height), 4, pixels.ptr, @intCast(c_int, width * 4));
+    if (res == 0) {
+        return error.Unknown;
+    }
+    return runtime.OwnedUint8Array{ .buf = png.toOwnedSlice() };
+}
+
+/// Decoded command from a draw batch. Args are slices into the batch buffer.
+const DrawBatchCmd = union(cs_graphics.DrawOp) {
+    fillColor: StdColor,
+    strokeColor: StdColor,
+    lineWidth: *const [1]f32,
+    rect: *const [4]f32,
+    rectOutline: *const [4]f32,
+    roundRect: *const [5]f32,
+    roundRectOutline: *const [5]f32,
+    circle: *const [3]f32,
+    circleOutline: *const [3]f32,
+    ellipse: *const [4]f32,
+    ellipseOutline: *const [4]f32,
+    point: *const [2]f32,
+    line: *const [4]f32,
+    triangle: *const [6]f32,
+    translate: *const [2]f32,
+    scale: *const [2]f32,
+    rotate: *const [1]f32,
+    resetTransform: void,
+    pushState: void,
+    popState: void,
+    /// Flat x,y pairs.
+    polygon: []const f32,
+    polygonOutline: []const f32,
+    convexPolygon: []const f32,
+};
+
+const DrawBatchIterator = struct {
+    const Self = @This();
+
+    cmds: []const f32,
+    idx: usize,
+
+    fn init(cmds: []const f32) Self {
+        return .{
+            .cmds = cmds,
+            .idx = 0,
+        };
+    }
+
+    fn next(self: *Self) !?DrawBatchCmd {
+        if (self.idx == self.cmds.len) {
+            return null;
+        }
+        const op_val = self.cmds[self.idx];
+        // Negated compare also rejects NaN.
+        if (!(op_val >= 0 and op_val < std.meta.fields(cs_graphics.DrawOp).len)) {
+            return error.UnknownOp;
+        }
+        const op = @intToEnum(cs_graphics.DrawOp, @floatToInt(u8, op_val));
+        self.idx += 1;
+        inline for (std.meta.fields(DrawBatchCmd)) |Field| {
+            if (op == @field(cs_graphics.DrawOp, Field.name)) {
+                switch (Field.field_type) {
+                    void => return @unionInit(DrawBatchCmd, Field.name, {}),
+                    StdColor => {
+                        const args = try self.readArgs(4);
+                        return @unionInit(DrawBatchCmd, Field.name, StdColor.init(toColorChannel(args[0]), toColorChannel(args[1]), toColorChannel(args[2]), toColorChannel(args[3])));
+                    },
+                    []const f32 => {
+                        const num_pts = (try self.readArgs(1))[0];
+                        if (!(num_pts >= 0 and num_pts <= @intToFloat(f32, self.cmds.len))) {
+                            return error.InvalidArgs;
+                        }
+                        const len = @floatToInt(usize, num_pts) * 2;
+                        if (self.idx + len > self.cmds.len) {
+                            return error.InvalidArgs;
+                        }
+                        defer self.idx += len;
+                        return @unionInit(DrawBatchCmd, Field.name, self.cmds[self.idx..self.idx + len]);
+                    },
+                    else => {
+                        const N = @typeInfo(@typeInfo(Field.field_type).Pointer.child).Array.len;
+                        return @unionInit(DrawBatchCmd, Field.name, try self.readArgs(N));
+                    },
+                }
+            }
+        }
+        unreachable;
+    }
+
+    fn readArgs(self: *Self, comptime N: usize) !*const [N]f32 {
+        if (self.idx + N > self.cmds.len) {
+            return error.InvalidArgs;
+        }
+        defer self.idx += N;
+        return self.cmds[self.idx..][0..N];
+    }
+};
+
+fn toColorChannel(val: f32) u8 {
+    if (!(val > 0)) {
+        return 0;
+    }
+    return @floatToInt(u8, std.math.min(val, 255));
+}
+
+/// Converts flat x,y pairs into the runtime's temporary vec2 buffer.
+fn toVec2Buf(rt: *RuntimeContext, pts: []const f32) []const Vec2 {
+    rt.vec2_buf.resize(pts.len / 2) catch unreachable;
+    for (rt.vec2_buf.items) |*it, i| {
+        it.* = Vec2.init(pts[i * 2], pts[i * 2 + 1]);
+    }
+    return rt.vec2_buf.items;
+}
+
+test "DrawBatchIterator" {
+    const op = struct {
+        fn op(o: cs_graphics.DrawOp) f32 {
+            return @intToFloat(f32, @enumToInt(o));
+        }
+    }.op;
+    const cmds = [_]f32{
+        op(.fillColor), 255, 0, 300, 128,
+        op(.rect), 1, 2, 3, 4,
+        op(.pushState),
+        op(.polygon), 2, 10, 11, 12, 13,
+        op(.popState),
+    };
+    var iter = DrawBatchIterator.init(&cmds);
+    try t.eq((try iter.next()).?.fillColor, StdColor.init(255, 0, 255, 128));
+    try t.eq((try iter.next()).?.rect.*, .{ 1, 2, 3, 4 });
+    try t.eq(std.meta.activeTag((try iter.next()).?), .pushState);
+    try t.eqSlice(f32, (try iter.next()).?.polygon, &.{ 10, 11, 12, 13 });
+    try t.eq(std.meta.activeTag((try iter.next()).?), .popState);
+    try t.expect((try iter.next()) == null);
+
+    // Truncated args.
+    iter = DrawBatchIterator.init(cmds[0..7]);
+    _ = try iter.next();
+    try t.expectError(iter.next(), error.InvalidArgs);
+
+    // Unknown op.
+    iter = DrawBatchIterator.init(&.{ 100, 1 });
+    try t.expectError(iter.next(), error.UnknownOp);
+}
+
 fn fromStdColor(color: StdColor) cs_graphics.Color {
     return .{ .r = color.channels.r, .g = color.channels.g, .b = color.channels.b, .a = color.channels.a };
 }
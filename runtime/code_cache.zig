@@ -0,0 +1,175 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+
+const log = stdx.log.scoped(.code_cache);
+
+/// Persistent V8 code cache for user module scripts.
+/// Each module gets one file under the app dir keyed by the hash of its absolute path.
+/// An entry is only used if the module source and the v8 version still match.
+///
+/// Layout (little endian):
+///   magic: [4]u8 "CSM1"
+///   v8_version_len: u32, v8_version: [v8_version_len]u8
+///   src_hash: u64
+///   data_len: u32, data: [data_len]u8
+pub const Magic = "CSM1";
+
+pub const ModuleCodeCache = struct {
+    const Self = @This();
+
+    alloc: std.mem.Allocator,
+    v8_version: []const u8,
+
+    /// Null if the app dir is not available, which disables the cache.
+    dir_path: ?[]const u8,
+
+    pub fn init(alloc: std.mem.Allocator, v8_version: []const u8) Self {
+        var dir_path: ?[]const u8 = null;
+        if (std.fs.getAppDataDir(alloc, "cosmic")) |app_dir| {
+            defer alloc.free(app_dir);
+            dir_path = std.fs.path.join(alloc, &.{ app_dir, "code-cache" }) catch unreachable;
+        } else |err| {
+            log.debug("Code cache disabled: {}", .{err});
+        }
+        return .{
+            .alloc = alloc,
+            .v8_version = v8_version,
+            .dir_path = dir_path,
+        };
+    }
+
+    pub fn initDisabled(alloc: std.mem.Allocator, v8_version: []const u8) Self {
+        return .{
+            .alloc = alloc,
+            .v8_version = v8_version,
+            .dir_path = null,
+        };
+    }
+
+    pub fn deinit(self: Self) void {
+        if (self.dir_path) |path| {
+            self.alloc.free(path);
+        }
+    }
+
+    pub fn isEnabled(self: Self) bool {
+        return self.dir_path != null;
+    }
+
+    /// Returns the cached data for the module at abs_path if it was created from src. Caller owns the memory.
+    pub fn load(self: Self, abs_path: []const u8, src_hash: u64) ?[]const u8 {
+        const dir_path = self.dir_path orelse return null;
+        var name_buf: [32]u8 = undefined;
+        const name = getEntryName(&name_buf, abs_path);
+
+        var dir = std.fs.cwd().openDir(dir_path, .{}) catch return null;
+        defer dir.close();
+        const buf = dir.readFileAlloc(self.alloc, name, 1e9) catch return null;
+        defer self.alloc.free(buf);
+
+        const entry = decodeEntry(buf) catch |err| {
+            log.debug("Invalid cache entry for {s}: {}", .{abs_path, err});
+            return null;
+        };
+        if (entry.src_hash != src_hash or !std.mem.eql(u8, entry.v8_version, self.v8_version)) {
+            return null;
+        }
+        return self.alloc.dupe(u8, entry.data) catch unreachable;
+    }
+
+    /// Writes the cache entry to a temporary file first so a concurrent reader never sees a partial entry.
+    pub fn store(self: Self, abs_path: []const u8, src_hash: u64, data: []const u8) !void {
+        const dir_path = self.dir_path orelse return;
+        var name_buf: [32]u8 = undefined;
+        const name = getEntryName(&name_buf, abs_path);
+
+        try std.fs.cwd().makePath(dir_path);
+        var dir = try std.fs.cwd().openDir(dir_path, .{});
+        defer dir.close();
+
+        var tmp_name_buf: [40]u8 = undefined;
+        const tmp_name = try std.fmt.bufPrint(&tmp_name_buf, "{s}.tmp", .{name});
+        {
+            const file = try dir.createFile(tmp_name, .{ .truncate = true });
+            defer file.close();
+            var buf_writer = std.io.bufferedWriter(file.writer());
+            try encodeEntry(buf_writer.writer(), self.v8_version, src_hash, data);
+            try buf_writer.flush();
+        }
+        try dir.rename(tmp_name, name);
+    }
+};
+
+pub fn hashSource(src: []const u8) u64 {
+    return std.hash.Wyhash.hash(0, src);
+}
+
+fn getEntryName(buf: []u8, abs_path: []const u8) []const u8 {
+    const path_hash = std.hash.Wyhash.hash(0, abs_path);
+    return std.fmt.bufPrint(buf, "{x:0>16}.bin", .{path_hash}) catch unreachable;
+}
+
+const Entry = struct {
+    v8_version: []const u8,
+    src_hash: u64,
+    data: []const u8,
+};
+
+fn encodeEntry(writer: anytype, v8_version: []const u8, src_hash: u64, data: []const u8) !void {
+    try writer.writeAll(Magic);
+    try writer.writeIntLittle(u32, @intCast(u32, v8_version.len));
+    try writer.writeAll(v8_version);
+    try writer.writeIntLittle(u64, src_hash);
+    try writer.writeIntLittle(u32, @intCast(u32, data.len));
+    try writer.writeAll(data);
+}
+
+/// Returned slices point into buf.
+fn decodeEntry(buf: []const u8) !Entry {
+    var stream = std.io.fixedBufferStream(buf);
+    const reader = stream.reader();
+
+    var magic: [4]u8 = undefined;
+    try reader.readNoEof(&magic);
+    if (!std.mem.eql(u8, &magic, Magic)) {
+        return error.InvalidFormat;
+    }
+    const version_len = try reader.readIntLittle(u32);
+    if (stream.pos + version_len > buf.len) {
+        return error.EndOfStream;
+    }
+    const v8_version = buf[stream.pos..stream.pos + version_len];
+    stream.pos += version_len;
+    const src_hash = try reader.readIntLittle(u64);
+    const data_len = try reader.readIntLittle(u32);
+    if (stream.pos + data_len != buf.len) {
+        return error.InvalidFormat;
+    }
+    return Entry{
+        .v8_version = v8_version,
+        .src_hash = src_hash,
+        .data = buf[stream.pos..],
+    };
+}
+
+test "Module code cache entry encode and decode." {
+    var buf = std.ArrayList(u8).init(t.alloc);
+    defer buf.deinit();
+
+    try encodeEntry(buf.writer(), "9.9.115.9", hashSource("export const a = 1"), "cached");
+    const entry = try decodeEntry(buf.items);
+    try t.eqStr(entry.v8_version, "9.9.115.9");
+    try t.eq(entry.src_hash, hashSource("export const a = 1"));
+    try t.eqStr(entry.data, "cached");
+
+    try t.expectError(decodeEntry(buf.items[0..buf.items.len-1]), error.InvalidFormat);
+    try t.expectError(decodeEntry("CSM0"), error.InvalidFormat);
+}
+
+test "Module code cache entry names are stable per path." {
+    var buf1: [32]u8 = undefined;
+    var buf2: [32]u8 = undefined;
+    try t.eqStr(getEntryName(&buf1, "/a/main.js"), getEntryName(&buf2, "/a/main.js"));
+    try t.expect(!std.mem.eql(u8, getEntryName(&buf1, "/a/main.js"), getEntryName(&buf2, "/b/main.js")));
+}
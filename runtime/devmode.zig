@@ -403,6 +403,10 @@ pub fn renderDevHud(rt: *RuntimeContext, w: *CsWindow) void {
     const height = @intToFloat(f32, w.window.impl.height);
 
     g.setFont(g.getDefaultFontId(), 16);
+    const atlas_stats = g.getImageAtlasStats();
+    g.setFillColor(graphics.Color.White);
+    g.fillTextFmt(20, height - 45, "image atlas: pages={} images={} saved draw calls={}", .{ atlas_stats.num_pages, atlas_stats.num_images, atlas_stats.saved_draw_calls });
+
     var y = height - 70;
     for (rt.dev_ctx.term_items.items) |it, i| {
         switch (it.tag) {
@@ -41,6 +41,10 @@ pub const Environment = struct {
 
     include_test_api: bool = false,
 
+    // Whether user modules should use the persistent V8 code cache stored in the app dir.
+    // Always disabled for unit tests.
+    enable_code_cache: bool = true,
+
     pub fn deinit(self: Self, alloc: std.mem.Allocator) void {
         if (self.user_ctx_json) |json| {
             alloc.free(json);
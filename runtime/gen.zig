@@ -20,6 +20,116 @@ const work_queue = @import("work_queue.zig");
 const TaskOutput = work_queue.TaskOutput;
 const log = stdx.log.scoped(.gen);
 
+/// Per isolate cache of property keys and struct templates used when converting native values to js.
+/// Keys and templates are identified by comptime slots so a lookup is an index into a list
+/// instead of creating a new js string or object shape for every conversion.
+pub const JsCache = struct {
+    const Self = @This();
+
+    keys: std.ArrayList(?v8.Persistent(v8.String)),
+    struct_tmpls: std.ArrayList(?v8.Persistent(v8.ObjectTemplate)),
+
+    pub fn init(alloc: std.mem.Allocator) Self {
+        return .{
+            .keys = std.ArrayList(?v8.Persistent(v8.String)).init(alloc),
+            .struct_tmpls = std.ArrayList(?v8.Persistent(v8.ObjectTemplate)).init(alloc),
+        };
+    }
+
+    /// Isolate should still be alive.
+    pub fn deinit(self: *Self) void {
+        for (self.keys.items) |*mb_key| {
+            if (mb_key.*) |*key| {
+                key.deinit();
+            }
+        }
+        self.keys.deinit();
+        for (self.struct_tmpls.items) |*mb_tmpl| {
+            if (mb_tmpl.*) |*tmpl| {
+                tmpl.deinit();
+            }
+        }
+        self.struct_tmpls.deinit();
+    }
+
+    /// Returns the js string for a comptime key. The string is created once per isolate.
+    pub fn getKey(self: *Self, iso: v8.Isolate, comptime key: []const u8) v8.String {
+        const id = KeySlot(key).getId();
+        if (id >= self.keys.items.len) {
+            self.keys.appendNTimes(null, id + 1 - self.keys.items.len) catch unreachable;
+        }
+        if (self.keys.items[id]) |js_key| {
+            return js_key.inner;
+        } else {
+            const js_key = iso.initPersistent(v8.String, iso.initStringUtf8(key));
+            self.keys.items[id] = js_key;
+            return js_key.inner;
+        }
+    }
+
+    /// Returns an object template with all the fields of T declared up front.
+    /// Objects created from the same template share a hidden class which keeps property access monomorphic in js.
+    pub fn getStructTemplate(self: *Self, iso: v8.Isolate, comptime T: type) v8.ObjectTemplate {
+        const id = StructSlot(T).getId();
+        if (id >= self.struct_tmpls.items.len) {
+            self.struct_tmpls.appendNTimes(null, id + 1 - self.struct_tmpls.items.len) catch unreachable;
+        }
+        if (self.struct_tmpls.items[id]) |tmpl| {
+            return tmpl.inner;
+        } else {
+            const tmpl = iso.initObjectTemplateDefault();
+            const undef = iso.initUndefined();
+            inline for (std.meta.fields(T)) |Field| {
+                tmpl.set(self.getKey(iso, Field.name), undef, v8.PropertyAttribute.None);
+            }
+            self.struct_tmpls.items[id] = iso.initPersistent(v8.ObjectTemplate, tmpl);
+            return tmpl;
+        }
+    }
+};
+
+/// Ids are process wide so they stay valid when the runtime is restarted with a new isolate.
+/// Slots are claimed atomically since isolates can run on different threads.
+var next_key_id = std.atomic.Atomic(u32).init(0);
+var next_struct_id = std.atomic.Atomic(u32).init(0);
+
+const NullSlotId = std.math.maxInt(u32);
+
+/// If two threads race to claim the same slot, the loser's id is left unused.
+fn claimSlotId(slot_id: *std.atomic.Atomic(u32), next_id: *std.atomic.Atomic(u32)) u32 {
+    const id = slot_id.load(.Acquire);
+    if (id != NullSlotId) {
+        return id;
+    }
+    const new_id = next_id.fetchAdd(1, .Monotonic);
+    if (slot_id.compareAndSwap(NullSlotId, new_id, .AcqRel, .Acquire)) |existing| {
+        return existing;
+    }
+    return new_id;
+}
+
+fn KeySlot(comptime key: []const u8) type {
+    return struct {
+        const Key = key;
+        var id = std.atomic.Atomic(u32).init(NullSlotId);
+
+        fn getId() u32 {
+            return claimSlotId(&id, &next_key_id);
+        }
+    };
+}
+
+fn StructSlot(comptime T: type) type {
+    return struct {
+        const Type = T;
+        var id = std.atomic.Atomic(u32).init(NullSlotId);
+
+        fn getId() u32 {
+            return claimSlotId(&id, &next_struct_id);
+        }
+    };
+}
+
 pub fn genJsFuncSync(comptime native_fn: anytype) v8.FunctionCallback {
     return genJsFunc(native_fn, .{
         .asyncify = false,
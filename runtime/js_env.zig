@@ -170,6 +170,7 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
         ctx.setConstFuncT(proto, "quadraticBezierCurve", Context.quadraticBezierCurve);
         ctx.setConstFuncT(proto, "cubicBezierCurve", Context.cubicBezierCurve);
         ctx.setConstFuncT(proto, "imageSized", Context.imageSized);
+        ctx.setConstFuncT(proto, "executeDrawBatch", Context.executeDrawBatch);
         if (builtin.mode == .Debug) {
             ctx.setConstFuncT(proto, "debugTriangulatePolygon", cs_graphics_pkg.debugTriangulatePolygon);
             ctx.setConstFuncT(proto, "debugTriangulateProcessNext", cs_graphics_pkg.debugTriangulateProcessNext);
@@ -401,6 +402,53 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
         ctx.setProp(text_baseline, "bottom", iso.initIntegerU32(@enumToInt(cs_graphics.TextBaseline.bottom)));
         ctx.setConstProp(mod, "TextBaseline", text_baseline);
 
+        // cs.graphics.DrawOp
+        const draw_op = iso.initObjectTemplateDefault();
+        inline for (std.meta.fields(cs_graphics.DrawOp)) |Field| {
+            ctx.setProp(draw_op, Field.name, iso.initIntegerU32(Field.value));
+        }
+        ctx.setConstProp(mod, "DrawOp", draw_op);
+
+        {
+            // cs.graphics.RenderTarget
+            const RenderTarget = cs_graphics.RenderTarget;
+            const render_target_class = iso.initPersistent(v8.ObjectTemplate, iso.initObjectTemplateDefault());
+            render_target_class.inner.setInternalFieldCount(2);
+            ctx.setConstFuncT(render_target_class.inner, "getWidth", RenderTarget.getWidth);
+            ctx.setConstFuncT(render_target_class.inner, "getHeight", RenderTarget.getHeight);
+            ctx.setConstFuncT(render_target_class.inner, "clear", RenderTarget.clear);
+            ctx.setConstFuncT(render_target_class.inner, "fillColor", RenderTarget.fillColor);
+            ctx.setConstFuncT(render_target_class.inner, "strokeColor", RenderTarget.strokeColor);
+            ctx.setConstFuncT(render_target_class.inner, "lineWidth", RenderTarget.lineWidth);
+            ctx.setConstFuncT(render_target_class.inner, "translate", RenderTarget.translate);
+            ctx.setConstFuncT(render_target_class.inner, "scale", RenderTarget.scale);
+            ctx.setConstFuncT(render_target_class.inner, "rotate", RenderTarget.rotate);
+            ctx.setConstFuncT(render_target_class.inner, "resetTransform", RenderTarget.resetTransform);
+            ctx.setConstFuncT(render_target_class.inner, "pushState", RenderTarget.pushState);
+            ctx.setConstFuncT(render_target_class.inner, "popState", RenderTarget.popState);
+            ctx.setConstFuncT(render_target_class.inner, "clipRect", RenderTarget.clipRect);
+            ctx.setConstFuncT(render_target_class.inner, "rect", RenderTarget.rect);
+            ctx.setConstFuncT(render_target_class.inner, "rectOutline", RenderTarget.rectOutline);
+            ctx.setConstFuncT(render_target_class.inner, "circle", RenderTarget.circle);
+            ctx.setConstFuncT(render_target_class.inner, "circleSector", RenderTarget.circleSector);
+            ctx.setConstFuncT(render_target_class.inner, "ellipse", RenderTarget.ellipse);
+            ctx.setConstFuncT(render_target_class.inner, "triangle", RenderTarget.triangle);
+            ctx.setConstFuncT(render_target_class.inner, "line", RenderTarget.line);
+            ctx.setConstFuncT(render_target_class.inner, "convexPolygon", RenderTarget.convexPolygon);
+            ctx.setConstFuncT(render_target_class.inner, "polygon", RenderTarget.polygon);
+            ctx.setConstFuncT(render_target_class.inner, "addTtfFont", RenderTarget.addTtfFont);
+            ctx.setConstFuncT(render_target_class.inner, "font", RenderTarget.font);
+            ctx.setConstFuncT(render_target_class.inner, "fontSize", RenderTarget.fontSize);
+            ctx.setConstFuncT(render_target_class.inner, "textAlign", RenderTarget.textAlign);
+            ctx.setConstFuncT(render_target_class.inner, "textBaseline", RenderTarget.textBaseline);
+            ctx.setConstFuncT(render_target_class.inner, "text", RenderTarget.text);
+            ctx.setConstFuncT(render_target_class.inner, "measureText", RenderTarget.measureText);
+            ctx.setConstFuncT(render_target_class.inner, "readPixels", RenderTarget.readPixels);
+            ctx.setConstFuncT(render_target_class.inner, "encodePngAsync", RenderTarget.encodePngAsync);
+            ctx.setConstProp(mod, "RenderTarget", render_target_class.inner);
+            rt.render_target_class = render_target_class;
+        }
+        ctx.setConstFuncT(mod, "createRenderTarget", cs_graphics.createRenderTarget);
         ctx.setConstFuncT(mod, "hsvToRgb", cs_graphics.hsvToRgb);
         ctx.setConstProp(cs, "graphics", mod);
     }
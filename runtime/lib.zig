@@ -22,6 +22,7 @@ pub const Options = struct {
     graphics_backend: GraphicsBackend,
     link_lyon: bool = false,
     link_tess2: bool = false,
+    has_api_snapshot: bool = false,
     add_dep_pkgs: bool = true,
 };
 
@@ -33,6 +34,7 @@ pub fn addPackage(step: *std.build.LibExeObjStep, opts: Options) void {
     build_options.addOption(GraphicsBackend, "GraphicsBackend", opts.graphics_backend);
     build_options.addOption(bool, "has_lyon", opts.link_lyon);
     build_options.addOption(bool, "has_tess2", opts.link_tess2);
+    build_options.addOption(bool, "has_api_snapshot", opts.has_api_snapshot);
     const build_options_pkg = build_options.getPackage("build_options");
 
     const platform_opts: platform.Options = .{
@@ -35,6 +35,7 @@ pub fn main() !void {
 const Flags = struct {
     help: bool = false,
     include_test_api: bool = false,
+    no_code_cache: bool = false,
 };
 
 fn parseFlags(alloc: std.mem.Allocator, args: []const []const u8, flags: *Flags) []const []const u8 {
@@ -47,6 +48,8 @@ fn parseFlags(alloc: std.mem.Allocator, args: []const []const u8, flags: *Flags)
                 flags.help = true;
             } else if (std.mem.eql(u8, arg, "--test-api")) {
                 flags.include_test_api = true;
+            } else if (std.mem.eql(u8, arg, "--no-code-cache")) {
+                flags.no_code_cache = true;
             }
         } else {
             const arg_dupe = alloc.dupe(u8, arg) catch unreachable;
@@ -87,6 +90,7 @@ pub fn runMain(alloc: std.mem.Allocator, orig_args: []const []const u8, env: *En
                 return;
             };
             env.include_test_api = flags.include_test_api;
+            env.enable_code_cache = !flags.no_code_cache;
             try runAndExit(src_path, true, env);
         }
     } else if (string.eq(cmd, "run")) {
@@ -99,6 +103,7 @@ pub fn runMain(alloc: std.mem.Allocator, orig_args: []const []const u8, env: *En
                 return;
             };
             env.include_test_api = flags.include_test_api;
+            env.enable_code_cache = !flags.no_code_cache;
             try runAndExit(src_path, false, env);
         }
     } else if (string.eq(cmd, "test")) {
@@ -171,6 +176,17 @@ pub fn runMain(alloc: std.mem.Allocator, orig_args: []const []const u8, env: *En
                 , .{ host, port, public_key_path, private_key_path });
             try runAndExit("http-main.js", false, env);
         }
+    } else if (string.eq(cmd, "gen-snapshot")) {
+        if (flags.help) {
+            printUsage(env, gen_snapshot_usage);
+            env.exit(0);
+        } else {
+            const out_path = nextArg(args, &arg_idx) orelse {
+                env.abortFmt("Expected output path.", .{});
+                return;
+            };
+            try genSnapshotAndExit(out_path, env);
+        }
     } else if (string.eq(cmd, "help")) {
         printUsage(env, main_usage);
         env.exit(0);
@@ -190,6 +206,7 @@ pub fn runMain(alloc: std.mem.Allocator, orig_args: []const []const u8, env: *En
         const src_path = cmd;
 
         env.include_test_api = flags.include_test_api;
+        env.enable_code_cache = !flags.no_code_cache;
         try runAndExit(src_path, false, env);
     }
 }
@@ -231,6 +248,27 @@ fn runAndExit(src_path: []const u8, dev_mode: bool, env: *Environment) !void {
     env.exit(0);
 }
 
+fn genSnapshotAndExit(out_path: []const u8, env: *Environment) !void {
+    const alloc = stdx.heap.getDefaultAllocator();
+    defer stdx.heap.deinitDefaultAllocator();
+
+    // Include the test api so test_init.js is also cached.
+    env.include_test_api = true;
+    const config = RuntimeConfig{
+        .run_init_scripts = false,
+    };
+
+    var rt: RuntimeContext = undefined;
+    runtime.initGlobalRuntime(alloc, &rt, config, env);
+    defer runtime.deinitGlobalRuntime(alloc, &rt);
+
+    rt.genSnapshot(out_path) catch |err| {
+        env.abortFmt("Failed to generate snapshot: {}", .{err});
+        return;
+    };
+    env.printFmt("Wrote snapshot to {s}\n", .{out_path});
+}
+
 fn repl(alloc: std.mem.Allocator, env: *Environment) void {
     const ShellContext = struct {
         env: *Environment,
@@ -371,6 +409,7 @@ const main_usage =
     \\
     \\  http             Starts an HTTP server over a directory.
     \\  https            Starts an HTTPS server over a directory.
+    \\  gen-snapshot     Generates a startup snapshot for the api init scripts.
     \\
     \\Help:
     \\
@@ -382,7 +421,8 @@ const main_usage =
     ;
 
 const common_run_usage_flags =
-    \\  --test-api   Include the cs.test api.
+    \\  --test-api        Include the cs.test api.
+    \\  --no-code-cache   Don't read or write the compiled code cache for modules.
     ;
 
 const run_usage = std.fmt.comptimePrint(
@@ -427,6 +467,15 @@ const shell_usage =
     \\
     ;
 
+const gen_snapshot_usage =
+    \\Usage: cosmic gen-snapshot [out-path]
+    \\
+    \\Runs the embedded api init scripts and writes their V8 code caches to [out-path].
+    \\When runtime/snapshots/api_snapshot.bin exists at build time, it's embedded and
+    \\new isolates boot from it instead of compiling the init scripts from source.
+    \\
+    ;
+
 const http_usage = 
     \\Usage: cosmic http [dir-path] [addr=127.0.0.1:8081]
     \\
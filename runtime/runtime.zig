@@ -36,6 +36,9 @@ const NullId = stdx.ds.CompactNull(u32);
 const devmode = @import("devmode.zig");
 const DevModeContext = devmode.DevModeContext;
 const adapter = @import("adapter.zig");
+const snapshot = @import("snapshot.zig");
+const code_cache = @import("code_cache.zig");
+const ModuleCodeCache = code_cache.ModuleCodeCache;
 const PromiseSkipJsGen = adapter.PromiseSkipJsGen;
 const FuncData = adapter.FuncData;
 const FuncDataUserPtr = adapter.FuncDataUserPtr;
@@ -47,6 +50,8 @@ pub const PromiseId = u32;
 const api_init = @embedFile("snapshots/api_init.js");
 const gen_api_init = @embedFile("snapshots/gen_api.js"); // Generated. Not tracked by git.
 const test_init = @embedFile("snapshots/test_init.js");
+// Code caches for the init scripts. Generated with `zig build gen-snapshot`. Not tracked by git.
+const api_snapshot: ?[]const u8 = if (build_options.has_api_snapshot) @embedFile("snapshots/api_snapshot.bin") else null;
 
 // Keep a global rt for debugging and prototyping.
 pub var global: *RuntimeContext = undefined;
@@ -70,10 +75,15 @@ pub const RuntimeContext = struct {
     transform_class: v8.Persistent(v8.FunctionTemplate),
     sound_class: v8.Persistent(v8.ObjectTemplate),
     random_class: v8.Persistent(v8.ObjectTemplate),
+    render_target_class: v8.Persistent(v8.ObjectTemplate),
     handle_class: v8.Persistent(v8.ObjectTemplate),
     rt_ctx_tmpl: v8.Persistent(v8.ObjectTemplate),
     default_obj_t: v8.Persistent(v8.ObjectTemplate),
 
+    /// Interned property keys and struct templates for native to js conversions.
+    /// Heap allocated since conversions only have a const view of the runtime.
+    js_cache: *gen.JsCache,
+
     /// Collection of mappings from id to resource handles.
     /// Resources of similar type are linked together.
     /// Resources can be deinited by js but the resource id slot won't be freed until a js finalizer callback.
@@ -116,6 +126,10 @@ pub const RuntimeContext = struct {
     // TODO: Rename to is_test_runner
     is_test_env: bool,
 
+    // Whether to run the api init scripts after creating the context.
+    // Disabled when generating a snapshot which runs them itself.
+    run_init_scripts: bool,
+
     // Test runner.
     num_tests: u32, // Includes sync and async tests.
     num_tests_passed: u32,
@@ -169,6 +183,9 @@ pub const RuntimeContext = struct {
 
     modules: std.AutoHashMap(u32, ModuleInfo),
 
+    // Persists V8 code caches for user modules across runs.
+    code_cache: ModuleCodeCache,
+
     // Holds the result of running the main script.
     run_main_script_res: ?RunModuleScriptResult,
 
@@ -201,7 +218,9 @@ pub const RuntimeContext = struct {
             .rt_ctx_tmpl = undefined,
             .sound_class = undefined,
             .random_class = undefined,
+            .render_target_class = undefined,
             .default_obj_t = undefined,
+            .js_cache = undefined,
             .resources = ds.CompactManySinglyLinkedList(ResourceListId, ResourceId, ResourceHandle).init(alloc),
             .weak_handles = ds.PooledHandleList(u32, WeakHandle).init(alloc),
             .generic_resource_list = undefined,
@@ -225,6 +244,7 @@ pub const RuntimeContext = struct {
             .js_true = undefined,
 
             .is_test_env = config.is_test_runner,
+            .run_init_scripts = config.run_init_scripts,
             .num_tests = 0,
             .num_tests_passed = 0,
             .num_async_tests = 0,
@@ -254,6 +274,8 @@ pub const RuntimeContext = struct {
             .hscope = undefined,
 
             .modules = std.AutoHashMap(u32, ModuleInfo).init(alloc),
+            .code_cache = if (env.enable_code_cache and !builtin.is_test) ModuleCodeCache.init(alloc, v8.getVersion())
+                else ModuleCodeCache.initDisabled(alloc, v8.getVersion()),
             .run_main_script_res = null,
             .main_script_done = false,
             .get_native_val_err = undefined,
@@ -261,6 +283,9 @@ pub const RuntimeContext = struct {
         };
         self.main_wakeup.reset();
 
+        self.js_cache = alloc.create(gen.JsCache) catch unreachable;
+        self.js_cache.* = gen.JsCache.init(alloc);
+
         self.initUv();
 
         self.work_queue = WorkQueue.init(alloc, self.uv_loop, &self.main_wakeup);
@@ -335,18 +360,52 @@ pub const RuntimeContext = struct {
             _ = self.global.inner.setValue(ctx, iso.initStringUtf8("user"), json_val);
         }
 
-        // Run api_init.js
-        self.runScript("api_init.js", api_init) catch unreachable;
+        if (!self.run_init_scripts) {
+            return;
+        }
 
-        // Run gen_api.js
-        self.runScript("gen_api.js", gen_api_init) catch unreachable;
+        var mb_snapshot: ?snapshot.Snapshot = null;
+        if (api_snapshot) |blob| {
+            if (snapshot.Snapshot.parse(self.alloc, blob)) |snapshot_| {
+                if (std.mem.eql(u8, snapshot_.v8_version, v8.getVersion())) {
+                    mb_snapshot = snapshot_;
+                } else {
+                    log.debug("Skipping snapshot made with v8 {s}", .{snapshot_.v8_version});
+                    snapshot_.deinit(self.alloc);
+                }
+            } else |err| {
+                log.debug("Invalid snapshot: {}", .{err});
+            }
+        }
+        defer if (mb_snapshot) |snapshot_| snapshot_.deinit(self.alloc);
 
+        for (self.getInitScripts()) |script| {
+            const cache = if (mb_snapshot) |snapshot_| snapshot_.getCodeCache(script.name, script.src) else null;
+            self.runScriptWithCache(script.name, script.src, cache) catch unreachable;
+        }
+    }
+
+    /// Init scripts in the order they run. api_init.js, then gen_api.js and test_init.js if the test api is included.
+    fn getInitScripts(self: Self) []const snapshot.Script {
+        const scripts = &[_]snapshot.Script{
+            .{ .name = "api_init.js", .src = api_init },
+            .{ .name = "gen_api.js", .src = gen_api_init },
+            .{ .name = "test_init.js", .src = test_init },
+        };
         if (self.is_test_env or builtin.is_test or self.env.include_test_api) {
-            // Run test_init.js
-            self.runScript("test_init.js", test_init) catch unreachable;
+            return scripts;
+        } else {
+            return scripts[0..2];
         }
     }
 
+    /// Runs the init scripts and writes their code caches to path.
+    /// Runtime should be inited with run_init_scripts = false.
+    pub fn genSnapshot(self: *Self, path: []const u8) !void {
+        std.debug.assert(!self.run_init_scripts);
+        try snapshot.generate(self.alloc, self.isolate, self.getContext(), path, self.getInitScripts());
+    }
+
     fn initUv(self: *Self) void {
         // Ensure we're using the right headers and the linked uv has patches applied.
         std.debug.assert(uv.uv_loop_size() == @sizeOf(uv.uv_loop_t));
@@ -459,6 +518,7 @@ pub const RuntimeContext = struct {
             }
             self.modules.deinit();
         }
+        self.code_cache.deinit();
 
         self.timer.deinit();
 
@@ -474,7 +534,10 @@ pub const RuntimeContext = struct {
         self.rt_ctx_tmpl.deinit();
         self.sound_class.deinit();
         self.random_class.deinit();
+        self.render_target_class.deinit();
         self.default_obj_t.deinit();
+        self.js_cache.deinit();
+        self.alloc.destroy(self.js_cache);
         self.global.deinit();
 
         if (self.run_main_script_res) |*res| {
@@ -507,11 +570,11 @@ pub const RuntimeContext = struct {
 
     fn runModuleScriptFile(self: *Self, abs_path: []const u8) !RunModuleScriptResult {
         if (self.env.main_script_override) |src_override| {
-            return self.runModuleScript(abs_path, self.env.main_script_origin orelse abs_path, src_override);
+            return self.runModuleScript(abs_path, self.env.main_script_origin orelse abs_path, src_override, false);
         } else {
             const src = try std.fs.cwd().readFileAlloc(self.alloc, abs_path, 1e9);
             defer self.alloc.free(src);
-            return self.runModuleScript(abs_path, abs_path, src);
+            return self.runModuleScript(abs_path, abs_path, src, true);
         }
     }
 
@@ -527,28 +590,19 @@ pub const RuntimeContext = struct {
     /// origin_str is an identifier for this script and is what is displayed in stack traces.
     /// Normally it is set to the abs_path but somtimes it can be different (eg. for in memory scripts for tests)
     /// Even though the src is provided, abs_path is still needed to set up import path resolving.
+    /// cacheable indicates the src is the content of the file at abs_path and can use the persistent code cache.
     /// Returns a result with a success flag.
     /// If a js exception was thrown, the stack trace is printed to stderr and also attached to the result.
-    fn runModuleScript(self: *Self, abs_path: []const u8, origin_str: []const u8, src: []const u8) !RunModuleScriptResult {
+    fn runModuleScript(self: *Self, abs_path: []const u8, origin_str: []const u8, src: []const u8, cacheable: bool) !RunModuleScriptResult {
         const iso = self.isolate;
 
         const js_origin_str = iso.initStringUtf8(origin_str);
-        const js_src = iso.initStringUtf8(src);
 
         var try_catch: v8.TryCatch = undefined;
         try_catch.init(iso);
         defer try_catch.deinit();
 
-        var origin = v8.ScriptOrigin.init(iso, js_origin_str.toValue(), 
-            0, 0, false, -1, null, false, false, true, null,
-        );
-
-        var mod_src: v8.ScriptCompilerSource = undefined;
-        // TODO: Look into CachedData.
-        mod_src.init(js_src, origin, null);
-        defer mod_src.deinit();
-
-        const mod = v8.ScriptCompiler.compileModule(self.isolate, &mod_src, .kNoCompileOptions, .kNoCacheNoReason) catch {
+        const mod = self.compileModule(abs_path, js_origin_str, src, cacheable) catch {
             const trace_str = v8x.allocPrintTryCatchStackTrace(self.alloc, self.isolate, self.getContext(), try_catch).?;
             self.env.errorFmt("{s}", .{trace_str});
             return RunModuleScriptResult{
@@ -560,11 +614,6 @@ pub const RuntimeContext = struct {
         };
         std.debug.assert(mod.getStatus() == .kUninstantiated);
 
-        const mod_info = ModuleInfo{
-            .dir = self.alloc.dupe(u8, std.fs.path.dirname(abs_path).?) catch unreachable,
-        };
-        self.modules.put(mod.getScriptId(), mod_info) catch unreachable;
-
         // const reqs = mod.getModuleRequests();
         // log.debug("reqs: {}", .{ reqs.length() });
         // const req = reqs.get(self.getContext(), 0).castTo(v8.ModuleRequest);
@@ -585,10 +634,6 @@ pub const RuntimeContext = struct {
                 const js_spec = v8.String{ .handle = spec_.? };
                 const iso_ = ctx.getIsolate();
 
-                var origin_ = v8.ScriptOrigin.init(iso_, js_spec.toValue(), 
-                    0, 0, false, -1, null, false, false, true, null,
-                );
-
                 const spec_str = v8x.allocStringAsUtf8(rt.alloc, iso_, js_spec);
                 defer rt.alloc.free(spec_str);
 
@@ -615,26 +660,14 @@ pub const RuntimeContext = struct {
                 };
                 defer rt.alloc.free(src_);
 
-                const js_src_ = iso_.initStringUtf8(src_);
-
-                var mod_src_: v8.ScriptCompilerSource = undefined;
-                mod_src_.init(js_src_, origin_, null);
-                defer mod_src_.deinit();
-
                 var try_catch_: v8.TryCatch = undefined;
                 try_catch_.init(iso_);
                 defer try_catch_.deinit();
 
-                const mod_ = v8.ScriptCompiler.compileModule(iso_, &mod_src_, .kNoCompileOptions, .kNoCacheNoReason) catch {
+                const mod_ = rt.compileModule(abs_path_, js_spec, src_, true) catch {
                     _ = try_catch_.rethrow();
                     return null;
                 };
-
-                const mod_info_ = ModuleInfo{
-                    .dir = rt.alloc.dupe(u8, std.fs.path.dirname(abs_path_).?) catch unreachable,
-                };
-                rt.modules.put(mod_.getScriptId(), mod_info_) catch unreachable;
-
                 return mod_.handle;
             }
         };
@@ -728,6 +761,77 @@ pub const RuntimeContext = struct {
         }
     }
 
+    /// Compiles a module and registers it's ModuleInfo for import resolving.
+    /// If cacheable, the persistent code cache is consumed when there is a valid entry for the source
+    /// and the module is marked to have it's cache refreshed once it has run. See updateModuleCodeCaches.
+    fn compileModule(self: *Self, abs_path: []const u8, js_origin: v8.String, src: []const u8, cacheable: bool) !v8.Module {
+        const iso = self.isolate;
+
+        const origin = v8.ScriptOrigin.init(iso, js_origin.toValue(), 
+            0, 0, false, -1, null, false, false, true, null,
+        );
+        const js_src = iso.initStringUtf8(src);
+
+        const use_cache = cacheable and self.code_cache.isEnabled();
+        const src_hash = if (use_cache) code_cache.hashSource(src) else 0;
+        const cache_data = if (use_cache) self.code_cache.load(abs_path, src_hash) else null;
+        defer if (cache_data) |data| self.alloc.free(data);
+
+        var mod_src: v8.ScriptCompilerSource = undefined;
+        if (cache_data) |data| {
+            // V8 copies nothing here, cache_data must outlive the compile.
+            mod_src.init(js_src, origin, v8.ScriptCompilerCachedData.init(data));
+        } else {
+            mod_src.init(js_src, origin, null);
+        }
+        defer mod_src.deinit();
+
+        const options: v8.ScriptCompiler.CompileOptions = if (cache_data != null) .kConsumeCodeCache else .kNoCompileOptions;
+        const mod = try v8.ScriptCompiler.compileModule(iso, &mod_src, options, .kNoCacheNoReason);
+
+        var cache_rejected = false;
+        if (cache_data != null) {
+            if (mod_src.getCachedData()) |data| {
+                cache_rejected = data.isRejected();
+            }
+        }
+
+        const mod_info = ModuleInfo{
+            .dir = self.alloc.dupe(u8, std.fs.path.dirname(abs_path).?) catch unreachable,
+            .abs_path = if (use_cache) self.alloc.dupe(u8, abs_path) catch unreachable else null,
+            .src_hash = src_hash,
+            .mod = if (use_cache) iso.initPersistent(v8.Module, mod) else null,
+            .needs_cache_update = use_cache and (cache_data == null or cache_rejected),
+        };
+        self.modules.put(mod.getScriptId(), mod_info) catch unreachable;
+        return mod;
+    }
+
+    /// Writes fresh code caches for modules that were compiled without a valid cache entry.
+    /// This is done after the main script has finished evaluating so that functions
+    /// compiled lazily during the run are included in the cache.
+    fn updateModuleCodeCaches(self: *Self) void {
+        if (!self.code_cache.isEnabled()) {
+            return;
+        }
+        var iter = self.modules.valueIterator();
+        while (iter.next()) |info| {
+            if (!info.needs_cache_update) {
+                continue;
+            }
+            info.needs_cache_update = false;
+            const mod = info.mod.?.inner;
+            if (mod.getStatus() != .kEvaluated) {
+                continue;
+            }
+            const data = v8x.allocModuleCodeCache(self.alloc, mod) orelse continue;
+            defer self.alloc.free(data);
+            self.code_cache.store(info.abs_path.?, info.src_hash, data) catch |err| {
+                log.debug("Failed to store code cache for {s}: {}", .{info.abs_path.?, err});
+            };
+        }
+    }
+
     fn runScriptFile(self: *Self, abs_path: []const u8) !void {
         const src = try std.fs.cwd().readFileAlloc(self.alloc, abs_path, 1e9);
         defer self.alloc.free(src);
@@ -743,6 +847,17 @@ pub const RuntimeContext = struct {
         }
     }
 
+    fn runScriptWithCache(self: *Self, origin: []const u8, src: []const u8, code_cache: ?[]const u8) !void {
+        const js_origin = v8.String.initUtf8(self.isolate, origin);
+        var res: v8x.ExecuteResult = undefined;
+        v8x.executeStringWithCache(self.alloc, self.isolate, self.getContext(), src, js_origin, code_cache, &res);
+        defer res.deinit();
+        if (!res.success) {
+            self.env.errorFmt("{s}", .{res.err.?});
+            return error.RunScriptError;
+        }
+    }
+
     pub fn runScriptGetResult(self: *Self, origin: []const u8, src: []const u8) v8x.ExecuteResult {
         const js_origin = v8.String.initUtf8(self.isolate, origin);
         var res: v8x.ExecuteResult = undefined;
@@ -772,6 +887,7 @@ pub const RuntimeContext = struct {
             },
             .Success => {
                 self.finishMainScript();
+                self.updateModuleCodeCaches();
                 if (self.dev_mode) {
                     self.dev_ctx.enterJsSuccessState();
                 }
@@ -1043,6 +1159,11 @@ pub const RuntimeContext = struct {
         return self.resources.findInList(self.window_resource_list, sdl_win_id, S.pred) orelse return null;
     }
 
+    /// Returns the interned js string for a property key.
+    pub inline fn getJsKey(self: Self, comptime key: []const u8) v8.String {
+        return self.js_cache.getKey(self.isolate, key);
+    }
+
     pub fn getJsValue(self: Self, native_val: anytype) v8.Value {
         return .{
             .handle = self.getJsValuePtr(native_val),
@@ -1068,41 +1189,38 @@ pub const RuntimeContext = struct {
             stdx.http.Response => {
                 const headers_buf = self.alloc.alloc(v8.Value, native_val.headers.len) catch unreachable;
                 defer self.alloc.free(headers_buf);
+                const header_t = self.js_cache.getStructTemplate(iso, HttpHeader);
                 for (native_val.headers) |header, i| {
-                    const js_header = self.default_obj_t.inner.initInstance(ctx);
-                    _ = js_header.setValue(ctx, iso.initStringUtf8("key"), iso.initStringUtf8(native_val.header[header.key.start..header.key.end]));
-                    _ = js_header.setValue(ctx, iso.initStringUtf8("value"), iso.initStringUtf8(native_val.header[header.value.start..header.value.end]));
+                    const js_header = header_t.initInstance(ctx);
+                    _ = js_header.setValue(ctx, self.getJsKey("key"), iso.initStringUtf8(native_val.header[header.key.start..header.key.end]));
+                    _ = js_header.setValue(ctx, self.getJsKey("value"), iso.initStringUtf8(native_val.header[header.value.start..header.value.end]));
                     headers_buf[i] = .{ .handle = js_header.handle };
                 }
 
                 const new = self.http_response_class.inner.getFunction(ctx).initInstance(ctx, &.{}).?;
-                _ = new.setValue(ctx, iso.initStringUtf8("status"), iso.initIntegerU32(native_val.status_code));
-                _ = new.setValue(ctx, iso.initStringUtf8("headers"), iso.initArrayElements(headers_buf));
-                _ = new.setValue(ctx, iso.initStringUtf8("body"), iso.initStringUtf8(native_val.body));
+                _ = new.setValue(ctx, self.getJsKey("status"), iso.initIntegerU32(native_val.status_code));
+                _ = new.setValue(ctx, self.getJsKey("headers"), iso.initArrayElements(headers_buf));
+                _ = new.setValue(ctx, self.getJsKey("body"), iso.initStringUtf8(native_val.body));
                 return new.handle;
             },
             graphics.Image => {
                 const new = self.image_class.inner.getFunction(ctx).initInstance(ctx, &.{}).?;
                 new.setInternalField(0, iso.initIntegerU32(native_val.id));
-                _ = new.setValue(ctx, iso.initStringUtf8("width"), iso.initIntegerU32(@intCast(u32, native_val.width)));
-                _ = new.setValue(ctx, iso.initStringUtf8("height"), iso.initIntegerU32(@intCast(u32, native_val.height)));
+                _ = new.setValue(ctx, self.getJsKey("width"), iso.initIntegerU32(@intCast(u32, native_val.width)));
+                _ = new.setValue(ctx, self.getJsKey("height"), iso.initIntegerU32(@intCast(u32, native_val.height)));
                 return new.handle;
             },
             cs_graphics.Color => {
                 const new = self.color_class.inner.getFunction(ctx).initInstance(ctx, &.{}).?;
-                _ = new.setValue(ctx, iso.initStringUtf8("r"), iso.initIntegerU32(native_val.r));
-                _ = new.setValue(ctx, iso.initStringUtf8("g"), iso.initIntegerU32(native_val.g));
-                _ = new.setValue(ctx, iso.initStringUtf8("b"), iso.initIntegerU32(native_val.b));
-                _ = new.setValue(ctx, iso.initStringUtf8("a"), iso.initIntegerU32(native_val.a));
+                _ = new.setValue(ctx, self.getJsKey("r"), iso.initIntegerU32(native_val.r));
+                _ = new.setValue(ctx, self.getJsKey("g"), iso.initIntegerU32(native_val.g));
+                _ = new.setValue(ctx, self.getJsKey("b"), iso.initIntegerU32(native_val.b));
+                _ = new.setValue(ctx, self.getJsKey("a"), iso.initIntegerU32(native_val.a));
                 return new.handle;
             },
             cs_graphics.Transform => {
                 const new = self.transform_class.inner.getFunction(ctx).initInstance(ctx, &.{}).?;
-                var buf: [16]v8.Value = undefined;
-                for (native_val.mat) |it, i| {
-                    buf[i] = iso.initNumber(it).toValue();
-                }
-                _ = new.setValue(ctx, iso.initStringUtf8("mat"), iso.initArrayElements(&buf));
+                _ = new.setValue(ctx, self.getJsKey("mat"), self.initFloat32Array(&native_val.mat));
                 return new.handle;
             },
             Uint8Array => {
@@ -1118,6 +1236,18 @@ pub const RuntimeContext = struct {
                 const js_uint8arr = v8.Uint8Array.init(array_buffer, 0, native_val.buf.len);
                 return js_uint8arr.handle;
             },
+            OwnedUint8Array => {
+                // Hand the native buffer over to v8 instead of copying it into a new backing store.
+                const store = if (native_val.buf.len > 0)
+                    v8.BackingStore.initWithData(@intToPtr(*anyopaque, @ptrToInt(native_val.buf.ptr)), native_val.buf.len, freeOwnedUint8ArrayData, null)
+                else v8.BackingStore.init(iso, 0);
+                var shared = store.toSharedPtr();
+                defer v8.BackingStore.sharedPtrReset(&shared);
+
+                const array_buffer = v8.ArrayBuffer.initWithBackingStore(iso, &shared);
+                const js_uint8arr = v8.Uint8Array.init(array_buffer, 0, native_val.buf.len);
+                return js_uint8arr.handle;
+            },
             v8.Value,
             v8.Boolean,
             v8.Object,
@@ -1130,10 +1260,11 @@ pub const RuntimeContext = struct {
             []const api.cs_files.FileEntry => {
                 const buf = self.alloc.alloc(v8.Value, native_val.len) catch unreachable;
                 defer self.alloc.free(buf);
+                const entry_t = self.js_cache.getStructTemplate(iso, api.cs_files.FileEntry);
                 for (native_val) |it, i| {
-                    const obj = self.default_obj_t.inner.initInstance(ctx);
-                    _ = obj.setValue(ctx, iso.initStringUtf8("name"), iso.initStringUtf8(it.name));
-                    _ = obj.setValue(ctx, iso.initStringUtf8("kind"), iso.initStringUtf8(it.kind));
+                    const obj = entry_t.initInstance(ctx);
+                    _ = obj.setValue(ctx, self.getJsKey("name"), iso.initStringUtf8(it.name));
+                    _ = obj.setValue(ctx, self.getJsKey("kind"), iso.initStringUtf8(it.kind));
                     buf[i] = obj.toValue();
                 }
                 return iso.initArrayElements(buf).handle;
@@ -1178,11 +1309,11 @@ pub const RuntimeContext = struct {
                         return self.getJsValuePtr(native_val.inner);
                     } else {
                         // Generic struct to js object.
-                        // TODO: Is it more performant to initialize from an object template if we know the fields beforehand?
-                        const obj = iso.initObject();
+                        // Instances from the struct's template share the same shape.
+                        const obj = self.js_cache.getStructTemplate(iso, Type).initInstance(ctx);
                         const Fields = std.meta.fields(Type);
                         inline for (Fields) |Field| {
-                            _ = obj.setValue(ctx, iso.initStringUtf8(Field.name), self.getJsValue(@field(native_val, Field.name)));
+                            _ = obj.setValue(ctx, self.getJsKey(Field.name), self.getJsValue(@field(native_val, Field.name)));
                         }
                         return obj.handle;
                     }
@@ -1200,6 +1331,21 @@ pub const RuntimeContext = struct {
         }
     }
 
+    /// Creates a Float32Array with a copy of the values.
+    pub fn initFloat32Array(self: Self, vals: []const f32) v8.Float32Array {
+        const iso = self.isolate;
+        const store = v8.BackingStore.init(iso, vals.len * @sizeOf(f32));
+        if (store.getData()) |ptr| {
+            const buf = stdx.mem.ptrCastAlign([*]f32, ptr);
+            std.mem.copy(f32, buf[0..vals.len], vals);
+        }
+        var shared = store.toSharedPtr();
+        defer v8.BackingStore.sharedPtrReset(&shared);
+
+        const array_buffer = v8.ArrayBuffer.initWithBackingStore(iso, &shared);
+        return v8.Float32Array.init(array_buffer, 0, vals.len);
+    }
+
     /// functions with error returns have problems being inside inlines so a quick hack is to return an optional
     /// and set a temporary error var.
     pub inline fn getNativeValue2(self: *Self, comptime T: type, val: anytype) ?T {
@@ -1218,7 +1364,21 @@ pub const RuntimeContext = struct {
         const ctx = self.getContext();
         switch (T) {
             []const f32 => {
-                if (val.isArray()) {
+                if (val.isFloat32Array()) {
+                    // Typed arrays are copied in one go instead of converting each element.
+                    const view = val.castTo(v8.ArrayBufferView);
+                    const len = view.getByteLength() / @sizeOf(f32);
+                    const start = self.cb_f32_buf.items.len;
+                    self.cb_f32_buf.resize(start + len) catch unreachable;
+                    if (len > 0) {
+                        var shared_store = view.getBuffer().getBackingStore();
+                        defer v8.BackingStore.sharedPtrReset(&shared_store);
+                        const store = v8.BackingStore.sharedPtrGet(&shared_store);
+                        const bytes = @ptrCast([*]const u8, store.getData().?) + view.getByteOffset();
+                        std.mem.copy(u8, std.mem.sliceAsBytes(self.cb_f32_buf.items[start..]), bytes[0..len * @sizeOf(f32)]);
+                    }
+                    return self.cb_f32_buf.items[start..];
+                } else if (val.isArray()) {
                     const len = val.castTo(v8.Array).length();
                     var i: u32 = 0;
                     const obj = val.castTo(v8.Object);
@@ -1263,13 +1423,15 @@ pub const RuntimeContext = struct {
             },
             Uint8Array => {
                 if (val.isUint8Array()) {
-                    var shared_store = val.castTo(v8.ArrayBufferView).getBuffer().getBackingStore();
-                    defer v8.BackingStore.sharedPtrReset(&shared_store);
-
-                    const store = v8.BackingStore.sharedPtrGet(&shared_store);
-                    const len = store.getByteLength();
+                    // Borrows the backing store memory. Only the range of the view is returned so subarrays don't leak the rest of the buffer.
+                    const view = val.castTo(v8.ArrayBufferView);
+                    const len = view.getByteLength();
                     if (len > 0) {
-                        const buf = @ptrCast([*]u8, store.getData().?);
+                        var shared_store = view.getBuffer().getBackingStore();
+                        defer v8.BackingStore.sharedPtrReset(&shared_store);
+
+                        const store = v8.BackingStore.sharedPtrGet(&shared_store);
+                        const buf = @ptrCast([*]u8, store.getData().?) + view.getByteOffset();
                         return Uint8Array{ .buf = buf[0..len] };
                     } else return Uint8Array{ .buf = "" };
                 } else return error.CantConvert;
@@ -1334,7 +1496,7 @@ pub const RuntimeContext = struct {
                             const Fields = std.meta.fields(T);
                             inline for (Fields) |Field| {
                                 if (@typeInfo(Field.field_type) == .Optional) {
-                                    const child_val = obj.getValue(ctx, self.isolate.initStringUtf8(Field.name)) catch return error.CantConvert;
+                                    const child_val = obj.getValue(ctx, self.getJsKey(Field.name)) catch return error.CantConvert;
                                     const Child = comptime @typeInfo(Field.field_type).Optional.child;
                                     if (child_val.isNullOrUndefined()) {
                                         @field(native_val, Field.name) = null;
@@ -1342,7 +1504,7 @@ pub const RuntimeContext = struct {
                                         @field(native_val, Field.name) = self.getNativeValue2(Child, child_val);
                                     }
                                 } else {
-                                    const js_val = obj.getValue(ctx, self.isolate.initStringUtf8(Field.name)) catch return error.CantConvert;
+                                    const js_val = obj.getValue(ctx, self.getJsKey(Field.name)) catch return error.CantConvert;
                                     if (self.getNativeValue2(Field.field_type, js_val)) |child_value| {
                                         @field(native_val, Field.name) = child_value;
                                     }
@@ -1354,7 +1516,19 @@ pub const RuntimeContext = struct {
                 } else if (@typeInfo(T) == .Array) {
                     const ArrayInfo = @typeInfo(T).Array;
                     var native_val: [ArrayInfo.len]ArrayInfo.child = undefined;
-                    if (val.isArray()) {
+                    if (ArrayInfo.child == f32 and val.isFloat32Array()) {
+                        // Vectors and matrices are returned to js as Float32Arrays, read them back directly from the backing store.
+                        const view = val.castTo(v8.ArrayBufferView);
+                        if (view.getByteLength() < ArrayInfo.len * @sizeOf(f32)) {
+                            return error.CantConvert;
+                        }
+                        var shared_store = view.getBuffer().getBackingStore();
+                        defer v8.BackingStore.sharedPtrReset(&shared_store);
+                        const store = v8.BackingStore.sharedPtrGet(&shared_store);
+                        const bytes = @ptrCast([*]const u8, store.getData().?) + view.getByteOffset();
+                        std.mem.copy(u8, std.mem.sliceAsBytes(native_val[0..]), bytes[0..ArrayInfo.len * @sizeOf(f32)]);
+                        return native_val;
+                    } else if (val.isArray()) {
                         const len = val.castTo(v8.Array).length();
                         if (len < ArrayInfo.len) {
                             return error.CantConvert;
@@ -1458,7 +1632,7 @@ pub const RuntimeContext = struct {
     }
 
     pub fn evalModuleScript(self: *Self, js: []const u8) !RunModuleScriptResult {
-        return self.runModuleScript("/eval", "eval", js);
+        return self.runModuleScript("/eval", "eval", js, false);
     }
 
     pub fn attachPromiseHandlers(
@@ -1663,6 +1837,19 @@ pub const Uint8Array =  struct {
     }
 };
 
+/// A buffer allocated from the runtime allocator that is handed over to v8 without copying.
+/// v8 frees the memory once the ArrayBuffer is garbage collected so the native side must not free or keep it.
+pub const OwnedUint8Array = struct {
+    buf: []const u8,
+};
+
+/// BackingStore deleter for OwnedUint8Array.
+/// This can be invoked from a v8 background thread so the runtime allocator needs to be thread safe.
+fn freeOwnedUint8ArrayData(data: ?*anyopaque, len: usize, _: ?*anyopaque) callconv(.C) void {
+    const ptr = @ptrCast([*]const u8, data.?);
+    galloc.free(ptr[0..len]);
+}
+
 var galloc: std.mem.Allocator = undefined;
 var uncaught_promise_errors: std.AutoHashMap(u32, []const u8) = undefined;
 
@@ -2440,6 +2627,7 @@ fn runIsolatedTests(rt: *RuntimeContext) void {
 pub const RuntimeConfig = struct {
     is_test_runner: bool = false,
     is_dev_mode: bool = false,
+    run_init_scripts: bool = true,
 };
 
 /// Initialize libs, deps, globals, and the runtime assumed to be global.
@@ -2555,6 +2743,11 @@ const WeakHandle = struct {
                 const ptr = stdx.mem.ptrCastAlign(*Random, self.ptr);
                 rt.alloc.destroy(ptr);
             },
+            .RenderTarget => {
+                const ptr = stdx.mem.ptrCastAlign(*graphics.cpu.Graphics, self.ptr);
+                ptr.deinit();
+                rt.alloc.destroy(ptr);
+            },
             .Null => {},
         }
     }
@@ -2564,6 +2757,7 @@ pub const WeakHandleTag = enum {
     DrawCommandList,
     Sound,
     Random,
+    RenderTarget,
     Null,
 };
 
@@ -2572,6 +2766,7 @@ pub fn WeakHandlePtr(comptime Tag: WeakHandleTag) type {
         .DrawCommandList => *graphics.DrawCommandList,
         .Sound => *audio.Sound,
         .Random => *Random,
+        .RenderTarget => *graphics.cpu.Graphics,
         else => unreachable,
     };
 }
@@ -2787,13 +2982,33 @@ test "F64SafeUint, F64SafeInt" {
     try t.eq(@floatToInt(F64SafeInt, double), int);
 }
 
+/// Shape of the header objects in a js http Response.
+const HttpHeader = struct {
+    key: []const u8,
+    value: []const u8,
+};
+
 const ModuleInfo = struct {
     const Self = @This();
 
     dir: []const u8,
 
-    pub fn deinit(self: Self, alloc: std.mem.Allocator) void {
+    // Only set for modules that use the persistent code cache.
+    abs_path: ?[]const u8,
+    src_hash: u64,
+    mod: ?v8.Persistent(v8.Module),
+
+    // Whether a new code cache should be written after the module has run.
+    needs_cache_update: bool,
+
+    pub fn deinit(self: *Self, alloc: std.mem.Allocator) void {
         alloc.free(self.dir);
+        if (self.abs_path) |path| {
+            alloc.free(path);
+        }
+        if (self.mod) |*mod| {
+            mod.deinit();
+        }
     }
 };
 
@@ -2811,6 +3026,7 @@ pub fn createWeakHandle(rt: *RuntimeContext, comptime Tag: WeakHandleTag, ptr: W
         .DrawCommandList => rt.handle_class,
         .Sound => rt.sound_class,
         .Random => rt.random_class,
+        .RenderTarget => rt.render_target_class,
         else => unreachable,
     };
     const new = template.inner.initInstance(ctx);
@@ -3078,6 +3294,7 @@ fn handleMainModuleScriptError(rt: *RuntimeContext, val: v8.Value) void {
 
 fn handleMainModuleScriptSuccess(rt: *RuntimeContext) void {
     rt.main_script_done = true;
+    rt.updateModuleCodeCaches();
     if (rt.dev_mode) {
         rt.dev_ctx.enterJsSuccessState();
     }
@@ -0,0 +1,183 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+const v8 = @import("v8");
+
+const v8x = @import("v8x.zig");
+const log = stdx.log.scoped(.snapshot);
+
+/// Startup snapshot for the embedded init scripts (api_init.js, gen_api.js, test_init.js).
+///
+/// A full V8 context snapshot would need every native callback bound in js_env.zig to be listed
+/// in a static external references table before the isolate is created. Since the bindings are
+/// generated at comptime per call site, the snapshot instead stores V8 code caches for the init scripts.
+/// Booting from it skips parsing and compiling the api js which is the bulk of isolate setup.
+///
+/// Layout (little endian):
+///   magic: [4]u8 "CSS1"
+///   v8_version_len: u32, v8_version: [v8_version_len]u8
+///   num_entries: u32
+///   entries: { name_len: u32, name, src_hash: u64, data_len: u32, data }
+pub const Magic = "CSS1";
+
+pub const Entry = struct {
+    name: []const u8,
+    /// Hash of the script source. A mismatch means the embedded script changed since the snapshot was made.
+    src_hash: u64,
+    data: []const u8,
+};
+
+pub const Snapshot = struct {
+    const Self = @This();
+
+    v8_version: []const u8,
+    entries: []const Entry,
+
+    /// Parses a snapshot blob. Returned slices point into buf.
+    pub fn parse(alloc: std.mem.Allocator, buf: []const u8) !Self {
+        var stream = std.io.fixedBufferStream(buf);
+        const reader = stream.reader();
+
+        var magic: [4]u8 = undefined;
+        try reader.readNoEof(&magic);
+        if (!std.mem.eql(u8, &magic, Magic)) {
+            return error.InvalidFormat;
+        }
+        const v8_version = try readSlice(&stream);
+        const num_entries = try reader.readIntLittle(u32);
+        const entries = try alloc.alloc(Entry, num_entries);
+        errdefer alloc.free(entries);
+        for (entries) |*entry| {
+            entry.name = try readSlice(&stream);
+            entry.src_hash = try reader.readIntLittle(u64);
+            entry.data = try readSlice(&stream);
+        }
+        return Self{
+            .v8_version = v8_version,
+            .entries = entries,
+        };
+    }
+
+    pub fn deinit(self: Self, alloc: std.mem.Allocator) void {
+        alloc.free(self.entries);
+    }
+
+    /// Returns the cached data for a script only if it was created from the same source.
+    pub fn getCodeCache(self: Self, name: []const u8, src: []const u8) ?[]const u8 {
+        const hash = hashSource(src);
+        for (self.entries) |entry| {
+            if (std.mem.eql(u8, entry.name, name)) {
+                if (entry.src_hash == hash) {
+                    return entry.data;
+                } else {
+                    return null;
+                }
+            }
+        }
+        return null;
+    }
+};
+
+fn readSlice(stream: *std.io.FixedBufferStream([]const u8)) ![]const u8 {
+    const len = try stream.reader().readIntLittle(u32);
+    if (stream.pos + len > stream.buffer.len) {
+        return error.EndOfStream;
+    }
+    defer stream.pos += len;
+    return stream.buffer[stream.pos..stream.pos + len];
+}
+
+pub fn hashSource(src: []const u8) u64 {
+    return std.hash.Wyhash.hash(0, src);
+}
+
+pub fn writeSnapshot(writer: anytype, v8_version: []const u8, entries: []const Entry) !void {
+    try writer.writeAll(Magic);
+    try writer.writeIntLittle(u32, @intCast(u32, v8_version.len));
+    try writer.writeAll(v8_version);
+    try writer.writeIntLittle(u32, @intCast(u32, entries.len));
+    for (entries) |entry| {
+        try writer.writeIntLittle(u32, @intCast(u32, entry.name.len));
+        try writer.writeAll(entry.name);
+        try writer.writeIntLittle(u64, entry.src_hash);
+        try writer.writeIntLittle(u32, @intCast(u32, entry.data.len));
+        try writer.writeAll(entry.data);
+    }
+}
+
+pub const Script = struct {
+    name: []const u8,
+    src: []const u8,
+};
+
+/// Compiles and runs the init scripts in order within the current context and writes their code caches to path.
+/// The caches are created after the scripts run so that lazily compiled functions that were hit during init are also included.
+/// The context must have the native bindings set up and must not have run the init scripts yet.
+pub fn generate(alloc: std.mem.Allocator, iso: v8.Isolate, ctx: v8.Context, path: []const u8, scripts: []const Script) !void {
+    var hscope: v8.HandleScope = undefined;
+    hscope.init(iso);
+    defer hscope.deinit();
+
+    var unbound = std.ArrayList(v8.UnboundScript).init(alloc);
+    defer unbound.deinit();
+
+    for (scripts) |script| {
+        var res: v8x.CompileResult = undefined;
+        v8x.compileScript(alloc, iso, ctx, script.src, iso.initStringUtf8(script.name), null, &res);
+        defer res.deinit();
+        if (!res.success) {
+            log.err("{s}", .{res.err.?});
+            return error.RunScriptError;
+        }
+        _ = res.script.?.bindToCurrentContext().run(ctx) catch {
+            log.err("Failed to run {s}", .{script.name});
+            return error.RunScriptError;
+        };
+        try unbound.append(res.script.?);
+    }
+
+    var entries = std.ArrayList(Entry).init(alloc);
+    defer {
+        for (entries.items) |entry| {
+            alloc.free(entry.data);
+        }
+        entries.deinit();
+    }
+    for (scripts) |script, i| {
+        const cache = v8x.allocCodeCache(alloc, unbound.items[i]) orelse return error.CreateCodeCache;
+        try entries.append(.{
+            .name = script.name,
+            .src_hash = hashSource(script.src),
+            .data = cache,
+        });
+    }
+
+    const file = try std.fs.cwd().createFile(path, .{ .truncate = true });
+    defer file.close();
+    var buf_writer = std.io.bufferedWriter(file.writer());
+    try writeSnapshot(buf_writer.writer(), v8.getVersion(), entries.items);
+    try buf_writer.flush();
+}
+
+test "Snapshot write and parse." {
+    var buf = std.ArrayList(u8).init(t.alloc);
+    defer buf.deinit();
+
+    const entries = &[_]Entry{
+        .{ .name = "api_init.js", .src_hash = hashSource("foo"), .data = "abc" },
+        .{ .name = "gen_api.js", .src_hash = hashSource("bar"), .data = "" },
+    };
+    try writeSnapshot(buf.writer(), "9.9.115.9", entries);
+
+    const snapshot = try Snapshot.parse(t.alloc, buf.items);
+    defer snapshot.deinit(t.alloc);
+    try t.eqStr(snapshot.v8_version, "9.9.115.9");
+    try t.eq(snapshot.entries.len, 2);
+    try t.eqStr(snapshot.getCodeCache("api_init.js", "foo").?, "abc");
+    try t.eqStr(snapshot.getCodeCache("gen_api.js", "bar").?, "");
+    try t.expect(snapshot.getCodeCache("api_init.js", "changed") == null);
+    try t.expect(snapshot.getCodeCache("test_init.js", "foo") == null);
+
+    try t.expectError(Snapshot.parse(t.alloc, "XXXX"), error.InvalidFormat);
+    try t.expectError(Snapshot.parse(t.alloc, buf.items[0..buf.items.len-2]), error.EndOfStream);
+}
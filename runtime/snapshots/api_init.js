@@ -105,6 +105,141 @@
         return resp
     }
 
+    // Records draw commands into a Float32Array so they can be submitted with one call to Graphics.executeDrawBatch.
+    // The encoding must stay in sync with cs_graphics.DrawOp in api_graphics.zig.
+    const DrawOp = cs.graphics.DrawOp
+    cs.graphics.DrawBatch = class {
+        constructor(capacity = 4096) {
+            this.buf = new Float32Array(capacity)
+            this.len = 0
+        }
+
+        reserve(n) {
+            if (this.len + n > this.buf.length) {
+                let cap = this.buf.length * 2
+                while (cap < this.len + n) {
+                    cap *= 2
+                }
+                const buf = new Float32Array(cap)
+                buf.set(this.buf.subarray(0, this.len))
+                this.buf = buf
+            }
+        }
+
+        push0(op) {
+            this.reserve(1)
+            this.buf[this.len++] = op
+        }
+
+        push1(op, a) {
+            this.reserve(2)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            this.len += 2
+        }
+
+        push2(op, a, b) {
+            this.reserve(3)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            buf[this.len + 2] = b
+            this.len += 3
+        }
+
+        push3(op, a, b, c) {
+            this.reserve(4)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            buf[this.len + 2] = b
+            buf[this.len + 3] = c
+            this.len += 4
+        }
+
+        push4(op, a, b, c, d) {
+            this.reserve(5)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            buf[this.len + 2] = b
+            buf[this.len + 3] = c
+            buf[this.len + 4] = d
+            this.len += 5
+        }
+
+        push5(op, a, b, c, d, e) {
+            this.reserve(6)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            buf[this.len + 2] = b
+            buf[this.len + 3] = c
+            buf[this.len + 4] = d
+            buf[this.len + 5] = e
+            this.len += 6
+        }
+
+        push6(op, a, b, c, d, e, f) {
+            this.reserve(7)
+            const buf = this.buf
+            buf[this.len] = op
+            buf[this.len + 1] = a
+            buf[this.len + 2] = b
+            buf[this.len + 3] = c
+            buf[this.len + 4] = d
+            buf[this.len + 5] = e
+            buf[this.len + 6] = f
+            this.len += 7
+        }
+
+        pushPts(op, pts) {
+            const numPts = pts.length >> 1
+            this.reserve(2 + numPts * 2)
+            this.buf[this.len] = op
+            this.buf[this.len + 1] = numPts
+            this.buf.set(numPts * 2 == pts.length ? pts : pts.slice(0, numPts * 2), this.len + 2)
+            this.len += 2 + numPts * 2
+        }
+
+        fillColor(color) { this.push4(DrawOp.fillColor, color.r, color.g, color.b, color.a) }
+        strokeColor(color) { this.push4(DrawOp.strokeColor, color.r, color.g, color.b, color.a) }
+        lineWidth(width) { this.push1(DrawOp.lineWidth, width) }
+        rect(x, y, width, height) { this.push4(DrawOp.rect, x, y, width, height) }
+        rectOutline(x, y, width, height) { this.push4(DrawOp.rectOutline, x, y, width, height) }
+        roundRect(x, y, width, height, radius) { this.push5(DrawOp.roundRect, x, y, width, height, radius) }
+        roundRectOutline(x, y, width, height, radius) { this.push5(DrawOp.roundRectOutline, x, y, width, height, radius) }
+        circle(x, y, radius) { this.push3(DrawOp.circle, x, y, radius) }
+        circleOutline(x, y, radius) { this.push3(DrawOp.circleOutline, x, y, radius) }
+        ellipse(x, y, hRadius, vRadius) { this.push4(DrawOp.ellipse, x, y, hRadius, vRadius) }
+        ellipseOutline(x, y, hRadius, vRadius) { this.push4(DrawOp.ellipseOutline, x, y, hRadius, vRadius) }
+        point(x, y) { this.push2(DrawOp.point, x, y) }
+        line(x1, y1, x2, y2) { this.push4(DrawOp.line, x1, y1, x2, y2) }
+        triangle(x1, y1, x2, y2, x3, y3) { this.push6(DrawOp.triangle, x1, y1, x2, y2, x3, y3) }
+        translate(x, y) { this.push2(DrawOp.translate, x, y) }
+        scale(x, y) { this.push2(DrawOp.scale, x, y) }
+        rotate(rad) { this.push1(DrawOp.rotate, rad) }
+        resetTransform() { this.push0(DrawOp.resetTransform) }
+        pushState() { this.push0(DrawOp.pushState) }
+        popState() { this.push0(DrawOp.popState) }
+        polygon(pts) { this.pushPts(DrawOp.polygon, pts) }
+        polygonOutline(pts) { this.pushPts(DrawOp.polygonOutline, pts) }
+        convexPolygon(pts) { this.pushPts(DrawOp.convexPolygon, pts) }
+
+        // Executes the recorded commands on a graphics context and clears the batch.
+        flush(g) {
+            if (this.len > 0) {
+                g.executeDrawBatch(this.buf.subarray(0, this.len))
+                this.len = 0
+            }
+        }
+
+        clear() {
+            this.len = 0
+        }
+    }
+
     cs.http.Response.prototype.getHeader = function(key) {
         return this.headers.get(key.toLowerCase())
     }
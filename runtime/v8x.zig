@@ -65,6 +65,113 @@ pub fn executeString(alloc: std.mem.Allocator, iso: v8.Isolate, ctx: v8.Context,
     };
 }
 
+pub const CompileResult = struct {
+    const Self = @This();
+
+    alloc: std.mem.Allocator,
+    script: ?v8.UnboundScript,
+    err: ?[]const u8,
+    success: bool,
+    // Whether V8 rejected the provided code cache. The script is still compiled from source in that case.
+    cache_rejected: bool,
+
+    pub fn deinit(self: Self) void {
+        if (self.err) |err| {
+            self.alloc.free(err);
+        }
+    }
+};
+
+/// Compiles a classic script into an unbound script. If code_cache is provided, it's consumed instead of parsing the full source.
+/// The returned handle belongs to the current HandleScope.
+pub fn compileScript(alloc: std.mem.Allocator, iso: v8.Isolate, ctx: v8.Context, src: []const u8, src_origin: v8.String, code_cache: ?[]const u8, result: *CompileResult) void {
+    var try_catch: v8.TryCatch = undefined;
+    try_catch.init(iso);
+    defer try_catch.deinit();
+
+    const origin = v8.ScriptOrigin.initDefault(iso, src_origin.toValue());
+    const js_src = v8.String.initUtf8(iso, src);
+
+    var script_src: v8.ScriptCompilerSource = undefined;
+    if (code_cache) |cache| {
+        // Source takes ownership of the cached data.
+        script_src.init(js_src, origin, v8.ScriptCompilerCachedData.init(cache));
+    } else {
+        script_src.init(js_src, origin, null);
+    }
+    defer script_src.deinit();
+
+    const options: v8.ScriptCompiler.CompileOptions = if (code_cache != null) .kConsumeCodeCache else .kNoCompileOptions;
+    const script = v8.ScriptCompiler.compileUnboundScript(iso, &script_src, options, .kNoCacheNoReason) catch {
+        result.* = .{
+            .alloc = alloc,
+            .script = null,
+            .err = allocPrintTryCatchStackTrace(alloc, iso, ctx, try_catch),
+            .success = false,
+            .cache_rejected = false,
+        };
+        return;
+    };
+    result.* = .{
+        .alloc = alloc,
+        .script = script,
+        .err = null,
+        .success = true,
+        .cache_rejected = if (script_src.getCachedData()) |data| data.isRejected() else false,
+    };
+}
+
+/// Serializes the compiled code of an unbound script. Returns null if V8 could not produce a cache.
+pub fn allocCodeCache(alloc: std.mem.Allocator, script: v8.UnboundScript) ?[]const u8 {
+    const data = v8.ScriptCompiler.createCodeCache(script) orelse return null;
+    defer data.deinit();
+    return alloc.dupe(u8, data.getData()) catch unreachable;
+}
+
+/// Serializes the compiled code of a module. Returns null if V8 could not produce a cache.
+pub fn allocModuleCodeCache(alloc: std.mem.Allocator, mod: v8.Module) ?[]const u8 {
+    const data = v8.ScriptCompiler.createCodeCacheForModule(mod.getUnboundModuleScript()) orelse return null;
+    defer data.deinit();
+    return alloc.dupe(u8, data.getData()) catch unreachable;
+}
+
+/// Executes a script within the current v8 context using a code cache if provided.
+pub fn executeStringWithCache(alloc: std.mem.Allocator, iso: v8.Isolate, ctx: v8.Context, src: []const u8, src_origin: v8.String, code_cache: ?[]const u8, result: *ExecuteResult) void {
+    var hscope: v8.HandleScope = undefined;
+    hscope.init(iso);
+    defer hscope.deinit();
+
+    var compile_res: CompileResult = undefined;
+    compileScript(alloc, iso, ctx, src, src_origin, code_cache, &compile_res);
+    if (!compile_res.success) {
+        result.* = .{
+            .alloc = alloc,
+            .result = null,
+            .err = compile_res.err,
+            .success = false,
+        };
+        return;
+    }
+    if (compile_res.cache_rejected) {
+        log.debug("Code cache was rejected, compiled from source.", .{});
+    }
+
+    var try_catch: v8.TryCatch = undefined;
+    try_catch.init(iso);
+    defer try_catch.deinit();
+
+    const script_res = compile_res.script.?.bindToCurrentContext().run(ctx) catch {
+        setResultError(alloc, iso, ctx, try_catch, result);
+        return;
+    };
+    result.* = .{
+        .alloc = alloc,
+        .result = allocValueAsUtf8(alloc, iso, ctx, script_res),
+        .err = null,
+        .success = true,
+    };
+}
+
 pub fn allocPrintMessageStackTrace(alloc: std.mem.Allocator, iso: v8.Isolate, ctx: v8.Context, message: v8.Message, default_msg: []const u8) []const u8 {
     // TODO: Use default message if getMessage is null.
     _ = default_msg;
@@ -0,0 +1,177 @@
+const std = @import("std");
+const stdx = @import("../stdx.zig");
+const t = stdx.testing;
+
+/// Binary indexed tree over a list of non negative values.
+/// Setting a value, appending and prefix sums are O(log n).
+/// Inserting or removing in the middle shifts the values so the tree is rebuilt in O(n).
+pub fn FenwickTree(comptime T: type) type {
+    return struct {
+        alloc: std.mem.Allocator,
+
+        /// 1-based. tree[i] is the sum of values in (i - lowbit(i), i].
+        tree: std.ArrayListUnmanaged(T),
+        values: std.ArrayListUnmanaged(T),
+
+        const Self = @This();
+
+        pub fn init(alloc: std.mem.Allocator) Self {
+            var new = Self{
+                .alloc = alloc,
+                .tree = .{},
+                .values = .{},
+            };
+            new.tree.append(alloc, 0) catch unreachable;
+            return new;
+        }
+
+        pub fn deinit(self: *Self) void {
+            self.tree.deinit(self.alloc);
+            self.values.deinit(self.alloc);
+        }
+
+        pub fn size(self: Self) u32 {
+            return @intCast(u32, self.values.items.len);
+        }
+
+        pub fn get(self: Self, idx: u32) T {
+            return self.values.items[idx];
+        }
+
+        pub fn clearRetainingCapacity(self: *Self) void {
+            self.values.clearRetainingCapacity();
+            self.tree.shrinkRetainingCapacity(1);
+        }
+
+        pub fn append(self: *Self, val: T) void {
+            self.values.append(self.alloc, val) catch unreachable;
+            const i = self.size();
+            // Node i covers the last lowbit(i) values.
+            const node = val + self.prefixSum(i - 1) - self.prefixSum(i - lowbit(i));
+            self.tree.append(self.alloc, node) catch unreachable;
+        }
+
+        pub fn set(self: *Self, idx: u32, val: T) void {
+            const old = self.values.items[idx];
+            if (val == old) {
+                return;
+            }
+            self.values.items[idx] = val;
+            var i = idx + 1;
+            if (val > old) {
+                const delta = val - old;
+                while (i < self.tree.items.len) : (i += lowbit(i)) {
+                    self.tree.items[i] += delta;
+                }
+            } else {
+                const delta = old - val;
+                while (i < self.tree.items.len) : (i += lowbit(i)) {
+                    self.tree.items[i] -= delta;
+                }
+            }
+        }
+
+        pub fn insert(self: *Self, idx: u32, val: T) void {
+            self.values.insert(self.alloc, idx, val) catch unreachable;
+            self.rebuild();
+        }
+
+        pub fn insertNTimes(self: *Self, idx: u32, val: T, n: u32) void {
+            const old_len = self.values.items.len;
+            self.values.resize(self.alloc, old_len + n) catch unreachable;
+            std.mem.copyBackwards(T, self.values.items[idx + n ..], self.values.items[idx..old_len]);
+            std.mem.set(T, self.values.items[idx .. idx + n], val);
+            self.rebuild();
+        }
+
+        pub fn orderedRemove(self: *Self, idx: u32) void {
+            _ = self.values.orderedRemove(idx);
+            self.rebuild();
+        }
+
+        fn rebuild(self: *Self) void {
+            const n = self.values.items.len;
+            self.tree.resize(self.alloc, n + 1) catch unreachable;
+            std.mem.copy(T, self.tree.items[1..], self.values.items);
+            var i: u32 = 1;
+            while (i <= n) : (i += 1) {
+                const parent = i + lowbit(i);
+                if (parent <= n) {
+                    self.tree.items[parent] += self.tree.items[i];
+                }
+            }
+        }
+
+        /// Sum of the values before end.
+        pub fn prefixSum(self: Self, end: u32) T {
+            var sum: T = 0;
+            var i = end;
+            while (i > 0) : (i -= lowbit(i)) {
+                sum += self.tree.items[i];
+            }
+            return sum;
+        }
+
+        pub fn total(self: Self) T {
+            return self.prefixSum(self.size());
+        }
+
+        /// Returns the index of the value whose range [prefixSum(idx), prefixSum(idx + 1)) contains sum.
+        /// Returns size() if sum is at or past the total.
+        pub fn findIndex(self: Self, sum: T) u32 {
+            const n = self.size();
+            var step: u32 = 1;
+            while (step * 2 <= n) {
+                step *= 2;
+            }
+            var pos: u32 = 0;
+            var rem = sum;
+            while (step > 0) : (step /= 2) {
+                if (pos + step <= n and self.tree.items[pos + step] <= rem) {
+                    pos += step;
+                    rem -= self.tree.items[pos];
+                }
+            }
+            return pos;
+        }
+    };
+}
+
+inline fn lowbit(i: u32) u32 {
+    return i & (~i +% 1);
+}
+
+test "FenwickTree" {
+    var tree = FenwickTree(u32).init(t.alloc);
+    defer tree.deinit();
+
+    var i: u32 = 0;
+    while (i < 10) : (i += 1) {
+        tree.append(i + 1);
+    }
+    try t.eq(tree.total(), 55);
+    try t.eq(tree.prefixSum(3), 6);
+    try t.eq(tree.findIndex(0), 0);
+    try t.eq(tree.findIndex(5), 2);
+    try t.eq(tree.findIndex(6), 3);
+    try t.eq(tree.findIndex(55), 10);
+
+    tree.set(2, 10);
+    try t.eq(tree.prefixSum(3), 13);
+    try t.eq(tree.total(), 62);
+    tree.set(2, 1);
+    try t.eq(tree.prefixSum(4), 8);
+
+    tree.insert(0, 100);
+    try t.eq(tree.prefixSum(1), 100);
+    try t.eq(tree.total(), 153);
+    tree.orderedRemove(0);
+    try t.eq(tree.total(), 53);
+    tree.insertNTimes(1, 2, 3);
+    try t.eq(tree.size(), 13);
+    try t.eq(tree.prefixSum(5), 9);
+    tree.orderedRemove(1);
+    tree.orderedRemove(1);
+    tree.orderedRemove(1);
+    try t.eq(tree.findIndex(3), 2);
+}
@@ -55,3 +55,48 @@ pub fn getFileMd5Hash(alloc: std.mem.Allocator, path: []const u8, out: *[16]u8)
     defer alloc.free(content);
     std.crypto.hash.Md5.hash(content, out, .{});
 }
+
+/// A read only view of a file's contents.
+pub const MappedFile = struct {
+    data: []const u8,
+
+    pub fn deinit(self: MappedFile, alloc: std.mem.Allocator) void {
+        if (self.data.len == 0) {
+            return;
+        }
+        const aligned = @alignCast(std.mem.page_size, self.data);
+        if (builtin.os.tag == .windows) {
+            alloc.free(aligned);
+        } else {
+            std.os.munmap(aligned);
+        }
+    }
+};
+
+/// Maps the file into memory so pages are only read when they're accessed.
+/// On windows the file is read into memory instead.
+/// The data stays backed by the file, so it must not be truncated while mapped or accessing the missing pages raises SIGBUS.
+/// Path can be absolute or relative to the cwd.
+pub fn mapFile(alloc: std.mem.Allocator, path: []const u8) !MappedFile {
+    const file = try std.fs.cwd().openFile(path, .{ .mode = .read_only });
+    defer file.close();
+    return mapOpenFile(alloc, file);
+}
+
+/// Same as mapFile for a file that's already open. The file can be closed while it's mapped.
+pub fn mapOpenFile(alloc: std.mem.Allocator, file: std.fs.File) !MappedFile {
+    const size = @intCast(usize, (try file.stat()).size);
+    if (size == 0) {
+        return MappedFile{ .data = "" };
+    }
+    if (builtin.os.tag == .windows) {
+        const buf = try alloc.allocAdvanced(u8, std.mem.page_size, size, .exact);
+        errdefer alloc.free(buf);
+        if (try file.readAll(buf) != size) {
+            return error.UnexpectedEndOfFile;
+        }
+        return MappedFile{ .data = buf };
+    }
+    const data = try std.os.mmap(null, size, std.os.PROT.READ, std.os.MAP.PRIVATE, file.handle, 0);
+    return MappedFile{ .data = data };
+}
@@ -30,14 +30,25 @@ pub const LineLocation = struct {
 
 const TreeBranchFactor = 3;
 
+pub const LineCol = struct {
+    line: u32,
+    col: u32,
+};
+
 // Document is organized by lines. It has nice properties for most text editing tasks.
-// A self balancing btree is used to group adjacent lines into chunks.
+// A btree is used to group adjacent lines into chunks.
 // This allows line ops to affect only relevant chunks and not the entire document while preserving line order.
 // It's also capable of propagating up aggregate line info like line-height which should come in handy when we implement line wrapping.
+// Branches sum the lines and bytes below them so a line index or a byte offset is found in O(logn) plus a scan of one chunk.
+//
+// Line text is stored like a piece table. Each line is a piece of either the source buffer or the append only add buffer.
+// Edits append the new text to the add buffer and repoint the line, so loading and bulk edits don't allocate per line.
 //
 // Notes:
 // - Always has at least one leaf node. (TODO: Revisit this)
 // - Once a chunk gets to size 0 it is removed. It won't be able to match any line position and it simplifies line iteration when we can assume each chunk is at least 1 line.
+// - Bulk ops pack lines into new leaves and rebuild the tree once, which is O(number of leaves).
+// - Line slices returned from the document are invalidated by the next edit.
 // TODO: Might want to keep newline characters in lines for scanning convenience.
 pub const Document = struct {
     const Self = @This();
@@ -47,8 +58,16 @@ pub const Document = struct {
     line_chunks: ds.PooledHandleList(LineChunkId, LineChunkArray),
     lines: ds.PooledHandleList(LineId, Line),
 
+    // Either an owned copy from loadSource or a mapped file from loadFromFile.
+    src: []const u8,
+    src_mapped: ?stdx.fs.MappedFile,
+
+    // Text from edits. Only appended to except when the last line in it is edited again.
+    add_buf: std.ArrayList(u8),
+
     // Temp vars.
     node_buf: std.ArrayList(NodeId),
+    leaf_buf: std.ArrayList(Node),
     str_buf: std.ArrayList(u8),
 
     pub fn init(self: *Self, alloc: std.mem.Allocator) void {
@@ -57,38 +76,24 @@ pub const Document = struct {
             .alloc = alloc,
             .line_chunks = ds.PooledHandleList(LineChunkId, LineChunkArray).init(alloc),
             .lines = ds.PooledHandleList(LineId, Line).init(alloc),
+            .src = "",
+            .src_mapped = null,
+            .add_buf = std.ArrayList(u8).init(alloc),
             .node_buf = std.ArrayList(NodeId).init(alloc),
+            .leaf_buf = std.ArrayList(Node).init(alloc),
             .str_buf = std.ArrayList(u8).init(alloc),
         };
-        self.setUpEmptyDoc();
-    }
-
-    fn setUpEmptyDoc(self: *Self) void {
-        const chunk_id = self.line_chunks.add(undefined) catch unreachable;
-        _ = self.line_tree.append(.{
-            .Branch = .{
-                .num_lines = 0,
-            },
-        }) catch unreachable;
-        _ = self.line_tree.append(.{
-            .Leaf = .{
-                .chunk = .{
-                    .id = chunk_id,
-                    .size = 0,
-                },
-            },
-        }) catch unreachable;
+        self.rebuildLineTree();
     }
 
     pub fn deinit(self: *Self) void {
         self.line_tree.deinit();
         self.line_chunks.deinit();
-        var iter = self.lines.iterator();
-        while (iter.next()) |line| {
-            line.buf.deinit();
-        }
         self.lines.deinit();
+        self.freeSource();
+        self.add_buf.deinit();
         self.node_buf.deinit();
+        self.leaf_buf.deinit();
         self.str_buf.deinit();
     }
 
@@ -124,19 +129,11 @@ pub const Document = struct {
                     const range = self.line_tree.getChildrenRange(node_id);
                     var id = range.start;
                     while (id < range.end) : (id += 1) {
-                        const cur_item = self.line_tree.getNode(id);
                         const res = self.findLineLoc2(id, cur_line, target_line);
                         if (res != null) {
                             return res;
                         }
-                        switch (cur_item) {
-                            .Branch => |child_br| {
-                                cur_line += child_br.num_lines;
-                            },
-                            .Leaf => |child_leaf| {
-                                cur_line += child_leaf.chunk.size;
-                            },
-                        }
+                        cur_line += self.line_tree.getNode(id).numLines();
                     }
                 }
             },
@@ -152,111 +149,90 @@ pub const Document = struct {
         return null;
     }
 
-    // Move lines from existing chunk to new if target threshold is exceeded.
-    // Caller must deal with rebalancing the tree and moving the new leaf to the right place.
-    fn reallocLeafLineChunk(self: *Self, loc: LineLocation) LineLocation {
-        const leaf = self.line_tree.getNodePtr(loc.leaf_id);
-        const num_lines = leaf.Leaf.chunk.size;
-        if (num_lines <= LineChunkTargetThreshold) {
-            unreachable;
+    // Byte offset of the start of a line. line_idx can be numLines() to get the end of the document plus one.
+    pub fn getLineOffset(self: *Self, line_idx: u32) u32 {
+        var offset: u32 = 0;
+        var start_line: u32 = 0;
+        var node_id: NodeId = 0;
+        while (true) {
+            switch (self.line_tree.getNode(node_id)) {
+                .Branch => {
+                    const range = self.line_tree.getChildrenRange(node_id);
+                    var id = range.start;
+                    while (id < range.end - 1) : (id += 1) {
+                        const child = self.line_tree.getNode(id);
+                        if (line_idx < start_line + child.numLines()) {
+                            break;
+                        }
+                        start_line += child.numLines();
+                        offset += child.numBytes();
+                    }
+                    node_id = id;
+                },
+                .Leaf => {
+                    for (self.getLeafLineChunkSlice(node_id)[0 .. line_idx - start_line]) |line_id| {
+                        offset += self.lines.getNoCheck(line_id).len + 1;
+                    }
+                    return offset;
+                },
+            }
         }
-        const num_moved = num_lines - LineChunkTargetThreshold;
-
-        const new_chunk_id = self.line_chunks.add(undefined) catch unreachable;
-        const new_chunk_ptr = LineChunk{
-            .id = new_chunk_id,
-            .size = num_moved,
-        };
-        const new_leaf = self.line_tree.append(.{
-            .Leaf = .{
-                .chunk = new_chunk_ptr,
-            },
-        }) catch unreachable;
+    }
 
-        // log.warn("leaf: {}, {}", .{leaf, loc});
-        const chunk = self.getLineChunkSlice(leaf.Leaf.chunk);
-        const new_chunk = self.getLineChunkSlice(new_chunk_ptr);
-        var i: u32 = 0;
-        while (i < num_moved) : (i += 1) {
-            new_chunk[i] = chunk[LineChunkTargetThreshold + i];
+    // Offsets past the end of the document map to the end of the last line.
+    pub fn getLineCol(self: *Self, offset: u32) LineCol {
+        if (self.numLines() == 0) {
+            return .{ .line = 0, .col = 0 };
+        }
+        const target = std.math.min(offset, self.len());
+        var start_offset: u32 = 0;
+        var start_line: u32 = 0;
+        var node_id: NodeId = 0;
+        while (true) {
+            switch (self.line_tree.getNode(node_id)) {
+                .Branch => {
+                    const range = self.line_tree.getChildrenRange(node_id);
+                    var id = range.start;
+                    while (id < range.end - 1) : (id += 1) {
+                        const child = self.line_tree.getNode(id);
+                        if (target < start_offset + child.numBytes()) {
+                            break;
+                        }
+                        start_line += child.numLines();
+                        start_offset += child.numBytes();
+                    }
+                    node_id = id;
+                },
+                .Leaf => {
+                    const chunk = self.getLeafLineChunkSlice(node_id);
+                    for (chunk[0 .. chunk.len - 1]) |line_id| {
+                        const line_len = self.lines.getNoCheck(line_id).len;
+                        if (target <= start_offset + line_len) {
+                            break;
+                        }
+                        start_line += 1;
+                        start_offset += line_len + 1;
+                    }
+                    return .{
+                        .line = start_line,
+                        .col = target - start_offset,
+                    };
+                },
+            }
         }
-
-        leaf.Leaf.chunk.size -= num_moved;
-        self.updateParentNumLines(loc.leaf_id, -@intCast(i32, num_moved));
-
-        return .{
-            .leaf_id = new_leaf,
-            .chunk_line_idx = 0,
-        };
     }
 
-    // Assumes already balanced line tree except new leaf node.
-    // Assumes new leaf was created to come after target leaf.
-    // If new leaf is after target, then we need to shift every node AFTER target downwards to the new node.
-    // Then new node is moved to the node AFTER target.
-    // If new leaf is before target, then we need to shift every node at target upwards to the new node.
-    // Then new node is moved to the target.
-    fn rebalanceWithNewLeaf(self: *Self, new_id: NodeId, after_target: NodeId) void {
-        self.node_buf.resize(self.line_tree.getMaxLeaves()) catch unreachable;
-
-        // TODO: Only get leaves from new to target.
-        const leaves = self.line_tree.getInOrderLeaves(self.node_buf.items);
-
-        if (self.line_tree.isLeafNodeBefore(new_id, after_target)) {
-            // Start from new node.
-            var i = std.mem.indexOfScalar(NodeId, leaves, new_id).?;
-            const temp = self.line_tree.getNode(new_id);
-
-            // First node that moves to the new node is special since all it's num lines is reported to parent.
-            var node = self.line_tree.getNodePtr(leaves[i]);
-            node.* = self.line_tree.getNode(leaves[i + 1]);
-            self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size));
-            i += 1;
-
-            // Shift the rest upwards.
-            while (leaves[i] != after_target) : (i += 1) {
-                // log.warn("i={} cur_node={} target={}", .{i, leaves[i], after_target});
-                node = self.line_tree.getNodePtr(leaves[i]);
-                const last_num_lines = node.Leaf.chunk.size;
-                node.* = self.line_tree.getNode(leaves[i + 1]);
-                self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size) - @intCast(i32, last_num_lines));
-            }
+    pub fn getOffset(self: *Self, line_idx: u32, col: u32) u32 {
+        return self.getLineOffset(line_idx) + col;
+    }
 
-            // Replace target with new.
-            node = self.line_tree.getNodePtr(leaves[i]);
-            const last_num_lines = node.Leaf.chunk.size;
-            node.* = temp;
-            self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size) - @intCast(i32, last_num_lines));
+    // Number of bytes including the newlines between lines.
+    pub fn len(self: *Self) u32 {
+        const root = self.line_tree.getNode(0).Branch;
+        if (root.num_lines == 0) {
+            return 0;
         } else {
-            // Start from new node.
-            var i = std.mem.indexOfScalar(NodeId, leaves, new_id).?;
-
-            // First node that moves to the new node is special since all it's num lines is reported to parent.
-            if (leaves[i] != after_target + 1) {
-                var node = self.line_tree.getNodePtr(leaves[i]);
-                node.* = self.line_tree.getNode(leaves[i - 1]);
-                self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size));
-                i -= 1;
-
-                const temp = self.line_tree.getNode(new_id);
-                // Shift the rest downwards.
-                while (leaves[i] != after_target + 1) : (i -= 1) {
-                    node = self.line_tree.getNodePtr(leaves[i]);
-                    const last_num_lines = node.Leaf.chunk.size;
-                    node.* = self.line_tree.getNode(leaves[i - 1]);
-                    self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size) - @intCast(i32, last_num_lines));
-                }
-
-                // Replace node AFTER target with new.
-                node = self.line_tree.getNodePtr(leaves[i]);
-                const last_num_lines = node.Leaf.chunk.size;
-                node.* = temp;
-                self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size) - @intCast(i32, last_num_lines));
-            } else {
-                // New node is exactly where it should be already.
-                const node = self.line_tree.getNodePtr(leaves[i]);
-                self.updateParentNumLines(leaves[i], @intCast(i32, node.Leaf.chunk.size));
-            }
+            return root.num_bytes - 1;
         }
     }
 
@@ -264,114 +240,419 @@ pub const Document = struct {
         self.replaceRangeInLine(line_idx, start, end, "");
     }
 
+    // str can't be a slice from the document.
     pub fn replaceRangeInLine(self: *Self, line_idx: u32, start: u32, end: u32, str: []const u8) void {
-        const line_id = self.getLineId(line_idx);
-        const buf = &self.lines.getPtrNoCheck(line_id).buf;
-        buf.replaceRange(start, end - start, str) catch unreachable;
+        const loc = self.findLineLoc(line_idx);
+        const line_id = self.getLineIdByLoc(loc);
+        const line = self.lines.getNoCheck(line_id);
+        if (line.buffer == .Add and line.start + line.len == self.add_buf.items.len) {
+            // Last edited line is edited in place. eg. Typing into the same line.
+            self.add_buf.replaceRange(line.start + start, end - start, str) catch unreachable;
+            self.setLine(loc, .{
+                .buffer = .Add,
+                .start = line.start,
+                .len = @intCast(u32, self.add_buf.items.len) - line.start,
+            });
+        } else {
+            const new_len = line.len - (end - start) + @intCast(u32, str.len);
+            self.add_buf.ensureUnusedCapacity(new_len) catch unreachable;
+
+            // Get the line after growing the add buffer since it could be a slice of it.
+            const text = self.getLineById(line_id);
+            const new_start = @intCast(u32, self.add_buf.items.len);
+            self.add_buf.appendSliceAssumeCapacity(text[0..start]);
+            self.add_buf.appendSliceAssumeCapacity(str);
+            self.add_buf.appendSliceAssumeCapacity(text[end..]);
+            self.setLine(loc, .{
+                .buffer = .Add,
+                .start = new_start,
+                .len = new_len,
+            });
+        }
     }
 
     // Performs insert in a line. Assumes no new lines.
     pub fn insertIntoLine(self: *Self, line_idx: u32, ch_idx: u32, str: []const u8) void {
-        const line_id = self.getLineId(line_idx);
-        const buf = &self.lines.getPtrNoCheck(line_id).buf;
-        buf.insertSlice(ch_idx, str) catch unreachable;
+        self.replaceRangeInLine(line_idx, ch_idx, ch_idx, str);
+    }
+
+    fn setLine(self: *Self, loc: LineLocation, line: Line) void {
+        const line_ptr = self.lines.getPtrNoCheck(self.getLineIdByLoc(loc));
+        const byte_delta = @intCast(i32, line.len) - @intCast(i32, line_ptr.len);
+        line_ptr.* = line;
+        const leaf = &self.line_tree.getNodePtr(loc.leaf_id).Leaf;
+        leaf.num_bytes = addDelta(leaf.num_bytes, byte_delta);
+        self.updateParentCounts(loc.leaf_id, 0, byte_delta);
     }
 
     pub fn insertLine(self: *Self, line_idx: u32, str: []const u8) void {
-        var line = Line{
-            .buf = std.ArrayList(u8).init(self.alloc),
-        };
-        line.buf.appendSlice(str) catch unreachable;
+        const start = @intCast(u32, self.add_buf.items.len);
+        self.add_buf.appendSlice(str) catch unreachable;
+        self.insertLineInternal(line_idx, .{
+            .buffer = .Add,
+            .start = start,
+            .len = @intCast(u32, str.len),
+        });
+    }
+
+    fn insertLineInternal(self: *Self, line_idx: u32, line: Line) void {
         const line_id = self.lines.add(line) catch unreachable;
         var loc = self.findInsertLineLoc(line_idx);
 
-        var leaf = self.line_tree.getNodePtr(loc.leaf_id);
-        if (leaf.Leaf.chunk.size == MaxLineChunkSize) {
-            // Reached chunk limit, allocate another leaf node line chunk.
-            const new_loc = self.reallocLeafLineChunk(loc);
-
-            if (self.line_tree.getParent(new_loc.leaf_id)) |parent_id| {
-                const parent = self.line_tree.getNode(parent_id);
-                if (parent == .Leaf) {
-                    // If parent is a leaf node, we have to insert a branch.
-                    const new_branch = self.line_tree.append(.{
-                        .Branch = .{
-                            .num_lines = parent.Leaf.chunk.size,
-                        },
-                    }) catch unreachable;
-                    self.line_tree.swap(parent_id, new_branch);
-                    // Update the target loc if we swapped it.
-                    if (loc.leaf_id == parent_id) {
-                        loc.leaf_id = new_branch;
-                    }
-                }
-            }
-
-            // Rebalance line tree with new leaf node.
-            self.rebalanceWithNewLeaf(new_loc.leaf_id, loc.leaf_id);
+        if (self.line_tree.getNode(loc.leaf_id).Leaf.chunk.size == MaxLineChunkSize) {
+            // Reached chunk limit, move the end of the chunk to a new leaf.
+            self.splitLeaf(loc.leaf_id);
 
             // Find the target leaf again.
             loc = self.findInsertLineLoc(line_idx);
-            leaf = self.line_tree.getNodePtr(loc.leaf_id);
         }
 
+        const leaf = &self.line_tree.getNodePtr(loc.leaf_id).Leaf;
+        leaf.chunk.size += 1;
+        leaf.num_bytes += line.len + 1;
+
         // Copy existing lines down.
         const offset = loc.chunk_line_idx;
-
-        leaf.Leaf.chunk.size += 1;
-        var chunk = self.getLineChunkSlice(leaf.Leaf.chunk);
-
-        var i = chunk.len - offset - 1;
-        while (i >= offset + 1) : (i -= 1) {
-            chunk[i] = chunk[i - 1];
-        }
+        const chunk = self.getLineChunkSlice(leaf.chunk);
+        std.mem.copyBackwards(LineId, chunk[offset + 1 ..], chunk[offset .. chunk.len - 1]);
         chunk[offset] = line_id;
-        // log.warn("new line id: {}", .{line_id});
-        // log.warn("buf after: {any}", .{chunk.*});
 
         // Propagate size change upwards.
-        self.updateParentNumLines(loc.leaf_id, 1);
+        self.updateParentCounts(loc.leaf_id, 1, @intCast(i32, line.len + 1));
     }
 
-    fn updateParentNumLines(self: *Self, node_id: NodeId, lc_delta: i32) void {
-        const parent_id = self.line_tree.getParent(node_id);
-        if (parent_id == null) {
+    // Inserts a string at a byte offset. New lines in the string split the line and each resulting line is a slice of one append to the add buffer.
+    // str can't be a slice from the document.
+    pub fn insert(self: *Self, offset: u32, str: []const u8) void {
+        if (self.numLines() == 0) {
+            self.insertLine(0, "");
+        }
+        const lc = self.getLineCol(offset);
+        const num_new_lines = @intCast(u32, std.mem.count(u8, str, "\n"));
+        if (num_new_lines == 0) {
+            self.insertIntoLine(lc.line, lc.col, str);
             return;
         }
-        const parent = self.line_tree.getNodePtr(parent_id.?);
-        if (lc_delta > 0) {
-            parent.Branch.num_lines += @intCast(u32, lc_delta);
+
+        const loc = self.findLineLoc(lc.line);
+        const line_id = self.getLineIdByLoc(loc);
+        self.add_buf.ensureUnusedCapacity(self.lines.getNoCheck(line_id).len + str.len) catch unreachable;
+
+        // Get the line after growing the add buffer since it could be a slice of it.
+        const text = self.getLineById(line_id);
+        var start = @intCast(u32, self.add_buf.items.len);
+        self.add_buf.appendSliceAssumeCapacity(text[0..lc.col]);
+        self.add_buf.appendSliceAssumeCapacity(str);
+        self.add_buf.appendSliceAssumeCapacity(text[lc.col..]);
+
+        var end = self.nextAddBufLineEnd(start);
+        self.setLine(loc, .{
+            .buffer = .Add,
+            .start = start,
+            .len = end - start,
+        });
+        start = end + 1;
+
+        const chunk_size = self.line_tree.getNode(loc.leaf_id).Leaf.chunk.size;
+        if (chunk_size + num_new_lines <= MaxLineChunkSize) {
+            var line_idx = lc.line + 1;
+            while (line_idx <= lc.line + num_new_lines) : (line_idx += 1) {
+                end = self.nextAddBufLineEnd(start);
+                self.insertLineInternal(line_idx, .{
+                    .buffer = .Add,
+                    .start = start,
+                    .len = end - start,
+                });
+                start = end + 1;
+            }
         } else {
-            parent.Branch.num_lines -= @intCast(u32, -lc_delta);
+            // Pack the new lines and the rest of the target chunk into new leaves and rebuild the tree once.
+            self.leaf_buf.clearRetainingCapacity();
+            var i: u32 = 0;
+            while (i < num_new_lines) : (i += 1) {
+                end = self.nextAddBufLineEnd(start);
+                const new_id = self.lines.add(.{
+                    .buffer = .Add,
+                    .start = start,
+                    .len = end - start,
+                }) catch unreachable;
+                self.appendLineToLeafBuf(new_id);
+                start = end + 1;
+            }
+            var num_moved_bytes: u32 = 0;
+            var chunk_line_idx = loc.chunk_line_idx + 1;
+            while (chunk_line_idx < chunk_size) : (chunk_line_idx += 1) {
+                // Get the chunk each time since adding line chunks can move it.
+                const moved_id = self.getLeafLineChunkSlice(loc.leaf_id)[chunk_line_idx];
+                self.appendLineToLeafBuf(moved_id);
+                num_moved_bytes += self.lines.getNoCheck(moved_id).len + 1;
+            }
+            const leaf = &self.line_tree.getNodePtr(loc.leaf_id).Leaf;
+            leaf.chunk.size = loc.chunk_line_idx + 1;
+            leaf.num_bytes -= num_moved_bytes;
+            self.insertBufferedLeavesAfter(loc.leaf_id);
         }
-        self.updateParentNumLines(parent_id.?, lc_delta);
     }
 
-    // Clears the doc.
+    fn nextAddBufLineEnd(self: *Self, start: u32) u32 {
+        const end = std.mem.indexOfScalarPos(u8, self.add_buf.items, start, '\n') orelse self.add_buf.items.len;
+        return @intCast(u32, end);
+    }
+
+    // Removes the bytes from start to end (exclusive). Lines in between are removed and the first and last lines are joined.
+    pub fn remove(self: *Self, start: u32, end: u32) void {
+        if (start >= end) {
+            return;
+        }
+        const start_lc = self.getLineCol(start);
+        const end_lc = self.getLineCol(end);
+        if (start_lc.line == end_lc.line) {
+            self.removeRangeInLine(start_lc.line, start_lc.col, end_lc.col);
+            return;
+        }
+
+        const loc = self.findLineLoc(start_lc.line);
+        const first_id = self.getLineIdByLoc(loc);
+        const last_id = self.getLineId(end_lc.line);
+        const new_len = start_lc.col + self.lines.getNoCheck(last_id).len - end_lc.col;
+        self.add_buf.ensureUnusedCapacity(new_len) catch unreachable;
+
+        // Get the lines after growing the add buffer since they could be slices of it.
+        const new_start = @intCast(u32, self.add_buf.items.len);
+        self.add_buf.appendSliceAssumeCapacity(self.getLineById(first_id)[0..start_lc.col]);
+        self.add_buf.appendSliceAssumeCapacity(self.getLineById(last_id)[end_lc.col..]);
+        self.setLine(loc, .{
+            .buffer = .Add,
+            .start = new_start,
+            .len = new_len,
+        });
+        self.removeLines(start_lc.line + 1, end_lc.line + 1);
+    }
+
+    // Removes lines from start to end (exclusive). Leaves that become empty are removed with one rebuild of the tree.
+    pub fn removeLines(self: *Self, start: u32, end: u32) void {
+        var num_remaining = end - start;
+        var has_empty_leaf = false;
+        while (num_remaining > 0) {
+            const loc = self.findLineLoc(start);
+            const leaf = &self.line_tree.getNodePtr(loc.leaf_id).Leaf;
+            const chunk = self.getLineChunkSlice(leaf.chunk);
+            const num_removed = std.math.min(num_remaining, leaf.chunk.size - loc.chunk_line_idx);
+
+            var num_removed_bytes: u32 = 0;
+            for (chunk[loc.chunk_line_idx .. loc.chunk_line_idx + num_removed]) |line_id| {
+                num_removed_bytes += self.lines.getNoCheck(line_id).len + 1;
+                self.lines.remove(line_id);
+            }
+            std.mem.copy(LineId, chunk[loc.chunk_line_idx..], chunk[loc.chunk_line_idx + num_removed ..]);
+
+            leaf.chunk.size -= num_removed;
+            leaf.num_bytes -= num_removed_bytes;
+            self.updateParentCounts(loc.leaf_id, -@intCast(i32, num_removed), -@intCast(i32, num_removed_bytes));
+            if (leaf.chunk.size == 0) {
+                has_empty_leaf = true;
+            }
+            num_remaining -= num_removed;
+        }
+        if (has_empty_leaf) {
+            self.removeEmptyLeaves();
+        }
+    }
+
+    fn removeEmptyLeaves(self: *Self) void {
+        self.leaf_buf.clearRetainingCapacity();
+        self.node_buf.resize(self.line_tree.getMaxLeaves()) catch unreachable;
+        for (self.line_tree.getInOrderLeaves(self.node_buf.items)) |leaf_id| {
+            const leaf = self.line_tree.getNode(leaf_id);
+            if (leaf.Leaf.chunk.size > 0) {
+                self.leaf_buf.append(leaf) catch unreachable;
+            } else {
+                self.line_chunks.remove(leaf.Leaf.chunk.id);
+            }
+        }
+        self.rebuildLineTree();
+    }
+
+    // Move lines from the end of a full chunk to a new leaf after it.
+    fn splitLeaf(self: *Self, leaf_id: NodeId) void {
+        // Add the chunk first since it can move the existing chunks.
+        const new_chunk = LineChunk{
+            .id = self.line_chunks.add(undefined) catch unreachable,
+            .size = MaxLineChunkSize - LineChunkTargetThreshold,
+        };
+        const leaf = &self.line_tree.getNodePtr(leaf_id).Leaf;
+        const chunk = self.getLineChunkSlice(leaf.chunk);
+        const moved = chunk[LineChunkTargetThreshold..];
+        std.mem.copy(LineId, self.getLineChunkSlice(new_chunk), moved);
+
+        var num_moved_bytes: u32 = 0;
+        for (moved) |line_id| {
+            num_moved_bytes += self.lines.getNoCheck(line_id).len + 1;
+        }
+        leaf.chunk.size = LineChunkTargetThreshold;
+        leaf.num_bytes -= num_moved_bytes;
+
+        self.leaf_buf.clearRetainingCapacity();
+        self.leaf_buf.append(.{
+            .Leaf = .{
+                .chunk = new_chunk,
+                .num_bytes = num_moved_bytes,
+            },
+        }) catch unreachable;
+        self.insertBufferedLeavesAfter(leaf_id);
+    }
+
+    // Inserts the leaves in leaf_buf after the target leaf in-order.
+    fn insertBufferedLeavesAfter(self: *Self, leaf_id: NodeId) void {
+        const num_new = self.leaf_buf.items.len;
+        var target_idx: usize = undefined;
+        self.node_buf.resize(self.line_tree.getMaxLeaves()) catch unreachable;
+        for (self.line_tree.getInOrderLeaves(self.node_buf.items)) |id, i| {
+            self.leaf_buf.append(self.line_tree.getNode(id)) catch unreachable;
+            if (id == leaf_id) {
+                target_idx = i;
+            }
+        }
+        // Move the new leaves from the front to after the target.
+        std.mem.rotate(Node, self.leaf_buf.items[0 .. num_new + target_idx + 1], num_new);
+        self.rebuildLineTree();
+    }
+
+    // Appends a line to the last leaf in leaf_buf. Leaves are only filled to the target threshold so there's room for inserts.
+    fn appendLineToLeafBuf(self: *Self, line_id: LineId) void {
+        const items = self.leaf_buf.items;
+        if (items.len == 0 or items[items.len - 1].Leaf.chunk.size == LineChunkTargetThreshold) {
+            self.appendEmptyLeafToLeafBuf();
+        }
+        const leaf = &self.leaf_buf.items[self.leaf_buf.items.len - 1].Leaf;
+        self.line_chunks.getPtrNoCheck(leaf.chunk.id)[leaf.chunk.size] = line_id;
+        leaf.chunk.size += 1;
+        leaf.num_bytes += self.lines.getNoCheck(line_id).len + 1;
+    }
+
+    fn appendEmptyLeafToLeafBuf(self: *Self) void {
+        const chunk_id = self.line_chunks.add(undefined) catch unreachable;
+        self.leaf_buf.append(.{
+            .Leaf = .{
+                .chunk = .{
+                    .id = chunk_id,
+                    .size = 0,
+                },
+                .num_bytes = 0,
+            },
+        }) catch unreachable;
+    }
+
+    // Replaces the line tree with the smallest complete tree that has the leaves in leaf_buf in-order.
+    // Branches come before their children in the array so the counts are summed with one pass from the end.
+    fn rebuildLineTree(self: *Self) void {
+        if (self.leaf_buf.items.len == 0) {
+            self.appendEmptyLeafToLeafBuf();
+        }
+        const num_leaves = @intCast(u32, self.leaf_buf.items.len);
+        var size: u32 = 2;
+        while (size - getNumBranches(size) < num_leaves) : (size += 1) {}
+        const num_branches = getNumBranches(size);
+
+        self.line_tree.resize(size) catch unreachable;
+        var id: NodeId = 0;
+        while (id < num_branches) : (id += 1) {
+            self.line_tree.getNodePtr(id).* = .{
+                .Branch = .{
+                    .num_lines = 0,
+                    .num_bytes = 0,
+                },
+            };
+        }
+        self.node_buf.resize(self.line_tree.getMaxLeaves()) catch unreachable;
+        for (self.line_tree.getInOrderLeaves(self.node_buf.items)) |leaf_id, i| {
+            self.line_tree.getNodePtr(leaf_id).* = self.leaf_buf.items[i];
+        }
+
+        id = size - 1;
+        while (id > 0) : (id -= 1) {
+            const node = self.line_tree.getNode(id);
+            const parent = &self.line_tree.getNodePtr(self.line_tree.getParent(id).?).Branch;
+            parent.num_lines += node.numLines();
+            parent.num_bytes += node.numBytes();
+        }
+        self.leaf_buf.clearRetainingCapacity();
+    }
+
+    fn getNumBranches(tree_size: u32) u32 {
+        return (tree_size - 1 + TreeBranchFactor - 1) / TreeBranchFactor;
+    }
+
+    // The leaf's own counts are updated by the caller.
+    fn updateParentCounts(self: *Self, node_id: NodeId, lc_delta: i32, byte_delta: i32) void {
+        var id = node_id;
+        while (self.line_tree.getParent(id)) |parent_id| {
+            const parent = &self.line_tree.getNodePtr(parent_id).Branch;
+            parent.num_lines = addDelta(parent.num_lines, lc_delta);
+            parent.num_bytes = addDelta(parent.num_bytes, byte_delta);
+            id = parent_id;
+        }
+    }
+
+    // Clears the doc. Caller rebuilds the line tree.
     fn clearRetainingCapacity(self: *Self) void {
         self.line_tree.clearRetainingCapacity();
         self.line_chunks.clearRetainingCapacity();
-        var iter = self.lines.iterator();
-        while (iter.next()) |line| {
-            line.buf.deinit();
-        }
         self.lines.clearRetainingCapacity();
-        self.setUpEmptyDoc();
+        self.add_buf.clearRetainingCapacity();
+        self.leaf_buf.clearRetainingCapacity();
+        self.freeSource();
+    }
+
+    fn freeSource(self: *Self) void {
+        if (self.src_mapped) |mapped| {
+            mapped.deinit(self.alloc);
+            self.src_mapped = null;
+        } else if (self.src.len > 0) {
+            self.alloc.free(self.src);
+        }
+        self.src = "";
     }
 
+    // The source is copied once and lines are slices of the copy.
     pub fn loadSource(self: *Self, src: []const u8) void {
         self.clearRetainingCapacity();
-        var iter = stdx.string.splitLines(src);
-        while (iter.next()) |line| {
-            self.insertLine(self.numLines(), line);
+        self.src = self.alloc.dupe(u8, src) catch unreachable;
+        self.insertSourceLines();
+    }
+
+    // The file is mapped into memory as the source buffer and pages are only read in when they're accessed.
+    // The mapping is private but still reads through to the file, so the file must not be truncated or rewritten
+    // while the document is loaded. Reading an unedited line after the file shrinks raises SIGBUS.
+    // Use loadSource with the file's contents when that can't be guaranteed.
+    pub fn loadFromFile(self: *Self, path: []const u8) !void {
+        const mapped = try stdx.fs.mapFile(self.alloc, path);
+        if (mapped.data.len > std.math.maxInt(u32)) {
+            mapped.deinit(self.alloc);
+            return error.FileTooBig;
         }
+        self.clearRetainingCapacity();
+        self.src_mapped = mapped;
+        self.src = mapped.data;
+        self.insertSourceLines();
     }
 
-    pub fn loadFromFile(self: *Self, path: []const u8) void {
-        _ = self;
-        _ = path;
-        // Load from stream.
-        @compileError("TODO");
+    fn insertSourceLines(self: *Self) void {
+        var start: u32 = 0;
+        while (true) {
+            const end = @intCast(u32, std.mem.indexOfScalarPos(u8, self.src, start, '\n') orelse self.src.len);
+            const line_id = self.lines.add(.{
+                .buffer = .Source,
+                .start = start,
+                .len = end - start,
+            }) catch unreachable;
+            self.appendLineToLeafBuf(line_id);
+            if (end == self.src.len) {
+                break;
+            }
+            start = end + 1;
+        }
+        self.rebuildLineTree();
     }
 
     pub fn getFirstLeaf(self: *Self) NodeId {
@@ -406,11 +687,16 @@ pub const Document = struct {
 
     pub fn getLine(self: *Self, line_idx: u32) []const u8 {
         const line_id = self.getLineId(line_idx);
-        return self.lines.getNoCheck(line_id).buf.items;
+        return self.getLineById(line_id);
     }
 
     pub fn getLineById(self: *Self, id: LineId) []const u8 {
-        return self.lines.getNoCheck(id).buf.items;
+        const line = self.lines.getNoCheck(id);
+        const buf = switch (line.buffer) {
+            .Source => self.src,
+            .Add => self.add_buf.items,
+        };
+        return buf[line.start .. line.start + line.len];
     }
 
     pub fn getNode(self: *Self, id: NodeId) Node {
@@ -555,17 +841,165 @@ test "Big document" {
     try t.eq(doc.numLines(), 1001);
 }
 
+test "Document.loadSource lines are copied on edit" {
+    var doc: Document = undefined;
+    doc.init(t.alloc);
+    defer doc.deinit();
+
+    doc.loadSource("abc\ndef");
+    doc.insertIntoLine(1, 1, "x");
+    try t.eqStr(doc.getLine(0), "abc");
+    try t.eqStr(doc.getLine(1), "dxef");
+
+    // Reloading frees the previous source.
+    doc.loadSource("ghi");
+    try t.eq(doc.numLines(), 1);
+    try t.eqStr(doc.getLine(0), "ghi");
+}
+
+test "Document.insert and remove across lines" {
+    var doc: Document = undefined;
+    doc.init(t.alloc);
+    defer doc.deinit();
+
+    doc.insert(0, "abc\ndef");
+    try t.eq(doc.numLines(), 2);
+    try t.eq(doc.len(), 7);
+
+    doc.insert(5, "1\n2\n3");
+    try t.eq(doc.numLines(), 4);
+    try t.eqStr(doc.getLine(1), "d1");
+    try t.eqStr(doc.getLine(2), "2");
+    try t.eqStr(doc.getLine(3), "3ef");
+
+    // Joins the first and last lines.
+    doc.remove(2, 10);
+    try t.eq(doc.numLines(), 1);
+    try t.eqStr(doc.getLine(0), "ab3ef");
+    try t.eq(doc.len(), 5);
+}
+
+test "Document.getLineCol and getLineOffset" {
+    var doc: Document = undefined;
+    doc.init(t.alloc);
+    defer doc.deinit();
+
+    doc.loadSource("ab\n\ncde\n");
+    try t.eq(doc.numLines(), 4);
+    try t.eq(doc.len(), 8);
+    try t.eq(doc.getLineOffset(0), 0);
+    try t.eq(doc.getLineOffset(1), 3);
+    try t.eq(doc.getLineOffset(2), 4);
+    try t.eq(doc.getLineOffset(3), 8);
+    try t.eq(doc.getLineCol(2), LineCol{ .line = 0, .col = 2 });
+    try t.eq(doc.getLineCol(3), LineCol{ .line = 1, .col = 0 });
+    try t.eq(doc.getLineCol(6), LineCol{ .line = 2, .col = 2 });
+    try t.eq(doc.getLineCol(8), LineCol{ .line = 3, .col = 0 });
+    try t.eq(doc.getOffset(2, 1), 5);
+}
+
+test "Document bulk insert and remove" {
+    var doc: Document = undefined;
+    doc.init(t.alloc);
+    defer doc.deinit();
+
+    var src = std.ArrayList(u8).init(t.alloc);
+    defer src.deinit();
+    var i: u32 = 0;
+    while (i < 1000) : (i += 1) {
+        try src.writer().print("{}\n", .{i});
+    }
+    doc.loadSource(src.items);
+    try t.eq(doc.numLines(), 1001);
+
+    // Enough lines to split into new leaves.
+    var str = std.ArrayList(u8).init(t.alloc);
+    defer str.deinit();
+    i = 0;
+    while (i < 200) : (i += 1) {
+        try str.appendSlice("x\n");
+    }
+    const offset = doc.getLineOffset(500);
+    doc.insert(offset, str.items);
+    try t.eq(doc.numLines(), 1201);
+    try t.eqStr(doc.getLine(499), "499");
+    try t.eqStr(doc.getLine(500), "x");
+    try t.eqStr(doc.getLine(699), "x");
+    try t.eqStr(doc.getLine(700), "500");
+    try t.eq(doc.len(), @intCast(u32, src.items.len + str.items.len));
+    try t.eq(doc.getLineCol(offset + 2), LineCol{ .line = 501, .col = 0 });
+
+    // Removes whole chunks.
+    doc.remove(doc.getLineOffset(100), doc.getLineOffset(1100));
+    try t.eq(doc.numLines(), 201);
+    try t.eqStr(doc.getLine(99), "99");
+    try t.eqStr(doc.getLine(100), "900");
+    try t.eq(doc.getLineOffset(100), 290);
+
+    // Line iteration still visits every line in order.
+    var leaf_id: ?NodeId = doc.getFirstLeaf();
+    var num_lines: u32 = 0;
+    while (leaf_id) |id| {
+        const chunk = doc.getLeafLineChunkSlice(id);
+        try t.eq(chunk.len > 0, true);
+        num_lines += @intCast(u32, chunk.len);
+        leaf_id = doc.getNextLeafNode(id);
+    }
+    try t.eq(num_lines, doc.numLines());
+
+    // Single lines inserted in the middle of a full chunk.
+    i = 0;
+    while (i < 100) : (i += 1) {
+        doc.insertLine(50, "y");
+    }
+    try t.eq(doc.numLines(), 301);
+    try t.eqStr(doc.getLine(49), "49");
+    try t.eqStr(doc.getLine(50), "y");
+    try t.eqStr(doc.getLine(150), "50");
+}
+
 pub const NodeId = u32;
 const Node = union(enum) {
     Branch: struct {
         num_lines: u32,
+        num_bytes: u32,
     },
     Leaf: struct {
         chunk: LineChunk,
+
+        // Line lengths plus a newline for each line.
+        num_bytes: u32,
     },
+
+    fn numLines(self: Node) u32 {
+        return switch (self) {
+            .Branch => |br| br.num_lines,
+            .Leaf => |leaf| leaf.chunk.size,
+        };
+    }
+
+    fn numBytes(self: Node) u32 {
+        return switch (self) {
+            .Branch => |br| br.num_bytes,
+            .Leaf => |leaf| leaf.num_bytes,
+        };
+    }
+};
+
+fn addDelta(val: u32, delta: i32) u32 {
+    return @intCast(u32, @intCast(i64, val) + delta);
+}
+
+const BufferKind = enum(u1) {
+    Source,
+    Add,
 };
 
 pub const LineId = u32;
+
+// A piece of Document.src or Document.add_buf. Doesn't include the newline.
 const Line = struct {
-    buf: std.ArrayList(u8),
+    buffer: BufferKind,
+    start: u32,
+    len: u32,
 };
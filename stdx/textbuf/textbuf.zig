@@ -110,7 +110,7 @@ pub const TextBuffer = struct {
         self.num_chars -= (end_idx - start_idx);
     }
 
-    fn getBufferIdx(self: TextBuffer, idx: u32) u32 {
+    pub fn getBufferIdx(self: TextBuffer, idx: u32) u32 {
         if (idx == 0) {
             // The starting char.
             return 0;
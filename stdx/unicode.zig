@@ -90,4 +90,33 @@ test "toLowerString" {
     var buf: [100]u8 = undefined;
     try t.eqSlice(u8, try toLowerString(&buf, "FOO"), "foo");
     try t.eqSlice(u8, try toLowerString(&buf, "FO🐥O"), "fo🐥o");
-}
\ No newline at end of file
+}
+
+/// Returns the index of the first non ASCII byte at or after start, or str.len if the rest is ASCII.
+/// Scans 16 bytes at a time so runs of ASCII text can skip UTF-8 decoding.
+pub fn indexOfNonAscii(str: []const u8, start: usize) usize {
+    const VecLen = 16;
+    var i = start;
+    while (i + VecLen <= str.len) : (i += VecLen) {
+        const chunk: @Vector(VecLen, u8) = str[i..][0..VecLen].*;
+        if (@reduce(.Or, chunk >= @splat(VecLen, @as(u8, 0x80)))) {
+            break;
+        }
+    }
+    while (i < str.len) : (i += 1) {
+        if (str[i] >= 0x80) {
+            return i;
+        }
+    }
+    return str.len;
+}
+
+test "indexOfNonAscii" {
+    try t.eq(indexOfNonAscii("", 0), 0);
+    try t.eq(indexOfNonAscii("foo", 0), 3);
+    try t.eq(indexOfNonAscii("fo🐥o", 0), 2);
+    try t.eq(indexOfNonAscii("the quick brown fox jumps over🐥", 0), 30);
+    // Continuation bytes are also non ASCII.
+    try t.eq(indexOfNonAscii("the quick brown fox jumps over🐥", 31), 31);
+    try t.eq(indexOfNonAscii("🐥 the quick brown fox jumps over", 4), 35);
+}
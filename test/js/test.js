@@ -597,4 +597,31 @@ test('Random', () => {
         const n = r.next()
         assert(n >= 0 && n < 1)
     }
-})
\ No newline at end of file
+})
+test('cs.graphics.createRenderTarget', () => {
+    const rt = cs.graphics.createRenderTarget(8, 4)
+    eq(rt.getWidth(), 8)
+    eq(rt.getHeight(), 4)
+    rt.clear(cs.graphics.Color.white)
+    rt.fillColor(cs.graphics.Color.black)
+    rt.rect(0, 0, 2, 2)
+    const pixels = rt.readPixels()
+    eq(pixels.length, 8 * 4 * 4)
+    eq(Array.from(pixels.slice(0, 4)), [0, 0, 0, 255])
+    eq(Array.from(pixels.slice(8 * 3 * 4, 8 * 3 * 4 + 4)), [255, 255, 255, 255])
+    throws(() => cs.graphics.createRenderTarget(0, 4))
+})
+
+testIsolated('RenderTarget.encodePngAsync', async () => {
+    const targets = [1, 2, 3].map(i => {
+        const rt = cs.graphics.createRenderTarget(16 * i, 16)
+        rt.clear(cs.graphics.Color.blue)
+        rt.text(0, 0, 'abc')
+        return rt
+    })
+    const pngs = await Promise.all(targets.map(rt => rt.encodePngAsync()))
+    for (const png of pngs) {
+        // PNG signature.
+        eq(Array.from(png.slice(0, 8)), [137, 80, 78, 71, 13, 10, 26, 10])
+    }
+})
@@ -9,6 +9,7 @@ test {
     const stdx = @import("../stdx/stdx.zig");
     t.refAllDecls(stdx);
     t.refAllDecls(stdx.ds);
+    t.refAllDecls(stdx.textbuf);
 
     const parser = @import("../parser/parser.zig");
     t.refAllDecls(parser);
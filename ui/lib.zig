@@ -3,6 +3,7 @@ const std = @import("std");
 const platform = @import("../platform/lib.zig");
 const stdx = @import("../stdx/lib.zig");
 const graphics = @import("../graphics/lib.zig");
+const parser = @import("../parser/lib.zig");
 
 const sdl = @import("../lib/sdl/lib.zig");
 const gl = @import("../lib/gl/lib.zig");
@@ -43,7 +44,9 @@ pub fn addPackage(step: *std.build.LibExeObjStep, opts: Options) void {
     };
     const graphics_pkg = graphics.getPackage(b, graphics_opts);
 
-    new_pkg.dependencies = &.{ stdx.pkg, graphics_pkg, platform_pkg };
+    const parser_pkg = parser.getPackage(b);
+
+    new_pkg.dependencies = &.{ stdx.pkg, graphics_pkg, platform_pkg, parser_pkg };
     step.addPackage(new_pkg);
 
     if (opts.add_dep_pkgs) {
@@ -7,6 +7,7 @@ const Duration = stdx.time.Duration;
 const platform = @import("platform");
 const KeyDownEvent = platform.KeyDownEvent;
 const graphics = @import("graphics");
+const parser = @import("parser");
 const FontGroupId = graphics.FontGroupId;
 const Color = graphics.Color;
 
@@ -27,10 +28,37 @@ pub const TextArea = struct {
         text_color: Color = Color.Black,
         bg_color: Color = Color.White,
         onBlur: stdx.Function(fn () void) = .{},
+        /// Wraps lines at the view width instead of scrolling horizontally.
+        wordWrap: bool = false,
     },
 
     lines: std.ArrayList(Line),
 
+    /// Number of wrapped rows of each line. Used to map between y positions and lines in O(log n).
+    /// Inserting or removing a line rebuilds the tree in O(n), so splitting and joining lines with Enter,
+    /// Backspace and Delete is linear in the number of lines. Pasted lines are inserted with one rebuild.
+    line_rows: stdx.ds.FenwickTree(u32),
+
+    /// Lines are only measured when they're visible. Incrementing this marks every line for measuring.
+    measure_gen: u32,
+
+    /// Max width of the lines. Only exact when word wrap is off since it's only needed for horizontal scrolling.
+    max_line_width: f32,
+    max_line_width_dirty: bool,
+
+    /// Set when lines outside the view may need measuring. Without word wrap, every line is measured
+    /// during the next layout so max_line_width covers lines that haven't been scrolled into view.
+    measure_all_lines: bool,
+
+    /// 0 if word wrap is off.
+    wrap_width: f32,
+
+    /// Set with setGrammar.
+    highlighter: ?Highlighter,
+
+    /// Lines are only tokenized when they're visible. Incrementing this marks every line for highlighting.
+    highlight_gen: u32,
+
     caret_line: u32,
     caret_col: u32,
     inner: ui.WidgetRef(TextAreaInner),
@@ -52,6 +80,14 @@ pub const TextArea = struct {
 
         self.font_gid = c.getFontGroupByFamily(self.props.fontFamily);
         self.lines = std.ArrayList(Line).init(c.alloc);
+        self.line_rows = stdx.ds.FenwickTree(u32).init(c.alloc);
+        self.measure_gen = 1;
+        self.max_line_width = 0;
+        self.max_line_width_dirty = false;
+        self.measure_all_lines = true;
+        self.wrap_width = 0;
+        self.highlighter = null;
+        self.highlight_gen = 1;
         self.caret_line = 0;
         self.caret_col = 0;
         self.inner = .{};
@@ -70,12 +106,17 @@ pub const TextArea = struct {
             line.deinit();
         }
         self.lines.deinit();
+        self.line_rows.deinit();
+        if (self.highlighter) |*h| {
+            h.deinit(self.alloc);
+        }
     }
 
     pub fn build(self: *TextArea, c: *ui.BuildContext) ui.FrameId {
         return u.ScrollView(.{
             .bind = &self.scroll_view,
             .bg_color = self.props.bg_color,
+            .enable_hscroll = !self.props.wordWrap,
             .onContentMouseDown = c.funcExt(self, onMouseDown) },
             c.build(TextAreaInner, .{
                 .bind = &self.inner,
@@ -119,15 +160,17 @@ pub const TextArea = struct {
         while (iter.next()) |it| {
             var line = Line.init(self.alloc);
             _ = line.buf.appendSubStr(it) catch fatal();
-            line.needs_measure = true;
             self.lines.append(line) catch fatal();
+            self.line_rows.append(1);
         }
 
         // Ensure at least one line.
         if (self.lines.items.len == 0) {
             const line = Line.init(self.alloc);
             self.lines.append(line) catch unreachable;
+            self.line_rows.append(1);
         }
+        self.measure_all_lines = true;
     }
 
     pub fn allocText(self: TextArea, alloc: std.mem.Allocator) ![]const u8 {
@@ -145,6 +188,36 @@ pub const TextArea = struct {
             line.deinit();
         }
         self.lines.clearRetainingCapacity();
+        self.line_rows.clearRetainingCapacity();
+        self.max_line_width = 0;
+    }
+
+    /// Colors the tokens named in colors. Other tokens and the text between tokens use text_color.
+    /// Each line is tokenized by itself so the grammar's tokens can't span multiple lines.
+    /// The grammar must outlive the TextArea.
+    pub fn setGrammar(self: *TextArea, grammar: ?*parser.Grammar, colors: []const TokenColor) void {
+        if (self.highlighter) |*h| {
+            h.deinit(self.alloc);
+            self.highlighter = null;
+        }
+        if (grammar) |g| {
+            var h = Highlighter{
+                .tokenizer = parser.Tokenizer.init(g),
+                .tag_colors = .{},
+                .token_buf = std.ArrayList(parser.Token).init(self.alloc),
+            };
+            h.tag_colors.appendNTimes(self.alloc, null, g.token_decls.items.len) catch fatal();
+            for (h.tag_colors.items) |*tag_color, tag| {
+                const name = g.getTokenName(@intCast(parser.TokenTag, tag));
+                for (colors) |color| {
+                    if (std.mem.eql(u8, name, color.token)) {
+                        tag_color.* = color.color;
+                    }
+                }
+            }
+            self.highlighter = h;
+        }
+        self.highlight_gen += 1;
     }
 
     /// Request focus on the TextArea.
@@ -172,17 +245,21 @@ pub const TextArea = struct {
         self.postLineUpdate(self.caret_line);
         self.caret_col += num_new_chars;
 
+        // Insert the new lines together so existing lines and the row counts are only shifted once.
+        var new_lines = std.ArrayList(Line).init(self.alloc);
+        defer new_lines.deinit();
         while (iter.next()) |line| {
-            self.caret_line += 1;
-
-            // Insert a new line.
             var new_line = Line.init(self.alloc);
             num_new_chars = new_line.buf.appendSubStr(line) catch fatal();
-            self.lines.insert(self.caret_line, new_line) catch fatal();
-            self.postLineUpdate(self.caret_line);
-
+            new_lines.append(new_line) catch fatal();
             self.caret_col = num_new_chars;
         }
+        if (new_lines.items.len > 0) {
+            self.lines.insertSlice(self.caret_line + 1, new_lines.items) catch fatal();
+            self.line_rows.insertNTimes(self.caret_line + 1, 1, @intCast(u32, new_lines.items.len));
+            self.measure_all_lines = true;
+            self.caret_line += @intCast(u32, new_lines.items.len);
+        }
 
         self.postCaretUpdate();
         self.postCaretActivity();
@@ -210,40 +287,32 @@ pub const TextArea = struct {
                 .col_idx = 0,
             };
         }
-        const line_idx = @floatToInt(u32, y / @intToFloat(f32, self.font_line_height));
-        if (line_idx >= self.lines.items.len) {
+        const row = @floatToInt(u32, y / @intToFloat(f32, self.font_line_height));
+        if (row >= self.line_rows.total()) {
             return .{
                 .line_idx = @intCast(u32, self.lines.items.len - 1),
                 .col_idx = @intCast(u32, self.lines.items[self.lines.items.len-1].buf.num_chars),
             };
         }
-
-        var iter = ctx.textGlyphIter(self.font_gid, self.font_size, self.lines.items[line_idx].buf.buf.items);
-        if (iter.nextCodepoint()) {
-            if (x < iter.state.advance_width/2) {
-                return .{
-                    .line_idx = line_idx,
-                    .col_idx = 0,
-                };
-            }
-        } else {
-            return .{
-                .line_idx = line_idx,
-                .col_idx = 0,
-            };
-        }
-        var cur_x: f32 = iter.state.advance_width;
-        var col: u32 = 1;
+        const line_idx = self.line_rows.findIndex(row);
+        const line = self.lines.items[line_idx];
+        const line_row = row - self.line_rows.prefixSum(line_idx);
+        const start_col = line.getRowStart(line_row);
+
+        var iter = ctx.textGlyphIter(self.font_gid, self.font_size, line.getRowStr(line_row));
+        var cur_x: f32 = 0;
+        var col: u32 = start_col;
         while (iter.nextCodepoint()) {
-            if (x < cur_x + iter.state.advance_width/2) {
+            cur_x = @round(cur_x + iter.state.kern);
+            if (iter.state.getCaretCharOffset(x - cur_x)) |offset| {
                 return .{
                     .line_idx = line_idx,
-                    .col_idx = col,
+                    .col_idx = col + offset,
                 };
             }
-            cur_x = @round(cur_x + iter.state.kern);
             cur_x += iter.state.advance_width;
-            col += 1;
+            // Ligatures cover several chars.
+            col += iter.state.num_chars;
         }
         return .{
             .line_idx = line_idx,
@@ -251,6 +320,7 @@ pub const TextArea = struct {
         };
     }
 
+    /// Lines are remeasured when they're visible.
     fn remeasureText(self: *TextArea) void {
         const font_vmetrics = self.ctx.getPrimaryFontVMetrics(self.font_gid, self.font_size);
         // log.warn("METRICS {}", .{font_vmetrics});
@@ -263,29 +333,189 @@ pub const TextArea = struct {
         self.font_line_height = @floatToInt(u32, font_line_height);
         self.font_line_offset_y = font_line_offset_y;
 
-        for (self.lines.items) |*line| {
-            line.width = self.ctx.measureText(self.font_gid, self.font_size, line.buf.buf.items).width;
-            line.needs_measure = false;
-        }
+        self.measure_gen += 1;
+        self.measure_all_lines = true;
+        self.max_line_width = 0;
+        // Span positions depend on the font.
+        self.highlight_gen += 1;
 
         if (self.inner.binded) {
-            const widget = self.inner.getWidget();
-            widget.to_caret_width = self.ctx.measureText(self.font_gid, self.font_size, widget.to_caret_str).width;
-            widget.to_caret_needs_measure = false;
+            self.inner.getWidget().to_caret_needs_measure = true;
+        }
+    }
+
+    fn measureLine(self: *TextArea, idx: u32) void {
+        const line = &self.lines.items[idx];
+        if (line.measure_gen == self.measure_gen) {
+            return;
+        }
+        line.measure_gen = self.measure_gen;
+
+        const old_width = line.width;
+        line.width = self.ctx.measureText(self.font_gid, self.font_size, line.buf.buf.items).width;
+        if (line.width > self.max_line_width) {
+            self.max_line_width = line.width;
+        } else if (old_width == self.max_line_width and line.width < old_width) {
+            // The widest line got shorter.
+            self.max_line_width_dirty = true;
+        }
+
+        line.row_starts.clearRetainingCapacity();
+        if (self.wrap_width > 0 and line.width > self.wrap_width) {
+            self.wrapLine(line);
+        }
+        self.line_rows.set(idx, @intCast(u32, line.row_starts.items.len) + 1);
+        // Spans are split at the rows.
+        line.highlight_gen = 0;
+    }
+
+    /// Tokenizes the line buffer in place and converts the colored tokens to spans.
+    /// Should be called after the line is measured.
+    fn highlightLine(self: *TextArea, idx: u32) void {
+        if (self.highlighter == null) {
+            return;
+        }
+        const h = &self.highlighter.?;
+        const line = &self.lines.items[idx];
+        if (line.highlight_gen == self.highlight_gen) {
+            return;
+        }
+        line.highlight_gen = self.highlight_gen;
+        line.spans.clearRetainingCapacity();
+
+        const text = line.buf.buf.items;
+        h.token_buf.clearRetainingCapacity();
+        h.tokenizer.tokenizeLine(text, &h.token_buf);
+
+        var builder = SpanBuilder{
+            .editor = self,
+            .line = line,
+            .row = 0,
+            .row_end = line.getRowBufEnd(0),
+            .x = 0,
+        };
+        // Uncolored tokens are merged with the text around them.
+        var pos: u32 = 0;
+        for (h.token_buf.items) |token| {
+            const color = h.tag_colors.items[token.tag] orelse continue;
+            if (token.loc.start < pos or token.loc.end <= token.loc.start) {
+                continue;
+            }
+            builder.append(pos, token.loc.start, null);
+            builder.append(token.loc.start, token.loc.end, color);
+            pos = token.loc.end;
+        }
+        builder.append(pos, @intCast(u32, text.len), null);
+    }
+
+    const SpanBuilder = struct {
+        editor: *TextArea,
+        line: *Line,
+        row: u32,
+        row_end: u32,
+        x: f32,
+
+        /// Splits the range at row ends.
+        fn append(self: *SpanBuilder, start: u32, end: u32, color: ?Color) void {
+            const text = self.line.buf.buf.items;
+            var cur = start;
+            while (cur < end) {
+                while (cur >= self.row_end) {
+                    self.row += 1;
+                    self.row_end = self.line.getRowBufEnd(self.row);
+                    self.x = 0;
+                }
+                const span_end = std.math.min(end, self.row_end);
+                self.line.spans.append(self.editor.alloc, .{
+                    .start = cur,
+                    .end = span_end,
+                    .row = self.row,
+                    .x = self.x,
+                    .color = color,
+                }) catch fatal();
+                self.x += self.editor.ctx.measureText(self.editor.font_gid, self.editor.font_size, text[cur..span_end]).width;
+                cur = span_end;
+            }
+        }
+    };
+
+    /// Breaks after the last space that fits in the row, or at the glyph that overflows.
+    fn wrapLine(self: *TextArea, line: *Line) void {
+        var iter = self.ctx.textGlyphIter(self.font_gid, self.font_size, line.buf.buf.items);
+        var x: f32 = 0;
+        var row_start: u32 = 0;
+        var col: u32 = 0;
+        var break_col: ?u32 = null;
+        var break_x: f32 = 0;
+        // Ligatures advance col by all of their chars and are never split across rows.
+        while (iter.nextCodepoint()) : (col += iter.state.num_chars) {
+            x += iter.state.kern + iter.state.advance_width;
+            if (x > self.wrap_width and col > row_start and iter.state.num_chars > 0) {
+                if (break_col) |bc| {
+                    row_start = bc;
+                    x -= break_x;
+                } else {
+                    row_start = col;
+                    x = iter.state.advance_width;
+                }
+                line.row_starts.append(self.alloc, row_start) catch fatal();
+                break_col = null;
+            }
+            if (iter.state.cp == ' ') {
+                break_col = col + iter.state.num_chars;
+                break_x = x;
+            }
         }
     }
 
+    fn recomputeMaxLineWidth(self: *TextArea) void {
+        self.max_line_width = 0;
+        for (self.lines.items) |line| {
+            if (line.width > self.max_line_width) {
+                self.max_line_width = line.width;
+            }
+        }
+        self.max_line_width_dirty = false;
+    }
+
+    /// Lines that intersect the scroll view.
+    fn getVisibleLineRange(self: *TextArea) stdx.IndexSlice(u32) {
+        const line_height = @intToFloat(f32, self.font_line_height);
+        const scroll_y = self.scroll_view.getWidget().scroll_y;
+        const start_row = @floatToInt(u32, std.math.max(0, @floor(scroll_y / line_height)));
+        const end_row = @floatToInt(u32, std.math.max(0, @ceil((scroll_y + self.scroll_view.getHeight()) / line_height)));
+        const num_lines = @intCast(u32, self.lines.items.len);
+        return .{
+            .start = std.math.min(self.line_rows.findIndex(start_row), num_lines),
+            .end = std.math.min(self.line_rows.findIndex(end_row) + 1, num_lines),
+        };
+    }
+
+    /// The wrapped row of the caret in the caret line.
+    fn getCaretRow(self: *TextArea) u32 {
+        const line = self.lines.items[self.caret_line];
+        var row: u32 = 0;
+        for (line.row_starts.items) |start| {
+            if (self.caret_col < start) {
+                break;
+            }
+            row += 1;
+        }
+        return row;
+    }
+
     pub fn setFontSize(self: *TextArea, font_size: f32) void {
         self.font_size = font_size;
         self.remeasureText();
     }
 
     fn getCaretBottomY(self: *TextArea) f32 {
-        return @intToFloat(f32, self.caret_line + 1) * @intToFloat(f32, self.font_line_height);
+        return self.getCaretTopY() + @intToFloat(f32, self.font_line_height);
     }
 
     fn getCaretTopY(self: *TextArea) f32 {
-        return @intToFloat(f32, self.caret_line) * @intToFloat(f32, self.font_line_height);
+        const row = self.line_rows.prefixSum(self.caret_line) + self.getCaretRow();
+        return @intToFloat(f32, row) * @intToFloat(f32, self.font_line_height);
     }
 
     fn getCaretX(self: *TextArea) f32 {
@@ -294,7 +524,8 @@ pub const TextArea = struct {
 
     fn postLineUpdate(self: *TextArea, idx: usize) void {
         const line = &self.lines.items[idx];
-        line.needs_measure = true;
+        line.measure_gen = 0;
+        line.highlight_gen = 0;
     }
 
     /// After something was done at the caret position.
@@ -362,6 +593,7 @@ pub const TextArea = struct {
                 _ = prev_line.buf.appendSubStr(line.buf.buf.items) catch @panic("error");
                 line.deinit();
                 _ = self.lines.orderedRemove(self.caret_line);
+                self.line_rows.orderedRemove(self.caret_line);
                 self.postLineUpdate(self.caret_line-1);
 
                 self.caret_line -= 1;
@@ -379,6 +611,7 @@ pub const TextArea = struct {
                     _ = line.buf.appendSubStr(self.lines.items[self.caret_line+1].buf.buf.items) catch @panic("error");
                     self.lines.items[self.caret_line+1].deinit();
                     _ = self.lines.orderedRemove(self.caret_line+1);
+                    self.line_rows.orderedRemove(self.caret_line+1);
                     self.postLineUpdate(self.caret_line);
                     self.postCaretActivity();
                 }
@@ -386,6 +619,7 @@ pub const TextArea = struct {
         } else if (val.code == .Enter) {
             const new_line = Line.init(c.alloc);
             self.lines.insert(self.caret_line + 1, new_line) catch unreachable;
+            self.line_rows.insert(self.caret_line + 1, 1);
             // Requery current line since insert could have resized array.
             const cur_line = &self.lines.items[self.caret_line];
             if (self.caret_col < cur_line.buf.num_chars) {
@@ -396,6 +630,8 @@ pub const TextArea = struct {
                 self.postLineUpdate(self.caret_line);
             }
             self.postLineUpdate(self.caret_line + 1);
+            // The split line is no longer the caret line.
+            self.measure_all_lines = true;
 
             self.caret_line += 1;
             self.caret_col = 0;
@@ -468,26 +704,113 @@ pub const TextArea = struct {
     }
 };
 
+pub const TokenColor = struct {
+    /// Token name in the grammar.
+    token: []const u8,
+    color: Color,
+};
+
+/// Colors for the token names in parser.grammars.ZigGrammar.
+pub const ZigTokenColors = [_]TokenColor{
+    .{ .token = "Keyword", .color = Color.init(175, 0, 219, 255) },
+    .{ .token = "Comment", .color = Color.init(0, 128, 0, 255) },
+    .{ .token = "StringLiteral", .color = Color.init(163, 21, 21, 255) },
+    .{ .token = "CharLiteral", .color = Color.init(163, 21, 21, 255) },
+    .{ .token = "LineString", .color = Color.init(163, 21, 21, 255) },
+    .{ .token = "DecLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "HexLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "OctLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "BinLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "DecFloatLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "HexFloatLiteral", .color = Color.init(9, 134, 88, 255) },
+    .{ .token = "AtIdentifier", .color = Color.init(38, 127, 153, 255) },
+};
+
+const Highlighter = struct {
+    tokenizer: parser.Tokenizer,
+
+    /// Indexed by token tag.
+    tag_colors: std.ArrayListUnmanaged(?Color),
+
+    /// Reused for each line.
+    token_buf: std.ArrayList(parser.Token),
+
+    fn deinit(self: *Highlighter, alloc: std.mem.Allocator) void {
+        self.tag_colors.deinit(alloc);
+        self.token_buf.deinit();
+    }
+};
+
+/// A run of text in one color that doesn't cross a wrapped row.
+const HighlightSpan = struct {
+    /// Byte offsets into the line buffer.
+    start: u32,
+    end: u32,
+    row: u32,
+    /// Offset from the start of the row.
+    x: f32,
+    /// Null uses text_color.
+    color: ?Color,
+};
+
 const Line = struct {
     buf: stdx.textbuf.TextBuffer,
 
     /// Computed width.
     width: f32,
 
-    /// Whether this line should be measured during layout.
-    needs_measure: bool,
+    /// The line is measured during layout if this doesn't match TextArea.measure_gen.
+    measure_gen: u32,
+
+    /// Char indexes where wrapped rows start after the first row.
+    row_starts: std.ArrayListUnmanaged(u32),
+
+    /// Colored runs covering the line. Only valid if highlight_gen matches TextArea.highlight_gen.
+    spans: std.ArrayListUnmanaged(HighlightSpan),
+
+    /// The line is tokenized during layout if this doesn't match TextArea.highlight_gen.
+    highlight_gen: u32,
 
     fn init(alloc: std.mem.Allocator) Line {
         return .{
             .buf = stdx.textbuf.TextBuffer.init(alloc, "") catch @panic("error"),
-            .needs_measure = false,
+            .measure_gen = 0,
             .width = 0,
+            .row_starts = .{},
+            .spans = .{},
+            .highlight_gen = 0,
         };
     }
 
     fn deinit(self: Line) void {
+        var row_starts = self.row_starts;
+        row_starts.deinit(self.buf.buf.allocator);
+        var spans = self.spans;
+        spans.deinit(self.buf.buf.allocator);
         self.buf.deinit();
     }
+
+    fn getRowStart(self: Line, row: u32) u32 {
+        if (row == 0) {
+            return 0;
+        }
+        // Row starts are stale until an edited line is measured again.
+        return std.math.min(self.row_starts.items[row - 1], self.buf.num_chars);
+    }
+
+    fn getRowStr(self: Line, row: u32) []const u8 {
+        const start = self.getRowStart(row);
+        const end = if (row < self.row_starts.items.len) std.math.min(self.row_starts.items[row], self.buf.num_chars) else self.buf.num_chars;
+        return self.buf.getSubStr(start, end);
+    }
+
+    /// Byte offset after the last char of the row.
+    fn getRowBufEnd(self: Line, row: u32) u32 {
+        if (row < self.row_starts.items.len) {
+            return self.buf.getBufferIdx(self.row_starts.items[row]);
+        }
+        return @intCast(u32, self.buf.buf.items.len);
+    }
 };
 
 pub const TextAreaInner = struct {
@@ -528,9 +851,8 @@ pub const TextAreaInner = struct {
         self.ctx.resetInterval(self.caret_anim_id);
     }
 
+    /// The caret's row depends on the line being measured so the string to the caret is updated during layout.
     fn postCaretUpdate(self: *TextAreaInner) void {
-        const line = self.editor.lines.items[self.editor.caret_line];
-        self.to_caret_str = line.buf.getSubStr(0, self.editor.caret_col);
         self.to_caret_needs_measure = true;
     }
 
@@ -545,25 +867,47 @@ pub const TextAreaInner = struct {
         return ui.NullFrameId;
     }
 
+    /// With word wrap, only the visible lines and the caret line are measured. Other lines keep their last row count
+    /// (one row if they were never measured) until they're scrolled into view.
+    /// Without word wrap, every line is one row but all lines are measured after a bulk change so the width is exact.
     pub fn layout(self: *TextAreaInner, ctx: *ui.LayoutContext) ui.LayoutSize {
-        var height: f32 = 0;
-        var max_width: f32 = 0;
-        for (self.editor.lines.items) |*it| {
-            if (it.needs_measure) {
-                it.width = ctx.measureText(self.editor.font_gid, self.editor.font_size, it.buf.buf.items).width;
-                it.needs_measure = false;
-            }
-            const width = it.width;
-            if (width > max_width) {
-                max_width = width;
+        const editor = self.editor;
+        const wrap_width = if (editor.props.wordWrap) ctx.getSizeConstraints().max_width else 0;
+        if (wrap_width != editor.wrap_width) {
+            editor.wrap_width = wrap_width;
+            editor.measure_gen += 1;
+            editor.measure_all_lines = true;
+            self.to_caret_needs_measure = true;
+        }
+        if (wrap_width == 0 and editor.measure_all_lines) {
+            // Lines that were already measured are skipped.
+            var line_idx: u32 = 0;
+            while (line_idx < editor.lines.items.len) : (line_idx += 1) {
+                editor.measureLine(line_idx);
             }
-            height += @intToFloat(f32, self.editor.font_line_height);
+            editor.measure_all_lines = false;
+        }
+
+        const range = editor.getVisibleLineRange();
+        var i = range.start;
+        while (i < range.end) : (i += 1) {
+            editor.measureLine(i);
+            editor.highlightLine(i);
         }
+        editor.measureLine(editor.caret_line);
+        if (editor.max_line_width_dirty) {
+            editor.recomputeMaxLineWidth();
+        }
+
         if (self.to_caret_needs_measure) {
-            self.to_caret_width = ctx.measureText(self.editor.font_gid, self.editor.font_size, self.to_caret_str).width;
+            const line = editor.lines.items[editor.caret_line];
+            self.to_caret_str = line.buf.getSubStr(line.getRowStart(editor.getCaretRow()), editor.caret_col);
+            self.to_caret_width = ctx.measureText(editor.font_gid, editor.font_size, self.to_caret_str).width;
             self.to_caret_needs_measure = false;
         }
-        return ui.LayoutSize.init(max_width, height);
+        const width = if (editor.props.wordWrap) wrap_width else editor.max_line_width;
+        const height = @intToFloat(f32, editor.line_rows.total() * editor.font_line_height);
+        return ui.LayoutSize.init(width, height);
     }
 
     pub fn render(self: *TextAreaInner, c: *ui.RenderContext) void {
@@ -576,16 +920,27 @@ pub const TextAreaInner = struct {
 
         g.setFontGroup(editor.font_gid, editor.font_size);
         g.setFillColor(self.editor.props.text_color);
-        // TODO: Use binary search when word wrap is enabled and we can't determine the first visible line with O(1)
-        const scroll_view = editor.scroll_view.getWidget();
-        const visible_start_idx = std.math.max(0, @floatToInt(i32, @floor(scroll_view.scroll_y / line_height)));
-        const visible_end_idx = std.math.min(editor.lines.items.len, @floatToInt(i32, @ceil((scroll_view.scroll_y + editor.scroll_view.getHeight()) / line_height)));
-        // log.warn("{} {}", .{visible_start_idx, visible_end_idx});
+        const range = editor.getVisibleLineRange();
+        // log.warn("{} {}", .{range.start, range.end});
         const line_offset_y = editor.font_line_offset_y;
-        var i: usize = @intCast(usize, visible_start_idx);
-        while (i < visible_end_idx) : (i += 1) {
+        var row = editor.line_rows.prefixSum(range.start);
+        var i = range.start;
+        while (i < range.end) : (i += 1) {
             const line = editor.lines.items[i];
-            g.fillText(bounds.min_x, bounds.min_y + line_offset_y + @intToFloat(f32, i) * line_height, line.buf.buf.items);
+            if (editor.highlighter != null and line.highlight_gen == editor.highlight_gen) {
+                for (line.spans.items) |span| {
+                    g.setFillColor(span.color orelse editor.props.text_color);
+                    g.fillText(bounds.min_x + span.x, bounds.min_y + line_offset_y + @intToFloat(f32, row + span.row) * line_height, line.buf.buf.items[span.start..span.end]);
+                }
+                g.setFillColor(self.editor.props.text_color);
+                row += editor.line_rows.get(i);
+                continue;
+            }
+            var line_row: u32 = 0;
+            while (line_row < editor.line_rows.get(i)) : (line_row += 1) {
+                g.fillText(bounds.min_x, bounds.min_y + line_offset_y + @intToFloat(f32, row) * line_height, line.getRowStr(line_row));
+                row += 1;
+            }
         }
 
         if (self.focused) {
@@ -594,7 +949,7 @@ pub const TextAreaInner = struct {
                 g.setFillColor(self.editor.props.text_color);
                 // log.warn("width {d:2}", .{width});
                 const height = self.editor.font_vmetrics.height;
-                g.fillRect(@round(bounds.min_x + self.to_caret_width), bounds.min_y + line_offset_y + @intToFloat(f32, self.editor.caret_line) * line_height, 1, height);
+                g.fillRect(@round(bounds.min_x + self.to_caret_width), bounds.min_y + line_offset_y + self.editor.getCaretTopY(), 1, height);
             }
         }
     }
@@ -127,22 +127,16 @@ pub const TextField = struct {
     fn getCaretIdx(self: *TextField, ctx: *ui.CommonContext, x: f32) u32 {
         const font_gid = ctx.getFontGroupForSingleFontOrDefault(self.props.font_id);
         var iter = ctx.textGlyphIter(font_gid, self.props.font_size, self.buf.buf.items);
-        if (iter.nextCodepoint()) {
-            if (x < iter.state.advance_width/2) {
-                return 0;
-            }
-        } else {
-            return 0;
-        }
-        var char_idx: u32 = 1;
-        var cur_x: f32 = iter.state.advance_width;
+        var char_idx: u32 = 0;
+        var cur_x: f32 = 0;
         while (iter.nextCodepoint()) {
-            if (x < cur_x + iter.state.advance_width/2) {
-                return char_idx;
-            }
             cur_x = @round(cur_x + iter.state.kern);
+            if (iter.state.getCaretCharOffset(x - cur_x)) |offset| {
+                return char_idx + offset;
+            }
             cur_x += iter.state.advance_width;
-            char_idx += 1;
+            // Ligatures cover several chars.
+            char_idx += iter.state.num_chars;
         }
         return char_idx;
     }